@@ -8,19 +8,43 @@ const AboutButton = document.getElementById('about');
 const AboutContent = document.getElementById('about-content');
 
 const LastStatusTime = document.getElementById('last-updated');
+const HistoryChart = document.getElementById('history-chart');
 
 var lastState;
 var lastProfile; // this is to check if the profile was modified, aka unsaved changes
 
+// The segments of the profile come from GET /config, fetched again whenever
+// the status reports a new config version.
+var profileSegments = [];
+var configVersion = null;
+var lastGains = null; // PID values of the last config version
+const SegmentTypes = ['ramp', 'hold', 'until'];
+const SegmentPhases = ['none', 'preheat', 'soak', 'reflow', 'cooldown'];
+const PhaseNames = {none: 'Running', preheat: 'Preheating', soak: 'Soaking', reflow: 'Reflowing', cooldown: 'Cooling down'};
+
 // Add event listeners to the buttons
 MonitorButton.addEventListener('click', () => showContent('monitor'));
 SettingsButton.addEventListener('click', () => showContent('settings'));
 AboutButton.addEventListener('click', () => showContent('about'));
 
+var pollTimer = null; // only runs while the event stream is down
+
+// The chart of the run: the oven downsamples the recorded run to one point per
+// chart pixel, after that only the samples since the last point are fetched.
+var historyRun = null;
+var historyPoints = []; // [seconds, temperature, setpoint, output]
+var historyWasRunning = false;
+setInterval(() => {
+    if (!lastState) return;
+    if (lastState.start || historyWasRunning) loadHistory(); // once more after the run ends
+    historyWasRunning = lastState.start;
+}, 2000);
+
 init();
 
-// Set up a timer to refresh the monitor data every second
-setInterval(refreshStatus, 500);
+// Live status is pushed by the oven over server-sent events, only the fields
+// that changed. Polling /status is the fallback when the stream is unavailable.
+startEvents();
 
 function init() {
     // Show the monitor content by default
@@ -31,6 +55,69 @@ function init() {
 
     // Fetch initial data for the monitor
     refreshStatus(true);
+    loadHistory();
+}
+
+function loadHistory(){
+    const last = historyPoints.length ? historyPoints[historyPoints.length - 1][0] : null;
+    const from = last === null ? '' : `&from=${(last + 0.1).toFixed(1)}`;
+
+    fetch(`/history?points=${HistoryChart.width}${from}`)
+        .then(response => response.json())
+        .then(data => {
+            if (data.run !== historyRun) {
+                historyRun = data.run;
+                historyPoints = [];
+                if (last !== null) return loadHistory(); // a new run, fetch it whole
+            }
+            historyPoints = historyPoints.concat(data.points);
+            // appended samples are not downsampled, start over when there are too many
+            if (historyPoints.length > 2 * HistoryChart.width) {
+                historyPoints = [];
+                return loadHistory();
+            }
+            drawHistory();
+        })
+        .catch(error => {
+            console.error('Error loading history:', error);
+        });
+}
+
+function drawHistory(){
+    const ctx = HistoryChart.getContext('2d');
+    const width = HistoryChart.width, height = HistoryChart.height, margin = 30;
+    ctx.clearRect(0, 0, width, height);
+
+    const duration = Math.max(60, ...historyPoints.map(p => p[0]));
+    const top = Math.max(250, ...historyPoints.map(p => Math.max(p[1], p[2]) + 10));
+    const x = seconds => margin + seconds / duration * (width - 2 * margin);
+    const y = temperature => height - margin - temperature / top * (height - 2 * margin);
+
+    // grid every 50 °C and every minute
+    ctx.strokeStyle = '#333333';
+    ctx.fillStyle = '#aaaaaa';
+    ctx.font = '10px Arial';
+    ctx.beginPath();
+    for (let t = 0; t <= top; t += 50) {
+        ctx.moveTo(margin, y(t));
+        ctx.lineTo(width - margin, y(t));
+        ctx.fillText(`${t}`, 2, y(t) + 3);
+    }
+    for (let s = 0; s <= duration; s += 60) {
+        ctx.moveTo(x(s), margin);
+        ctx.lineTo(x(s), height - margin);
+        ctx.fillText(`${s / 60}m`, x(s) - 6, height - margin + 12);
+    }
+    ctx.stroke();
+
+    const line = (index, color) => {
+        ctx.strokeStyle = color;
+        ctx.beginPath();
+        historyPoints.forEach((p, i) => i ? ctx.lineTo(x(p[0]), y(p[index])) : ctx.moveTo(x(p[0]), y(p[index])));
+        ctx.stroke();
+    };
+    line(2, '#ffcd00'); // setpoint
+    line(1, '#ff4040'); // temperature
 }
 
 function updateProfiles(){
@@ -42,8 +129,8 @@ function updateProfiles(){
             profileSelect.innerHTML = data; // Clear existing options
             data.forEach(profile => {
                 const option = document.createElement('option');
-                option.value = profile;
-                option.textContent = profile;
+                option.value = profile.name;
+                option.textContent = `${profile.name} (${profile.peakTemp} °C, ${profile.segments} segments, ${Math.round(profile.totalTime / 60000)} min)`;
                 profileSelect.appendChild(option);
             });
         })
@@ -77,6 +164,37 @@ function loadProfile(){
 
 }
 
+function startEvents() {
+    if (!window.EventSource) {
+        startPolling();
+        return;
+    }
+
+    const events = new EventSource('/events');
+    events.onmessage = (event) => {
+        // the first event carries every field, later ones only what changed
+        lastState = Object.assign(lastState || {}, JSON.parse(event.data));
+        LastStatusTime.textContent = `${new Date().toLocaleTimeString()}`;
+        displayStatus();
+        stopPolling();
+    };
+    events.onerror = () => {
+        startPolling();
+        // the browser reconnects by itself unless the oven refused the stream
+        if (events.readyState === EventSource.CLOSED) setTimeout(startEvents, 30000);
+    };
+}
+
+function startPolling() {
+    if (pollTimer === null) pollTimer = setInterval(refreshStatus, 500);
+}
+
+function stopPolling() {
+    if (pollTimer === null) return;
+    clearInterval(pollTimer);
+    pollTimer = null;
+}
+
 // Fetch new data from the ESP32
 function refreshStatus(updateProfileValues = false) {
     fetch('/status')
@@ -88,6 +206,7 @@ function refreshStatus(updateProfileValues = false) {
             if (updateProfileValues){
                 lastProfile = lastState.currentProfile;
                 changeValues();
+                loadConfig(true);
             }
         })
         .catch(error => {
@@ -123,11 +242,10 @@ function startReflow(){
 
 
     fetch('/start')
-        .then(response => response.json())
-        .then(data => {
-            console.log('Reflow started:', data);
-            refreshStatus();
-        })
+        .then(response => response.text().then(text => {
+            if (!response.ok) { alert(text); throw new Error(text); }
+            console.log('Reflow started:', text);
+        }))
         .catch(error => {
             console.error('Error starting reflow:', error);
         })
@@ -145,11 +263,10 @@ function stopReflow(){
     }
 
     fetch('/stop')
-        .then(response => response.json())
-        .then(data => {
-            console.log('Reflow stopped:', data);
-            refreshStatus();
-        })
+        .then(response => response.text().then(text => {
+            if (!response.ok) { alert(text); throw new Error(text); }
+            console.log('Reflow stopped:', text);
+        }))
         .catch(error => {
             console.error('Error stopping reflow:', error);
         })
@@ -167,29 +284,15 @@ function displayStatus(){
     const currentProfile = document.getElementById("current-profile");
     currentProfile.innerHTML = `<b>Current Profile: ${lastProfile}</b>`;
 
-    const preheatDetail = document.getElementById("preheat-detail");
-    preheatDetail.innerHTML = 
-    `<b>Preheat</b><br><br>
-    ${lastState.preheatTemp}  °C<br>
-    ${lastState.preheatTime} S`;
-
-    const soakDetail = document.getElementById("soak-detail");
-    soakDetail.innerHTML = 
-    `<b>Soak</b><br><br>
-    ${lastState.soakTemp}  °C<br>
-    ${lastState.soakTime} S`;
-
-    const reflowDetail = document.getElementById("reflow-detail");
-    reflowDetail.innerHTML =
-    `<b>Reflow</b><br><br>
-    ${lastState.reflowTemp} °C<br>
-    ${lastState.reflowTime} S`;
-
-    const cooldownDetail = document.getElementById("cooling-detail");
-    cooldownDetail.innerHTML =
-    `<b>Cooldown</b><br><br>
-    ${lastState.cooldownTemp} °C<br>
-    ${lastState.cooldownTime} S`;
+    if (lastState.config !== configVersion) {
+        configVersion = lastState.config;
+        loadConfig(false);
+        // an autotune or another browser changed the PID values
+        const gains = `${lastState.kp} ${lastState.ki} ${lastState.kd}`;
+        if (lastGains !== null && gains !== lastGains) changeValues();
+        lastGains = gains;
+    }
+    displaySegments();
 
     const tempratureDisplay = document.getElementById('temperature-display');
     tempratureDisplay.innerHTML = `
@@ -205,17 +308,13 @@ function displayStatus(){
     var reflowStatus;
 
     if (lastState.start === false) 
-        reflowStatus = 'Idle';
-    else if (lastState.preheating)
-        reflowStatus = 'Preheating';
-    else if (lastState.soaking)
-        reflowStatus = 'Soaking';
-    else if (lastState.reflowing)
-        reflowStatus = 'Reflowing';
-    else if (lastState.coolingDown)
-        reflowStatus = 'Cooling down';
-    else
-        reflowStatus = 'Error: Unknown state';
+        reflowStatus = lastState.fault ? `Aborted: ${lastState.fault}` : 'Idle';
+    else if (lastState.tuning)
+        reflowStatus = 'Autotuning';
+    else {
+        reflowStatus = `${PhaseNames[lastState.phase] || 'Running'} (segment ${lastState.segment + 1}/${lastState.segments})`;
+        if (lastState.waiting) reflowStatus += `, waiting for ${profileSegments[lastState.segment]?.target} °C`;
+    }
 
 
     statusDisplay.innerHTML = `
@@ -231,72 +330,109 @@ function displayStatus(){
 }
 
 function changeValues(){
-    const preheatTempInput = document.getElementById('preheat-temp');
-    const preheatTimeInput = document.getElementById('preheat-time');
-    const soakTempInput = document.getElementById('soak-temp');
-    const soakTimeInput = document.getElementById('soak-time');
-    const reflowTempInput = document.getElementById('reflow-temp');
-    const reflowTimeInput = document.getElementById('reflow-time');
-    const coolTempInput = document.getElementById('cooling-temp');
-    const coolTimeInput = document.getElementById('cooling-time');
     const kp = document.getElementById('kp');
     const ki = document.getElementById('ki');
     const kd = document.getElementById('kd');
 
-    preheatTempInput.value = parseFloat(lastState.preheatTemp);
-    preheatTimeInput.value = parseInt(lastState.preheatTime);
-    soakTempInput.value = parseFloat(lastState.soakTemp);
-    soakTimeInput.value = parseInt(lastState.soakTime);
-    reflowTempInput.value = parseFloat(lastState.reflowTemp);
-    reflowTimeInput.value = parseInt(lastState.reflowTime);
-    coolTempInput.value = parseFloat(lastState.cooldownTemp);
-    coolTimeInput.value = parseInt(lastState.cooldownTime);
     kp.value = parseFloat(lastState.kp);
     ki.value = parseFloat(lastState.ki);
     kd.value = parseFloat(lastState.kd);
 }
 
-function sendValues(){
-    
-    // send the current settings to the server to save the profile
-    const preheatTemp = parseFloat(document.getElementById('preheat-temp').value);
-    const preheatTime = parseInt(document.getElementById('preheat-time').value);
-    const soakTemp = parseFloat(document.getElementById('soak-temp').value);
-    const soakTime = parseInt(document.getElementById('soak-time').value);
-    const reflowTemp = parseFloat(document.getElementById('reflow-temp').value);
-    const reflowTime = parseInt(document.getElementById('reflow-time').value);
-    const coolTemp = parseFloat(document.getElementById('cooling-temp').value);
-    const coolTime = parseInt(document.getElementById('cooling-time').value);
-
-    if (isNaN(preheatTemp) || isNaN(preheatTime) || isNaN(soakTemp) || isNaN(soakTime) ||
-        isNaN(reflowTemp) || isNaN(reflowTime) || isNaN(coolTemp) || isNaN(coolTime)) {
-        alert('Please enter valid numeric values for all fields.');
+// Fetch the segments of the profile, and put them in the editor when asked to
+function loadConfig(updateEditor){
+    fetch('/config')
+        .then(response => response.json())
+        .then(data => {
+            profileSegments = data.segments;
+            displaySegments();
+            if (updateEditor) fillSegments(profileSegments);
+        })
+        .catch(error => {
+            console.error('Error loading config:', error);
+        });
+}
+
+// One box per segment on the monitor, the running one highlighted
+function displaySegments(){
+    const details = document.getElementById('profile-details');
+    const running = lastState && lastState.start ? lastState.segment : -1;
+    const boxes = profileSegments.map((segment, i) => {
+        const name = segment.phase === 'none' ? `Segment ${i + 1}` : segment.phase;
+        const detail = segment.type === 'hold' ? `${segment.time / 1000} S` :
+                       segment.type === 'ramp' ? `${segment.rate} °C/s` : 'until reached';
+        return `<p class="${i === running ? 'active' : ''}"><b>${name}</b><br><br>${segment.target} °C<br>${detail}</p>`;
+    });
+    const html = boxes.join('<b> > </b>');
+    if (details.innerHTML !== html) details.innerHTML = html;
+}
+
+function fillSegments(segments){
+    document.getElementById('segment-rows').innerHTML = '';
+    segments.forEach(segment => addSegment(segment));
+}
+
+// Adds a row to the segment editor, a copy of the last one when none is given
+function addSegment(segment){
+    const rows = document.getElementById('segment-rows');
+    if (rows.children.length >= 12) {
+        alert('A profile has at most 12 segments.');
         return;
     }
+    segment = segment || readSegments().pop() || {type: 'hold', phase: 'none', target: 100, rate: 0, time: 60000};
+
+    const select = (options, value) =>
+        `<select>${options.map(option => `<option${option === value ? ' selected' : ''}>${option}</option>`).join('')}</select>`;
+    const row = document.createElement('tr');
+    row.innerHTML = `
+        <td>${select(SegmentTypes, segment.type)}</td>
+        <td>${select(SegmentPhases, segment.phase)}</td>
+        <td><input type="number" value="${segment.target}"></td>
+        <td><input type="number" min="0" step="0.1" value="${segment.rate}"></td>
+        <td><input type="number" min="0" value="${segment.time / 1000}"></td>
+        <td><button onclick="this.closest('tr').remove()">Remove</button></td>`;
+    rows.appendChild(row);
+}
 
-    // Prepare the data to be sent
-    const profileData = {
-        preheatTemp: preheatTemp,
-        preheatTime: preheatTime,
-        soakTemp: soakTemp,
-        soakTime: soakTime,
-        reflowTemp: reflowTemp,
-        reflowTime: reflowTime,
-        cooldownTemp: coolTemp,
-        cooldownTime: coolTime
-    };
+// The rows of the segment editor in the format of /config
+function readSegments(){
+    return Array.from(document.getElementById('segment-rows').children).map(row => {
+        const fields = row.querySelectorAll('select, input');
+        return {
+            type: fields[0].value,
+            phase: fields[1].value,
+            target: parseFloat(fields[2].value),
+            rate: parseFloat(fields[3].value) || 0,
+            time: Math.round((parseFloat(fields[4].value) || 0) * 1000)
+        };
+    });
+}
+
+// Sends the segments in the editor, resolves once the oven took them
+function sendValues(confirmation = true){
+    const segments = readSegments();
+    if (!segments.length || segments.some(segment => isNaN(segment.target))) {
+        alert('Please enter a target temperature for every segment.');
+        return Promise.reject();
+    }
 
-    // Send the data to the server
-    fetch('/setvalues', {
+    return fetch('/config', {
         method: 'POST',
         headers: {
             'Content-Type': 'application/json'
         },
-        body: JSON.stringify(profileData)
-    }).then(() => {
-        alert("Set Successfully");
+        body: JSON.stringify({segments: segments})
+    }).then(response => {
+        if (!response.ok) return response.text().then(text => { alert(text); throw new Error(text); });
+        return response.json().then(data => {
+            profileSegments = data.segments;
+            lastProfile = data.profile;
+            displaySegments();
+            if (confirmation) alert("Set Successfully");
+        });
     }).catch(error => {
-        alert(error);
+        console.error('Error sending segments:', error);
+        throw error;
     });
 }
 
@@ -333,6 +469,31 @@ function sendPID(){
     })
 }
 
+function startAutotune(){
+    const setpoint = parseFloat(document.getElementById("autotune-setpoint").value);
+    const rule = document.getElementById("autotune-rule").value;
+
+    if (isNaN(setpoint)){
+        alert("Invalid Values");
+        return;
+    }
+
+    if (!confirm("Start an autotune at " + setpoint + " °C? The PID values are replaced when it is done"))
+        return;
+
+    fetch('/autotune', {
+        method: 'POST',
+        headers:{
+            'Content-Type': 'application/json'
+        },
+        body: JSON.stringify({setpoint: setpoint, rule: rule})
+    }).then(response => {
+        if (!response.ok) return response.text().then(text => { throw text; });
+    }).catch(error =>{
+        alert(error);
+    })
+}
+
 function saveProfile() {
     var profileName = document.getElementById('profile-name').value;
     if (!profileName) {
@@ -340,36 +501,17 @@ function saveProfile() {
         return;
     }
 
-    // Send the profile data to the server
-     const preheatTemp = parseFloat(document.getElementById('preheat-temp').value);
-     const preheatTime = parseInt(document.getElementById('preheat-time').value);
-     const soakTemp = parseFloat(document.getElementById('soak-temp').value);
-     const soakTime = parseInt(document.getElementById('soak-time').value);
-     const reflowTemp = parseFloat(document.getElementById('reflow-temp').value);
-     const reflowTime = parseInt(document.getElementById('reflow-time').value);
-     const coolTemp = parseFloat(document.getElementById('cooling-temp').value);
-     const coolTime = parseInt(document.getElementById('cooling-time').value);
-    
-    // if the values are the same as the last state, don't send them
-    if (lastState.preheatTemp === preheatTemp &&
-        lastState.preheatTime === preheatTime &&
-        lastState.soakTemp === soakTemp &&
-        lastState.soakTime === soakTime &&
-        lastState.reflowTemp === reflowTemp &&
-        lastState.reflowTime === reflowTime &&
-        lastState.cooldownTemp === coolTemp &&
-        lastState.cooldownTime === coolTime
-    ) sendValues();
-
     profileName += `.json`;
 
-    fetch('/saveprofile', {
+    // the oven saves the profile it has, so the editor goes first
+    sendValues(false)
+    .then(() => fetch('/saveprofile', {
         method: 'POST',
         headers: {
             'Content-Type': 'application/json'
         },
         body: JSON.stringify({name: profileName})
-    })
+    }))
     .then(response => {
         console.log('Profile saved:', response);
         updateProfiles();
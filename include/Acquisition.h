@@ -0,0 +1,26 @@
+#ifndef Acquisition_h
+#define Acquisition_h
+
+#include <stdint.h>
+
+// ---------------- Continuous ADC acquisition ----------------
+// A hardware timer triggers one conversion every period, independent of how
+// long the control tick takes. Samples are handed to the control task through
+// a lock-free single-producer/single-consumer ring and drained in batches.
+
+// number of samples the ring can hold, 1.28 s of slack at 10 ms
+#define ACQUISITION_BUFFER 128
+
+// one ADC conversion, stamped with the timer tick that triggered it (micros())
+struct AdcSample {
+  uint32_t time;
+  uint16_t value;
+};
+
+void AcquisitionBegin(uint8_t pin, uint32_t periodUs);
+bool AcquisitionRead(AdcSample &sample);       // consumer side, control task only
+void AcquisitionPush(const AdcSample &sample); // producer side, sampler only
+uint32_t AcquisitionDropped();                 // samples lost because the ring was full
+uint32_t AcquisitionPending();
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef Board_h
+#define Board_h
+
+// ---------------- Pin assignments ----------------
+// which analog pin to connect
+// WARNING: Use ADC1 (GPIO 32 to 39) on ESP32, as ADC2 is used by WiFi and Bluetooth.
+#define THERMISTORPIN 32
+#define RELAYPIN 23 // pin to control the relay
+#define STOPBTN 34
+#define STARTBTN 35
+
+// ---------------- Heater ----------------
+// frequency of the mains the heater runs on, the relay (a zero-cross SSR) switches once per half cycle
+#define MAINS_HZ 50
+
+// ---------------- Thermistor Settings ----------------
+// resistance at 25 degrees C
+#define THERMISTORNOMINAL 100000
+// temp. for nominal resistance (almost always 25 C)
+#define TEMPERATURENOMINAL 25
+// The beta coefficient of the thermistor (usually 3000-4000)
+#define BCOEFFICIENT 4267
+// the value of the 'other' resistor
+#define SERIESRESISTOR 5450
+// for ESP32, the ADC max value is 4095 (12-bit resolution)
+#define ADC_MAX_VALUE 4095
+// Optional Steinhart-Hart coefficients from the thermistor datasheet or a
+// three-point calibration. When defined they replace the Beta equation.
+// #define THERMISTOR_SH_A 0.8269925494e-3
+// #define THERMISTOR_SH_B 2.088185118e-4
+// #define THERMISTOR_SH_C 0.8059992866e-7
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef ReflowState_h
+#define ReflowState_h
+
+#include <stdint.h>
+#include <SampleFilter.h>
+#include <ProfileEngine.h>
+#include <RelayAutotune.h>
+
+// ---------------- Reflow state snapshot ----------------
+// Everything the UI side shows about the run. The control task publishes one
+// of these per tick through a Seqlock (see PublishState() in main.cpp), so the
+// web server, display and simulation always see values from the same tick.
+
+struct ReflowState {
+  uint32_t time;           // millis() of the control tick that published it
+  bool running;
+  ReflowPhase phase;       // of the current segment
+  bool waiting;            // an until segment waits for the oven
+  uint8_t segment;         // index of the current segment
+  uint8_t segments;        // in the profile of the run, of the last one when idle
+  float target;            // C, of the current segment or the autotune
+  bool tuning;             // the run is an autotune
+  uint8_t tuneCycles;      // relay cycles of the autotune so far
+  uint32_t autotunes;      // completed since boot, tune holds the last result
+  TuneResult tune;
+  FilterMode filter;
+  float filterAlpha;       // of the EMA filter
+  float temperature;       // C
+  float adcAverage;        // filtered ADC value
+  double setpoint;         // C
+  double output;           // PID output, 0..1
+  uint32_t elapsed;        // ms since the run started
+  uint32_t totalTime;      // ms, planned length of the run in progress, of the last one when idle
+  uint32_t droppedSamples;
+  uint32_t pidComputations; // since boot, the values of the last one follow
+  float pidTemperature;    // C, the input
+  double pidSetpoint;      // C
+  double pidOutput;        // 0..1
+  const char *fault;       // string literal, empty unless the last run was aborted
+  uint32_t aborts;         // runs aborted since boot, fault is the reason of the last one
+  bool abortedTune;        // the last aborted run was an autotune
+};
+
+// wait-free for the control task, any task may call this
+ReflowState GetReflowState(uint32_t *version = nullptr);
+
+#endif
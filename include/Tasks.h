@@ -0,0 +1,17 @@
+#ifndef Tasks_h
+#define Tasks_h
+
+// ---------------- Task split ----------------
+// The ESP32 has two cores. The WiFi stack and the web server live on core 0,
+// the control loop (samples -> filter -> PID -> relay) is pinned to core 1 and
+// paced by vTaskDelayUntil(), so a slow HTTP client can no longer delay it.
+// The two sides only talk through the command ring in main.cpp.
+
+// period of the control task
+#define CONTROL_PERIOD_MS 5
+
+void ControlTick(); // main.cpp, control task body
+void UiTick();      // main.cpp, UI task body
+void StartTasks();  // starts both tasks, never returns on the ESP32
+
+#endif
@@ -0,0 +1,69 @@
+#include "HeaterModulator.h"
+
+#include <string.h>
+
+static const char *const modeNames[HEATER_MODES] = {"burst", "pwm"};
+
+void HeaterModulator::SetBurst(uint16_t minOn, uint16_t minOff) {
+  this->minOn = minOn ? minOn : 1;
+  this->minOff = minOff ? minOff : 1;
+}
+
+void HeaterModulator::SetPwm(uint16_t period, uint16_t steps) {
+  this->period = period ? period : 1;
+  this->steps = steps ? steps : 1;
+  slot = 0;
+}
+
+void HeaterModulator::Reset() {
+  on = false;
+  held = UINT16_MAX; // off long enough, the first slot may turn on
+  error = 0;
+  slot = 0;
+  onSlots = 0;
+  switches = 0;
+}
+
+bool HeaterModulator::Update(float duty) {
+  if (!(duty > 0)) duty = 0; // NaN too
+  else if (duty > 1) duty = 1;
+
+  bool next = mode == HEATER_SLOW_PWM ? SlowPwm(duty) : Burst(duty);
+  if (next != on) {
+    if (next) switches++;
+    on = next;
+    held = 0;
+  }
+  if (held < UINT16_MAX) held++;
+  return on;
+}
+
+bool HeaterModulator::Burst(float duty) {
+  // the slot about to pass is owed, the decision below pays for it
+  error += duty;
+  bool next = on;
+  if (held >= (on ? minOn : minOff)) next = error >= 0.5f;
+  if (next) error -= 1;
+  return next;
+}
+
+bool HeaterModulator::SlowPwm(float duty) {
+  if (slot == 0) onSlots = (uint32_t)(duty * steps) * period / steps;
+  bool next = slot < onSlots;
+  if (++slot == period) slot = 0;
+  return next;
+}
+
+const char *HeaterModulator::ModeName(uint8_t mode) {
+  return mode < HEATER_MODES ? modeNames[mode] : "unknown";
+}
+
+bool HeaterModulator::ParseMode(const char *name, HeaterMode &out) {
+  for (uint8_t i = 0; i < HEATER_MODES; i++) {
+    if (strcmp(name, modeNames[i]) == 0) {
+      out = (HeaterMode)i;
+      return true;
+    }
+  }
+  return false;
+}
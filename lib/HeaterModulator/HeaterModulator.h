@@ -0,0 +1,74 @@
+#ifndef HeaterModulator_h
+#define HeaterModulator_h
+
+#include <stdint.h>
+
+// Turns the heater duty of the PID (0..1) into the state of the relay, one
+// slot at a time. A slot is a half cycle of the mains: a zero-cross SSR only
+// switches at the zero crossings, anything finer is lost.
+//
+// HEATER_BURST fires whole half cycles by error diffusion (a first order
+// sigma-delta): every slot adds the duty to the energy owed and every slot
+// the relay is on pays one off, the relay is on for a slot when at least half
+// a slot is owed. The error is carried from slot to slot, so any duty is
+// delivered on average however small it is and however often it changes,
+// with no window to wait for. Minimum on and off times hold the relay after
+// each switch to spare it; what is given or withheld meanwhile stays in the
+// error and is made up by the next pause or burst, which keeps the error
+// within max(minOn, minOff) + 1 slots.
+//
+// HEATER_SLOW_PWM is the slow PWM of earlier firmware: the duty is truncated
+// to one of steps levels at the start of each period slots long and kept for
+// the whole period, so anything below 1 / steps gives no heat.
+
+enum HeaterMode : uint8_t {
+  HEATER_BURST,     // error-diffusion burst firing
+  HEATER_SLOW_PWM,  // a fixed window of steps levels
+  HEATER_MODES
+};
+
+class HeaterModulator
+{
+  public:
+    HeaterModulator() : mode(HEATER_BURST), minOn(1), minOff(1), period(50), steps(10) { Reset(); }
+
+    void SetMode(HeaterMode mode) { this->mode = mode < HEATER_MODES ? mode : HEATER_BURST; Reset(); }
+    // slots the relay stays on and off at least, at least 1
+    void SetBurst(uint16_t minOn, uint16_t minOff);
+    // slots of a window and its levels, a level is period / steps slots
+    void SetPwm(uint16_t period, uint16_t steps);
+    // relay off, nothing owed, a new window; at the start of every run
+    void Reset();
+
+    // once per slot with the duty to deliver, returns whether the relay is on for the slot
+    bool Update(float duty);
+
+    HeaterMode Mode() const { return mode; }
+    uint16_t MinOn() const { return minOn; }
+    uint16_t MinOff() const { return minOff; }
+    bool On() const { return on; }
+    // slots of heat owed, negative when more was given than asked (bursts only)
+    float Error() const { return error; }
+    // off to on since the last Reset()
+    uint32_t Switches() const { return switches; }
+
+    static const char *ModeName(uint8_t mode);
+    // parses the names returned by ModeName(), returns false if unknown
+    static bool ParseMode(const char *name, HeaterMode &out);
+
+  private:
+    bool Burst(float duty);
+    bool SlowPwm(float duty);
+
+    HeaterMode mode;
+    uint16_t minOn, minOff, period, steps;
+
+    bool on;
+    uint16_t held;       // slots in the current state
+    float error;         // bursts
+    uint16_t slot;       // slow PWM, position in the window
+    uint16_t onSlots;    // slow PWM, of the current window
+    uint32_t switches;
+};
+
+#endif
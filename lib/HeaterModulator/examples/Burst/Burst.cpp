@@ -0,0 +1,181 @@
+// Host check for HeaterModulator: burst accuracy, minimum on and off times, slow PWM compatibility and ripple on the simulated oven.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/PID -I lib/HostSim -I lib/HeaterModulator lib/HostSim/Arduino.cpp lib/HostSim/WString.cpp lib/HostSim/SimOven.cpp lib/HeaterModulator/HeaterModulator.cpp lib/HeaterModulator/examples/Burst/Burst.cpp -o heater_burst && ./heater_burst
+
+#include <HeaterModulator.h>
+#include <PidCore.h>
+#include <SimOven.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+struct SimMillis {
+  static unsigned long Now() { return millis(); }
+};
+
+static uint32_t rng = 12345;
+static float Random() {
+  rng = rng * 1664525 + 1013904223;
+  return (rng >> 8) / 16777216.0f;
+}
+
+// the firmware's defaults at 50 Hz: 10 ms slots, 250 ms on and off at least,
+// the slow PWM 500 ms in 10 steps
+static const uint16_t MIN_SLOTS = 25, PWM_SLOTS = 50, PWM_STEPS = 10;
+
+// mean relay state over slots at a fixed duty
+static float Mean(HeaterModulator &heater, float duty, int slots) {
+  heater.Reset();
+  int on = 0;
+  for (int i = 0; i < slots; i++) on += heater.Update(duty);
+  return (float)on / slots;
+}
+
+int main() {
+  HeaterModulator heater;
+  heater.SetBurst(MIN_SLOTS, MIN_SLOTS);
+
+  float worst = 0;
+  for (int percent = 1; percent <= 99; percent++) {
+    worst = fmaxf(worst, fabsf(Mean(heater, percent / 100.0f, 10000) - percent / 100.0f));
+  }
+  printf("  bursts: largest error of the mean over 100 s %.3f%%, 0.5%% gives %.3f%%\n", worst * 100,
+         Mean(heater, 0.005f, 100000) * 100);
+  Expect(worst < 0.003f, "every duty in 1% steps within 0.3% over 100 s");
+  Expect(fabsf(Mean(heater, 0.005f, 100000) - 0.005f) < 0.0005f, "0.5% duty heats, 0.5% over 1000 s");
+  Expect(Mean(heater, 0, 1000) == 0 && Mean(heater, 1, 1000) == 1, "0 and 1 are off and on");
+
+  {
+    HeaterModulator slow;
+    slow.SetMode(HEATER_SLOW_PWM);
+    slow.SetPwm(PWM_SLOTS, PWM_STEPS);
+    Expect(Mean(slow, 0.099f, 1000) == 0 && Mean(heater, 0.099f, 10000) > 0.09f,
+           "9.9%: the slow PWM gives none, bursts deliver it");
+  }
+
+  // a duty that changes every PID computation, as the firmware's does
+  heater.Reset();
+  double owed = 0, worstError = 0;
+  uint32_t shortest[2] = {UINT32_MAX, UINT32_MAX}, run = 0, given = 0;
+  bool last = false, first = true;
+  float duty = 0;
+  for (int i = 0; i < 1000000; i++) {
+    if (i % 25 == 0) duty = Random() < 0.1f ? (Random() < 0.5f ? 0 : 1) : Random();
+    bool on = heater.Update(duty);
+    owed += duty;
+    given += on;
+    worstError = fmax(worstError, fabs(owed - given));
+    if (on != last) {
+      if (!first) shortest[last] = run < shortest[last] ? run : shortest[last];
+      first = false;
+      run = 0;
+    }
+    run++;
+    last = on;
+  }
+  printf("  random duties: error at most %.2f slots, shortest on %u, off %u slots, %u switches\n", worstError,
+         (unsigned)shortest[1], (unsigned)shortest[0], (unsigned)heater.Switches());
+  Expect(worstError <= MIN_SLOTS + 1, "the carried error stays within max(minOn, minOff) + 1");
+  Expect(fabs(heater.Error() - (owed - given)) < 0.01, "Error() is the energy owed");
+  Expect(shortest[0] >= MIN_SLOTS && shortest[1] >= MIN_SLOTS, "the relay keeps its minimum on and off times");
+
+  heater.Reset();
+  for (int i = 0; i < 100; i++) heater.Update(1);
+  bool off = !heater.Update(0);
+  heater.Reset();
+  int held = 0;
+  for (int i = 0; i < 5; i++) held += heater.Update(1);
+  while (heater.Update(0)) held++;
+  Expect(off && held == MIN_SLOTS, "a duty of 0 turns off at once, after the minimum on time");
+
+  {
+    // HandleSlowPWM() of earlier firmware, called every step of the period
+    HeaterModulator slow;
+    slow.SetMode(HEATER_SLOW_PWM);
+    slow.SetPwm(PWM_SLOTS, PWM_STEPS);
+    const int slotsPerStep = PWM_SLOTS / PWM_STEPS;
+    int pwmStep = 0, dutySteps = 0;
+    bool relay = false, same = true;
+    for (int i = 0; i < 100000 && same; i++) {
+      if (i % 25 == 0) duty = Random();
+      if (i % slotsPerStep == 0) {
+        if (pwmStep == 0) {
+          dutySteps = (int)(duty * PWM_STEPS);
+          relay = dutySteps > 0;
+        } else if (pwmStep == dutySteps) {
+          relay = false;
+        }
+        if (++pwmStep == PWM_STEPS) pwmStep = 0;
+      }
+      same = slow.Update(duty) == relay;
+    }
+    Expect(same, "slow PWM mode switches like the earlier firmware");
+  }
+
+  HeaterMode mode;
+  Expect(HeaterModulator::ParseMode("pwm", mode) && mode == HEATER_SLOW_PWM && !HeaterModulator::ParseMode("fast", mode) &&
+         strcmp(HeaterModulator::ModeName(HEATER_BURST), "burst") == 0, "modes by name");
+
+  // the oven held at a temperature, ripple and switches over the last 10 of 20 minutes
+  bool lessRipple = true, fewerSwitches = true;
+  for (float target : {50.0f, 100.0f, 150.0f, 230.0f}) {
+    float ripple[2];
+    unsigned long switches[2];
+    for (int m = 0; m < 2; m++) {
+      SimClock::Reset();
+      SimOven oven;
+      HeaterModulator modulator;
+      modulator.SetMode(m ? HEATER_SLOW_PWM : HEATER_BURST);
+      modulator.SetBurst(MIN_SLOTS, MIN_SLOTS);
+      modulator.SetPwm(PWM_SLOTS, PWM_STEPS);
+      PidController<float, SimMillis> pid(0.103, 0.127, 0.021, P_ON_E, DIRECT);
+      pid.SetOutputLimits(0, 1);
+      pid.SetSampleTime(10);
+      pid.SetIntegralBounds(-10, 10); // as in the firmware
+      pid.SetMode(AUTOMATIC, 25.0f);
+      float output = 0, low = 1e9f, high = -1e9f;
+      unsigned long before = 0;
+      for (unsigned long ms = 0; ms < 1200000; ms += 10) {
+        SimClock::Advance(10000);
+        if (ms % 250 == 0) {
+          pid.Compute(oven.SensorTemp(), target);
+          output = pid.Output();
+        }
+        oven.SetHeater(modulator.Update(output));
+        if (ms == 600000) before = oven.RelaySwitches();
+        if (ms >= 600000) {
+          low = fminf(low, oven.SensorTemp());
+          high = fmaxf(high, oven.SensorTemp());
+        }
+      }
+      ripple[m] = high - low;
+      switches[m] = oven.RelaySwitches() - before;
+    }
+    printf("  holding %3.0f C: ripple %.3f C, %4lu switches in 10 min (slow PWM %.3f C, %4lu)\n", target, ripple[0],
+           switches[0], ripple[1], switches[1]);
+    lessRipple = lessRipple && ripple[0] < ripple[1];
+    fewerSwitches = fewerSwitches && switches[0] < switches[1];
+  }
+  Expect(lessRipple, "bursts hold the oven with less ripple than the slow PWM");
+  Expect(fewerSwitches, "and with fewer relay switches");
+
+  const int updates = 10000000;
+  HeaterModulator bench;
+  bench.SetBurst(MIN_SLOTS, MIN_SLOTS);
+  unsigned long sum = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < updates; i++) sum += bench.Update((i & 1023) / 1023.0f);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / updates;
+  printf("  one Update(): %.1f ns (checksum %lu)\n", ns, sum);
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
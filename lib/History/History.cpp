@@ -0,0 +1,51 @@
+#include "History.h"
+
+static int16_t Tenths(float value) {
+  float scaled = value * 10 + (value >= 0 ? 0.5f : -0.5f);
+  if (scaled > INT16_MAX) return INT16_MAX;
+  if (scaled < INT16_MIN) return INT16_MIN;
+  return (int16_t)scaled;
+}
+
+void History::Clear() {
+  // a reader that saw the old run fails Valid() from here on
+  run.store(run.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  written.store(0, std::memory_order_release);
+}
+
+void History::Add(uint32_t ms, float temperature, float setpoint, float output) {
+  uint32_t index = written.load(std::memory_order_relaxed);
+  uint32_t time = (ms + 50) / 100;
+  if (time > UINT16_MAX) time = UINT16_MAX; // 109 minutes, longer than any profile
+  if (output < 0) output = 0;
+  if (output > 1) output = 1;
+
+  std::atomic<uint32_t> *slot = words[index % HISTORY_CAPACITY];
+  slot[0].store(time | (uint32_t)(uint16_t)Tenths(temperature) << 16, std::memory_order_relaxed);
+  slot[1].store((uint16_t)Tenths(setpoint) | (uint32_t)(output * 1000 + 0.5f) << 16, std::memory_order_relaxed);
+  written.store(index + 1, std::memory_order_release);
+}
+
+HistorySample History::At(uint32_t index) const {
+  const std::atomic<uint32_t> *slot = words[index % HISTORY_CAPACITY];
+  uint32_t first = slot[0].load(std::memory_order_relaxed);
+  uint32_t second = slot[1].load(std::memory_order_relaxed);
+  HistorySample sample;
+  sample.time = (uint16_t)first;
+  sample.temperature = (int16_t)(first >> 16);
+  sample.setpoint = (int16_t)second;
+  sample.output = (uint16_t)(second >> 16);
+  return sample;
+}
+
+// the times only grow, so a binary search
+uint32_t History::Find(uint32_t first, uint32_t end, float seconds) const {
+  if (seconds <= 0) return first;
+  uint32_t target = (uint32_t)(seconds * 10 + 0.5f);
+  while (first < end) {
+    uint32_t middle = first + (end - first) / 2;
+    if (At(middle).time < target) first = middle + 1;
+    else end = middle;
+  }
+  return first;
+}
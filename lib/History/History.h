@@ -0,0 +1,122 @@
+#ifndef History_h
+#define History_h
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-memory record of a run, for charting.
+// A sample is 8 bytes: the time since the run started in 0.1 s and the
+// temperature, setpoint and output as fixed-point integers. The control task
+// Add()s one per PID period; 4096 of them cover 17 minutes at 250 ms, so a
+// whole profile fits and the ring only wraps on very long runs.
+//
+// One writer, any number of readers, no locks. Indices count samples since the
+// run started and only grow, a slot is overwritten HISTORY_CAPACITY samples
+// later. A reader takes Run() and Written(), reads from First(), which keeps
+// HISTORY_READ_MARGIN samples away from the slots the writer reuses next, and
+// checks Valid() afterwards; a reader that took longer than the margin or ran
+// into a Clear() reads again. Samples are stored as relaxed atomic words like
+// in Seqlock, so reading a slot while it is rewritten is not a data race.
+
+#define HISTORY_CAPACITY 4096
+#define HISTORY_READ_MARGIN 64 // 16 s of samples at 250 ms, far more than a read takes
+
+struct HistorySample {
+  uint16_t time;       // 0.1 s since the run started
+  int16_t temperature; // 0.1 C
+  int16_t setpoint;    // 0.1 C
+  uint16_t output;     // 0..1000 for 0..1
+
+  float Seconds() const { return time * 0.1f; }
+  float Temperature() const { return temperature * 0.1f; }
+  float Setpoint() const { return setpoint * 0.1f; }
+  float Output() const { return output * 0.001f; }
+};
+
+class History
+{
+  public:
+    History() : run(0), written(0) {}
+
+    // writer side, only one task may call these
+    void Clear();
+    void Add(uint32_t ms, float temperature, float setpoint, float output);
+
+    // reader side
+    uint32_t Run() const { return run.load(std::memory_order_acquire); }
+    uint32_t Written() const { return written.load(std::memory_order_acquire); }
+    // oldest index that is safe to read until Written() has grown by the margin
+    uint32_t First(uint32_t end) const {
+      return end > HISTORY_CAPACITY - HISTORY_READ_MARGIN ? end - (HISTORY_CAPACITY - HISTORY_READ_MARGIN) : 0;
+    }
+    HistorySample At(uint32_t index) const;
+    // first index in [first, end) at or after seconds into the run, end when there is none
+    uint32_t Find(uint32_t first, uint32_t end, float seconds) const;
+    // nothing read from first on was overwritten, and the run is still the same
+    bool Valid(uint32_t run, uint32_t first) const {
+      return Run() == run && Written() - first <= HISTORY_CAPACITY;
+    }
+
+    // Calls emit(index) for at most points indices of [first, end), in order,
+    // picked with largest-triangle-three-buckets on the temperature: the first
+    // and last sample, and of every bucket in between the one that spans the
+    // largest triangle with its neighbours, so peaks and edges survive.
+    template <typename Emit>
+    void Downsample(uint32_t first, uint32_t end, uint32_t points, Emit emit) const;
+
+  private:
+    std::atomic<uint32_t> words[HISTORY_CAPACITY][2];
+    std::atomic<uint32_t> run, written;
+};
+
+template <typename Emit>
+void History::Downsample(uint32_t first, uint32_t end, uint32_t points, Emit emit) const {
+  uint32_t count = end - first;
+  if (points >= count || points < 3) {
+    for (uint32_t i = first; i < end; i++) emit(i);
+    return;
+  }
+
+  // every bucket but the first and last sample holds `every` samples
+  float every = (float)(count - 2) / (points - 2);
+  uint32_t chosen = first;
+  HistorySample a = At(first);
+  emit(first);
+
+  for (uint32_t bucket = 0; bucket < points - 2; bucket++) {
+    uint32_t start = first + 1 + (uint32_t)(bucket * every);
+    uint32_t stop = first + 1 + (uint32_t)((bucket + 1) * every);
+
+    // the next bucket is represented by its average, the last one by the last sample
+    uint32_t nextStart = stop;
+    uint32_t nextStop = bucket + 2 < points - 1 ? first + 1 + (uint32_t)((bucket + 2) * every) : end;
+    if (nextStop > end) nextStop = end;
+    float nextTime = 0, nextTemperature = 0;
+    for (uint32_t i = nextStart; i < nextStop; i++) {
+      HistorySample sample = At(i);
+      nextTime += sample.time;
+      nextTemperature += sample.temperature;
+    }
+    nextTime /= nextStop - nextStart;
+    nextTemperature /= nextStop - nextStart;
+
+    float largest = -1;
+    HistorySample best = a;
+    for (uint32_t i = start; i < stop; i++) {
+      HistorySample sample = At(i);
+      float area = (a.time - nextTime) * (sample.temperature - a.temperature) -
+                   (a.time - sample.time) * (nextTemperature - a.temperature);
+      if (area < 0) area = -area;
+      if (area > largest) {
+        largest = area;
+        chosen = i;
+        best = sample;
+      }
+    }
+    a = best;
+    emit(chosen);
+  }
+  emit(end - 1);
+}
+
+#endif
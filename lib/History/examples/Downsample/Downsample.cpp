@@ -0,0 +1,100 @@
+// Host check for History: fixed-point round trip, LTTB downsampling and reads racing a wrapping writer.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/History lib/History/History.cpp lib/History/examples/Downsample/Downsample.cpp -o history_downsample && ./history_downsample
+
+#include <History.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static History history;
+
+// preheat, soak, a 230 C reflow peak at 300 s, cooldown
+static float Curve(float t) {
+  if (t < 90) return 25 + t * 1.4f;
+  if (t < 210) return 151 + (t - 90) * 0.2f;
+  if (t < 300) return 175 + (t - 210) * 0.6f;
+  return 229 - (t - 300) * 1.2f;
+}
+
+int main() {
+  history.Clear();
+  for (uint32_t i = 0; i < 1680; i++) history.Add(i * 250, Curve(i * 0.25f), 150, (i % 5) * 0.25f);
+
+  uint32_t end = history.Written();
+  HistorySample sample = history.At(361);
+  Expect(end == 1680 && history.First(end) == 0, "a whole profile fits");
+  Expect(fabsf(sample.Seconds() - 90.3f) < 0.01f && fabsf(sample.Temperature() - Curve(90.25f)) < 0.051f &&
+         fabsf(sample.Setpoint() - 150) < 0.01f && fabsf(sample.Output() - 0.25f) < 0.0005f, "fixed-point round trip");
+  Expect(history.Find(0, end, 100) == 400 && history.Find(0, end, 1000) == end, "time search");
+
+  std::vector<uint32_t> picked;
+  history.Downsample(0, end, 300, [&](uint32_t i) { picked.push_back(i); });
+  bool ordered = true;
+  float peak = 0, pickedPeak = 0;
+  for (size_t i = 1; i < picked.size(); i++) ordered &= picked[i] > picked[i - 1];
+  for (uint32_t i = 0; i < end; i++) peak = fmaxf(peak, history.At(i).Temperature());
+  for (uint32_t i : picked) pickedPeak = fmaxf(pickedPeak, history.At(i).Temperature());
+  Expect(picked.size() == 300 && ordered, "300 points, in order");
+  Expect(picked.front() == 0 && picked.back() == end - 1, "first and last sample kept");
+  printf("  peak %.1f C, downsampled %.1f C\n", peak, pickedPeak);
+  Expect(peak - pickedPeak <= 0.2f, "peak kept to within 0.2 C");
+
+  picked.clear();
+  history.Downsample(history.Find(0, end, 400), end, 300, [&](uint32_t i) { picked.push_back(i); });
+  Expect(picked.size() == 80, "fewer samples than points are all returned");
+
+  // a writer that wraps the ring while readers downsample
+  history.Clear();
+  std::atomic<bool> running{true};
+  std::atomic<int> clears{0};
+  std::thread writer([&]() {
+    for (uint32_t n = 0; running; n++) {
+      if (n % 50000 == 0) {
+        history.Clear();
+        clears++;
+      }
+      uint32_t i = history.Written();
+      history.Add(i * 100 % 6500000, (float)(i % 3000), (float)(i % 3000) / 2, 0.5f);
+    }
+  });
+
+  unsigned long reads = 0, retries = 0, torn = 0, runs = 0;
+  uint32_t lastRun = history.Run();
+  // on one CPU the writer can get all its clears done in a single time slice,
+  // so the reader also waits for new runs, until the writer has cleared plenty
+  while (clears < 10 || reads + retries < 200000 || (runs < 10 && clears < 1000)) {
+    uint32_t run = history.Run(), end = history.Written();
+    uint32_t first = history.First(end);
+    bool consistent = true;
+    history.Downsample(first, end, 50, [&](uint32_t i) {
+      HistorySample sample = history.At(i);
+      consistent &= sample.temperature == (int16_t)(i % 3000 * 10) && sample.setpoint == (int16_t)(i % 3000 * 5);
+    });
+    if (!history.Valid(run, first)) {
+      retries++;
+      continue;
+    }
+    reads++;
+    if (!consistent) torn++;
+    if (run != lastRun) runs++;
+    lastRun = run;
+  }
+  running = false;
+  writer.join();
+
+  printf("  %lu valid reads, %lu retried, %lu runs seen\n", reads, retries, runs);
+  Expect(reads > 0 && torn == 0, "no read accepted by Valid() holds a foreign sample");
+  Expect(runs > 0, "readers see Clear() start a new run");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+#include "Arduino.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+
+// ---------------- Virtual clock ----------------
+// atomic because simulated producer threads read it while the driver advances it
+static std::atomic<uint64_t> simMicros{0};
+// realtime mode: simMicros holds the offset of the steady clock epoch below
+static std::atomic<bool> simRealtime{false};
+static std::chrono::steady_clock::time_point realtimeEpoch;
+
+struct SimTimer {
+  uint64_t period;
+  uint64_t due;
+  std::function<void(uint64_t)> callback;
+  bool active;
+};
+
+static std::vector<SimTimer> simTimers;
+
+static uint64_t RealtimeMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - realtimeEpoch).count();
+}
+
+uint64_t SimClock::Micros() {
+  uint64_t base = simMicros.load(std::memory_order_acquire);
+  return simRealtime.load(std::memory_order_acquire) ? base + RealtimeMicros() : base;
+}
+
+void SimClock::SetRealtime(bool enabled) {
+  if (enabled == Realtime()) return;
+  uint64_t now = Micros();
+  realtimeEpoch = std::chrono::steady_clock::now();
+  simMicros.store(now, std::memory_order_release);
+  simRealtime.store(enabled, std::memory_order_release);
+}
+
+bool SimClock::Realtime() { return simRealtime.load(std::memory_order_acquire); }
+
+void SimClock::Advance(uint64_t us) {
+  if (Realtime()) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    return;
+  }
+  uint64_t target = Micros() + us;
+  for (;;) {
+    SimTimer *next = nullptr;
+    for (SimTimer &timer : simTimers) {
+      if (timer.active && timer.due <= target && (!next || timer.due < next->due)) next = &timer;
+    }
+    if (!next) break;
+    simMicros.store(next->due, std::memory_order_release);
+    next->due += next->period;
+    next->callback(Micros());
+  }
+  simMicros.store(target, std::memory_order_release);
+}
+
+void SimClock::Reset() {
+  simRealtime.store(false);
+  simMicros.store(0);
+  simTimers.clear();
+}
+
+int SimClock::Every(uint64_t periodUs, std::function<void(uint64_t tickUs)> callback) {
+  if (periodUs == 0) return -1;
+  simTimers.push_back({periodUs, Micros() + periodUs, callback, true});
+  return (int)simTimers.size() - 1;
+}
+
+void SimClock::Cancel(int timer) {
+  if (timer >= 0 && timer < (int)simTimers.size()) simTimers[timer].active = false;
+}
+
+unsigned long millis() { return (unsigned long)(SimClock::Micros() / 1000); }
+unsigned long micros() { return (unsigned long)SimClock::Micros(); }
+void delay(uint32_t ms) { SimClock::Advance((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { SimClock::Advance(us); }
+void yield() {}
+
+// ---------------- Simulated board ----------------
+struct SimPin {
+  int level = HIGH;        // latched output level or driven input level
+  bool driven = false;     // input level set by the simulation
+  std::function<uint16_t()> analogSource;
+  std::function<void(int)> outputSink;
+};
+
+// fixed table, so pins can be read from a producer thread while others are configured
+static const uint8_t SIM_PIN_COUNT = 40;
+static SimPin simPins[SIM_PIN_COUNT];
+static SimPin unusedPin;
+
+static SimPin &Pin(uint8_t pin) { return pin < SIM_PIN_COUNT ? simPins[pin] : unusedPin; }
+
+void SimBoard::SetInput(uint8_t pin, int level) {
+  Pin(pin).level = level;
+  Pin(pin).driven = true;
+}
+
+void SimBoard::AttachAnalog(uint8_t pin, std::function<uint16_t()> source) {
+  Pin(pin).analogSource = source;
+}
+
+void SimBoard::AttachOutput(uint8_t pin, std::function<void(int)> sink) {
+  Pin(pin).outputSink = sink;
+}
+
+int SimBoard::PinLevel(uint8_t pin) { return Pin(pin).level; }
+
+void SimBoard::Reset() {
+  for (SimPin &p : simPins) p = SimPin();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  SimPin &p = Pin(pin);
+  if (mode == OUTPUT && !p.driven) p.level = LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  SimPin &p = Pin(pin);
+  p.level = val ? HIGH : LOW;
+  if (p.outputSink) p.outputSink(p.level);
+}
+
+int digitalRead(uint8_t pin) { return SimBoard::PinLevel(pin); }
+
+uint16_t analogRead(uint8_t pin) {
+  SimPin &p = Pin(pin);
+  return p.analogSource ? p.analogSource() : 0;
+}
+
+void analogReadResolution(uint8_t bits) { (void)bits; }
+
+// ---------------- Print / Stream ----------------
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char stackBuf[128];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(stackBuf)) return write((const uint8_t *)stackBuf, len);
+
+  std::vector<char> heapBuf(len + 1);
+  va_start(args, format);
+  vsnprintf(heapBuf.data(), heapBuf.size(), format, args);
+  va_end(args);
+  return write((const uint8_t *)heapBuf.data(), len);
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = read();
+    if (c < 0) break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+String Stream::readString() {
+  String ret;
+  int c;
+  while ((c = read()) >= 0) ret += (char)c;
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String ret;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) ret += (char)c;
+  return ret;
+}
+
+// ---------------- Serial ----------------
+int HardwareSerial::available() { return (int)rx.size(); }
+
+int HardwareSerial::read() {
+  if (rx.empty()) return -1;
+  int c = (unsigned char)rx.front();
+  rx.erase(0, 1);
+  return c;
+}
+
+int HardwareSerial::peek() { return rx.empty() ? -1 : (unsigned char)rx.front(); }
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (echo) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (echo) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+void HardwareSerial::Inject(const String &line) {
+  rx += line.str();
+  rx += '\n';
+}
@@ -0,0 +1,162 @@
+#ifndef HostSim_Arduino_h
+#define HostSim_Arduino_h
+
+// Host replacement for the Arduino-ESP32 core.
+// Time comes from a virtual clock (SimClock) and the GPIO/ADC calls are routed
+// through SimBoard so a simulated plant can sit behind the pins.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define PULLUP       0x04
+#define INPUT_PULLUP 0x05
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+// ---------------- Time ----------------
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// ---------------- GPIO / ADC ----------------
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+
+// Virtual clock shared by every host shim.
+// It only moves when the simulation driver (or delay()) advances it. Periodic
+// callbacks emulate hardware timer interrupts: Advance() stops the clock at
+// every due tick and runs the callback with the exact tick time.
+// In realtime mode the clock follows the host's steady clock instead, Advance()
+// just sleeps and timers never fire, so periodic work needs real threads.
+namespace SimClock {
+  uint64_t Micros();
+  void Advance(uint64_t us);
+  void Reset();
+  void SetRealtime(bool enabled);
+  bool Realtime();
+  int Every(uint64_t periodUs, std::function<void(uint64_t tickUs)> callback);
+  void Cancel(int timer);
+}
+
+// Pin routing for the simulated board.
+// Unattached outputs are only latched, unattached inputs read HIGH (pull-up).
+namespace SimBoard {
+  void SetInput(uint8_t pin, int level);
+  void AttachAnalog(uint8_t pin, std::function<uint16_t()> source);
+  void AttachOutput(uint8_t pin, std::function<void(int)> sink);
+  int PinLevel(uint8_t pin);
+  void Reset();
+}
+
+// ---------------- Print / Stream ----------------
+class Print;
+
+class Printable
+{
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print(String(n, base)); }
+    size_t print(int n, int base = DEC) { return print(String(n, base)); }
+    size_t print(unsigned int n, int base = DEC) { return print(String(n, base)); }
+    size_t print(long n, int base = DEC) { return print(String(n, base)); }
+    size_t print(unsigned long n, int base = DEC) { return print(String(n, base)); }
+    size_t print(long long n, int base = DEC) { return print(String(n, base)); }
+    size_t print(unsigned long long n, int base = DEC) { return print(String(n, base)); }
+    size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+    size_t print(const Printable &x) { return x.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &x) { size_t n = print(x); return n + println(); }
+    template <typename T>
+    size_t println(const T &x, int format) { size_t n = print(x, format); return n + println(); }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+  protected:
+    unsigned long _timeout = 1000;
+};
+
+// Serial console. Output goes to stdout, input is fed by the simulation driver.
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+
+    // host extras
+    void Inject(const String &line);
+    void SetEcho(bool enabled) { echo = enabled; }
+
+  private:
+    std::string rx;
+    bool echo = true;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef HostSim_EEPROM_h
+#define HostSim_EEPROM_h
+
+#include "Arduino.h"
+
+#include <vector>
+
+// Emulated EEPROM held in RAM. A fresh image reads back as zeros, like the
+// ESP32 core does when the "eeprom" NVS blob does not exist yet.
+class EEPROMClass
+{
+  public:
+    bool begin(size_t size) {
+      if (size > bytes.size()) bytes.resize(size, 0);
+      return true;
+    }
+    uint8_t read(int address) { return in(address) ? bytes[address] : 0; }
+    void write(int address, uint8_t value) { if (in(address)) bytes[address] = value; }
+    bool commit() { commits++; return true; }
+    size_t length() { return bytes.size(); }
+
+    template <typename T>
+    T &get(int address, T &t) {
+      if (in(address) && address + sizeof(T) <= bytes.size()) memcpy((void *)&t, &bytes[address], sizeof(T));
+      return t;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &t) {
+      if (in(address) && address + sizeof(T) <= bytes.size()) memcpy(&bytes[address], (const void *)&t, sizeof(T));
+      return t;
+    }
+
+    // host extras
+    unsigned long Commits() const { return commits; }
+
+  private:
+    bool in(int address) const { return address >= 0 && (size_t)address < bytes.size(); }
+
+    std::vector<uint8_t> bytes;
+    unsigned long commits = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HostSim_ESPmDNS_h
+#define HostSim_ESPmDNS_h
+
+#include "Arduino.h"
+
+class MDNSResponder
+{
+  public:
+    bool begin(const char *hostName) { (void)hostName; return true; }
+};
+
+extern MDNSResponder MDNS;
+
+#endif
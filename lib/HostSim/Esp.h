@@ -0,0 +1,27 @@
+#ifndef HostSim_Esp_h
+#define HostSim_Esp_h
+
+#include "Arduino.h"
+
+// Host stand-in for the ESP32 system class. The heap figures are fixed so
+// that anything printing them stays deterministic between runs.
+class EspClass
+{
+  public:
+    uint32_t getHeapSize() { return 327680; }
+    uint32_t getFreeHeap() { return 262144; }
+    uint32_t getMinFreeHeap() { return 262144; }
+    uint32_t getMaxAllocHeap() { return 131072; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getCycleCount() { return (uint32_t)(SimClock::Micros() * 240); }
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+// host extras: operator new calls made by the calling thread so far (Heap.cpp),
+// and a way to leave out allocations of the simulation itself
+unsigned long SimHeapAllocations();
+void SimHeapUncount(unsigned long since);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef HostSim_FS_h
+#define HostSim_FS_h
+
+#include "Arduino.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs
+{
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+
+// Same shape as the ESP32 fs::File: a cheap shared handle that is also a Stream.
+class File : public Stream
+{
+  public:
+    File() = default;
+    explicit File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t *buf, size_t size);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    const char *name() const;
+    const char *path() const;
+    bool isDirectory() const;
+    File openNextFile(const char *mode = FILE_READ);
+    void rewindDirectory();
+
+  private:
+    std::shared_ptr<FileImpl> impl;
+};
+
+// Filesystem rooted at a host directory, so data/ can be used as the image.
+class FS
+{
+  public:
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool rename(const String &pathFrom, const String &pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path);
+    bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+    // host extras
+    void SetRoot(const std::string &hostDirectory) { root = hostDirectory; }
+    const std::string &Root() const { return root; }
+
+  protected:
+    std::string HostPath(const char *path) const;
+
+    std::string root = "data";
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HostSim_HTTP_Method_h
+#define HostSim_HTTP_Method_h
+
+// Host version of the Arduino-ESP32 HTTP_Method.h, which takes the methods
+// from the IDF's http_parser.h; the values match it.
+enum HTTPMethod { HTTP_DELETE = 0, HTTP_GET = 1, HTTP_HEAD = 2, HTTP_POST = 3, HTTP_PUT = 4, HTTP_OPTIONS = 6, HTTP_PATCH = 28 };
+
+#define HTTP_ANY (HTTPMethod)(255)
+
+#endif
@@ -0,0 +1,25 @@
+#include "Esp.h"
+
+#include <new>
+#include <stdlib.h>
+
+// Counts every operator new of the calling thread, so the simulation can
+// check which handlers allocate. The ESP32 heap figures stay fixed (Esp.h).
+static thread_local unsigned long allocations = 0;
+
+unsigned long SimHeapAllocations() { return allocations; }
+void SimHeapUncount(unsigned long since) { allocations = since; }
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *p = malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { allocations++; return malloc(size ? size : 1); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { allocations++; return malloc(size ? size : 1); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
@@ -0,0 +1,15 @@
+#include "Esp.h"
+#include "WiFi.h"
+#include "ESPmDNS.h"
+#include "Wire.h"
+#include "SSD1306Wire.h"
+#include "EEPROM.h"
+
+// Global instances the Arduino-ESP32 core would normally provide.
+EspClass ESP;
+WiFiClass WiFi;
+MDNSResponder MDNS;
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+const uint8_t ArialMT_Plain_10[] = {0};
@@ -0,0 +1,207 @@
+#include "LittleFS.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace stdfs = std::filesystem;
+
+fs::LittleFSFS LittleFS;
+
+// same size as the littlefs partition of the default ESP32 4MB layout
+static const size_t SIM_FS_TOTAL_BYTES = 0x160000;
+
+namespace fs
+{
+
+class FileImpl
+{
+  public:
+    ~FileImpl() { Close(); }
+    void Close() {
+      if (handle) fclose(handle);
+      handle = nullptr;
+    }
+
+    FILE *handle = nullptr;
+    bool directory = false;
+    std::string fsPath;   // path as seen by the firmware, e.g. /profiles/default.json
+    std::string fileName; // last path component
+    std::string hostPath;
+    std::vector<std::string> entries; // directory listing, names only
+    size_t nextEntry = 0;
+    FS *owner = nullptr;
+};
+
+// ---------------- File ----------------
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t *buf, size_t size) {
+  if (!impl || !impl->handle) return 0;
+  return fwrite(buf, 1, size, impl->handle);
+}
+
+int File::available() {
+  if (!impl || !impl->handle) return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  if (!impl || !impl->handle) return -1;
+  int c = fgetc(impl->handle);
+  return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+  if (!impl || !impl->handle) return -1;
+  int c = fgetc(impl->handle);
+  if (c == EOF) return -1;
+  ungetc(c, impl->handle);
+  return c;
+}
+
+void File::flush() {
+  if (impl && impl->handle) fflush(impl->handle);
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+  if (!impl || !impl->handle) return 0;
+  return fread(buf, 1, size, impl->handle);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!impl || !impl->handle) return false;
+  int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+  return fseek(impl->handle, pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!impl || !impl->handle) return 0;
+  long pos = ftell(impl->handle);
+  return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+  if (!impl || !impl->handle) return 0;
+  long pos = ftell(impl->handle);
+  fseek(impl->handle, 0, SEEK_END);
+  long end = ftell(impl->handle);
+  fseek(impl->handle, pos, SEEK_SET);
+  return end < 0 ? 0 : (size_t)end;
+}
+
+void File::close() {
+  if (impl) impl->Close();
+  impl.reset();
+}
+
+File::operator bool() const { return impl && (impl->handle || impl->directory); }
+
+const char *File::name() const { return impl ? impl->fileName.c_str() : nullptr; }
+
+const char *File::path() const { return impl ? impl->fsPath.c_str() : nullptr; }
+
+bool File::isDirectory() const { return impl && impl->directory; }
+
+File File::openNextFile(const char *mode) {
+  if (!impl || !impl->directory || impl->nextEntry >= impl->entries.size()) return File();
+  std::string child = impl->fsPath;
+  if (child.empty() || child.back() != '/') child += '/';
+  child += impl->entries[impl->nextEntry++];
+  return impl->owner->open(child.c_str(), mode);
+}
+
+void File::rewindDirectory() {
+  if (impl) impl->nextEntry = 0;
+}
+
+// ---------------- FS ----------------
+std::string FS::HostPath(const char *path) const {
+  std::string p = path ? path : "";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  return root + p;
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  auto impl = std::make_shared<FileImpl>();
+  impl->owner = this;
+  impl->fsPath = path ? path : "/";
+  impl->hostPath = HostPath(path);
+  impl->fileName = stdfs::path(impl->fsPath).filename().string();
+
+  std::error_code ec;
+  bool writing = mode && (mode[0] == 'w' || mode[0] == 'a');
+
+  if (!writing && stdfs::is_directory(impl->hostPath, ec)) {
+    impl->directory = true;
+    for (const auto &entry : stdfs::directory_iterator(impl->hostPath, ec)) {
+      impl->entries.push_back(entry.path().filename().string());
+    }
+    std::sort(impl->entries.begin(), impl->entries.end());
+    return File(impl);
+  }
+
+  if (writing && create) {
+    stdfs::create_directories(stdfs::path(impl->hostPath).parent_path(), ec);
+  }
+
+  std::string hostMode = mode ? mode : "r";
+  if (hostMode.find('b') == std::string::npos) hostMode += "b";
+  impl->handle = fopen(impl->hostPath.c_str(), hostMode.c_str());
+  if (!impl->handle) return File();
+  return File(impl);
+}
+
+bool FS::exists(const char *path) {
+  std::error_code ec;
+  return stdfs::exists(HostPath(path), ec);
+}
+
+bool FS::remove(const char *path) {
+  std::error_code ec;
+  return stdfs::is_regular_file(HostPath(path), ec) && stdfs::remove(HostPath(path), ec);
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+  std::error_code ec;
+  stdfs::rename(HostPath(pathFrom), HostPath(pathTo), ec);
+  return !ec;
+}
+
+bool FS::mkdir(const char *path) {
+  std::error_code ec;
+  stdfs::create_directories(HostPath(path), ec);
+  return !ec;
+}
+
+bool FS::rmdir(const char *path) {
+  std::error_code ec;
+  return stdfs::is_directory(HostPath(path), ec) && stdfs::remove(HostPath(path), ec);
+}
+
+// ---------------- LittleFS ----------------
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel) {
+  (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+  std::error_code ec;
+  if (stdfs::is_directory(root, ec)) return true;
+  return formatOnFail && format();
+}
+
+bool LittleFSFS::format() {
+  std::error_code ec;
+  stdfs::remove_all(root, ec);
+  return stdfs::create_directories(root, ec);
+}
+
+size_t LittleFSFS::totalBytes() { return SIM_FS_TOTAL_BYTES; }
+
+size_t LittleFSFS::usedBytes() {
+  std::error_code ec;
+  size_t used = 0;
+  for (const auto &entry : stdfs::recursive_directory_iterator(root, ec)) {
+    if (entry.is_regular_file(ec)) used += entry.file_size(ec);
+  }
+  return used;
+}
+
+} // namespace fs
@@ -0,0 +1,41 @@
+#ifndef HostSim_OvenModelFile_h
+#define HostSim_OvenModelFile_h
+
+#include <ArduinoJson.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "SimOven.h"
+
+// Reads the oven of a model file as written by the identification tool
+// (src/identify), {"oven": {"ambient": 25, "heaterPower": 1200, ...}} with the
+// fields of OvenModel; fields it does not have keep the values in model.
+// Returns what is wrong or "". Header only, so only the programs that load
+// model files need ArduinoJson.
+inline String ReadOvenModel(const String &path, OvenModel &model) {
+  std::ifstream file(path.c_str());
+  if (!file) return "cannot open " + path;
+  std::stringstream text;
+  text << file.rdbuf();
+  JsonDocument doc;
+  if (deserializeJson(doc, text.str().c_str()) || !doc["oven"].is<JsonObject>()) return path + " is not a model file";
+
+  JsonVariant oven = doc["oven"];
+  OvenModel read = model;
+  read.ambient = oven["ambient"] | read.ambient;
+  read.heaterPower = oven["heaterPower"] | read.heaterPower;
+  read.elementCapacity = oven["elementCapacity"] | read.elementCapacity;
+  read.chamberCapacity = oven["chamberCapacity"] | read.chamberCapacity;
+  read.elementToChamber = oven["elementToChamber"] | read.elementToChamber;
+  read.chamberLoss = oven["chamberLoss"] | read.chamberLoss;
+  read.sensorTau = oven["sensorTau"] | read.sensorTau;
+  if (!(read.heaterPower > 0 && read.elementCapacity > 0 && read.chamberCapacity > 0 && read.elementToChamber > 0 &&
+        read.chamberLoss > 0 && read.sensorTau > 0)) {
+    return path + ": the oven's power, capacities, conductances and sensor lag must be positive";
+  }
+  model = read;
+  return "";
+}
+
+#endif
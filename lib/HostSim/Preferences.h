@@ -0,0 +1,66 @@
+#ifndef HostSim_Preferences_h
+#define HostSim_Preferences_h
+
+#include "Arduino.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Emulated NVS key/value store held in RAM, shared by every Preferences
+// object like the flash partition is. Only the blob calls the firmware uses.
+class Preferences
+{
+  public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr) {
+      (void)partitionLabel;
+      space = name;
+      readonly = readOnly;
+      open = true;
+      return true;
+    }
+    void end() { open = false; }
+
+    size_t getBytesLength(const char *key) {
+      auto entry = Entries().find(Key(key));
+      return open && entry != Entries().end() ? entry->second.size() : 0;
+    }
+    size_t getBytes(const char *key, void *buf, size_t maxLen) {
+      auto entry = Entries().find(Key(key));
+      if (!open || entry == Entries().end() || entry->second.size() > maxLen) return 0;
+      memcpy(buf, entry->second.data(), entry->second.size());
+      return entry->second.size();
+    }
+    size_t putBytes(const char *key, const void *value, size_t len) {
+      if (!open || readonly) return 0;
+      const uint8_t *bytes = (const uint8_t *)value;
+      Entries()[Key(key)].assign(bytes, bytes + len);
+      Writes()++;
+      return len;
+    }
+    bool remove(const char *key) { return open && !readonly && Entries().erase(Key(key)) > 0; }
+    bool clear() {
+      if (!open || readonly) return false;
+      for (auto entry = Entries().begin(); entry != Entries().end();) {
+        if (entry->first.compare(0, space.size() + 1, space + "/") == 0) entry = Entries().erase(entry);
+        else ++entry;
+      }
+      return true;
+    }
+
+    // host extras: blob writes since start, and a factory-new flash
+    static unsigned long &Writes() { static unsigned long writes = 0; return writes; }
+    static void Erase() { Entries().clear(); }
+
+  private:
+    std::string Key(const char *key) const { return space + "/" + key; }
+    static std::map<std::string, std::vector<uint8_t>> &Entries() {
+      static std::map<std::string, std::vector<uint8_t>> entries;
+      return entries;
+    }
+
+    std::string space;
+    bool readonly = false, open = false;
+};
+
+#endif
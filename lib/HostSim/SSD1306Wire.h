@@ -0,0 +1,37 @@
+#ifndef HostSim_SSD1306Wire_h
+#define HostSim_SSD1306Wire_h
+
+#include "Wire.h"
+
+// Headless SSD1306 display: accepts the drawing calls used by the firmware
+// and keeps the last drawn frame as text lines for inspection.
+extern const uint8_t ArialMT_Plain_10[];
+
+class SSD1306Wire
+{
+  public:
+    SSD1306Wire(uint8_t address, int sda, int scl) { (void)address; (void)sda; (void)scl; }
+
+    bool init() { return true; }
+    void displayOn() {}
+    void displayOff() {}
+    void setContrast(uint8_t contrast) { (void)contrast; }
+    void flipScreenVertically() {}
+    void setFont(const uint8_t *font) { (void)font; }
+    void clear() { for (String &line : lines) line = ""; }
+    void drawString(int16_t x, int16_t y, const String &text) {
+      (void)x;
+      if (y >= 0 && y / 10 < 8) lines[y / 10] = text;
+    }
+    void display() { frames++; }
+
+    // host extras
+    const String &Line(int row) const { return lines[row]; }
+    unsigned long Frames() const { return frames; }
+
+  private:
+    String lines[8];
+    unsigned long frames = 0;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "SimHttpClient.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static const double TIMEOUT_SECONDS = 30; // a test that waits longer is stuck
+
+static const char *MethodName(HTTPMethod method) {
+  switch (method) {
+    case HTTP_POST: return "POST";
+    case HTTP_HEAD: return "HEAD";
+    case HTTP_PUT: return "PUT";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_OPTIONS: return "OPTIONS";
+    case HTTP_PATCH: return "PATCH";
+    default: return "GET";
+  }
+}
+
+String SimHttpResponse::Header(const char *name) const {
+  for (const auto &header : headers) {
+    if (header.first.equalsIgnoreCase(name)) return header.second;
+  }
+  return String("");
+}
+
+bool SimHttpConnection::Open(uint16_t port, HTTPMethod method, const String &uri, const String &body,
+                             const SimHttpHeaders &headers, uint32_t pauseUs) {
+  Close();
+  received.clear();
+  headerEnd = receivedBytes = 0;
+  response = SimHttpResponse();
+
+  socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (socket < 0) return false;
+  int yes = 1;
+  setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  // the server's listen backlog takes it even while the server is busy
+  if (connect(socket, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    Close();
+    return false;
+  }
+
+  std::string request = std::string(MethodName(method)) + " " + uri.str() + " HTTP/1.1\r\nHost: 192.168.4.1\r\n";
+  for (const auto &header : headers) request += header.first.str() + ": " + header.second.str() + "\r\n";
+  if (body.length()) request += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.length()) + "\r\n";
+  request += "\r\n" + body.str();
+
+  size_t split = pauseUs ? request.size() / 2 : request.size();
+  for (size_t sent = 0; sent < request.size();) {
+    if (sent == split) std::this_thread::sleep_for(std::chrono::microseconds(pauseUs));
+    ssize_t n = send(socket, request.data() + sent, (sent < split ? split : request.size()) - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      Close();
+      return false;
+    }
+    sent += n;
+  }
+  return true;
+}
+
+void SimHttpConnection::SetReceiveBuffer(int bytes) {
+  if (socket >= 0) setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+}
+
+bool SimHttpConnection::Poll(const Pump &pump, size_t max) {
+  if (socket < 0) return false;
+  if (pump) pump();
+
+  char buffer[65536];
+  ssize_t n = recv(socket, buffer, std::min(max, sizeof(buffer)), pump ? MSG_DONTWAIT : 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+  if (n <= 0) {
+    ParseHeader();
+    if (headerEnd) response.body = String(received.substr(headerEnd));
+    Close();
+    return false;
+  }
+  received.append(buffer, n);
+  receivedBytes += n;
+  response.bytes = receivedBytes;
+  ParseHeader();
+  return true;
+}
+
+bool SimHttpConnection::WaitHeader(const Pump &pump) {
+  auto start = std::chrono::steady_clock::now();
+  while (!headerEnd && Poll(pump)) {
+    if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > TIMEOUT_SECONDS) return false;
+  }
+  return headerEnd > 0;
+}
+
+bool SimHttpConnection::WaitClosed(const Pump &pump) {
+  auto start = std::chrono::steady_clock::now();
+  while (Poll(pump)) {
+    if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > TIMEOUT_SECONDS) return false;
+  }
+  return true;
+}
+
+String SimHttpConnection::Take() {
+  if (!headerEnd || received.size() <= headerEnd) return String("");
+  String data(received.substr(headerEnd));
+  received.resize(headerEnd); // only the header is kept
+  return data;
+}
+
+void SimHttpConnection::Close() {
+  if (socket >= 0) close(socket);
+  socket = -1;
+}
+
+// splits the header off what was received into code, content type and headers
+void SimHttpConnection::ParseHeader() {
+  if (headerEnd) return;
+  size_t end = received.find("\r\n\r\n");
+  if (end == std::string::npos || received.compare(0, 9, "HTTP/1.1 ") != 0) return;
+  headerEnd = end + 4;
+
+  response.code = atoi(received.c_str() + 9);
+  size_t lineStart = received.find("\r\n") + 2;
+  while (lineStart < end) {
+    size_t lineEnd = received.find("\r\n", lineStart);
+    std::string line = received.substr(lineStart, lineEnd - lineStart);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      String name(line.substr(0, colon)), value(line.substr(colon + 1));
+      value.trim();
+      if (name.equalsIgnoreCase("Content-Type")) response.contentType = value;
+      else response.headers.push_back({name, value});
+    }
+    lineStart = lineEnd + 2;
+  }
+}
+
+SimHttpResponse SimHttpRequest(uint16_t port, HTTPMethod method, const String &uri, const String &body,
+                               const SimHttpHeaders &headers, const SimHttpConnection::Pump &pump) {
+  SimHttpConnection connection;
+  if (!connection.Open(port, method, uri, body, headers) || !connection.WaitClosed(pump)) return SimHttpResponse();
+  return connection.Response();
+}
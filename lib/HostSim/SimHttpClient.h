@@ -0,0 +1,76 @@
+#ifndef HostSim_SimHttpClient_h
+#define HostSim_SimHttpClient_h
+
+#include "Arduino.h"
+#include "HTTP_Method.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<String, String>> SimHttpHeaders;
+
+// A response as the browser sees it.
+struct SimHttpResponse
+{
+  int code = 0;
+  String contentType;
+  String body;
+  SimHttpHeaders headers;
+  size_t bytes = 0; // on the wire, header included
+
+  String Header(const char *name) const;
+};
+
+// A browser's connection to the firmware's server, over TCP on localhost.
+// When the firmware runs on the calling thread, pass a pump (normally
+// server.handleClient()): every wait then becomes non-blocking reads with a
+// pump call in between. Without one the calls block, for client threads next
+// to a firmware that runs on its own.
+class SimHttpConnection
+{
+  public:
+    typedef std::function<void()> Pump;
+
+    SimHttpConnection() = default;
+    SimHttpConnection(const SimHttpConnection &) = delete;
+    SimHttpConnection &operator=(const SimHttpConnection &) = delete;
+    ~SimHttpConnection() { Close(); }
+
+    // connects and sends the request; a pause splits it in two sends, like a slow uplink
+    bool Open(uint16_t port, HTTPMethod method, const String &uri, const String &body = String(""),
+              const SimHttpHeaders &headers = {}, uint32_t pauseUs = 0);
+    // a small receive buffer makes the server wait for a slow reader
+    void SetReceiveBuffer(int bytes);
+
+    // reads at most max bytes of what arrived, waits for some without a pump;
+    // false once the server closed the connection
+    bool Poll(const Pump &pump = nullptr, size_t max = 65536);
+    // until the response header is in, e.g. of a stream that stays open
+    bool WaitHeader(const Pump &pump = nullptr);
+    // until the server closed the connection; false after a wall-clock timeout
+    bool WaitClosed(const Pump &pump = nullptr);
+
+    const SimHttpResponse &Response() const { return response; }
+    // body received since the last call
+    String Take();
+    // bytes received, header included
+    size_t Received() const { return receivedBytes; }
+    bool Connected() const { return socket >= 0; }
+    void Close();
+
+  private:
+    void ParseHeader();
+
+    int socket = -1;
+    std::string received;
+    size_t headerEnd = 0, receivedBytes = 0;
+    SimHttpResponse response;
+};
+
+// one request, answered once the server closed the connection (code 0 when it never did)
+SimHttpResponse SimHttpRequest(uint16_t port, HTTPMethod method, const String &uri, const String &body = String(""),
+                               const SimHttpHeaders &headers = {}, const SimHttpConnection::Pump &pump = nullptr);
+
+#endif
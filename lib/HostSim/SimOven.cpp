@@ -0,0 +1,62 @@
+#include "SimOven.h"
+
+// explicit Euler is plenty: the fastest time constant of the plant is seconds
+static const uint64_t MAX_STEP_US = 10000;
+
+SimOven::SimOven(const OvenModel &model, const ThermistorModel &thermistor, uint32_t seed)
+  : model(model), thermistor(thermistor), rng(seed), noise(0.0f, thermistor.noise) {
+  element = chamber = sensor = model.ambient;
+  lastUpdate = SimClock::Micros();
+}
+
+void SimOven::SetHeater(bool on) {
+  SetHeaterAt(SimClock::Micros(), on);
+}
+
+uint16_t SimOven::ReadAdc() {
+  return ReadAdcAt(SimClock::Micros());
+}
+
+void SimOven::SetHeaterAt(uint64_t us, bool on) {
+  std::lock_guard<std::mutex> guard(lock);
+  AdvanceTo(us);
+  if (on && !heaterOn) switches++;
+  heaterOn = on;
+}
+
+uint16_t SimOven::ReadAdcAt(uint64_t us) {
+  std::lock_guard<std::mutex> guard(lock);
+  AdvanceTo(us);
+
+  // R(T) from the Beta equation, then the divider voltage as an ADC count
+  float kelvin = sensor + 273.15f;
+  float r = thermistor.nominal * expf(thermistor.beta * (1.0f / kelvin - 1.0f / (thermistor.nominalTemp + 273.15f)));
+  float adc = thermistor.adcMax * r / (r + thermistor.series);
+  if (thermistor.noise > 0) adc += noise(rng);
+
+  long count = lroundf(adc);
+  if (count < 0) count = 0;
+  if (count > thermistor.adcMax) count = thermistor.adcMax;
+  return (uint16_t)count;
+}
+
+void SimOven::AdvanceTo(uint64_t us) {
+  while (lastUpdate < us) {
+    uint64_t step = us - lastUpdate;
+    if (step > MAX_STEP_US) step = MAX_STEP_US;
+    Step(step * 1e-6f);
+    lastUpdate += step;
+  }
+}
+
+void SimOven::Step(float dt) {
+  float power = heaterOn ? model.heaterPower : 0;
+  float toChamber = model.elementToChamber * (element - chamber);
+  float toRoom = model.chamberLoss * (chamber - model.ambient);
+
+  element += dt * (power - toChamber) / model.elementCapacity;
+  chamber += dt * (toChamber - toRoom) / model.chamberCapacity;
+  sensor += dt * (chamber - sensor) / model.sensorTau;
+
+  if (heaterOn) heaterOnSeconds += dt;
+}
@@ -0,0 +1,74 @@
+#ifndef HostSim_SimOven_h
+#define HostSim_SimOven_h
+
+#include "Arduino.h"
+
+#include <mutex>
+#include <random>
+
+// Lumped two-node model of a small toaster oven.
+// The heating elements (node 1) are driven by the relay and heat the chamber
+// (node 2: air, tray and board), which loses heat to the room. The default
+// values give roughly 1.4 C/s at full power and a ~320 C ceiling.
+struct OvenModel
+{
+  float ambient = 25;           // room temperature (C)
+  float heaterPower = 1200;     // element power with the relay closed (W)
+  float elementCapacity = 150;  // heat capacity of elements and reflector (J/K)
+  float chamberCapacity = 700;  // heat capacity of air, tray and board (J/K)
+  float elementToChamber = 20;  // conductance elements -> chamber (W/K)
+  float chamberLoss = 4;        // conductance chamber -> room (W/K)
+  float sensorTau = 3;          // thermistor time constant (s)
+};
+
+// Thermistor in the low side of a divider against SERIESRESISTOR, read by a
+// 12-bit ADC, matching the wiring in Schematic.png.
+struct ThermistorModel
+{
+  float nominal = 100000;       // resistance at nominalTemp (Ohm)
+  float nominalTemp = 25;       // (C)
+  float beta = 4267;
+  float series = 5450;          // (Ohm)
+  int adcMax = 4095;
+  float noise = 1.5;            // ADC noise, standard deviation in LSB
+};
+
+class SimOven
+{
+  public:
+    SimOven(const OvenModel &model = OvenModel(), const ThermistorModel &thermistor = ThermistorModel(), uint32_t seed = 1);
+
+    void SetHeater(bool on);      // relay pin sink
+    uint16_t ReadAdc();           // thermistor pin source
+    // the same at a time of the caller's (us), for ovens that do not follow
+    // SimClock, e.g. one per thread of a sweep; time must not go backwards
+    void SetHeaterAt(uint64_t us, bool on);
+    uint16_t ReadAdcAt(uint64_t us);
+    void AdvanceTo(uint64_t us);  // integrate the plant up to a point in virtual time
+
+    float ElementTemp() const { return element; }
+    float ChamberTemp() const { return chamber; }
+    float SensorTemp() const { return sensor; }
+    bool HeaterOn() const { return heaterOn; }
+    unsigned long RelaySwitches() const { return switches; }
+    double HeaterOnSeconds() const { return heaterOnSeconds; }
+    double EnergyJoules() const { return heaterOnSeconds * model.heaterPower; }
+
+  private:
+    void Step(float dt);
+
+    std::mutex lock; // the relay and the ADC may be driven from different threads
+
+    OvenModel model;
+    ThermistorModel thermistor;
+    std::mt19937 rng;
+    std::normal_distribution<float> noise;
+
+    float element, chamber, sensor;
+    bool heaterOn = false;
+    uint64_t lastUpdate;
+    unsigned long switches = 0;
+    double heaterOnSeconds = 0;
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HostSim_WProgram_h
+#define HostSim_WProgram_h
+
+// Pre-1.0 Arduino header, included by libraries that test ARDUINO < 100.
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,139 @@
+#include "WString.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static std::string FormatInteger(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  int pos = sizeof(buf) - 1;
+  buf[pos] = '\0';
+  do {
+    int digit = value % base;
+    buf[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative) buf[--pos] = '-';
+  return std::string(buf + pos);
+}
+
+static std::string FormatSigned(long long value, unsigned char base) {
+  // like the Arduino core, only base 10 prints a sign
+  if (base == 10 && value < 0) return FormatInteger(0ULL - (unsigned long long)value, true, base);
+  return FormatInteger((unsigned long long)value, false, base);
+}
+
+static std::string FormatFloat(double value, unsigned int decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+  return std::string(buf);
+}
+
+String::String(const char *cstr) : buffer(cstr ? cstr : "") {}
+String::String(const char *cstr, unsigned int length) : buffer(cstr ? std::string(cstr, length) : "") {}
+String::String(char c) : buffer(1, c) {}
+String::String(unsigned char value, unsigned char base) : buffer(FormatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : buffer(FormatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : buffer(FormatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : buffer(FormatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : buffer(FormatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : buffer(FormatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : buffer(FormatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : buffer(FormatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : buffer(FormatFloat(value, decimalPlaces)) {}
+
+String &String::operator=(const char *cstr) {
+  // ArduinoJson assigns a null pointer to reset the destination string
+  buffer = cstr ? cstr : "";
+  return *this;
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+  if (buffer.length() != s.buffer.length()) return false;
+  for (size_t i = 0; i < buffer.length(); i++) {
+    if (tolower((unsigned char)buffer[i]) != tolower((unsigned char)s.buffer[i])) return false;
+  }
+  return true;
+}
+
+bool String::startsWith(const String &prefix) const {
+  return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  if (offset > buffer.length() || prefix.buffer.length() > buffer.length() - offset) return false;
+  return buffer.compare(offset, prefix.buffer.length(), prefix.buffer) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  if (suffix.buffer.length() > buffer.length()) return false;
+  return buffer.compare(buffer.length() - suffix.buffer.length(), suffix.buffer.length(), suffix.buffer) == 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  size_t pos = buffer.find(ch, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+  size_t pos = buffer.find(str.buffer, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const {
+  size_t pos = buffer.rfind(ch);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str) const {
+  size_t pos = buffer.rfind(str.buffer);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= buffer.length()) return String();
+  if (endIndex > buffer.length()) endIndex = buffer.length();
+  return String(buffer.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(const String &find, const String &replace) {
+  if (find.buffer.empty()) return;
+  size_t pos = 0;
+  while ((pos = buffer.find(find.buffer, pos)) != std::string::npos) {
+    buffer.replace(pos, find.buffer.length(), replace.buffer);
+    pos += replace.buffer.length();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= buffer.length()) return;
+  buffer.erase(index, count);
+}
+
+void String::toLowerCase() {
+  for (char &c : buffer) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char &c : buffer) c = toupper((unsigned char)c);
+}
+
+void String::trim() {
+  size_t begin = 0, end = buffer.length();
+  while (begin < end && isspace((unsigned char)buffer[begin])) begin++;
+  while (end > begin && isspace((unsigned char)buffer[end - 1])) end--;
+  buffer = buffer.substr(begin, end - begin);
+}
+
+long String::toInt() const { return atol(buffer.c_str()); }
+float String::toFloat() const { return (float)atof(buffer.c_str()); }
+double String::toDouble() const { return atof(buffer.c_str()); }
+
+String operator+(const String &lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, const char *rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char *lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
@@ -0,0 +1,99 @@
+#ifndef HostSim_WString_h
+#define HostSim_WString_h
+
+#include <string>
+#include <cstddef>
+
+// Host version of the Arduino String class.
+// Only the members used by the firmware (and by ArduinoJson's String adapter)
+// are provided, with the same semantics as the Arduino-ESP32 core.
+class String
+{
+  public:
+    String(const char *cstr = "");
+    String(const char *cstr, unsigned int length);
+    String(const std::string &str) : buffer(str) {}
+    String(const String &str) = default;
+    String(String &&str) = default;
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String &operator=(const String &rhs) = default;
+    String &operator=(String &&rhs) = default;
+    String &operator=(const char *cstr);
+
+    bool reserve(unsigned int size) { buffer.reserve(size); return true; }
+    unsigned int length() const { return buffer.length(); }
+    bool isEmpty() const { return buffer.empty(); }
+    const char *c_str() const { return buffer.c_str(); }
+    const std::string &str() const { return buffer; }
+
+    bool concat(const String &str) { buffer += str.buffer; return true; }
+    bool concat(const char *cstr) { if (cstr) buffer += cstr; return cstr != nullptr; }
+    bool concat(const char *cstr, unsigned int length) { if (cstr) buffer.append(cstr, length); return cstr != nullptr; }
+    bool concat(char c) { buffer += c; return true; }
+    bool concat(int num) { return concat(String(num)); }
+    bool concat(unsigned int num) { return concat(String(num)); }
+    bool concat(long num) { return concat(String(num)); }
+    bool concat(unsigned long num) { return concat(String(num)); }
+    bool concat(float num) { return concat(String(num)); }
+    bool concat(double num) { return concat(String(num)); }
+
+    template <typename T>
+    String &operator+=(const T &rhs) { concat(rhs); return *this; }
+
+    explicit operator bool() const { return true; }
+
+    int compareTo(const String &s) const { return buffer.compare(s.buffer); }
+    bool equals(const String &s) const { return buffer == s.buffer; }
+    bool equals(const char *cstr) const { return buffer == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &s) const;
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return buffer < rhs.buffer; }
+    bool startsWith(const String &prefix) const;
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const { return index < buffer.length() ? buffer[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < buffer.length()) buffer[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return buffer[index]; }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String &str) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, buffer.length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+  private:
+    std::string buffer;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+
+#endif
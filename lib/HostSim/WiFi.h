@@ -0,0 +1,29 @@
+#ifndef HostSim_WiFi_h
+#define HostSim_WiFi_h
+
+#include "Arduino.h"
+
+class IPAddress : public Printable
+{
+  public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+    String toString() const {
+      return String((int)octets[0]) + "." + String((int)octets[1]) + "." + String((int)octets[2]) + "." + String((int)octets[3]);
+    }
+    size_t printTo(Print &p) const override { return p.print(toString()); }
+
+  private:
+    uint8_t octets[4];
+};
+
+// The simulated soft-AP always comes up on the ESP32 default address.
+class WiFiClass
+{
+  public:
+    bool softAP(const char *ssid, const char *passphrase = nullptr) { (void)ssid; (void)passphrase; return true; }
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HostSim_Wire_h
+#define HostSim_Wire_h
+
+#include "Arduino.h"
+
+class TwoWire
+{
+  public:
+    bool begin(int sda = -1, int scl = -1) { (void)sda; (void)scl; return true; }
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,589 @@
+#include "HttpServer.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <lwip/sockets.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // lwIP has no SIGPIPE to suppress
+#endif
+
+static const char *Reason(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 408: return "Request Timeout";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+static HTTPMethod ParseMethod(const char *name) {
+  if (!strcmp(name, "GET")) return HTTP_GET;
+  if (!strcmp(name, "POST")) return HTTP_POST;
+  if (!strcmp(name, "HEAD")) return HTTP_HEAD;
+  if (!strcmp(name, "PUT")) return HTTP_PUT;
+  if (!strcmp(name, "DELETE")) return HTTP_DELETE;
+  if (!strcmp(name, "OPTIONS")) return HTTP_OPTIONS;
+  if (!strcmp(name, "PATCH")) return HTTP_PATCH;
+  return HTTP_ANY; // matches no route but a HTTP_ANY one
+}
+
+static int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// in place, the decoded text is never longer
+static void UrlDecode(char *text) {
+  char *out = text;
+  for (char *in = text; *in; in++) {
+    if (*in == '+') {
+      *out++ = ' ';
+    } else if (*in == '%' && HexValue(in[1]) >= 0 && HexValue(in[2]) >= 0) {
+      *out++ = (char)(HexValue(in[1]) * 16 + HexValue(in[2]));
+      in += 2;
+    } else {
+      *out++ = *in;
+    }
+  }
+  *out = 0;
+}
+
+// the body of a request without one, arg("plain") and body() read it as empty
+static char noBody[1];
+
+static char *Trim(char *text) {
+  while (*text == ' ' || *text == '\t') text++;
+  char *end = text + strlen(text);
+  while (end > text && (end[-1] == ' ' || end[-1] == '\t')) *--end = 0;
+  return text;
+}
+
+// ---------------- HttpStream ----------------
+
+bool HttpStream::connected() const {
+  if (!server) return false;
+  const HttpServer::Connection &connection = server->connections[slot];
+  return connection.state == HttpServer::CONNECTION_STREAMING && connection.generation == generation;
+}
+
+size_t HttpStream::write(const uint8_t *data, size_t length) {
+  if (!connected()) return 0;
+  HttpServer::Connection &connection = server->connections[slot];
+
+  // move what is still unsent to the front, then append
+  if (connection.txSent > 0) {
+    memmove(connection.tx, connection.tx + connection.txSent, connection.txLength - connection.txSent);
+    connection.txLength -= connection.txSent;
+    connection.txSent = 0;
+  }
+  if (connection.txLength + length > sizeof(connection.tx)) return 0;
+  memcpy(connection.tx + connection.txLength, data, length);
+  connection.txLength += length;
+
+  server->Send(connection);
+  return length;
+}
+
+void HttpStream::stop() {
+  if (connected()) server->Close(server->connections[slot]);
+}
+
+// ---------------- HttpServer ----------------
+
+HttpServer::HttpServer(uint16_t port)
+  : port(port), listener(-1), routeCount(0), notFound(nullptr), current(nullptr),
+    pendingHeadersLength(0), requests(0), generations(0)
+{
+  for (Connection &connection : connections) {
+    connection.socket = -1;
+    connection.state = CONNECTION_FREE;
+    connection.generation = 0;
+    connection.producer = nullptr;
+    connection.body = noBody;
+  }
+  for (Connection *&owner : bodyOwners) owner = nullptr;
+}
+
+void HttpServer::begin() {
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) return;
+
+  int yes = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, HTTP_LISTEN_BACKLOG) < 0) {
+    close(listener);
+    listener = -1;
+    return;
+  }
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+
+  socklen_t length = sizeof(address);
+  if (getsockname(listener, (struct sockaddr *)&address, &length) == 0) port = ntohs(address.sin_port);
+}
+
+void HttpServer::on(const char *uri, HTTPMethod method, Handler handler) {
+  if (routeCount < HTTP_MAX_ROUTES) routes[routeCount++] = {uri, method, handler};
+}
+
+int HttpServer::Connections() const {
+  int count = 0;
+  for (const Connection &connection : connections) {
+    if (connection.state != CONNECTION_FREE) count++;
+  }
+  return count;
+}
+
+void HttpServer::handleClient() {
+  if (listener < 0) return;
+  Accept();
+
+  for (Connection &connection : connections) {
+    switch (connection.state) {
+      case CONNECTION_FREE:
+        break;
+
+      case CONNECTION_READING:
+        Receive(connection);
+        // since is the accept: trickling bytes does not buy a slow client more time
+        if (connection.state == CONNECTION_READING && millis() - connection.since > HTTP_REQUEST_TIMEOUT_MS) Close(connection);
+        break;
+
+      case CONNECTION_SENDING:
+        Send(connection);
+        if (connection.state == CONNECTION_SENDING && millis() - connection.since > HTTP_SEND_TIMEOUT_MS) Close(connection);
+        break;
+
+      case CONNECTION_STREAMING: {
+        // nothing is expected from the other side, reading only tells when it hung up
+        char scratch[64];
+        int n = recv(connection.socket, scratch, sizeof(scratch), MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+          Close(connection);
+          break;
+        }
+        Send(connection);
+        if (connection.state == CONNECTION_STREAMING && connection.txSent < connection.txLength &&
+            millis() - connection.since > HTTP_SEND_TIMEOUT_MS) {
+          Close(connection);
+        }
+        break;
+      }
+    }
+  }
+}
+
+void HttpServer::Accept() {
+  for (uint8_t slot = 0; slot < HTTP_MAX_CONNECTIONS; slot++) {
+    Connection &connection = connections[slot];
+    if (connection.state != CONNECTION_FREE) continue;
+
+    // connections beyond the free slots wait in the listen backlog
+    int client = accept(listener, nullptr, nullptr);
+    if (client < 0) return;
+
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+    int yes = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+    connection.socket = client;
+    connection.state = CONNECTION_READING;
+    connection.generation = ++generations;
+    connection.since = millis();
+    connection.rxLength = 0;
+    connection.rx[0] = 0;
+    connection.headerEnd = 0;
+    connection.body = noBody;
+    connection.bodyLength = connection.bodyReceived = 0;
+    connection.txLength = connection.txSent = 0;
+    connection.contentSent = 0;
+    connection.responded = false;
+  }
+}
+
+void HttpServer::Receive(Connection &connection) {
+  // the request line and headers go to rx, once they are in the body goes to its own buffer
+  bool header = !connection.headerEnd;
+  char *into = header ? connection.rx + connection.rxLength : connection.body + connection.bodyReceived;
+  size_t space = header ? HTTP_RX_BUFFER_SIZE - connection.rxLength : connection.bodyLength - connection.bodyReceived;
+  if (space > 0) {
+    int n = recv(connection.socket, into, space, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      Close(connection);
+      return;
+    }
+    if (n < 0) return;
+    if (header) {
+      connection.rxLength += n;
+      connection.rx[connection.rxLength] = 0;
+    } else {
+      connection.bodyReceived += n;
+    }
+  }
+
+  if (Parse(connection)) Dispatch(connection);
+}
+
+// true once the whole request is in, errors are answered right here
+bool HttpServer::Parse(Connection &connection) {
+  if (!connection.headerEnd) {
+    char *end = strstr(connection.rx, "\r\n\r\n");
+    if (!end) {
+      if (connection.rxLength == HTTP_RX_BUFFER_SIZE) {
+        current = &connection;
+        send(431, "text/plain", "Request header too large");
+        current = nullptr;
+        connection.state = CONNECTION_SENDING;
+      }
+      return false;
+    }
+    *end = 0;
+    connection.headerEnd = end - connection.rx + 4;
+
+    // request line: METHOD URI VERSION
+    char *line = connection.rx;
+    char *next = strstr(line, "\r\n");
+    if (next) *next = 0;
+    char *uri = strchr(line, ' ');
+    if (uri) *uri++ = 0;
+    char *version = uri ? strchr(uri, ' ') : nullptr;
+    if (version) *version = 0;
+    connection.method = ParseMethod(line);
+    connection.path = uri ? uri : "/";
+
+    connection.argCount = 0;
+    char *query = uri ? strchr(uri, '?') : nullptr;
+    if (query) {
+      *query++ = 0;
+      char *saveptr = nullptr;
+      for (char *pair = strtok_r(query, "&", &saveptr); pair && connection.argCount < HTTP_MAX_ARGS; pair = strtok_r(nullptr, "&", &saveptr)) {
+        char *value = strchr(pair, '=');
+        if (value) *value++ = 0;
+        UrlDecode(pair);
+        if (value) UrlDecode(value);
+        connection.args[connection.argCount++] = {pair, value ? value : ""};
+      }
+    }
+    if (uri) UrlDecode(uri);
+
+    connection.headerCount = 0;
+    connection.bodyLength = 0;
+    for (line = next ? next + 2 : nullptr; line && *line; line = next) {
+      next = strstr(line, "\r\n");
+      if (next) {
+        *next = 0;
+        next += 2;
+      }
+      char *colon = strchr(line, ':');
+      if (!colon) continue;
+      *colon = 0;
+      const char *name = Trim(line), *value = Trim(colon + 1);
+      // the length counts even among headers beyond those kept
+      if (!strcasecmp(name, "Content-Length")) connection.bodyLength = strtoul(value, nullptr, 10);
+      if (connection.headerCount < HTTP_MAX_HEADERS) connection.headers[connection.headerCount++] = {name, value};
+    }
+
+    if (connection.bodyLength > HTTP_BODY_BUFFER_SIZE) {
+      current = &connection;
+      send(413, "text/plain", "Request body too large");
+      current = nullptr;
+      connection.state = CONNECTION_SENDING;
+      return false;
+    }
+    if (connection.bodyLength > 0 && !TakeBody(connection)) {
+      current = &connection;
+      send(503, "text/plain", "Server busy, try again");
+      current = nullptr;
+      connection.state = CONNECTION_SENDING;
+      return false;
+    }
+
+    // what came with the headers is the start of the body
+    connection.bodyReceived = std::min(connection.rxLength - connection.headerEnd, connection.bodyLength);
+    memcpy(connection.body, connection.rx + connection.headerEnd, connection.bodyReceived);
+  }
+
+  if (connection.bodyReceived < connection.bodyLength) return false;
+  connection.body[connection.bodyLength] = 0;
+  return true;
+}
+
+void HttpServer::Dispatch(Connection &connection) {
+  requests++;
+  current = &connection;
+  pendingHeadersLength = 0;
+  currentBody.Reset(connection.body, connection.bodyLength);
+
+  // HEAD is GET without the body, the responses leave it out
+  HTTPMethod method = connection.method == HTTP_HEAD ? HTTP_GET : connection.method;
+  Handler handler = notFound;
+  for (uint8_t i = 0; i < routeCount; i++) {
+    if (!strcmp(routes[i].uri, connection.path) && (routes[i].method == HTTP_ANY || routes[i].method == method)) {
+      handler = routes[i].handler;
+      break;
+    }
+  }
+  if (handler) handler();
+  else send(404, "text/plain", "Not found");
+  current = nullptr;
+  ReleaseBody(connection);
+
+  if (connection.state == CONNECTION_STREAMING) return;
+  if (!connection.responded) {
+    Close(connection); // like the Arduino WebServer, no response closes the connection
+    return;
+  }
+  connection.state = CONNECTION_SENDING;
+  Send(connection);
+}
+
+size_t HttpServer::Transmit(Connection &connection, const char *data, size_t length) {
+  int n = ::send(connection.socket, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (n > 0) {
+    connection.since = millis();
+    return n;
+  }
+  if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) Close(connection);
+  return 0;
+}
+
+// sends what the socket takes, at most one buffer per call
+void HttpServer::Send(Connection &connection) {
+  size_t budget = HTTP_TX_BUFFER_SIZE;
+  while (budget > 0 && connection.state != CONNECTION_FREE) {
+    if (connection.txSent < connection.txLength) {
+      size_t n = Transmit(connection, connection.tx + connection.txSent, std::min(connection.txLength - connection.txSent, budget));
+      if (!n) return;
+      connection.txSent += n;
+      budget -= n;
+      continue;
+    }
+    connection.txLength = connection.txSent = 0;
+    if (connection.state == CONNECTION_STREAMING) return;
+
+    if (connection.contentSent < connection.content.length()) {
+      size_t n = Transmit(connection, connection.content.c_str() + connection.contentSent,
+                          std::min(connection.content.length() - connection.contentSent, budget));
+      if (!n) return;
+      connection.contentSent += n;
+      budget -= n;
+      continue;
+    }
+    if (connection.file) {
+      size_t n = connection.file.read((uint8_t *)connection.tx, std::min(sizeof(connection.tx), budget));
+      if (n > 0) {
+        connection.txLength = n;
+        continue;
+      }
+    }
+    if (connection.producer) {
+      if (budget < sizeof(connection.tx)) return; // it gets a whole buffer, on the next pass
+      size_t n = connection.producer->Read(connection.tx, sizeof(connection.tx));
+      if (n > 0) {
+        connection.txLength = n;
+        continue;
+      }
+    }
+    Close(connection); // all sent
+    return;
+  }
+}
+
+void HttpServer::Close(Connection &connection) {
+  if (connection.socket >= 0) close(connection.socket);
+  connection.socket = -1;
+  connection.state = CONNECTION_FREE;
+  connection.content = String(); // frees a large body right away
+  connection.file = File();
+  Release(connection);
+  ReleaseBody(connection);
+}
+
+void HttpServer::Release(Connection &connection) {
+  if (!connection.producer) return;
+  connection.producer->Release();
+  connection.producer = nullptr;
+}
+
+bool HttpServer::TakeBody(Connection &connection) {
+  for (uint8_t i = 0; i < HTTP_BODY_BUFFERS; i++) {
+    if (bodyOwners[i]) continue;
+    bodyOwners[i] = &connection;
+    connection.body = bodies[i];
+    return true;
+  }
+  return false;
+}
+
+void HttpServer::ReleaseBody(Connection &connection) {
+  for (Connection *&owner : bodyOwners) {
+    if (owner == &connection) owner = nullptr;
+  }
+  connection.body = noBody;
+  connection.bodyLength = connection.bodyReceived = 0;
+}
+
+// ---------------- Request ----------------
+
+String HttpServer::uri() const {
+  return current ? String(current->path) : String("");
+}
+
+HTTPMethod HttpServer::method() const {
+  return current ? current->method : HTTP_GET;
+}
+
+String HttpServer::arg(const String &name) const {
+  if (!current) return String("");
+  if (name == "plain") return String(current->body);
+  for (uint8_t i = 0; i < current->argCount; i++) {
+    if (name == current->args[i].name) return String(current->args[i].value);
+  }
+  return String("");
+}
+
+bool HttpServer::hasArg(const String &name) const {
+  if (!current) return false;
+  if (name == "plain") return current->bodyLength > 0;
+  for (uint8_t i = 0; i < current->argCount; i++) {
+    if (name == current->args[i].name) return true;
+  }
+  return false;
+}
+
+String HttpServer::header(const String &name) const {
+  if (!current) return String("");
+  for (uint8_t i = 0; i < current->headerCount; i++) {
+    if (!strcasecmp(name.c_str(), current->headers[i].name)) return String(current->headers[i].value);
+  }
+  return String("");
+}
+
+bool HttpServer::hasHeader(const String &name) const {
+  if (!current) return false;
+  for (uint8_t i = 0; i < current->headerCount; i++) {
+    if (!strcasecmp(name.c_str(), current->headers[i].name)) return true;
+  }
+  return false;
+}
+
+Stream &HttpServer::body() {
+  return currentBody;
+}
+
+// ---------------- Response ----------------
+
+void HttpServer::sendHeader(const String &name, const String &value, bool first) {
+  size_t length = name.length() + value.length() + 4;
+  if (pendingHeadersLength + length >= sizeof(pendingHeaders)) return;
+  if (first) memmove(pendingHeaders + length, pendingHeaders, pendingHeadersLength);
+  char *at = first ? pendingHeaders : pendingHeaders + pendingHeadersLength;
+  memcpy(at, name.c_str(), name.length());
+  memcpy(at + name.length(), ": ", 2);
+  memcpy(at + name.length() + 2, value.c_str(), value.length());
+  memcpy(at + length - 2, "\r\n", 2);
+  pendingHeadersLength += length;
+}
+
+void HttpServer::BeginResponse(int code, const char *contentType, size_t length, const char *extraHeader) {
+  Connection &connection = *current;
+  if (connection.state == CONNECTION_STREAMING) connection.state = CONNECTION_READING; // answered after all
+  connection.since = millis(); // the send timeout counts from here
+  int n = snprintf(connection.tx, sizeof(connection.tx), "HTTP/1.1 %d %s\r\n", code, Reason(code));
+  if (contentType && *contentType) n += snprintf(connection.tx + n, sizeof(connection.tx) - n, "Content-Type: %s\r\n", contentType);
+  if (length != SIZE_MAX) n += snprintf(connection.tx + n, sizeof(connection.tx) - n, "Content-Length: %u\r\n", (unsigned)length);
+  n += snprintf(connection.tx + n, sizeof(connection.tx) - n, "%s%.*sConnection: close\r\n\r\n",
+                extraHeader ? extraHeader : "", (int)pendingHeadersLength, pendingHeaders);
+  connection.txLength = std::min((size_t)n, sizeof(connection.tx));
+  connection.txSent = 0;
+  connection.content = String();
+  connection.contentSent = 0;
+  connection.file = File();
+  Release(connection);
+  connection.responded = true;
+  pendingHeadersLength = 0;
+}
+
+void HttpServer::send(int code, const char *contentType, const char *content, size_t length) {
+  if (!current || current->responded) return;
+  BeginResponse(code, contentType, length);
+  if (current->method == HTTP_HEAD) return;
+  if (current->txLength + length <= sizeof(current->tx)) {
+    memcpy(current->tx + current->txLength, content, length);
+    current->txLength += length;
+  } else {
+    current->content = String(content, length);
+  }
+}
+
+void HttpServer::send(int code, const char *contentType, const String &content) {
+  if (!current || current->responded) return;
+  BeginResponse(code, contentType, content.length());
+  if (current->method == HTTP_HEAD) return;
+  if (current->txLength + content.length() <= sizeof(current->tx)) {
+    memcpy(current->tx + current->txLength, content.c_str(), content.length());
+    current->txLength += content.length();
+  } else {
+    current->content = content;
+  }
+}
+
+size_t HttpServer::streamFile(File &file, const String &contentType, int code) {
+  if (!current || current->responded) return 0;
+  // like the Arduino WebServer: a .gz file is sent as the compressed form of the content type
+  String name = file.name();
+  bool gzip = name.endsWith(".gz") && contentType != "application/x-gzip" && contentType != "application/octet-stream";
+  BeginResponse(code, contentType.c_str(), file.size(), gzip ? "Content-Encoding: gzip\r\n" : nullptr);
+  if (current->method != HTTP_HEAD) current->file = file;
+  return file.size();
+}
+
+void HttpServer::send(int code, const char *contentType, HttpContent *content) {
+  if (!current || current->responded) {
+    if (content) content->Release();
+    return;
+  }
+  BeginResponse(code, contentType, SIZE_MAX);
+  if (current->method != HTTP_HEAD) current->producer = content;
+  else if (content) content->Release();
+}
+
+HttpStream HttpServer::stream() {
+  if (!current) return HttpStream();
+  if (current->method == HTTP_HEAD) {
+    // all a stream writes is body, only the status line and headers are sent
+    if (!current->responded) BeginResponse(200, nullptr, SIZE_MAX);
+    return HttpStream();
+  }
+  current->state = CONNECTION_STREAMING;
+  current->txLength = current->txSent = 0;
+  current->since = millis();
+  return HttpStream(this, (uint8_t)(current - connections), current->generation);
+}
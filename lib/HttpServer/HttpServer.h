@@ -0,0 +1,219 @@
+#ifndef HttpServer_h
+#define HttpServer_h
+
+#include <Arduino.h>
+#include <FS.h>
+#include <HTTP_Method.h>
+
+// Non-blocking HTTP/1.1 server on BSD sockets (lwIP on the ESP32, POSIX on a PC).
+//
+// handleClient() makes one pass over every connection and never waits: it
+// accepts what is pending, reads what has arrived, runs the handler of every
+// request that is complete, and sends at most one buffer per connection. A
+// phone on a weak signal downloading the logo therefore costs a few hundred
+// microseconds per pass instead of holding the loop until it is done.
+//
+// The route API is that of the Arduino WebServer (on(), send(), arg(),
+// streamFile(), ...), so handlers did not change. The request line, headers
+// and arguments are parsed in place in a fixed receive buffer per connection,
+// the body goes to one of a few body buffers, and small responses are copied
+// into a fixed send buffer, so none of them needs heap; String contents and
+// files are sent from where they are. Bodies are not streamed off the socket:
+// the largest one the firmware takes, a 12-segment profile, is at most 1.4 kB
+// of JSON, and a bounded buffer sized for it keeps parsing simple and free of
+// allocations. Larger headers or bodies are refused with 431 or 413.
+//
+// Memory: all of it is static, about 3.4 kB per connection (receive and send
+// buffer, header and argument pointers) plus 2 kB per body buffer, 31 kB with
+// the defaults below. Only a POST has a body and the web page posts one at a
+// time, so the body buffers are shared: a connection takes one once its
+// headers announce a body and gives it back when its handler returns. When
+// all are taken the request is answered with 503 "Server busy, try again".
+//
+// A HEAD request is handled by the GET route and answered with the headers
+// alone, Content-Length included (RFC 9110, 9.3.2).
+//
+// Every response closes its connection, like the Arduino WebServer. A handler
+// can keep the connection instead with stream(), e.g. for server-sent events.
+
+#define HTTP_MAX_CONNECTIONS 8
+#define HTTP_LISTEN_BACKLOG 16        // connections waiting for a free slot
+#define HTTP_MAX_ROUTES 24
+#define HTTP_MAX_HEADERS 24           // a mobile browser sends about 20
+#define HTTP_MAX_ARGS 8
+#define HTTP_RX_BUFFER_SIZE 1536      // request line and headers, a browser sends 600-800 bytes
+#define HTTP_BODY_BUFFER_SIZE 2048    // the largest body, a 12-segment profile is at most 1.4 kB as JSON
+#define HTTP_BODY_BUFFERS 2           // requests with a body handled at the same time
+#define HTTP_TX_BUFFER_SIZE 1536      // response header and small bodies, one send per pass
+#define HTTP_HEADER_BUFFER_SIZE 384   // headers added with sendHeader()
+#define HTTP_REQUEST_TIMEOUT_MS 5000  // to receive a whole request, from the accept
+#define HTTP_SEND_TIMEOUT_MS 10000    // without any progress while sending
+
+class HttpServer;
+
+// A response body produced while it is sent, e.g. a CSV export generated from a
+// binary file. The server calls Read() whenever the send buffer is free and
+// Release() once the connection is done with it, sent or not.
+class HttpContent
+{
+  public:
+    virtual ~HttpContent() {}
+    // fills at most size bytes (a whole send buffer), 0 at the end
+    virtual size_t Read(char *buffer, size_t size) = 0;
+    virtual void Release() {}
+};
+
+// A connection kept open by a handler. Copies refer to the same connection,
+// and a stale copy stays disconnected after its slot was reused.
+class HttpStream
+{
+  public:
+    HttpStream() : server(nullptr), slot(0), generation(0) {}
+
+    bool connected() const;
+    // all or nothing: returns 0 when the data does not fit the send buffer
+    size_t write(const uint8_t *data, size_t length);
+    void stop();
+
+  private:
+    friend class HttpServer;
+    HttpStream(HttpServer *server, uint8_t slot, uint32_t generation) : server(server), slot(slot), generation(generation) {}
+
+    HttpServer *server;
+    uint8_t slot;
+    uint32_t generation;
+};
+
+// The request body, read in place from its buffer (deserializeJson(doc, server.body())).
+class HttpBody : public Stream
+{
+  public:
+    HttpBody() : data(nullptr), length(0), position(0) {}
+    void Reset(const char *body, size_t size) { data = body; length = size; position = 0; }
+
+    int available() override { return (int)(length - position); }
+    int read() override { return position < length ? (uint8_t)data[position++] : -1; }
+    int peek() override { return position < length ? (uint8_t)data[position] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+  private:
+    const char *data;
+    size_t length, position;
+};
+
+class HttpServer
+{
+  public:
+    typedef void (*Handler)();
+
+    explicit HttpServer(uint16_t port = 80);
+
+    // the port takes effect at begin(), 0 lets the system pick a free one
+    void SetPort(uint16_t port) { this->port = port; }
+    uint16_t Port() const { return port; }
+    void begin();
+    void handleClient();
+
+    void on(const char *uri, HTTPMethod method, Handler handler);
+    void on(const char *uri, Handler handler) { on(uri, HTTP_ANY, handler); }
+    void onNotFound(Handler handler) { notFound = handler; }
+
+    // the request being handled
+    String uri() const;
+    HTTPMethod method() const;
+    String arg(const String &name) const; // "plain" is the body
+    bool hasArg(const String &name) const;
+    String header(const String &name) const;
+    bool hasHeader(const String &name) const;
+    void collectHeaders(const char *headerKeys[], size_t headerKeysCount) { (void)headerKeys; (void)headerKeysCount; } // every header is kept
+    Stream &body();
+
+    // the response
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void send(int code, const char *contentType = nullptr, const String &content = String(""));
+    void send(int code, const char *contentType, const char *content) { send(code, contentType, content, content ? strlen(content) : 0); }
+    // copies the content into the send buffer when it fits, so it may change right after
+    void send(int code, const char *contentType, const char *content, size_t length);
+    // the server keeps a copy of the file until it is sent, do not close() it
+    size_t streamFile(File &file, const String &contentType, int code = 200);
+    // sends what content produces, without a Content-Length; the end of the
+    // body is the end of the connection
+    void send(int code, const char *contentType, HttpContent *content);
+    // keeps the connection open after the handler, nothing is sent for it
+    // unless the handler still calls send()
+    HttpStream stream();
+
+    uint32_t Requests() const { return requests; }
+    int Connections() const;
+
+  private:
+    friend class HttpStream;
+
+    enum ConnectionState { CONNECTION_FREE, CONNECTION_READING, CONNECTION_SENDING, CONNECTION_STREAMING };
+
+    struct Pair {
+      const char *name, *value;
+    };
+
+    struct Connection {
+      int socket;
+      ConnectionState state;
+      uint32_t generation;
+      unsigned long since; // millis() of the accept while reading, of the last progress while sending
+
+      char rx[HTTP_RX_BUFFER_SIZE + 1]; // +1 keeps the headers 0-terminated
+      size_t rxLength;
+      HTTPMethod method;
+      const char *path;
+      Pair headers[HTTP_MAX_HEADERS];
+      Pair args[HTTP_MAX_ARGS];
+      uint8_t headerCount, argCount;
+      size_t headerEnd; // 0 until the blank line after the headers arrived
+      char *body; // one of the body buffers while a body is received and handled, see TakeBody()
+      size_t bodyLength, bodyReceived;
+
+      char tx[HTTP_TX_BUFFER_SIZE];
+      size_t txLength, txSent;
+      String content; // a response body too large for tx
+      size_t contentSent;
+      File file;      // a streamed file
+      HttpContent *producer; // a generated body
+      bool responded;
+    };
+
+    struct Route {
+      const char *uri;
+      HTTPMethod method;
+      Handler handler;
+    };
+
+    void Accept();
+    void Receive(Connection &connection);
+    bool Parse(Connection &connection);
+    void Dispatch(Connection &connection);
+    void Send(Connection &connection);
+    void Close(Connection &connection);
+    // a length of SIZE_MAX leaves out Content-Length
+    void BeginResponse(int code, const char *contentType, size_t length, const char *extraHeader = nullptr);
+    void Release(Connection &connection);
+    bool TakeBody(Connection &connection);
+    void ReleaseBody(Connection &connection);
+    size_t Transmit(Connection &connection, const char *data, size_t length); // non-blocking, closes on errors
+
+    uint16_t port;
+    int listener;
+    Route routes[HTTP_MAX_ROUTES];
+    uint8_t routeCount;
+    Handler notFound;
+    Connection connections[HTTP_MAX_CONNECTIONS];
+    char bodies[HTTP_BODY_BUFFERS][HTTP_BODY_BUFFER_SIZE + 1]; // +1 keeps a body 0-terminated
+    Connection *bodyOwners[HTTP_BODY_BUFFERS];
+    Connection *current; // inside a handler
+    HttpBody currentBody;
+    char pendingHeaders[HTTP_HEADER_BUFFER_SIZE];
+    size_t pendingHeadersLength;
+    uint32_t requests;
+    uint32_t generations;
+};
+
+#endif
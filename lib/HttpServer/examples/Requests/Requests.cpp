@@ -0,0 +1,175 @@
+// Host check for HttpServer over localhost TCP: bodies, browser headers, large and generated responses, HEAD, limits, streams and silent clients.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/HostSim -I lib/HttpServer lib/HostSim/*.cpp lib/HttpServer/HttpServer.cpp lib/HttpServer/examples/Requests/Requests.cpp -o http_requests && ./http_requests
+
+#include <HttpServer.h>
+#include <SimHttpClient.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// a profile name as the profile store keeps it, at most 47 bytes
+static const size_t PROFILE_NAME_LENGTH = 47;
+
+static HttpServer server(0);
+static HttpStream kept;
+static int failures = 0;
+
+// counts to 20000, one line at a time, like a CSV export
+class Counter : public HttpContent
+{
+  public:
+    size_t Read(char *buffer, size_t size) override {
+      size_t filled = 0;
+      while (next <= 20000 && filled + 8 <= size) filled += snprintf(buffer + filled, 8, "%d\n", next++);
+      return filled;
+    }
+    void Release() override { released++; }
+
+    int next = 1, released = 0;
+};
+static Counter counter;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static void Pump() {
+  server.handleClient();
+}
+
+static SimHttpResponse Request(HTTPMethod method, const char *uri, const String &body = String(""),
+                               const SimHttpHeaders &headers = {}) {
+  return SimHttpRequest(server.Port(), method, uri, body, headers, Pump);
+}
+
+int main() {
+  server.on("/hello", HTTP_GET, []() { server.send(200, "text/plain", "hello " + server.arg("name")); });
+  server.on("/echo", HTTP_POST, []() {
+    String body;
+    for (int c = server.body().read(); c >= 0; c = server.body().read()) body += (char)c;
+    server.sendHeader("X-Length", String((int)body.length()));
+    server.send(200, "application/json", body);
+  });
+  server.on("/large", HTTP_GET, []() { server.send(200, "text/plain", String(std::string(100000, 'x'))); });
+  server.on("/keep", HTTP_GET, []() { kept = server.stream(); });
+  server.on("/count", HTTP_GET, []() { server.send(200, "text/plain", &counter); });
+  server.begin();
+  Expect(server.Port() != 0, "listening on a free port");
+
+  SimHttpResponse reply = Request(HTTP_GET, "/hello?name=tosti%20reflow&x");
+  Expect(reply.code == 200 && reply.body == "hello tosti reflow", "query argument decoded");
+  Expect(Request(HTTP_POST, "/hello").code == 404, "wrong method is not found");
+  Expect(Request(HTTP_GET, "/nothing").code == 404, "unknown path is not found");
+
+  SimHttpConnection split;
+  split.Open(server.Port(), HTTP_POST, "/echo", "{\"kp\":0.05,\"ki\":0}", {}, 20000);
+  split.WaitClosed(Pump);
+  Expect(split.Response().code == 200 && split.Response().body == "{\"kp\":0.05,\"ki\":0}" &&
+         split.Response().Header("X-Length") == "18", "body in two halves read as a stream");
+
+  // the longest profile the web page can post: 12 segments with a full name and numbers as JSON.stringify() writes them
+  String profile = "{\"name\":\"" + String(std::string(PROFILE_NAME_LENGTH, 'n')) + "\",\"segments\":[";
+  for (int i = 0; i < 12; i++) {
+    profile += String(i ? "," : "") + "{\"type\":\"until\",\"phase\":\"cooldown\",\"target\":249.99999999999997," +
+               "\"rate\":0.30000000000000004,\"time\":86400000}";
+  }
+  profile += "]}";
+  SimHttpHeaders browser = {
+      {"Connection", "keep-alive"},
+      {"sec-ch-ua", "\"Chromium\";v=\"128\", \"Not;A=Brand\";v=\"24\", \"Google Chrome\";v=\"128\""},
+      {"sec-ch-ua-platform", "\"Android\""},
+      {"sec-ch-ua-mobile", "?1"},
+      {"User-Agent", "Mozilla/5.0 (Linux; Android 10; K) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Mobile Safari/537.36"},
+      {"Accept", "*/*"},
+      {"Origin", "http://192.168.4.1"},
+      {"Sec-Fetch-Site", "same-origin"},
+      {"Sec-Fetch-Mode", "cors"},
+      {"Sec-Fetch-Dest", "empty"},
+      {"Referer", "http://192.168.4.1/"},
+      {"Accept-Encoding", "gzip, deflate"},
+      {"Accept-Language", "nl-NL,nl;q=0.9,en-US;q=0.8,en;q=0.7,de;q=0.6"},
+      {"Cache-Control", "no-cache"},
+      {"Pragma", "no-cache"},
+      {"Priority", "u=1, i"},
+      {"X-Requested-With", "com.android.chrome"},
+  };
+  size_t headerBytes = 0;
+  for (const auto &header : browser) headerBytes += header.first.length() + header.second.length() + 4;
+  printf("  12-segment profile %u bytes behind %u bytes of browser headers\n", (unsigned)profile.length(), (unsigned)headerBytes);
+  reply = Request(HTTP_POST, "/echo", profile, browser);
+  Expect(reply.code == 200 && reply.body == profile && profile.length() + headerBytes > HTTP_RX_BUFFER_SIZE,
+         "12-segment profile with browser headers accepted");
+
+  reply = Request(HTTP_GET, "/large");
+  Expect(reply.code == 200 && reply.body.length() == 100000, "response larger than the send buffer");
+
+  reply = Request(HTTP_GET, "/count");
+  Expect(reply.code == 200 && reply.Header("Content-Length") == "" && reply.body.endsWith("\n19999\n20000\n") &&
+         reply.body.length() == 108894 && counter.released == 1, "generated response ends with the connection");
+
+  // HEAD gets the headers of the GET, Content-Length included, and no body
+  reply = Request(HTTP_HEAD, "/hello?name=head");
+  Expect(reply.code == 200 && reply.Header("Content-Length") == "10" && reply.bytes > 0 && reply.body == "",
+         "HEAD answered with the headers alone");
+  reply = Request(HTTP_HEAD, "/large");
+  Expect(reply.code == 200 && reply.Header("Content-Length") == "100000" && reply.body == "", "HEAD of a large response");
+  counter.next = 1;
+  reply = Request(HTTP_HEAD, "/count");
+  Expect(reply.code == 200 && reply.body == "" && counter.next == 1 && counter.released == 2,
+         "HEAD of a generated response releases it unread");
+  reply = Request(HTTP_HEAD, "/keep");
+  Expect(reply.code == 200 && reply.body == "" && !kept.connected() && server.Connections() == 0, "HEAD of a stream is not kept");
+
+  reply = Request(HTTP_GET, "/hello", String(""), {{"X-Padding", String(std::string(2000, 'p'))}});
+  Expect(reply.code == 431, "header larger than the receive buffer refused");
+  reply = Request(HTTP_POST, "/echo", String(std::string(HTTP_BODY_BUFFER_SIZE + 1, '1')));
+  Expect(reply.code == 413, "body larger than the body buffer refused");
+
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(server.Port());
+
+  // posts that are still sending their bodies hold the body buffers, one more is turned away until they are done
+  int posting[HTTP_BODY_BUFFERS];
+  const char partial[] = "POST /echo HTTP/1.1\r\nContent-Length: 10\r\n\r\n12345";
+  bool sent = true;
+  for (int &client : posting) {
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    sent = sent && connect(client, (struct sockaddr *)&address, sizeof(address)) == 0 &&
+           ::send(client, partial, sizeof(partial) - 1, 0) == (ssize_t)sizeof(partial) - 1;
+  }
+  for (int i = 0; i < 100; i++) Pump();
+  reply = Request(HTTP_POST, "/echo", "{\"kp\":1}");
+  Expect(sent && reply.code == 503, "post beyond the body buffers answered with 503");
+  for (int client : posting) close(client);
+  for (int i = 0; i < 100; i++) Pump();
+  reply = Request(HTTP_POST, "/echo", "{\"kp\":1}");
+  Expect(reply.code == 200 && reply.body == "{\"kp\":1}", "body buffers free again once those are gone");
+
+  // a connected client that never sends must not hold up the next one
+  int silent = socket(AF_INET, SOCK_STREAM, 0);
+  Expect(connect(silent, (struct sockaddr *)&address, sizeof(address)) == 0, "silent client connected");
+  reply = Request(HTTP_GET, "/hello?name=next");
+  Expect(reply.code == 200 && reply.body == "hello next", "served next to a silent connection");
+  Expect(server.Connections() == 1, "silent connection still open");
+  close(silent);
+
+  SimHttpConnection stream;
+  stream.Open(server.Port(), HTTP_GET, "/keep");
+  while (!kept.connected() && stream.Poll(Pump)) {}
+  const char event[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\ndata: 1\n\n";
+  Expect(kept.write((const uint8_t *)event, sizeof(event) - 1) == sizeof(event) - 1, "stream takes a write");
+  stream.WaitHeader(Pump);
+  for (int i = 0; i < 100 && stream.Received() < sizeof(event) - 1; i++) stream.Poll(Pump);
+  Expect(stream.Take() == "data: 1\n\n", "stream write arrives after the handler");
+  kept.stop();
+  Expect(!kept.connected() && stream.WaitClosed(Pump) && !stream.Connected(), "stop() closes the stream");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
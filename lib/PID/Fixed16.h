@@ -0,0 +1,62 @@
+#ifndef Fixed16_h
+#define Fixed16_h
+
+#include <stdint.h>
+
+// Q16.16 fixed point number: 16 integer bits (-32768..32767) and 16 fraction
+// bits (resolution 1/65536), kept in one int32_t. Every operation saturates
+// instead of wrapping, and infinities convert to the largest value, so it can
+// stand in for float/double in PidController without any special cases.
+class Fixed16
+{
+  public:
+    static const int32_t ONE = 1L << 16;
+
+    Fixed16() : raw(0) {}
+    Fixed16(int value) : raw(Saturate((int64_t)value * ONE)) {}
+    Fixed16(float value) : raw(FromReal(value)) {}
+    Fixed16(double value) : raw(FromReal(value)) {}
+
+    static Fixed16 FromRaw(int32_t raw) { Fixed16 f; f.raw = raw; return f; }
+    int32_t Raw() const { return raw; }
+
+    explicit operator float() const { return raw / (float)ONE; }
+    explicit operator double() const { return raw / (double)ONE; }
+
+    Fixed16 operator-() const { return FromRaw(Saturate(-(int64_t)raw)); }
+    Fixed16 operator+(Fixed16 rhs) const { return FromRaw(Saturate((int64_t)raw + rhs.raw)); }
+    Fixed16 operator-(Fixed16 rhs) const { return FromRaw(Saturate((int64_t)raw - rhs.raw)); }
+    // rounds to nearest, the product of two Q16.16 values has 32 fraction bits
+    Fixed16 operator*(Fixed16 rhs) const { return FromRaw(Saturate(((int64_t)raw * rhs.raw + (ONE / 2)) >> 16)); }
+
+    Fixed16 &operator+=(Fixed16 rhs) { return *this = *this + rhs; }
+    Fixed16 &operator-=(Fixed16 rhs) { return *this = *this - rhs; }
+    Fixed16 &operator*=(Fixed16 rhs) { return *this = *this * rhs; }
+
+    bool operator<(Fixed16 rhs) const { return raw < rhs.raw; }
+    bool operator>(Fixed16 rhs) const { return raw > rhs.raw; }
+    bool operator<=(Fixed16 rhs) const { return raw <= rhs.raw; }
+    bool operator>=(Fixed16 rhs) const { return raw >= rhs.raw; }
+    bool operator==(Fixed16 rhs) const { return raw == rhs.raw; }
+    bool operator!=(Fixed16 rhs) const { return raw != rhs.raw; }
+
+  private:
+    static int32_t Saturate(int64_t value) {
+      if (value > INT32_MAX) return INT32_MAX;
+      if (value < INT32_MIN) return INT32_MIN;
+      return (int32_t)value;
+    }
+
+    template <typename R>
+    static int32_t FromReal(R value) {
+      R scaled = value * ONE;
+      if (!(scaled == scaled)) return 0; // NaN
+      if (scaled >= (R)INT32_MAX) return INT32_MAX;
+      if (scaled <= (R)INT32_MIN) return INT32_MIN;
+      return (int32_t)(scaled < 0 ? scaled - (R)0.5 : scaled + (R)0.5);
+    }
+
+    int32_t raw;
+};
+
+#endif
@@ -2,19 +2,29 @@
 #define PID_v1_h
 #define LIBRARY_VERSION	1.2.1
 
+#include "PidCore.h"
+
+// number type the PID computes in, the linked variables stay double.
+// float runs on the ESP32 FPU, double is emulated in software.
+#ifndef PID_NUMERIC
+#define PID_NUMERIC float
+#endif
+
+// millis() as a PidController clock
+struct PidMillisClock
+{
+  static unsigned long Now();
+};
+
+// The original PID_v1 interface, a thin wrapper around PidController (PidCore.h)
+// that reads and writes the linked Input, Output and Setpoint variables.
 class PID
 {
 
 
   public:
 
-  //Constants used in some of the functions below
-  #define AUTOMATIC	1
-  #define MANUAL	0
-  #define DIRECT  0
-  #define REVERSE  1
-  #define P_ON_M 0
-  #define P_ON_E 1
+  //Constants used in some of the functions below are in PidCore.h
 
   //commonly used functions **************************************************************************
     PID(double*, double*, double*,        // * constructor.  links the PID to the Input, Output, and 
@@ -67,32 +77,12 @@ class PID
 	int GetDirection();					  //
 
   private:
-	void Initialize();
-	
-	double dispKp;				// * we'll hold on to the tuning parameters in user-entered 
-	double dispKi;				//   format for display purposes
-	double dispKd;				//
-    
-	double kp;                  // * (P)roportional Tuning Parameter
-  double ki;                  // * (I)ntegral Tuning Parameter
-  double kd;                  // * (D)erivative Tuning Parameter
-  
-  double integralLowerbound, integralUpperbound; // * used to limit the integral term to prevent windup
-
-	int controllerDirection;
-	int pOn;
+    PidController<PID_NUMERIC, PidMillisClock> core;
 
     double *myInput;              // * Pointers to the Input, Output, and Setpoint variables
     double *myOutput;             //   This creates a hard link between the variables and the 
     double *mySetpoint;           //   PID, freeing the user from having to constantly tell us
                                   //   what these values are.  with pointers we'll just know.
-			  
-	unsigned long lastTime;
-	double outputSum, lastInput;
-
-	unsigned long SampleTime;
-	double outMin, outMax;
-	bool inAuto, pOnE;
 };
 #endif
 
@@ -0,0 +1,166 @@
+#ifndef PidCore_h
+#define PidCore_h
+
+#include <math.h>
+#include "Fixed16.h"
+
+// Header-only PID controller, the arithmetic of PID_v1 as a template.
+//
+// T is the number type every Compute() works in: float (single precision, in
+// hardware on the ESP32), double (software emulated on the ESP32) or Fixed16
+// (Q16.16, integer only). The tunings are scaled in double once when they are
+// set and stored as T, so no conversion happens per computation.
+//
+// Clock is any type with a static Now() returning milliseconds, so the same
+// controller runs on millis(), a virtual clock or a test counter.
+//
+// Input, setpoint and output are passed by value instead of through linked
+// pointers; PID (PID_v1.h) wraps this class with the original pointer API.
+
+#define AUTOMATIC	1
+#define MANUAL	0
+#define DIRECT  0
+#define REVERSE  1
+#define P_ON_M 0
+#define P_ON_E 1
+
+template <typename T, typename Clock>
+class PidController
+{
+  public:
+    PidController(double Kp, double Ki, double Kd, int POn = P_ON_E, int ControllerDirection = DIRECT)
+      // every member set first: SetTunings() keeps what it has for negative gains
+      : dispKp(0), dispKi(0), dispKd(0), kp(0), ki(0), kd(0), integralLowerBound(0), integralUpperBound(0),
+        outMin(0), outMax(0), controllerDirection(ControllerDirection), pOn(POn), pOnE(POn == P_ON_E), inAuto(false),
+        lastTime(0), sampleTime(100), output(0), outputSum(0), lastInput(0)
+    {
+      SetOutputLimits(0, 255);
+      SetTunings(Kp, Ki, Kd, POn);
+      SetIntegralBounds(-INFINITY, INFINITY);
+      lastTime = Clock::Now() - sampleTime;
+    }
+
+    // runs one computation when at least the sample time has passed since the
+    // last one, returns true when Output() was updated
+    bool Compute(T input, T setpoint)
+    {
+      if (!inAuto) return false;
+      unsigned long now = Clock::Now();
+      if (now - lastTime < sampleTime) return false;
+
+      T error = setpoint - input;
+      T dInput = input - lastInput;
+      outputSum += ki * error;
+
+      // proportional on measurement acts through the integral
+      if (!pOnE) outputSum -= kp * dInput;
+
+      // outside the bounds the integral is reset to prevent windup
+      if (error < integralLowerBound || error > integralUpperBound) outputSum = T(0);
+      outputSum = Clamp(outputSum);
+
+      T result = pOnE ? kp * error : T(0);
+      result += outputSum - kd * dInput;
+      output = Clamp(result);
+
+      lastInput = input;
+      lastTime = now;
+      return true;
+    }
+
+    T Output() const { return output; }
+    // the output used while in MANUAL, and the start of the integral when switching to AUTOMATIC
+    void SetOutput(T value) { output = value; }
+
+    // switching from MANUAL to AUTOMATIC starts bumpless from the current output
+    void SetMode(int Mode, T input)
+    {
+      bool newAuto = Mode == AUTOMATIC;
+      if (newAuto && !inAuto) {
+        outputSum = Clamp(output);
+        lastInput = input;
+      }
+      inAuto = newAuto;
+    }
+
+    void SetOutputLimits(double Min, double Max)
+    {
+      if (Min >= Max) return;
+      outMin = T(Min);
+      outMax = T(Max);
+      if (inAuto) {
+        output = Clamp(output);
+        outputSum = Clamp(outputSum);
+      }
+    }
+
+    void SetIntegralBounds(double Min, double Max)
+    {
+      if (Min >= Max) return;
+      integralLowerBound = T(Min);
+      integralUpperBound = T(Max);
+    }
+
+    void SetTunings(double Kp, double Ki, double Kd, int POn)
+    {
+      if (Kp < 0 || Ki < 0 || Kd < 0) return;
+      pOn = POn;
+      pOnE = POn == P_ON_E;
+      dispKp = Kp; dispKi = Ki; dispKd = Kd;
+      ScaleTunings();
+    }
+    void SetTunings(double Kp, double Ki, double Kd) { SetTunings(Kp, Ki, Kd, pOn); }
+
+    void SetControllerDirection(int Direction)
+    {
+      controllerDirection = Direction;
+      ScaleTunings();
+    }
+
+    // period of the computation in milliseconds
+    void SetSampleTime(int NewSampleTime)
+    {
+      if (NewSampleTime <= 0) return;
+      sampleTime = (unsigned long)NewSampleTime;
+      ScaleTunings();
+    }
+
+    double GetKp() const { return dispKp; }
+    double GetKi() const { return dispKi; }
+    double GetKd() const { return dispKd; }
+    int GetMode() const { return inAuto ? AUTOMATIC : MANUAL; }
+    int GetDirection() const { return controllerDirection; }
+
+  private:
+    T Clamp(T value) const
+    {
+      if (value > outMax) return outMax;
+      if (value < outMin) return outMin;
+      return value;
+    }
+
+    // the integral and derivative gains include the sample time, so Compute()
+    // needs no division
+    void ScaleTunings()
+    {
+      double sampleTimeInSec = sampleTime / 1000.0;
+      double sign = controllerDirection == REVERSE ? -1 : 1;
+      kp = T(sign * dispKp);
+      ki = T(sign * dispKi * sampleTimeInSec);
+      kd = T(sign * dispKd / sampleTimeInSec);
+    }
+
+    double dispKp, dispKi, dispKd; // tunings as the user entered them
+    T kp, ki, kd;                  // scaled and signed working tunings
+    T integralLowerBound, integralUpperBound;
+    T outMin, outMax;
+
+    int controllerDirection;
+    int pOn;
+    bool pOnE, inAuto;
+
+    unsigned long lastTime, sampleTime;
+    T output, outputSum, lastInput;
+};
+
+#endif
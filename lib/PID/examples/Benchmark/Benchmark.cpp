@@ -0,0 +1,57 @@
+// Host micro-benchmark for PidController: Compute() in double, float and Q16.16.
+//   g++ -O2 -std=gnu++17 -I lib/PID lib/PID/examples/Benchmark/Benchmark.cpp -o pid_bench && ./pid_bench
+
+#include <PidCore.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static unsigned long now = 0;
+struct StepClock {
+  static unsigned long Now() { return now += 10; }
+};
+
+static const int COMPUTATIONS = 2000000;
+
+template <typename T>
+static double Time(const char *type, const std::vector<double> &inputs, double &checksum) {
+  PidController<T, StepClock> pid(0.05, 0.02, 0.005);
+  pid.SetOutputLimits(0, 1);
+  pid.SetSampleTime(10);
+  pid.SetIntegralBounds(-10, 10);
+  pid.SetMode(AUTOMATIC, T(inputs[0]));
+
+  // converted up front, the firmware keeps its variables in the PID's type
+  std::vector<T> converted(inputs.begin(), inputs.end());
+  T setpoint = T(150.0);
+  T sum = T(0);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < COMPUTATIONS; i++) {
+    pid.Compute(converted[i & 4095], setpoint);
+    sum += pid.Output();
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / COMPUTATIONS;
+
+  checksum += (double)sum;
+  printf("%-8s %6.2f ns per Compute()\n", type, ns);
+  return ns;
+}
+
+int main() {
+  std::vector<double> inputs(4096);
+  srand(1);
+  for (size_t i = 0; i < inputs.size(); i++) {
+    inputs[i] = 25 + 150 * (1 - exp(-(double)i / 800)) + (rand() % 100) / 100.0;
+  }
+
+  double checksum = 0; // keeps the loops from being optimised away
+  Time<double>("double", inputs, checksum);
+  Time<float>("float", inputs, checksum);
+  Time<Fixed16>("Q16.16", inputs, checksum);
+  printf("checksum %.3f\n", checksum);
+  return 0;
+}
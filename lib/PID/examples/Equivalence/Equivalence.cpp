@@ -0,0 +1,107 @@
+// Host check that the float and Q16.16 PidController track the double one, open and closed loop.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/PID -I lib/HostSim lib/HostSim/Arduino.cpp lib/HostSim/WString.cpp lib/HostSim/SimOven.cpp lib/PID/examples/Equivalence/Equivalence.cpp -o pid_equivalence && ./pid_equivalence
+
+#include <PidCore.h>
+#include <SimOven.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+struct SimMillis {
+  static unsigned long Now() { return millis(); }
+};
+
+struct Tuning {
+  const char *name;
+  double kp, ki, kd;
+  int pOn;
+  double integralBound; // the firmware resets the integral beyond 10 C of error
+};
+
+struct Trace {
+  std::vector<double> input, output, temperature;
+};
+
+static double ProfileSetpoint(unsigned long ms) {
+  if (ms < 120000) return 100;
+  if (ms < 180000) return 150;
+  if (ms < 300000) return 230;
+  return 25;
+}
+
+static const unsigned long RUN_MS = 420000, PID_MS = 250, PWM_MS = 500, PWM_STEPS = 10;
+
+// closed loop, or open loop replaying the inputs of a previous trace
+template <typename T>
+static Trace Run(const Tuning &tuning, const Trace *replay = nullptr) {
+  SimClock::Reset();
+  SimOven oven;
+  PidController<T, SimMillis> pid(tuning.kp, tuning.ki, tuning.kd, tuning.pOn, DIRECT);
+  pid.SetOutputLimits(0, 1);
+  pid.SetSampleTime(10);
+  pid.SetIntegralBounds(-tuning.integralBound, tuning.integralBound);
+  pid.SetOutput(T(0));
+  pid.SetMode(AUTOMATIC, T(oven.SensorTemp()));
+
+  Trace trace;
+  double output = 0;
+  int dutySteps = 0;
+  for (unsigned long ms = 0; ms < RUN_MS; ms += PWM_MS / PWM_STEPS) {
+    SimClock::Advance((ms - millis()) * 1000ULL);
+
+    if (ms % PID_MS == 0) {
+      double input = replay ? replay->input[trace.input.size()] : oven.SensorTemp();
+      pid.Compute(T(input), T(ProfileSetpoint(ms)));
+      output = (double)pid.Output();
+      trace.input.push_back(input);
+      trace.output.push_back(output);
+      trace.temperature.push_back(oven.SensorTemp());
+    }
+
+    unsigned long step = (ms % PWM_MS) / (PWM_MS / PWM_STEPS);
+    if (step == 0) dutySteps = (int)(output * PWM_STEPS);
+    oven.SetHeater(step < (unsigned long)dutySteps);
+  }
+  return trace;
+}
+
+static double MaxDifference(const std::vector<double> &a, const std::vector<double> &b) {
+  double worst = 0;
+  for (size_t i = 0; i < a.size() && i < b.size(); i++) worst = fmax(worst, fabs(a[i] - b[i]));
+  return worst;
+}
+
+template <typename T>
+static bool Check(const char *type, const Tuning &tuning, const Trace &reference, double outputTolerance, double tempTolerance) {
+  double outputError = MaxDifference(Run<T>(tuning, &reference).output, reference.output);
+  double tempError = MaxDifference(Run<T>(tuning).temperature, reference.temperature);
+  bool ok = outputError <= outputTolerance && tempError <= tempTolerance;
+  printf("%-8s %-18s open loop max |output error| %.2e, closed loop max |temp error| %.3f C  %s\n",
+         type, tuning.name, outputError, tempError, ok ? "OK" : "FAIL");
+  return ok;
+}
+
+int main() {
+  const Tuning tunings[] = {
+    {"firmware default", 0.05, 0, 0.005, P_ON_E, 10},
+    {"soft P", 0.01, 0, 0, P_ON_E, 10},
+    {"PI", 0.02, 0.02, 0, P_ON_E, 10},
+    {"PID", 0.02, 0.02, 0.05, P_ON_E, 10},
+    {"PI on measurement", 0.005, 0.02, 0, P_ON_M, INFINITY},
+  };
+
+  bool ok = true;
+  for (const Tuning &tuning : tunings) {
+    Trace reference = Run<double>(tuning);
+    double peak = 0;
+    for (double t : reference.temperature) peak = fmax(peak, t);
+    printf("double   %-18s reference peak %.1f C\n", tuning.name, peak);
+
+    ok &= Check<float>("float", tuning, reference, 1e-5, 0.5);
+    // Q16.16 steps are 1.5e-5 and the integral gain per computation is only
+    // Ki * 0.01, so its rounding adds up in the integral: 1% of the output range
+    ok &= Check<Fixed16>("Q16.16", tuning, reference, 1e-2, 0.5);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include "ProfileCatalog.h"
+
+#include <stdio.h>
+
+void ProfileCatalog::Clear() {
+  entries.clear();
+  version++;
+}
+
+size_t ProfileCatalog::LowerBound(const String &name) const {
+  size_t first = 0, end = entries.size();
+  while (first < end) {
+    size_t middle = first + (end - first) / 2;
+    if (strcmp(entries[middle].name.c_str(), name.c_str()) < 0) first = middle + 1;
+    else end = middle;
+  }
+  return first;
+}
+
+void ProfileCatalog::Put(const ProfileSummary &summary) {
+  size_t index = LowerBound(summary.name);
+  if (index < entries.size() && entries[index].name == summary.name) entries[index] = summary;
+  else entries.insert(entries.begin() + index, summary);
+  version++;
+}
+
+bool ProfileCatalog::Remove(const String &name) {
+  size_t index = LowerBound(name);
+  if (index >= entries.size() || entries[index].name != name) return false;
+  entries.erase(entries.begin() + index);
+  version++;
+  return true;
+}
+
+const ProfileSummary *ProfileCatalog::Find(const String &name) const {
+  size_t index = LowerBound(name);
+  return index < entries.size() && entries[index].name == name ? &entries[index] : nullptr;
+}
+
+const String &ProfileCatalog::Json() {
+  if (builtVersion != version) Build();
+  return json;
+}
+
+const String &ProfileCatalog::ETag() {
+  if (builtVersion != version) Build();
+  return etag;
+}
+
+void ProfileCatalog::Build() {
+  json = "[";
+  json.reserve(entries.size() * 110 + 2);
+  char line[96];
+  for (size_t i = 0; i < entries.size(); i++) {
+    const ProfileSummary &entry = entries[i];
+    json += i ? ",{\"name\":\"" : "{\"name\":\"";
+    for (const char *c = entry.name.c_str(); *c; c++) {
+      if (*c == '"' || *c == '\\') json += '\\';
+      if ((unsigned char)*c >= 0x20) json += *c; // names have no control characters worth keeping
+    }
+    snprintf(line, sizeof(line), "\",\"segments\":%u,\"peakTemp\":%.1f,\"totalTime\":%lu}",
+             (unsigned)entry.segments, entry.peakTemp, (unsigned long)entry.totalTime);
+    json += line;
+  }
+  json += "]";
+
+  // FNV-1a, the same list always gets the same tag, also after a reboot
+  uint32_t hash = 2166136261u;
+  for (const char *c = json.c_str(); *c; c++) hash = (hash ^ (uint8_t)*c) * 16777619u;
+  snprintf(line, sizeof(line), "\"%08lx\"", (unsigned long)hash);
+  etag = line;
+  builtVersion = version;
+}
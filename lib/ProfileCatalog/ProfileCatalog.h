@@ -0,0 +1,52 @@
+#ifndef ProfileCatalog_h
+#define ProfileCatalog_h
+
+#include <Arduino.h>
+#include <vector>
+
+// The stored profiles, kept in RAM so listing them never touches the flash.
+// The firmware fills it once at boot from the profile store and then Put()s
+// or Remove()s a profile whenever it saves or deletes one, there is no limit
+// on the number of profiles but the filesystem.
+//
+// Json() is the GET /profiles response, an array of the summaries sorted by
+// name. It is only serialised again after a change, and ETag() is a hash of
+// it, so an unchanged list costs a browser a 304 and the firmware a compare.
+
+struct ProfileSummary {
+  String name;
+  int32_t slot;         // record in the profile store, not listed
+  uint8_t segments;
+  float peakTemp;       // C, highest target
+  uint32_t totalTime;   // ms, planned from room temperature
+};
+
+class ProfileCatalog
+{
+  public:
+    ProfileCatalog() : version(1), builtVersion(0) {}
+
+    void Clear();
+    // adds the profile, or replaces the one with the same name
+    void Put(const ProfileSummary &summary);
+    bool Remove(const String &name);
+
+    const ProfileSummary *Find(const String &name) const;
+    size_t Count() const { return entries.size(); }
+    const ProfileSummary &At(size_t index) const { return entries[index]; }
+    // changes with every Put(), Remove() and Clear()
+    uint32_t Version() const { return version; }
+
+    const String &Json();
+    const String &ETag();
+
+  private:
+    size_t LowerBound(const String &name) const;
+    void Build();
+
+    std::vector<ProfileSummary> entries; // sorted by name
+    uint32_t version, builtVersion;
+    String json, etag;
+};
+
+#endif
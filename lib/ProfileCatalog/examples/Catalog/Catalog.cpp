@@ -0,0 +1,62 @@
+// Host check for ProfileCatalog: sorted entries, Put() and Remove(), and a JSON whose ETag follows its content.
+//   g++ -O2 -std=gnu++17 -I lib/HostSim -I lib/ProfileCatalog lib/HostSim/*.cpp lib/ProfileCatalog/ProfileCatalog.cpp lib/ProfileCatalog/examples/Catalog/Catalog.cpp -pthread -o profile_catalog && ./profile_catalog
+
+#include <ProfileCatalog.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static ProfileSummary Profile(const String &name, float reflowTemp) {
+  ProfileSummary summary = {};
+  summary.name = name;
+  summary.segments = 4;
+  summary.peakTemp = reflowTemp;
+  summary.totalTime = 420000;
+  return summary;
+}
+
+int main() {
+  ProfileCatalog catalog;
+  srand(1);
+  for (int i = 0; i < 50; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "profile-%02d.json", rand() % 100);
+    catalog.Put(Profile(name, 200 + i));
+  }
+  bool sorted = true;
+  for (size_t i = 1; i < catalog.Count(); i++) sorted &= strcmp(catalog.At(i - 1).name.c_str(), catalog.At(i).name.c_str()) < 0;
+  Expect(catalog.Count() > 20 && sorted, "more than 20 profiles, sorted and unique");
+
+  catalog.Clear();
+  catalog.Put(Profile("leadfree.json", 245));
+  catalog.Put(Profile("default.json", 230));
+  catalog.Put(Profile("say \"hi\".json", 220));
+  Expect(catalog.Json() == "[{\"name\":\"default.json\",\"segments\":4,\"peakTemp\":230.0,\"totalTime\":420000},"
+                           "{\"name\":\"leadfree.json\",\"segments\":4,\"peakTemp\":245.0,\"totalTime\":420000},"
+                           "{\"name\":\"say \\\"hi\\\".json\",\"segments\":4,\"peakTemp\":220.0,\"totalTime\":420000}]",
+         "JSON sorted by name, quotes escaped");
+
+  const char *before = catalog.Json().c_str();
+  String etag = catalog.ETag();
+  Expect(catalog.Json().c_str() == before && catalog.ETag() == etag, "not serialised again without a change");
+
+  catalog.Put(Profile("default.json", 235));
+  Expect(catalog.Count() == 3 && catalog.Find("default.json")->peakTemp == 235, "Put() replaces by name");
+  Expect(catalog.ETag() != etag, "a change changes the ETag");
+
+  Expect(!catalog.Remove("missing.json") && catalog.Remove("leadfree.json") && !catalog.Find("leadfree.json") &&
+         catalog.Count() == 2, "Remove() only removes what is there");
+  catalog.Put(Profile("leadfree.json", 245));
+  catalog.Put(Profile("default.json", 230));
+  Expect(catalog.ETag() == etag, "the same list gets the same ETag back");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
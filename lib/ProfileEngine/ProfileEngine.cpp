@@ -0,0 +1,173 @@
+#include "ProfileEngine.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char *const typeNames[SEGMENT_TYPES] = {"ramp", "hold", "until"};
+static const char *const phaseNames[PHASE_COUNT] = {"none", "preheat", "soak", "reflow", "cooldown"};
+
+bool ProfileEngine::Valid(const ProfileSegment &segment) {
+  if (segment.type >= SEGMENT_TYPES || segment.phase >= PHASE_COUNT) return false;
+  if (!isfinite(segment.target) || !(segment.rate >= 0) || !isfinite(segment.rate)) return false;
+  return segment.type != SEGMENT_RAMP || segment.rate > 0; // a ramp without a rate never ends
+}
+
+float ProfileEngine::MoveTime(const ProfileSegment &segment, float from) {
+  float distance = fabsf(segment.target - from);
+  if (segment.rate <= 0 || distance == 0) return 0;
+  return distance / segment.rate * 1000.0f;
+}
+
+uint32_t ProfileEngine::PlannedDuration(const ProfileSegment *table, uint8_t size, float temperature) {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < size; i++) {
+    total += table[i].type == SEGMENT_HOLD ? table[i].time : (uint32_t)MoveTime(table[i], temperature);
+    temperature = table[i].target;
+  }
+  return total;
+}
+
+bool ProfileEngine::Load(const ProfileSegment *table, uint8_t size) {
+  count = 0;
+  state = ENGINE_IDLE;
+  if (size > PROFILE_MAX_SEGMENTS) return false;
+  for (uint8_t i = 0; i < size; i++) {
+    if (!Valid(table[i])) return false;
+  }
+  if (size) memcpy(segments, table, size * sizeof(ProfileSegment));
+  count = size;
+  return true;
+}
+
+void ProfileEngine::Start(float temperature) {
+  setpoint = temperature;
+  if (!count) {
+    state = ENGINE_DONE;
+    return;
+  }
+
+  // planned length of what follows each segment, so Duration() stays O(1)
+  uint32_t planned[PROFILE_MAX_SEGMENTS];
+  float from = temperature;
+  for (uint8_t i = 0; i < count; i++) {
+    planned[i] = PlannedDuration(&segments[i], 1, from);
+    from = segments[i].target;
+  }
+  rest[count - 1] = 0;
+  for (int i = count - 2; i >= 0; i--) rest[i] = rest[i + 1] + planned[i + 1];
+
+  state = ENGINE_RUNNING;
+  Enter(0, 0);
+}
+
+void ProfileEngine::Enter(uint8_t i, uint32_t segmentStart) {
+  const ProfileSegment &segment = segments[i];
+  index = i;
+  start = segmentStart;
+  from = setpoint; // where the previous segment left it
+  to = segment.target;
+
+  float ms = MoveTime(segment, from);
+  if (segment.type == SEGMENT_HOLD && segment.time > 0 && !(ms < segment.time)) {
+    // a move cut short by the hold time ends where the rate got it
+    move = segment.time;
+    to = from + (segment.target > from ? 1 : -1) * segment.rate * move / 1000.0f;
+  } else {
+    move = (uint32_t)ms;
+  }
+  length = segment.type == SEGMENT_HOLD ? segment.time : move;
+}
+
+EngineState ProfileEngine::Update(uint32_t t, float temperature) {
+  if (state != ENGINE_RUNNING && state != ENGINE_WAITING) return state;
+
+  for (;;) {
+    const ProfileSegment &segment = segments[index];
+    uint32_t elapsed = t - start, end;
+    if (segment.type == SEGMENT_UNTIL) {
+      bool reached = to >= from ? temperature >= to - PROFILE_REACHED_BAND : temperature <= to + PROFILE_REACHED_BAND;
+      if (!(elapsed >= move && reached)) {
+        if (segment.time && elapsed >= segment.time) {
+          state = ENGINE_TIMEOUT;
+          return state;
+        }
+        break;
+      }
+      end = t; // the oven got there now, the next segment starts from here
+    } else {
+      if (elapsed < length) break;
+      end = start + length;
+    }
+
+    setpoint = to;
+    if (index + 1 >= count) {
+      state = ENGINE_DONE;
+      return state;
+    }
+    Enter(index + 1, end);
+  }
+
+  uint32_t elapsed = t - start;
+  setpoint = elapsed >= move ? to : from + (to - from) * (float)elapsed / move;
+  state = segments[index].type == SEGMENT_UNTIL && elapsed >= move ? ENGINE_WAITING : ENGINE_RUNNING;
+  return state;
+}
+
+uint32_t ProfileEngine::Duration(uint32_t t) const {
+  if (!count || state == ENGINE_IDLE) return 0;
+  uint32_t elapsed = t - start;
+  uint32_t current = segments[index].type == SEGMENT_UNTIL && elapsed > move ? elapsed : length;
+  return start + current + rest[index];
+}
+
+uint8_t ProfileEngine::FromPhases(const float temperature[4], const uint32_t time[4], float rampRate, float coolRate,
+                                  ProfileSegment *table) {
+  static const uint8_t phases[4] = {PHASE_PREHEAT, PHASE_SOAK, PHASE_REFLOW, PHASE_COOLDOWN};
+  float last = temperature[0]; // the first phase heats
+  for (int i = 0; i < 4; i++) {
+    ProfileSegment &segment = table[i];
+    memset(&segment, 0, sizeof(segment));
+    segment.type = SEGMENT_HOLD;
+    segment.phase = phases[i];
+    segment.target = temperature[i];
+    // heating or cooling from where the previous phase left the setpoint, as they always did
+    segment.rate = temperature[i] >= last ? rampRate : coolRate;
+    segment.time = time[i];
+
+    float ms = MoveTime(segment, last);
+    if (segment.time > 0 && ms > 0 && !(ms < segment.time)) {
+      last += (segment.target > last ? 1 : -1) * segment.rate * segment.time / 1000.0f;
+    } else {
+      last = segment.target;
+    }
+  }
+  return 4;
+}
+
+const char *ProfileEngine::TypeName(uint8_t type) {
+  return type < SEGMENT_TYPES ? typeNames[type] : "unknown";
+}
+
+bool ProfileEngine::ParseType(const char *name, uint8_t &type) {
+  for (uint8_t i = 0; i < SEGMENT_TYPES; i++) {
+    if (strcmp(name, typeNames[i]) == 0) {
+      type = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *ProfileEngine::PhaseName(uint8_t phase) {
+  return phase < PHASE_COUNT ? phaseNames[phase] : "none";
+}
+
+bool ProfileEngine::ParsePhase(const char *name, uint8_t &phase) {
+  for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+    if (strcmp(name, phaseNames[i]) == 0) {
+      phase = i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,96 @@
+#ifndef ProfileEngine_h
+#define ProfileEngine_h
+
+#include <stdint.h>
+
+// Reflow, curing and annealing profiles as a table of up to
+// PROFILE_MAX_SEGMENTS segments, each moving the setpoint towards its target:
+//
+//   ramp    at rate (C/s) until the setpoint is at the target
+//   hold    for time ms, the move at rate (0 steps) included: the phase of a
+//           reflow profile, a move cut short by the time ends where it got
+//   until   the setpoint moves at rate and stays at the target until the oven
+//           has reached it (PROFILE_REACHED_BAND), time is a timeout (0 none)
+//
+// ProfileEngine runs one table: a cursor on the current segment, its start
+// time and the move within it, so Update() is O(1) per call whatever the
+// length of the profile and Setpoint() one interpolation. Times are ms since
+// the start of the run. A segment starts where the previous one planned to
+// end, so holds keep their length however late Update() is called.
+
+#define PROFILE_MAX_SEGMENTS 12
+#define PROFILE_REACHED_BAND 2.0f // C, an until segment is done this close to its target
+
+// what the oven is doing, shown for a segment; PHASE_IDLE labels none
+enum ReflowPhase : uint8_t { PHASE_IDLE, PHASE_PREHEAT, PHASE_SOAK, PHASE_REFLOW, PHASE_COOLDOWN, PHASE_COUNT };
+enum SegmentType : uint8_t { SEGMENT_RAMP, SEGMENT_HOLD, SEGMENT_UNTIL, SEGMENT_TYPES };
+
+struct ProfileSegment {
+  uint8_t type;     // SegmentType
+  uint8_t phase;    // ReflowPhase
+  uint16_t reserved;
+  float target;     // C
+  float rate;       // C/s, 0 steps
+  uint32_t time;    // ms: length of a hold, timeout of an until (0 none), not used by a ramp
+};
+
+enum EngineState : uint8_t {
+  ENGINE_IDLE,
+  ENGINE_RUNNING,  // moving or holding on a timed segment
+  ENGINE_WAITING,  // an until segment waits for the oven
+  ENGINE_DONE,     // past the last segment
+  ENGINE_TIMEOUT   // an until segment ran out of time
+};
+
+class ProfileEngine
+{
+  public:
+    ProfileEngine() : count(0), index(0), state(ENGINE_IDLE), setpoint(0) {}
+
+    // copies the table; false, with nothing loaded, when a segment is not Valid()
+    bool Load(const ProfileSegment *table, uint8_t size);
+    // the first segment starts now (t = 0) from this setpoint, e.g. the oven temperature
+    void Start(float temperature);
+    // advances to t with the measured temperature, t must not go backwards
+    EngineState Update(uint32_t t, float temperature);
+    void Stop() { state = ENGINE_IDLE; }
+
+    EngineState State() const { return state; }
+    float Setpoint() const { return setpoint; }
+    uint8_t Index() const { return index; }
+    uint8_t Count() const { return count; }
+    const ProfileSegment &Segment(uint8_t i) const { return segments[i]; }
+    ReflowPhase Phase() const { return count && index < count ? (ReflowPhase)segments[index].phase : PHASE_IDLE; }
+    // ms the run is planned to last, longer while an until segment waits
+    uint32_t Duration(uint32_t t) const;
+
+    static bool Valid(const ProfileSegment &segment);
+    // planned length of a table started at temperature, untils counted by their move
+    static uint32_t PlannedDuration(const ProfileSegment *table, uint8_t size, float temperature);
+    // the four phases of older profiles as hold segments, returns 4
+    static uint8_t FromPhases(const float temperature[4], const uint32_t time[4], float rampRate, float coolRate,
+                              ProfileSegment *table);
+
+    static const char *TypeName(uint8_t type);
+    static bool ParseType(const char *name, uint8_t &type);
+    static const char *PhaseName(uint8_t phase);
+    static bool ParsePhase(const char *name, uint8_t &phase);
+
+  private:
+    void Enter(uint8_t i, uint32_t start);
+    // ms the setpoint takes from from to the segment's target, before a hold's cap
+    static float MoveTime(const ProfileSegment &segment, float from);
+
+    ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+    uint32_t rest[PROFILE_MAX_SEGMENTS]; // planned ms of the segments after each one
+    uint8_t count, index;
+    EngineState state;
+
+    uint32_t start;    // ms, start of the current segment
+    uint32_t move;     // ms the setpoint moves in it
+    uint32_t length;   // ms it lasts, for ramps and holds
+    float from, to;    // setpoint at the start and the end of the move
+    float setpoint;
+};
+
+#endif
@@ -0,0 +1,130 @@
+// Host check for ProfileEngine: converted phases, until segments, late updates and table validation.
+//   g++ -O2 -std=gnu++17 -I lib/ProfileEngine lib/ProfileEngine/ProfileEngine.cpp lib/ProfileEngine/examples/Segments/Segments.cpp -o profile_engine && ./profile_engine
+
+#include <ProfileEngine.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static bool Near(float a, float b) { return fabsf(a - b) < 0.01f; }
+
+static ProfileSegment Segment(uint8_t type, float target, float rate, uint32_t time, uint8_t phase = PHASE_IDLE) {
+  ProfileSegment segment = {};
+  segment.type = type;
+  segment.phase = phase;
+  segment.target = target;
+  segment.rate = rate;
+  segment.time = time;
+  return segment;
+}
+
+int main() {
+  // preheat 100 C/120 s, soak 150 C/60 s, reflow 230 C/120 s, cooldown 25 C/120 s at 1 C/s up and 2 C/s down
+  const float temperature[4] = {100, 150, 230, 25};
+  const uint32_t time[4] = {120000, 60000, 120000, 120000};
+  ProfileSegment reflow[4];
+  ProfileEngine::FromPhases(temperature, time, 1, 2, reflow);
+  Expect(reflow[0].type == SEGMENT_HOLD && reflow[1].rate == 1 && reflow[3].rate == 2 && reflow[3].phase == PHASE_COOLDOWN,
+         "four phases become four holds, cooling at the cool rate");
+
+  ProfileEngine engine;
+  Expect(engine.Load(reflow, 4), "loaded");
+  engine.Start(25);
+  Expect(engine.Duration(0) == 420000 && ProfileEngine::PlannedDuration(reflow, 4, 25) == 420000, "planned 420 s");
+  engine.Update(0, 25);
+  Expect(engine.Setpoint() == 25 && engine.Phase() == PHASE_PREHEAT, "starts at the oven temperature");
+  engine.Update(50000, 70);
+  Expect(Near(engine.Setpoint(), 75), "ramps at 1 C/s");
+  engine.Update(100000, 99);
+  Expect(engine.Setpoint() == 100 && engine.Index() == 0, "then holds for the rest of the phase");
+  engine.Update(150000, 120);
+  Expect(engine.Index() == 1 && engine.Phase() == PHASE_SOAK && Near(engine.Setpoint(), 130), "soak ramps from 100 at 120 s");
+  engine.Update(290000, 230);
+  Expect(engine.Phase() == PHASE_REFLOW && engine.Setpoint() == 230, "reflow holds at 230");
+  engine.Update(330000, 200);
+  Expect(engine.Phase() == PHASE_COOLDOWN && Near(engine.Setpoint(), 170), "cooldown ramps down at 2 C/s");
+  Expect(engine.Update(419999, 30) == ENGINE_RUNNING && engine.Update(420000, 30) == ENGINE_DONE, "done after exactly 420 s");
+
+  // a hold whose ramp does not fit ends where the rate got it
+  ProfileSegment shortHold[2] = {Segment(SEGMENT_HOLD, 250, 1, 60000), Segment(SEGMENT_HOLD, 0, 0, 1000)};
+  engine.Load(shortHold, 2);
+  engine.Start(100);
+  engine.Update(60000, 160);
+  Expect(engine.Index() == 1 && engine.Setpoint() == 0, "a step takes no time");
+  engine.Start(100);
+  engine.Update(59999, 160);
+  Expect(Near(engine.Setpoint(), 160), "a ramp cut short by its hold ends at 160");
+
+  // cure: ramp to 80, wait until the oven is there, hold an hour, ramp to 150, wait, hold, cool until 40
+  ProfileSegment cure[7] = {
+    Segment(SEGMENT_RAMP, 80, 2, 0),
+    Segment(SEGMENT_UNTIL, 80, 0, 600000),
+    Segment(SEGMENT_HOLD, 80, 0, 3600000),
+    Segment(SEGMENT_RAMP, 150, 0.5f, 0),
+    Segment(SEGMENT_UNTIL, 150, 0, 0),
+    Segment(SEGMENT_HOLD, 150, 0, 1800000),
+    Segment(SEGMENT_UNTIL, 40, 1, 0, PHASE_COOLDOWN),
+  };
+  engine.Load(cure, 7);
+  engine.Start(20);
+  uint32_t planned = engine.Duration(0);
+  Expect(planned == 30000 + 3600000 + 140000 + 1800000 + 110000, "until segments plan with their move only");
+
+  // first-order oven, 1/60 s towards the setpoint
+  float oven = 20;
+  uint32_t t = 0, holdStart = 0, lastWaiting = 0;
+  EngineState state = ENGINE_RUNNING;
+  while (t < 20000000 && (state = engine.Update(t, oven)) != ENGINE_DONE) {
+    if (state == ENGINE_WAITING) lastWaiting = t;
+    if (engine.Index() == 2 && !holdStart) holdStart = t;
+    oven += (engine.Setpoint() - oven) / 60.0f * 0.25f;
+    t += 250;
+  }
+  Expect(state == ENGINE_DONE && holdStart > 30000 && oven < 40 + PROFILE_REACHED_BAND, "waits for the oven before the hold starts");
+  Expect(t > planned && lastWaiting > 0, "and runs longer than planned");
+
+  // the oven never gets there
+  engine.Start(20);
+  engine.Update(30000, 30);
+  state = engine.Update(629999, 30);
+  Expect(state == ENGINE_WAITING && engine.Update(630000, 30) == ENGINE_TIMEOUT, "an until times out after its time");
+
+  // one Update() ten minutes late passes the ramp and the wait at once, the hold keeps its hour
+  engine.Start(80);
+  engine.Update(0, 80);
+  Expect(engine.Index() == 2 && engine.Update(3599999, 80) == ENGINE_RUNNING && engine.Index() == 2, "a satisfied until passes at once");
+  Expect(engine.Update(3600000 + 140000 + 600000, 150) == ENGINE_RUNNING && engine.Index() == 5 &&
+         engine.Duration(3600000 + 140000 + 600000) == 3600000 + 140000 + 600000 + 1800000 + 110000, "a late update does not stretch the holds");
+
+  ProfileSegment tooMany[PROFILE_MAX_SEGMENTS + 1];
+  for (auto &segment : tooMany) segment = Segment(SEGMENT_HOLD, 100, 0, 1000);
+  Expect(engine.Load(tooMany, PROFILE_MAX_SEGMENTS) && !engine.Load(tooMany, PROFILE_MAX_SEGMENTS + 1), "12 segments, not 13");
+  ProfileSegment stuck = Segment(SEGMENT_RAMP, 100, 0, 0), badPhase = Segment(SEGMENT_HOLD, 100, 0, 1000, PHASE_COUNT);
+  Expect(!engine.Load(&stuck, 1) && !engine.Load(&badPhase, 1) && engine.Count() == 0, "a ramp without a rate is refused");
+  uint8_t type, phase;
+  Expect(ProfileEngine::ParseType("until", type) && type == SEGMENT_UNTIL && ProfileEngine::ParsePhase("soak", phase) &&
+         phase == PHASE_SOAK && !ProfileEngine::ParseType("wait", type), "names parse back");
+
+  engine.Load(tooMany, PROFILE_MAX_SEGMENTS);
+  engine.Start(20);
+  const int updates = 1000000;
+  auto begin = std::chrono::steady_clock::now();
+  float sum = 0;
+  for (int i = 0; i < updates; i++) {
+    engine.Update(i * 5, 100);
+    sum += engine.Setpoint();
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / updates;
+  printf("  one Update(): %.1f ns (checksum %.0f)\n", ns, sum);
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+#include "ProfileStore.h"
+
+static_assert(sizeof(ProfileStoreHeader) == 16, "the header layout is part of the file format");
+static_assert(sizeof(ProfileRecord) == 256, "the record layout is part of the file format");
+
+// the records of a version 1 store, only read by Upgrade()
+struct ProfileRecordV1 {
+  char name[PROFILE_NAME_SIZE];
+  float temperature[4]; // preheat, soak, reflow, cooldown; C
+  uint32_t time[4];     // ms
+  float rampRate, coolRate;
+  uint32_t reserved;
+  uint32_t crc;
+};
+static_assert(sizeof(ProfileRecordV1) == 96, "the record layout of version 1");
+
+uint32_t ProfileStore::Crc32(const void *data, size_t length) {
+  // bitwise, profiles are written rarely and read one record at a time
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+bool ProfileStore::Begin() {
+  created = upgraded = false;
+  String next = String(path) + ".new";
+  if (!fs.exists(path) && fs.exists(next)) fs.rename(next, path); // power lost at the end of an Upgrade()
+
+  file = fs.open(path, "r+");
+  if (file) {
+    ProfileStoreHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == PROFILE_STORE_MAGIC &&
+        header.crc == Crc32(&header, offsetof(ProfileStoreHeader, crc))) {
+      if (header.version == PROFILE_STORE_VERSION && header.recordSize == sizeof(ProfileRecord)) {
+        slots = (file.size() - sizeof(header)) / sizeof(ProfileRecord);
+        return true;
+      }
+      if (header.version == 1 && header.recordSize == sizeof(ProfileRecordV1) && Upgrade()) return true;
+    }
+    file.close();
+  }
+  return Create();
+}
+
+bool ProfileStore::WriteHeader(File &out) {
+  ProfileStoreHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = PROFILE_STORE_MAGIC;
+  header.version = PROFILE_STORE_VERSION;
+  header.recordSize = sizeof(ProfileRecord);
+  header.crc = Crc32(&header, offsetof(ProfileStoreHeader, crc));
+  return out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+}
+
+bool ProfileStore::Upgrade() {
+  // into a new file that only replaces the old one once complete, the old one
+  // is still there to upgrade again if the power goes before that
+  String next = String(path) + ".new";
+  File out = fs.open(next, "w", true);
+  if (!out || !WriteHeader(out)) {
+    file.close();
+    return false;
+  }
+  uint32_t count = (file.size() - sizeof(ProfileStoreHeader)) / sizeof(ProfileRecordV1);
+  for (uint32_t slot = 0; slot < count; slot++) {
+    ProfileRecordV1 old;
+    ProfileRecord record;
+    memset(&record, 0, sizeof(record));
+    if (file.read((uint8_t *)&old, sizeof(old)) != sizeof(old)) break;
+    if (old.crc == Crc32(&old, offsetof(ProfileRecordV1, crc)) && old.name[0]) {
+      memcpy(record.name, old.name, PROFILE_NAME_SIZE);
+      record.name[PROFILE_NAME_SIZE - 1] = 0;
+      record.segmentCount = ProfileEngine::FromPhases(old.temperature, old.time, old.rampRate, old.coolRate,
+                                                      record.segments);
+    } // else a free or damaged slot stays free
+    record.crc = Crc32(&record, offsetof(ProfileRecord, crc));
+    if (out.write((const uint8_t *)&record, sizeof(record)) != sizeof(record)) {
+      out.close();
+      file.close();
+      return false;
+    }
+  }
+  out.close();
+  file.close();
+  if (!fs.remove(path) || !fs.rename(next, path)) return false;
+
+  file = fs.open(path, "r+");
+  if (!file) return false;
+  slots = (file.size() - sizeof(ProfileStoreHeader)) / sizeof(ProfileRecord);
+  upgraded = true;
+  return true;
+}
+
+bool ProfileStore::Create() {
+  file = fs.open(path, "w", true);
+  if (!file || !WriteHeader(file)) {
+    file = File();
+    return false;
+  }
+  file.close();
+  file = fs.open(path, "r+"); // "w" cannot read, the store does both
+  slots = 0;
+  created = true;
+  return (bool)file;
+}
+
+bool ProfileStore::Read(uint32_t slot, ProfileRecord &record) {
+  if (!file || slot >= slots) return false;
+  if (!file.seek(sizeof(ProfileStoreHeader) + slot * sizeof(ProfileRecord)) ||
+      file.read((uint8_t *)&record, sizeof(record)) != sizeof(record)) return false;
+  if (record.crc != Crc32(&record, offsetof(ProfileRecord, crc))) return false;
+  record.name[PROFILE_NAME_SIZE - 1] = 0;
+  return record.name[0] != 0;
+}
+
+bool ProfileStore::WriteAt(uint32_t slot, const ProfileRecord &record) {
+  if (!file || slot > slots) return false;
+  if (!file.seek(sizeof(ProfileStoreHeader) + slot * sizeof(ProfileRecord)) ||
+      file.write((const uint8_t *)&record, sizeof(record)) != sizeof(record)) return false;
+  file.flush();
+  if (slot == slots) slots++;
+  return true;
+}
+
+int32_t ProfileStore::Write(ProfileRecord &record, int32_t slot) {
+  if (slot < 0) {
+    ProfileRecord existing;
+    for (slot = 0; (uint32_t)slot < slots && Read(slot, existing); slot++) {}
+  }
+  record.name[PROFILE_NAME_SIZE - 1] = 0;
+  if (record.segmentCount > PROFILE_MAX_SEGMENTS) record.segmentCount = PROFILE_MAX_SEGMENTS;
+  memset(record.reserved, 0, sizeof(record.reserved));
+  memset(record.reserved2, 0, sizeof(record.reserved2));
+  record.crc = Crc32(&record, offsetof(ProfileRecord, crc));
+  return WriteAt(slot, record) ? slot : -1;
+}
+
+bool ProfileStore::Erase(uint32_t slot) {
+  if (slot >= slots) return false;
+  ProfileRecord record;
+  memset(&record, 0, sizeof(record));
+  record.crc = Crc32(&record, offsetof(ProfileRecord, crc));
+  return WriteAt(slot, record);
+}
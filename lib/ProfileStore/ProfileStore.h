@@ -0,0 +1,80 @@
+#ifndef ProfileStore_h
+#define ProfileStore_h
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ProfileEngine.h>
+
+// All profiles in one file of fixed-size records, so loading one is a seek
+// and a read of 256 bytes into a struct instead of opening a file and parsing
+// JSON. Layout (little endian like the ESP32 and a PC):
+//
+//   ProfileStoreHeader   magic, version, record size, CRC-32 of the header
+//   ProfileRecord[]      one per slot, each with its own CRC-32
+//
+// A deleted profile leaves a free slot (empty name) that the next new profile
+// reuses. Records are rewritten in place, a write cut short by a power loss
+// only damages that record, which fails its CRC and reads as a free slot.
+// JSON stays the import/export format, see the firmware's /exportprofile.
+//
+// Version 1 stored the four phases of a reflow profile, a store of that
+// version is converted to segments (ProfileEngine::FromPhases) by Begin().
+
+#define PROFILE_STORE_MAGIC 0x31535054 // "TPS1"
+#define PROFILE_STORE_VERSION 2
+#define PROFILE_NAME_SIZE 48
+
+struct ProfileStoreHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t reserved;
+  uint32_t crc;
+};
+
+struct ProfileRecord {
+  char name[PROFILE_NAME_SIZE]; // 0-terminated, empty for a free slot
+  uint8_t segmentCount;
+  uint8_t reserved[3];
+  ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+  uint32_t reserved2[2];
+  uint32_t crc; // CRC-32 of everything before it
+};
+
+class ProfileStore
+{
+  public:
+    ProfileStore(fs::FS &fs, const char *path) : fs(fs), path(path), slots(0), created(false), upgraded(false) {}
+
+    // Opens the store, converts a version 1 store, or creates an empty one
+    // when there is none or the file is not a store. Keeps the file open.
+    bool Begin();
+    // Begin() started a new store, e.g. on the first boot with this firmware
+    bool Created() const { return created; }
+    // Begin() converted a version 1 store, every slot kept its profile
+    bool Upgraded() const { return upgraded; }
+
+    uint32_t Slots() const { return slots; }
+    // false for a free slot or a damaged record
+    bool Read(uint32_t slot, ProfileRecord &record);
+    // Stores the record in slot, or in the first free slot (or a new one) when
+    // slot is -1. Sets the CRC, returns the slot or -1.
+    int32_t Write(ProfileRecord &record, int32_t slot = -1);
+    bool Erase(uint32_t slot);
+
+    static uint32_t Crc32(const void *data, size_t length);
+
+  private:
+    bool Create();
+    bool Upgrade();
+    bool WriteHeader(File &out);
+    bool WriteAt(uint32_t slot, const ProfileRecord &record);
+
+    fs::FS &fs;
+    const char *path;
+    File file;
+    uint32_t slots;
+    bool created, upgraded;
+};
+
+#endif
@@ -0,0 +1,131 @@
+// Host check for ProfileStore on the HostSim LittleFS: round trip, slot reuse, damaged records and version 1 conversion.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/HostSim -I lib/ProfileEngine -I lib/ProfileStore lib/HostSim/*.cpp lib/ProfileEngine/ProfileEngine.cpp lib/ProfileStore/ProfileStore.cpp lib/ProfileStore/examples/Records/Records.cpp -o profile_store && ./profile_store
+
+#include <ProfileStore.h>
+#include <LittleFS.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static ProfileRecord Profile(const char *name, float reflowTemp) {
+  ProfileRecord record;
+  memset(&record, 0, sizeof(record));
+  snprintf(record.name, sizeof(record.name), "%s", name);
+  const float temperature[4] = {100, 150, reflowTemp, 25};
+  const uint32_t time[4] = {120000, 60000, 120000, 120000};
+  record.segmentCount = ProfileEngine::FromPhases(temperature, time, 1.5f, 0, record.segments);
+  return record;
+}
+
+// a record as version 1 of the store wrote it
+struct RecordV1 {
+  char name[PROFILE_NAME_SIZE];
+  float temperature[4];
+  uint32_t time[4];
+  float rampRate, coolRate;
+  uint32_t reserved;
+  uint32_t crc;
+};
+
+static void WriteV1(const char *path) {
+  ProfileStoreHeader header = {PROFILE_STORE_MAGIC, 1, sizeof(RecordV1), 0, 0};
+  header.crc = ProfileStore::Crc32(&header, offsetof(ProfileStoreHeader, crc));
+  File file = LittleFS.open(path, "w", true);
+  file.write((const uint8_t *)&header, sizeof(header));
+  for (int i = 0; i < 3; i++) {
+    RecordV1 record = {};
+    if (i != 1) { // the middle slot is free
+      snprintf(record.name, sizeof(record.name), "old-%d.json", i);
+      float temperature[4] = {100, 150, 230.0f + i, 25};
+      uint32_t time[4] = {120000, 60000, 120000, 120000};
+      memcpy(record.temperature, temperature, sizeof(temperature));
+      memcpy(record.time, time, sizeof(time));
+      record.rampRate = 1.5f;
+    }
+    record.crc = ProfileStore::Crc32(&record, offsetof(RecordV1, crc));
+    file.write((const uint8_t *)&record, sizeof(record));
+  }
+  file.close();
+}
+
+int main() {
+  char scratch[] = "/tmp/profilestore_XXXXXX";
+  if (!mkdtemp(scratch)) return 1;
+  LittleFS.SetRoot(scratch);
+  LittleFS.begin();
+
+  uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  Expect(ProfileStore::Crc32(check, sizeof(check)) == 0xCBF43926, "CRC-32 of \"123456789\"");
+
+  {
+    ProfileStore store(LittleFS, "/profiles.bin");
+    Expect(store.Begin() && store.Created() && store.Slots() == 0, "a missing store is created empty");
+    ProfileRecord a = Profile("default.json", 230), b = Profile("leaded.json", 215), c = Profile("lead-free.json", 245);
+    Expect(store.Write(a) == 0 && store.Write(b) == 1 && store.Write(c) == 2, "new profiles take new slots");
+    Expect(store.Erase(1) && store.Write(b = Profile("leaded v2.json", 210)) == 1, "a deleted profile's slot is reused");
+  }
+
+  ProfileStore store(LittleFS, "/profiles.bin");
+  ProfileRecord record;
+  Expect(store.Begin() && !store.Created() && store.Slots() == 3, "reopened with its slots");
+  Expect(store.Read(1, record) && strcmp(record.name, "leaded v2.json") == 0 && record.segmentCount == 4 &&
+         record.segments[2].target == 210 && record.segments[0].rate == 1.5f &&
+         record.segments[3].time == 120000, "records read back as written");
+  Expect(!store.Read(3, record), "no slot past the end");
+
+  const int reads = 100000;
+  auto begin = std::chrono::steady_clock::now();
+  float sum = 0;
+  for (int i = 0; i < reads; i++) {
+    store.Read(i % 3, record);
+    sum += record.segments[2].target;
+  }
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / reads;
+  printf("  one Read(): %.2f us (checksum %.0f)\n", us, sum);
+
+  // one flipped byte in the middle record, as a cut-short write would leave it
+  File raw = LittleFS.open("/profiles.bin", "r+");
+  raw.seek(sizeof(ProfileStoreHeader) + sizeof(ProfileRecord) + 50);
+  raw.write((uint8_t)0x5A);
+  raw.close();
+  ProfileStore damaged(LittleFS, "/profiles.bin");
+  damaged.Begin();
+  Expect(!damaged.Read(1, record) && damaged.Read(0, record) && damaged.Read(2, record) &&
+         strcmp(record.name, "lead-free.json") == 0, "a damaged record reads as free, its neighbours do not");
+  ProfileRecord replacement = Profile("replacement.json", 220);
+  Expect(damaged.Write(replacement) == 1, "and its slot is reused");
+
+  WriteV1("/old.bin");
+  ProfileStore old(LittleFS, "/old.bin");
+  Expect(old.Begin() && old.Upgraded() && old.Slots() == 3, "a version 1 store is upgraded in place");
+  Expect(old.Read(0, record) && strcmp(record.name, "old-0.json") == 0 && record.segmentCount == 4 &&
+         record.segments[2].target == 230 && record.segments[2].phase == PHASE_REFLOW &&
+         record.segments[1].time == 60000 && !old.Read(1, record) && old.Read(2, record) &&
+         record.segments[2].target == 232, "its profiles as segments, free slots stay free");
+  Expect(!LittleFS.exists("/old.bin.new"), "no leftover from the upgrade");
+  ProfileStore reopened(LittleFS, "/old.bin");
+  Expect(reopened.Begin() && !reopened.Upgraded() && !reopened.Created() && reopened.Slots() == 3,
+         "and opens as version 2 afterwards");
+
+  File other = LittleFS.open("/profiles.bin", "r+");
+  other.seek(4);
+  other.write((uint8_t)(PROFILE_STORE_VERSION + 1)); // a future version
+  other.close();
+  ProfileStore future(LittleFS, "/profiles.bin");
+  Expect(future.Begin() && future.Created() && future.Slots() == 0, "another version is replaced by an empty store");
+
+  std::string command = std::string("rm -rf ") + scratch;
+  system(command.c_str());
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+#include "Profiler.h"
+
+#ifdef PROFILER
+
+ProfileProbe *ProfileProbe::first = nullptr;
+std::atomic<uint32_t> ProfileProbe::resetEpoch{0};
+
+// probes are globals, so this runs during static initialisation before any task exists
+ProfileProbe::ProfileProbe(const char *name) : name(name), local(), next(nullptr) {
+  ProfileProbe **tail = &first;
+  while (*tail) tail = &(*tail)->next;
+  *tail = this;
+}
+
+ProbeStats ProfileProbe::Stats() const {
+  ProbeStats stats = published.Read();
+  // reset, but the owner has not run since
+  if (stats.epoch != resetEpoch.load(std::memory_order_relaxed)) return ProbeStats();
+  return stats;
+}
+
+#endif
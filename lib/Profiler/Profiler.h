@@ -0,0 +1,106 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <stdint.h>
+#include <atomic>
+
+// Hot-path profiler.
+// A ProfileProbe counts the calls, total and longest duration of one piece of
+// code, measured by a ProfileScope around it. Durations are in profiler ticks:
+// CPU cycles of the core the task is pinned to on the ESP32, nanoseconds of the
+// monotonic clock on the host.
+//
+// Probes only exist when the build defines PROFILER. Without it PROFILE_PROBE
+// and PROFILE_SCOPE expand to nothing, so instrumented code costs nothing.
+//
+//   PROFILE_PROBE(probeDisplay, "display");  // file scope
+//   void HandleDisplay() { PROFILE_SCOPE(probeDisplay); ... }
+//
+// Each probe must only be entered from one task. Its totals are published
+// through a Seqlock, so any task can read them while that task runs.
+
+#ifdef PROFILER
+#include <Seqlock.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+#include <Esp.h>
+inline uint32_t ProfilerTicks() { return ESP.getCycleCount(); }
+inline uint32_t ProfilerTicksPerSecond() { return getCpuFrequencyMhz() * 1000000UL; }
+#else
+#include <chrono>
+inline uint32_t ProfilerTicks() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t ProfilerTicksPerSecond() { return 1000000000UL; }
+#endif
+
+struct ProbeStats {
+  uint32_t calls;
+  uint32_t maxTicks;
+  uint64_t totalTicks;
+  uint32_t epoch; // ResetAll() generation the counts belong to
+};
+
+class ProfileProbe
+{
+  public:
+    explicit ProfileProbe(const char *name);
+
+    // owner task only, ticks is the duration of one call
+    void Record(uint32_t ticks) {
+      uint32_t epoch = resetEpoch.load(std::memory_order_relaxed);
+      if (epoch != local.epoch) {
+        local = ProbeStats();
+        local.epoch = epoch;
+      }
+      local.calls++;
+      local.totalTicks += ticks;
+      if (ticks > local.maxTicks) local.maxTicks = ticks;
+      published.Write(local);
+    }
+
+    const char *Name() const { return name; }
+    ProbeStats Stats() const;
+
+    // all registered probes, in the order they were constructed
+    static ProfileProbe *First() { return first; }
+    ProfileProbe *Next() const { return next; }
+
+    // clears every probe, any task may call this, owners apply it on their next Record()
+    static void ResetAll() { resetEpoch.fetch_add(1, std::memory_order_relaxed); }
+
+  private:
+    const char *name;
+    ProbeStats local;
+    Seqlock<ProbeStats> published;
+    ProfileProbe *next;
+
+    static ProfileProbe *first;
+    static std::atomic<uint32_t> resetEpoch;
+};
+
+// records the time from construction to the end of the enclosing block
+class ProfileScope
+{
+  public:
+    explicit ProfileScope(ProfileProbe &probe) : probe(probe), start(ProfilerTicks()) {}
+    ~ProfileScope() { probe.Record(ProfilerTicks() - start); }
+
+  private:
+    ProfileProbe &probe;
+    uint32_t start;
+};
+
+#define PROFILE_PROBE(variable, name) ProfileProbe variable(name)
+#define PROFILE_SCOPE(variable) ProfileScope variable##Scope(variable)
+
+#else
+
+#define PROFILE_PROBE(variable, name)
+#define PROFILE_SCOPE(variable) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#include "RelayAutotune.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char *const ruleNames[TUNE_RULES] = {"classic", "some-overshoot", "no-overshoot"};
+
+// Kp as a fraction of Ku, Ti and Td as fractions of Tu
+static const float ruleTable[TUNE_RULES][3] = {
+  {0.6f, 0.5f, 0.125f},
+  {0.33f, 0.5f, 1 / 3.0f},
+  {0.2f, 0.5f, 1 / 3.0f},
+};
+
+void RelayAutotune::Begin(float setpoint, float hysteresis, float low, float high, TuneRule rule) {
+  this->setpoint = setpoint;
+  this->hysteresis = hysteresis;
+  this->low = low;
+  this->high = high;
+  this->rule = rule < TUNE_RULES ? rule : TUNE_NO_OVERSHOOT;
+  state = TUNE_APPROACH;
+  output = low;
+  failure = "";
+  lastSwitch = 0;
+  risen = false;
+  cycles = 0;
+  memset(&result, 0, sizeof(result));
+  first = true;
+}
+
+float RelayAutotune::Update(uint32_t t, float input) {
+  if (state != TUNE_APPROACH && state != TUNE_RELAY) return output;
+
+  if (first) {
+    // heat or cool towards the setpoint, whichever side the plant starts on
+    on = input < setpoint;
+    output = on ? high : low;
+    peak = trough = input;
+    first = false;
+  }
+
+  if (input > peak) peak = input;
+  if (input < trough) trough = input;
+
+  if (on && input > setpoint + hysteresis) Switch(t, false, input);
+  else if (!on && input < setpoint - hysteresis) Switch(t, true, input);
+  else if (t - lastSwitch > TUNE_MAX_HALF_CYCLE_MS) Fail(state == TUNE_APPROACH ? "Setpoint not reached" : "Relay cycle too long");
+
+  return output;
+}
+
+void RelayAutotune::Switch(uint32_t t, bool nowOn, float input) {
+  state = TUNE_RELAY;
+  on = nowOn;
+  output = on ? high : low;
+  lastSwitch = t;
+
+  if (!on) {
+    // the half cycle with the relay on ended, its lowest point is the trough of this cycle
+    lastTrough = trough;
+  } else {
+    // a half cycle with the relay off ended: a whole cycle since the last switch on
+    if (risen) {
+      uint8_t i = cycles % TUNE_AVERAGE_CYCLES;
+      periods[i] = (float)(t - lastRise);
+      amplitudes[i] = (peak - lastTrough) / 2;
+      cycles++;
+      if (Settled()) {
+        Finish();
+        return;
+      }
+      if (cycles >= TUNE_MAX_CYCLES) {
+        Fail("No steady oscillation");
+        return;
+      }
+    }
+    lastRise = t;
+    risen = true;
+  }
+
+  // the extremes of the next half cycle come after the switch, the plant lags
+  peak = trough = input;
+}
+
+// largest difference between the last cycles relative to their mean is within the tolerance
+static bool Agree(const float *values) {
+  float lowest = values[0], highest = values[0], sum = 0;
+  for (int i = 0; i < TUNE_AVERAGE_CYCLES; i++) {
+    if (values[i] < lowest) lowest = values[i];
+    if (values[i] > highest) highest = values[i];
+    sum += values[i];
+  }
+  return highest - lowest <= TUNE_TOLERANCE * sum / TUNE_AVERAGE_CYCLES;
+}
+
+// the last cycles agree, the first one (the approach overshoot) is never among them
+bool RelayAutotune::Settled() const {
+  return cycles >= TUNE_AVERAGE_CYCLES + 1 && Agree(periods) && Agree(amplitudes);
+}
+
+void RelayAutotune::Finish() {
+  float period = 0, amplitude = 0;
+  for (int i = 0; i < TUNE_AVERAGE_CYCLES; i++) {
+    period += periods[i] / TUNE_AVERAGE_CYCLES;
+    amplitude += amplitudes[i] / TUNE_AVERAGE_CYCLES;
+  }
+
+  result.tu = period / 1000.0f;
+  result.amplitude = amplitude;
+  result.ku = 4 * (high - low) / 2 / ((float)M_PI * amplitude);
+  result.cycles = cycles;
+  Gains(rule, result.ku, result.tu, result.kp, result.ki, result.kd);
+  state = TUNE_DONE;
+  output = low;
+}
+
+void RelayAutotune::Fail(const char *why) {
+  failure = why;
+  state = TUNE_FAILED;
+  output = low;
+}
+
+void RelayAutotune::Gains(TuneRule rule, float ku, float tu, float &kp, float &ki, float &kd) {
+  const float *row = ruleTable[rule < TUNE_RULES ? rule : TUNE_NO_OVERSHOOT];
+  kp = row[0] * ku;
+  ki = kp / (row[1] * tu);
+  kd = kp * row[2] * tu;
+}
+
+const char *RelayAutotune::RuleName(uint8_t rule) {
+  return rule < TUNE_RULES ? ruleNames[rule] : "unknown";
+}
+
+bool RelayAutotune::ParseRule(const char *name, uint8_t &rule) {
+  for (uint8_t i = 0; i < TUNE_RULES; i++) {
+    if (strcmp(name, ruleNames[i]) == 0) {
+      rule = i;
+      return true;
+    }
+  }
+  return false;
+}
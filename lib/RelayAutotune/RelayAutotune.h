@@ -0,0 +1,95 @@
+#ifndef RelayAutotune_h
+#define RelayAutotune_h
+
+#include <stdint.h>
+
+// Relay feedback autotuning (Åström-Hägglund). Instead of a PID, a relay with
+// hysteresis drives the plant around the setpoint: full output below
+// setpoint - hysteresis, none above setpoint + hysteresis. Any plant with
+// enough lag settles into a limit cycle at its ultimate period Tu, and the
+// amplitude a of that cycle gives the ultimate gain
+//
+//   Ku = 4 d / (pi sqrt(a^2 - hysteresis^2)),  d = (high - low) / 2
+//
+// from which the gains follow by one of the TuneRule tables. The first cycle
+// is the heat-up overshoot and is not used; the result is the mean of the
+// last TUNE_AVERAGE_CYCLES once their periods and amplitudes agree within
+// TUNE_TOLERANCE. Update() is O(1), times are ms since the start.
+
+#define TUNE_AVERAGE_CYCLES 3
+#define TUNE_MAX_CYCLES 12         // without a steady cycle by then the plant does not settle
+#define TUNE_TOLERANCE 0.1f        // spread of the averaged periods and amplitudes
+#define TUNE_MAX_HALF_CYCLE_MS 900000UL // longest the relay may stay in one position
+
+enum TuneRule : uint8_t {
+  TUNE_CLASSIC,         // Ziegler-Nichols: Kp 0.6 Ku, Ti Tu/2, Td Tu/8, fast with a large overshoot
+  TUNE_SOME_OVERSHOOT,  // Kp 0.33 Ku, Ti Tu/2, Td Tu/3
+  TUNE_NO_OVERSHOOT,    // Kp 0.2 Ku, Ti Tu/2, Td Tu/3
+  TUNE_RULES
+};
+
+enum TuneState : uint8_t {
+  TUNE_IDLE,
+  TUNE_APPROACH,   // the relay has not switched yet, the plant moves to the setpoint
+  TUNE_RELAY,      // the relay cycles, measuring
+  TUNE_DONE,       // Result() holds the gains
+  TUNE_FAILED      // Failure() says why
+};
+
+struct TuneResult {
+  float ku;        // ultimate gain, output per C
+  float tu;        // s, ultimate period
+  float amplitude; // C, half the peak to peak of the cycle
+  uint8_t cycles;  // relay cycles it took, the first one included
+  // ideal PID gains in seconds: output per C, per C s and C/s
+  float kp, ki, kd;
+};
+
+class RelayAutotune
+{
+  public:
+    RelayAutotune() : state(TUNE_IDLE), low(0), output(0), failure("") {}
+
+    // starts at t = 0 with the relay between low and high output
+    void Begin(float setpoint, float hysteresis, float low, float high, TuneRule rule);
+    // the next measurement, returns the relay output to apply until the next call
+    float Update(uint32_t t, float input);
+    void Stop() { state = TUNE_IDLE; output = low; }
+
+    TuneState State() const { return state; }
+    float Output() const { return output; }
+    float Setpoint() const { return setpoint; }
+    // complete cycles so far, the first one included
+    uint8_t Cycles() const { return cycles; }
+    const TuneResult &Result() const { return result; }
+    const char *Failure() const { return failure; }
+
+    // gains of a rule for a measured Ku and Tu (s), ki and kd as in TuneResult
+    static void Gains(TuneRule rule, float ku, float tu, float &kp, float &ki, float &kd);
+    static const char *RuleName(uint8_t rule);
+    static bool ParseRule(const char *name, uint8_t &rule);
+
+  private:
+    void Switch(uint32_t t, bool on, float input);
+    bool Settled() const;
+    void Finish();
+    void Fail(const char *why);
+
+    TuneState state;
+    TuneRule rule;
+    float setpoint, hysteresis, low, high, output;
+    const char *failure;
+
+    bool first;            // no Update() yet, the relay starts on the side the input is
+    bool on;               // relay position, output is high
+    uint32_t lastSwitch;   // ms, when the relay last switched
+    uint32_t lastRise;     // ms, when it last switched on, the start of a cycle
+    bool risen;            // lastRise is set
+    float peak, trough;    // extremes of the current half cycle
+    float lastTrough;      // of the cycle in progress
+    uint8_t cycles;
+    float periods[TUNE_AVERAGE_CYCLES], amplitudes[TUNE_AVERAGE_CYCLES]; // of the last cycles, a ring
+    TuneResult result;
+};
+
+#endif
@@ -0,0 +1,140 @@
+// Host check for RelayAutotune: a plant of known ultimate gain and period, then the simulated oven.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/PID -I lib/HostSim -I lib/RelayAutotune lib/HostSim/Arduino.cpp lib/HostSim/WString.cpp lib/HostSim/SimOven.cpp lib/RelayAutotune/RelayAutotune.cpp lib/RelayAutotune/examples/Relay/Relay.cpp -o relay_autotune && ./relay_autotune
+
+#include <RelayAutotune.h>
+#include <PidCore.h>
+#include <SimOven.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+struct SimMillis {
+  static unsigned long Now() { return millis(); }
+};
+
+// gain/(tau s + 1)^3: the phase is -180 degrees where every lag turns 60, at
+// w tau = sqrt(3), and the gain there is gain / 8
+struct ThreeLags {
+  float gain, tau, x[3] = {0, 0, 0};
+  void Step(float u, float dt) {
+    x[0] += dt * (gain * u - x[0]) / tau;
+    x[1] += dt * (x[0] - x[1]) / tau;
+    x[2] += dt * (x[1] - x[2]) / tau;
+  }
+};
+
+static const unsigned long PID_MS = 250, PWM_MS = 500, PWM_STEPS = 10;
+
+// the oven driven like the firmware: Output every PID_MS, the relay by the slow PWM
+template <typename Control>
+static void RunOven(SimOven &oven, unsigned long runMs, Control control) {
+  double output = 0;
+  int dutySteps = 0;
+  unsigned long start = millis();
+  for (unsigned long ms = 0; ms < runMs; ms += PWM_MS / PWM_STEPS) {
+    SimClock::Advance((start + ms - millis()) * 1000ULL);
+    if (ms % PID_MS == 0 && !control(ms, oven.SensorTemp(), output)) return;
+    unsigned long step = (ms % PWM_MS) / (PWM_MS / PWM_STEPS);
+    if (step == 0) dutySteps = (int)(output * PWM_STEPS);
+    oven.SetHeater(step < (unsigned long)dutySteps);
+  }
+}
+
+int main() {
+  float kp, ki, kd;
+  RelayAutotune::Gains(TUNE_CLASSIC, 1, 10, kp, ki, kd);
+  Expect(fabsf(kp - 0.6f) < 1e-6f && fabsf(ki - 0.12f) < 1e-6f && fabsf(kd - 0.75f) < 1e-6f,
+         "Ziegler-Nichols: Kp 0.6 Ku, Ti Tu/2, Td Tu/8");
+  RelayAutotune::Gains(TUNE_NO_OVERSHOOT, 1, 10, kp, ki, kd);
+  uint8_t rule;
+  Expect(fabsf(kp - 0.2f) < 1e-6f && RelayAutotune::ParseRule("no-overshoot", rule) && rule == TUNE_NO_OVERSHOOT &&
+         !RelayAutotune::ParseRule("fast", rule), "rules by name");
+
+  {
+    ThreeLags plant = {2, 10};
+    RelayAutotune tune;
+    tune.Begin(1, 0.002f, 0, 1, TUNE_CLASSIC);
+    float output = 0;
+    for (uint32_t ms = 0; ms < 3600000 && tune.State() < TUNE_DONE; ms += 10) {
+      if (ms % 50 == 0) output = tune.Update(ms, plant.x[2]);
+      plant.Step(output, 0.01f);
+    }
+    const TuneResult &result = tune.Result();
+    float ku = 8 / plant.gain, tu = 2 * (float)M_PI * plant.tau / sqrtf(3);
+    printf("  three lags: Ku %.3f (exact %.3f), Tu %.2f s (exact %.2f s), %u cycles\n", result.ku, ku, result.tu, tu,
+           (unsigned)result.cycles);
+    Expect(tune.State() == TUNE_DONE, "three lags settle into a steady cycle");
+    Expect(fabsf(result.tu - tu) < 0.05f * tu && fabsf(result.ku - ku) < 0.1f * ku,
+           "Tu within 5%, Ku within 10% of the exact values");
+  }
+
+  SimClock::Reset();
+  SimOven oven;
+  RelayAutotune tune;
+  tune.Begin(150, 1, 0, 1, TUNE_CLASSIC);
+  RunOven(oven, 7200000, [&](unsigned long ms, float temperature, double &output) {
+    output = tune.Update(ms, temperature);
+    return tune.State() < TUNE_DONE;
+  });
+  const TuneResult &result = tune.Result();
+  printf("  oven at 150 C: Ku %.4f/C, Tu %.1f s, amplitude %.2f C after %u cycles, %.0f s\n", result.ku, result.tu,
+         result.amplitude, (unsigned)result.cycles, millis() / 1000.0);
+  Expect(tune.State() == TUNE_DONE && result.ku > 0 && result.tu > 0, "the oven is tuned at 150 C");
+
+  // the firmware's PID has a 10 ms sample time but computes every 250 ms, see TuneGains() in main.cpp
+  double scale = PID_MS / 10.0;
+  printf("  gains Kp %.4f, Ki %.5f/s, Kd %.3f s -> firmware Kp %.4f, Ki %.4f, Kd %.5f\n", result.kp, result.ki,
+         result.kd, result.kp, result.ki * scale, result.kd / scale);
+  for (float target : {100.0f, 150.0f, 230.0f}) {
+    SimClock::Reset();
+    SimOven hold;
+    PidController<float, SimMillis> pid(result.kp, result.ki * scale, result.kd / scale, P_ON_E, DIRECT);
+    pid.SetOutputLimits(0, 1);
+    pid.SetSampleTime(10);
+    pid.SetIntegralBounds(-10, 10); // as in the firmware
+    pid.SetMode(AUTOMATIC, 25.0f);
+    float peak = 0, worst = 0;
+    RunOven(hold, 900000, [&](unsigned long ms, float temperature, double &output) {
+      pid.Compute(temperature, target);
+      output = pid.Output();
+      peak = fmaxf(peak, temperature);
+      if (ms >= 600000) worst = fmaxf(worst, fabsf(temperature - target));
+      return true;
+    });
+    char what[64];
+    snprintf(what, sizeof(what), "the tuned PID holds %.0f C within 1 C, 2 C overshoot", target);
+    printf("  holding %.0f C: peak %.1f C, within %.2f C after 600 s\n", target, peak, worst);
+    Expect(worst < 1 && peak < target + 2, what);
+  }
+
+  RelayAutotune unreachable;
+  unreachable.Begin(400, 1, 0, 1, TUNE_NO_OVERSHOOT); // the oven tops out at 325 C
+  SimClock::Reset();
+  SimOven weak;
+  RunOven(weak, 7200000, [&](unsigned long ms, float temperature, double &output) {
+    output = unreachable.Update(ms, temperature);
+    return unreachable.State() < TUNE_DONE;
+  });
+  Expect(unreachable.State() == TUNE_FAILED && strcmp(unreachable.Failure(), "Setpoint not reached") == 0,
+         "an unreachable setpoint fails");
+
+  const int updates = 10000000;
+  RelayAutotune bench;
+  bench.Begin(0, 0.5f, 0, 1, TUNE_CLASSIC);
+  float sum = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < updates; i++) sum += bench.Update(i, (i / 1000 % 2) ? 1.0f : -1.0f);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / updates;
+  printf("  one Update(): %.1f ns (checksum %.0f)\n", ns, sum);
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
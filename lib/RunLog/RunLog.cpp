@@ -0,0 +1,209 @@
+#include "RunLog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static_assert(sizeof(HistorySample) == 8, "run logs store 8-byte samples");
+static_assert(RUNLOG_BLOCK_SIZE % sizeof(HistorySample) == 0, "a block holds whole samples");
+
+#define RUNLOG_MAGIC_V1 0x314C5254 // "TRL1"
+
+// the header of older firmware, only read
+struct RunLogHeaderV1 {
+  uint32_t magic;
+  uint16_t headerSize;
+  uint16_t sampleSize;
+  uint32_t id;
+  uint32_t samplePeriod;
+  char profile[32];
+  float temperature[4];  // preheat, soak, reflow, cooldown (C)
+  uint32_t time[4];      // ms
+  float rampRate, coolRate;
+  float kp, ki, kd;
+};
+
+String RunLogPath(uint32_t id) {
+  return String(RUNLOG_DIR "/") + String((unsigned long)id) + ".bin";
+}
+
+int RunLogList(fs::FS &fs, uint32_t *ids, int max) {
+  int count = 0;
+  File dir = fs.open(RUNLOG_DIR, "r");
+  if (!dir || !dir.isDirectory()) return 0;
+
+  for (File file = dir.openNextFile(); file && count < max; file = dir.openNextFile()) {
+    String name = file.name();
+    if (file.isDirectory() || !name.endsWith(".bin")) continue;
+    uint32_t id = strtoul(name.c_str(), nullptr, 10);
+    if (id == 0) continue;
+
+    // insertion sort, there are only a few
+    int i = count++;
+    while (i > 0 && ids[i - 1] > id) {
+      ids[i] = ids[i - 1];
+      i--;
+    }
+    ids[i] = id;
+  }
+  return count;
+}
+
+// ---------------- RunLogWriter ----------------
+
+void RunLogWriter::Begin() {
+  uint32_t ids[RUNLOG_MAX_RUNS + 8];
+  int count = RunLogList(fs, ids, RUNLOG_MAX_RUNS + 8);
+  nextId = count ? ids[count - 1] + 1 : 1;
+}
+
+// deletes the oldest runs until there is room for a new one
+void RunLogWriter::Rotate() {
+  uint32_t ids[RUNLOG_MAX_RUNS + 8];
+  int count = RunLogList(fs, ids, RUNLOG_MAX_RUNS + 8);
+  for (int i = 0; i < count; i++) {
+    if (count - i < RUNLOG_MAX_RUNS && freeSpace() >= RUNLOG_MIN_FREE) break;
+    fs.remove(RunLogPath(ids[i]));
+  }
+}
+
+bool RunLogWriter::Open(RunLogHeader &header) {
+  Close();
+  fs.mkdir(RUNLOG_DIR);
+  Rotate();
+
+  header.magic = RUNLOG_MAGIC;
+  header.headerSize = sizeof(RunLogHeader);
+  header.sampleSize = sizeof(HistorySample);
+  header.id = nextId++;
+  path = RunLogPath(header.id);
+
+  File file = fs.open(path, "w", true);
+  if (!file) return false;
+  bool written = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  file.close();
+  if (!written) {
+    fs.remove(path);
+    return false;
+  }
+
+  blockLength = 0;
+  open = true;
+  return true;
+}
+
+void RunLogWriter::Append(const HistorySample &sample) {
+  if (!open) return;
+  if (blockLength + sizeof(sample) > sizeof(block) && !Flush()) {
+    dropped += blockLength / sizeof(sample); // the filesystem is full, keep what is stored
+    blockLength = 0;
+  }
+  memcpy(block + blockLength, &sample, sizeof(sample));
+  blockLength += sizeof(sample);
+}
+
+bool RunLogWriter::Flush() {
+  if (!blockLength) return true;
+  // appending and closing every block keeps all but the last block after a power cut
+  File file = fs.open(path, "a");
+  if (!file) return false;
+  bool written = file.write(block, blockLength) == blockLength;
+  file.close();
+  if (written) blockLength = 0;
+  return written;
+}
+
+void RunLogWriter::Close() {
+  if (!open) return;
+  if (!Flush()) dropped += blockLength / sizeof(HistorySample);
+  blockLength = 0;
+  open = false;
+}
+
+// ---------------- RunLogReader ----------------
+
+bool RunLogReader::ReadHeader() {
+  uint32_t magic;
+  if (file.read((uint8_t *)&magic, sizeof(magic)) != sizeof(magic) || !file.seek(0)) return false;
+  if (magic == RUNLOG_MAGIC) {
+    return file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.headerSize >= sizeof(header) &&
+           header.segmentCount <= PROFILE_MAX_SEGMENTS;
+  }
+  if (magic != RUNLOG_MAGIC_V1) return false;
+
+  RunLogHeaderV1 old;
+  if (file.read((uint8_t *)&old, sizeof(old)) != sizeof(old) || old.headerSize < sizeof(old)) return false;
+  memset(&header, 0, sizeof(header));
+  header.magic = old.magic;
+  header.headerSize = old.headerSize;
+  header.sampleSize = old.sampleSize;
+  header.id = old.id;
+  header.samplePeriod = old.samplePeriod;
+  memcpy(header.profile, old.profile, sizeof(header.profile));
+  header.kp = old.kp;
+  header.ki = old.ki;
+  header.kd = old.kd;
+  header.segmentCount = ProfileEngine::FromPhases(old.temperature, old.time, old.rampRate, old.coolRate, header.segments);
+  return true;
+}
+
+bool RunLogReader::Open(fs::FS &fs, uint32_t id) {
+  file = fs.open(RunLogPath(id), "r");
+  if (!file || !ReadHeader() || header.sampleSize != sizeof(HistorySample)) {
+    Close();
+    return false;
+  }
+  header.profile[sizeof(header.profile) - 1] = 0;
+  file.seek(header.headerSize);
+  samples = (file.size() - header.headerSize) / sizeof(HistorySample);
+  next = 0;
+  lineLength = linePosition = 0;
+  stage = segment = 0;
+  return true;
+}
+
+bool RunLogReader::NextLine() {
+  int length;
+  switch (stage) {
+    case 0:
+      length = snprintf(line, sizeof(line), "# run %lu, profile %s, kp %.4f, ki %.4f, kd %.4f, %u segments\n",
+                        (unsigned long)header.id, header.profile, header.kp, header.ki, header.kd,
+                        (unsigned)header.segmentCount);
+      stage = 1;
+      break;
+    case 1:
+      if (segment < header.segmentCount) {
+        const ProfileSegment &s = header.segments[segment++];
+        length = snprintf(line, sizeof(line), "# segment %u, %s, %s, %.1f C, %.2f C/s, %lus\n", (unsigned)segment,
+                          ProfileEngine::TypeName(s.type), ProfileEngine::PhaseName(s.phase), s.target, s.rate,
+                          (unsigned long)s.time / 1000);
+        break;
+      }
+      length = snprintf(line, sizeof(line), "time,temperature,setpoint,output\n");
+      stage = 2;
+      break;
+    default: {
+      HistorySample sample;
+      if (next >= samples || file.read((uint8_t *)&sample, sizeof(sample)) != sizeof(sample)) return false;
+      next++;
+      length = snprintf(line, sizeof(line), "%.1f,%.1f,%.1f,%.3f\n",
+                        sample.Seconds(), sample.Temperature(), sample.Setpoint(), sample.Output());
+      break;
+    }
+  }
+  lineLength = length < (int)sizeof(line) ? length : sizeof(line) - 1;
+  linePosition = 0;
+  return true;
+}
+
+size_t RunLogReader::ReadCsv(char *buffer, size_t size) {
+  size_t filled = 0;
+  while (filled < size) {
+    if (linePosition == lineLength && !NextLine()) break;
+    size_t n = lineLength - linePosition;
+    if (n > size - filled) n = size - filled;
+    memcpy(buffer + filled, line + linePosition, n);
+    filled += n;
+    linePosition += n;
+  }
+  return filled;
+}
@@ -0,0 +1,112 @@
+#ifndef RunLog_h
+#define RunLog_h
+
+#include <Arduino.h>
+#include <FS.h>
+#include <History.h>
+#include <ProfileEngine.h>
+
+// Binary record of every run on the filesystem, RUNLOG_DIR/<id>.bin: a fixed
+// RunLogHeader with the profile and PID gains, then the HistorySample of every
+// PID computation (8 bytes each, little endian like the ESP32 and a PC).
+//
+// RunLogWriter collects samples in a RAM block and appends it to the file a
+// flash page at a time. It runs on the UI side, the control task only fills
+// the History ring it is read from, so a slow flash write never delays a
+// control tick. Before a run is opened the oldest runs are deleted until
+// RUNLOG_MIN_FREE bytes are free and at most RUNLOG_MAX_RUNS are kept.
+//
+// RunLogReader turns a stored run back into CSV a piece at a time, so an
+// export needs one line of RAM whatever the length of the run. It also reads
+// the runs of older firmware ("TRL1", four phases instead of segments).
+
+#define RUNLOG_DIR "/runs"
+#define RUNLOG_BLOCK_SIZE 256  // bytes per append, one flash page
+#define RUNLOG_MAX_RUNS 32
+#define RUNLOG_MIN_FREE 65536  // about four default runs
+#define RUNLOG_MAGIC 0x324C5254 // "TRL2"
+
+struct RunLogHeader {
+  uint32_t magic;
+  uint16_t headerSize;   // sizeof(RunLogHeader), the samples start here
+  uint16_t sampleSize;   // sizeof(HistorySample)
+  uint32_t id;
+  uint32_t samplePeriod; // ms between samples
+  char profile[32];
+  float kp, ki, kd;
+  uint8_t segmentCount;
+  uint8_t reserved[3];
+  ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+};
+
+class RunLogWriter
+{
+  public:
+    // free bytes on the filesystem, for the rotation
+    typedef size_t (*FreeSpace)();
+
+    RunLogWriter(fs::FS &fs, FreeSpace freeSpace)
+      : fs(fs), freeSpace(freeSpace), blockLength(0), nextId(1), open(false), dropped(0) {}
+
+    // finds the next run id, call once the filesystem is mounted
+    void Begin();
+    // makes room, sets header.id and writes the header; false when the file cannot be created
+    bool Open(RunLogHeader &header);
+    void Append(const HistorySample &sample);
+    // samples that never made it into the History ring's reach
+    void Lost(uint32_t samples) { dropped += samples; }
+    // writes what is left in the block
+    void Close();
+
+    bool IsOpen() const { return open; }
+    uint32_t Dropped() const { return dropped; }
+    uint32_t LastId() const { return nextId - 1; }
+
+  private:
+    bool Flush();
+    void Rotate();
+
+    fs::FS &fs;
+    FreeSpace freeSpace;
+    String path;
+    uint8_t block[RUNLOG_BLOCK_SIZE];
+    size_t blockLength;
+    uint32_t nextId;
+    bool open;
+    uint32_t dropped; // samples lost since boot, also to a full filesystem
+};
+
+class RunLogReader
+{
+  public:
+    RunLogReader() : samples(0), next(0), lineLength(0), linePosition(0), stage(0), segment(0) {}
+
+    bool Open(fs::FS &fs, uint32_t id);
+    void Close() { file = File(); }
+
+    const RunLogHeader &Header() const { return header; }
+    uint32_t Samples() const { return samples; }
+
+    // The next piece of the CSV export: a comment line with the profile and
+    // gains and one per segment, a column header, then one line per sample.
+    // Fills at most size bytes, returns 0 at the end.
+    size_t ReadCsv(char *buffer, size_t size);
+
+  private:
+    bool NextLine();
+    bool ReadHeader();
+
+    File file;
+    RunLogHeader header;
+    uint32_t samples, next;
+    char line[160];
+    size_t lineLength, linePosition;
+    uint8_t stage, segment;
+};
+
+// ids of the stored runs, oldest first; returns how many (at most max)
+int RunLogList(fs::FS &fs, uint32_t *ids, int max);
+// RUNLOG_DIR/<id>.bin
+String RunLogPath(uint32_t id);
+
+#endif
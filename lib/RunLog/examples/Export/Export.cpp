@@ -0,0 +1,138 @@
+// Host check for RunLog on the HostSim LittleFS: block writes, CSV export and pruning of old runs.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/HostSim -I lib/History -I lib/ProfileEngine -I lib/RunLog lib/HostSim/*.cpp lib/History/History.cpp lib/ProfileEngine/ProfileEngine.cpp lib/RunLog/RunLog.cpp lib/RunLog/examples/Export/Export.cpp -o runlog_export && ./runlog_export
+
+#include <RunLog.h>
+#include <LittleFS.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static size_t freeBytes = 1 << 20;
+static size_t FreeSpace() { return freeBytes; }
+
+static RunLogWriter writer(LittleFS, FreeSpace);
+
+static size_t FileSize(uint32_t id) {
+  return LittleFS.open(RunLogPath(id)).size();
+}
+
+static HistorySample Sample(uint32_t i) {
+  HistorySample sample;
+  sample.time = i * 25 / 10;
+  sample.temperature = 250 + i;
+  sample.setpoint = 1500;
+  sample.output = i % 1001;
+  return sample;
+}
+
+static std::string Export(uint32_t id, size_t piece) {
+  RunLogReader reader;
+  if (!reader.Open(LittleFS, id)) return "";
+  std::string csv;
+  char buffer[4096];
+  for (size_t n = reader.ReadCsv(buffer, piece); n; n = reader.ReadCsv(buffer, piece)) csv.append(buffer, n);
+  return csv;
+}
+
+int main() {
+  char scratch[] = "/tmp/runlog_XXXXXX";
+  if (!mkdtemp(scratch)) return 1;
+  LittleFS.SetRoot(scratch);
+  LittleFS.begin();
+  writer.Begin();
+
+  RunLogHeader header;
+  memset(&header, 0, sizeof(header));
+  snprintf(header.profile, sizeof(header.profile), "Default");
+  header.samplePeriod = 250;
+  header.kp = 0.05f;
+  header.kd = 0.005f;
+  const float temperature[4] = {150, 180, 230, 25};
+  const uint32_t time[4] = {120000, 60000, 120000, 120000};
+  header.segmentCount = ProfileEngine::FromPhases(temperature, time, 0, 0, header.segments);
+  Expect(writer.Open(header) && header.id == 1, "first run is id 1");
+
+  for (uint32_t i = 0; i < 100; i++) writer.Append(Sample(i));
+  Expect(FileSize(1) == sizeof(RunLogHeader) + 768, "only whole blocks are written while open");
+  for (uint32_t i = 100; i < 1680; i++) writer.Append(Sample(i));
+  writer.Close();
+  Expect(FileSize(1) == sizeof(RunLogHeader) + 1680 * sizeof(HistorySample), "closed: header plus 8 bytes per sample");
+
+  std::string whole = Export(1, 4096), pieces = Export(1, 7);
+  int lines = 0;
+  for (char c : whole) lines += c == '\n';
+  Expect(whole == pieces && lines == 1686, "same CSV in 7-byte pieces, 6 header lines + 1680");
+  Expect(whole.compare(0, 37, "# run 1, profile Default, kp 0.0500, ") == 0 &&
+         whole.find("4 segments\n# segment 1, hold, preheat, 150.0 C, 0.00 C/s, 120s\n") != std::string::npos &&
+         whole.find("\ntime,temperature,setpoint,output\n0.0,25.0,150.0,0.000\n0.2,25.1,150.0,0.001\n") != std::string::npos,
+         "comment, column header and first samples");
+  std::string last = "\n419.7,192.9,150.0,0.678\n";
+  Expect(whole.compare(whole.size() - last.size(), last.size(), last) == 0, "last sample");
+
+  // as the firmware before segments wrote it: the four phases, 3 samples
+  struct {
+    uint32_t magic;
+    uint16_t headerSize, sampleSize;
+    uint32_t id, samplePeriod;
+    char profile[32];
+    float temperature[4];
+    uint32_t time[4];
+    float rampRate, coolRate, kp, ki, kd;
+  } old = {0x314C5254, 100, 8, 800, 250, "Old", {100, 150, 230, 25}, {120000, 60000, 120000, 120000}, 1, 0, 0.05f, 0, 0};
+  FILE *older = fopen((std::string(scratch) + RUNLOG_DIR "/800.bin").c_str(), "wb");
+  fwrite(&old, sizeof(old), 1, older);
+  for (uint32_t i = 0; i < 3; i++) {
+    HistorySample sample = Sample(i);
+    fwrite(&sample, sizeof(sample), 1, older);
+  }
+  fclose(older);
+  std::string converted = Export(800, 4096);
+  Expect(sizeof(old) == 100 && converted.find("# segment 3, hold, reflow, 230.0 C, 1.00 C/s, 120s\n") != std::string::npos &&
+         converted.find("\n0.5,25.2,150.0,0.002\n") != std::string::npos, "a run of older firmware exports its phases");
+  LittleFS.remove(RunLogPath(800));
+
+  FILE *bad = fopen((std::string(scratch) + RUNLOG_DIR "/900.bin").c_str(), "wb");
+  fputs("not a run log", bad);
+  fclose(bad);
+  RunLogReader reader;
+  Expect(!reader.Open(LittleFS, 900) && !reader.Open(LittleFS, 901), "foreign and missing files are refused");
+  LittleFS.remove(RunLogPath(900));
+
+  // rotation by count
+  for (int run = 0; run < 40; run++) {
+    writer.Open(header);
+    writer.Append(Sample(run));
+    writer.Close();
+  }
+  uint32_t ids[64];
+  int count = RunLogList(LittleFS, ids, 64);
+  bool ordered = true;
+  for (int i = 1; i < count; i++) ordered &= ids[i] == ids[i - 1] + 1;
+  Expect(count == RUNLOG_MAX_RUNS && ids[0] == 10 && ids[count - 1] == 41 && ordered, "newest 32 runs kept, listed in order");
+
+  RunLogWriter restarted(LittleFS, FreeSpace);
+  restarted.Begin();
+  Expect(restarted.Open(header) && header.id == 42, "ids continue after a restart");
+  restarted.Close();
+
+  // rotation by free space: nothing frees up, so every old run goes
+  freeBytes = RUNLOG_MIN_FREE - 1;
+  writer.Begin();
+  Expect(writer.Open(header) && RunLogList(LittleFS, ids, 64) == 1 && ids[0] == 43, "a full filesystem drops the old runs");
+  writer.Close();
+
+  std::string command = std::string("rm -rf ") + scratch;
+  system(command.c_str());
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+#ifndef SampleFilter_h
+#define SampleFilter_h
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+// Incremental filters for raw ADC samples.
+// Every filter returns its output as a float, so averaging keeps the sub-LSB
+// information instead of truncating it, and every filter is correct from the
+// first sample on (the window is only averaged over what has been seen so far).
+
+enum FilterMode {
+  FILTER_AVERAGE = 0, // running-sum moving average over the window
+  FILTER_EMA = 1,     // exponential moving average (first order IIR)
+  FILTER_MEDIAN = 2   // sliding median, rejects single-sample spikes
+};
+
+// Moving average over the last N samples.
+// Keeps an exact integer running sum, so each sample is O(1) and never drifts.
+template <uint16_t N>
+class MovingAverage
+{
+  public:
+    MovingAverage() { Reset(); }
+
+    void Reset() {
+      sum = 0;
+      count = 0;
+      index = 0;
+    }
+
+    float Add(uint16_t sample) {
+      if (count == N) sum -= window[index];
+      else count++;
+
+      window[index] = sample;
+      sum += sample;
+      if (++index == N) index = 0;
+
+      return Value();
+    }
+
+    float Value() const { return count ? (float)sum / count : 0; }
+    uint16_t Count() const { return count; }
+
+  private:
+    uint16_t window[N];
+    uint32_t sum;
+    uint16_t count, index;
+};
+
+// Exponential moving average: y += alpha * (x - y). O(1), no window memory.
+// An alpha of 2 / (N + 1) has about the same noise bandwidth as an N sample average.
+class ExponentialFilter
+{
+  public:
+    explicit ExponentialFilter(float alpha = 0.04f) : alpha(alpha) { Reset(); }
+
+    void Reset() {
+      value = 0;
+      primed = false;
+    }
+
+    void SetAlpha(float newAlpha) {
+      if (newAlpha > 0 && newAlpha <= 1) alpha = newAlpha;
+    }
+    float Alpha() const { return alpha; }
+
+    float Add(uint16_t sample) {
+      if (!primed) {
+        value = sample; // start at the first reading instead of ramping up from 0
+        primed = true;
+      } else {
+        value += alpha * (sample - value);
+      }
+      return value;
+    }
+
+    float Value() const { return value; }
+
+  private:
+    float alpha;
+    float value;
+    bool primed;
+};
+
+// Sliding median over the last N samples.
+// The window is kept sorted, so the old sample and the new sample are located
+// with a binary search (O(log N) compares) and the median is read directly.
+template <uint16_t N>
+class MedianFilter
+{
+  public:
+    MedianFilter() { Reset(); }
+
+    void Reset() {
+      count = 0;
+      index = 0;
+    }
+
+    float Add(uint16_t sample) {
+      if (count == N) {
+        // drop the oldest sample from the sorted copy
+        uint16_t *old = std::lower_bound(sorted, sorted + count, window[index]);
+        memmove(old, old + 1, (sorted + count - old - 1) * sizeof(uint16_t));
+        count--;
+      }
+
+      uint16_t *pos = std::upper_bound(sorted, sorted + count, sample);
+      memmove(pos + 1, pos, (sorted + count - pos) * sizeof(uint16_t));
+      *pos = sample;
+      count++;
+
+      window[index] = sample;
+      if (++index == N) index = 0;
+
+      return Value();
+    }
+
+    float Value() const {
+      if (!count) return 0;
+      if (count & 1) return sorted[count / 2];
+      return (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0f;
+    }
+
+  private:
+    uint16_t window[N]; // samples in arrival order
+    uint16_t sorted[N]; // the same samples, ascending
+    uint16_t count, index;
+};
+
+// Runtime selectable filter stage. Only the active filter is fed, switching
+// mode restarts it so the output never mixes two filters' histories.
+template <uint16_t AVERAGE_N, uint16_t MEDIAN_N>
+class SampleFilter
+{
+  public:
+    explicit SampleFilter(FilterMode mode = FILTER_AVERAGE, float alpha = 0.04f) : mode(mode), ema(alpha) {}
+
+    float Add(uint16_t sample) {
+      switch (mode) {
+        case FILTER_EMA: return ema.Add(sample);
+        case FILTER_MEDIAN: return median.Add(sample);
+        default: return average.Add(sample);
+      }
+    }
+
+    void SetMode(FilterMode newMode) {
+      if (newMode == mode) return;
+      mode = newMode;
+      average.Reset();
+      ema.Reset();
+      median.Reset();
+    }
+    FilterMode Mode() const { return mode; }
+
+    void SetAlpha(float alpha) { ema.SetAlpha(alpha); }
+    float Alpha() const { return ema.Alpha(); }
+
+    static const char *ModeName(FilterMode mode) {
+      switch (mode) {
+        case FILTER_EMA: return "ema";
+        case FILTER_MEDIAN: return "median";
+        default: return "average";
+      }
+    }
+
+    // parses the names returned by ModeName(), returns false if unknown
+    static bool ParseMode(const char *name, FilterMode &out) {
+      for (int m = FILTER_AVERAGE; m <= FILTER_MEDIAN; m++) {
+        if (strcmp(name, ModeName((FilterMode)m)) == 0) {
+          out = (FilterMode)m;
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    FilterMode mode;
+    MovingAverage<AVERAGE_N> average;
+    ExponentialFilter ema;
+    MedianFilter<MEDIAN_N> median;
+};
+
+#endif
@@ -0,0 +1,163 @@
+// Host check for SampleFilter: every filter against a recompute from scratch over random samples, through resets and mode changes.
+//   g++ -O2 -std=gnu++17 -I lib/SampleFilter lib/SampleFilter/examples/Reference/Reference.cpp -o sample_filter && ./sample_filter
+
+#include <SampleFilter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static uint32_t rng = 12345;
+static uint32_t Random(uint32_t range) {
+  rng = rng * 1664525 + 1013904223;
+  return (rng >> 8) % range;
+}
+
+// a 12 bit ADC: noise around a level that drifts, some spikes, and stretches
+// of a narrow range so the median window holds many equal samples
+static uint16_t Sample(int i) {
+  int level = 2000 + (i / 500 % 8) * 150;
+  if (Random(100) == 0) return Random(4096);
+  if (i / 1000 % 3 == 1) return level + Random(3);
+  return level + Random(64) - 32;
+}
+
+// the filters recomputed from the samples since their last reset
+static float Average(const std::vector<uint16_t> &seen, size_t n) {
+  size_t count = std::min(seen.size(), n);
+  uint32_t sum = 0;
+  for (size_t i = seen.size() - count; i < seen.size(); i++) sum += seen[i];
+  return count ? (float)sum / count : 0;
+}
+
+static float Median(const std::vector<uint16_t> &seen, size_t n) {
+  size_t count = std::min(seen.size(), n);
+  if (!count) return 0;
+  std::vector<uint16_t> window(seen.end() - count, seen.end());
+  std::sort(window.begin(), window.end());
+  if (count & 1) return window[count / 2];
+  return (window[count / 2 - 1] + window[count / 2]) / 2.0f;
+}
+
+static float Ema(const std::vector<uint16_t> &seen, const std::vector<float> &alphas) {
+  float value = 0;
+  for (size_t i = 0; i < seen.size(); i++) value = i ? value + alphas[i] * (seen[i] - value) : seen[i];
+  return value;
+}
+
+// samples, with a Reset() of the filter every reset samples; returns the first mismatch or -1
+template <uint16_t N, typename Filter, typename Reference>
+static int Compare(Filter &filter, int samples, int reset, Reference reference) {
+  std::vector<uint16_t> seen;
+  for (int i = 0; i < samples; i++) {
+    if (i && i % reset == 0) {
+      filter.Reset();
+      seen.clear();
+    }
+    uint16_t sample = Sample(i);
+    seen.push_back(sample);
+    float got = filter.Add(sample);
+    if (got != reference(seen, N) || filter.Value() != got) {
+      printf("  sample %d: got %.3f expected %.3f\n", i, got, reference(seen, N));
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <uint16_t N>
+static bool CheckWindow() {
+  MovingAverage<N> average;
+  MedianFilter<N> median;
+  // resets at an odd count so the windows restart both full and part full
+  bool ok = Compare<N>(average, 20000, 1237, Average) < 0 && Compare<N>(median, 20000, 1237, Median) < 0;
+  printf("  window %3u: %s\n", N, ok ? "same as the recompute" : "differs");
+  return ok;
+}
+
+int main() {
+  bool windows = CheckWindow<1>() && CheckWindow<2>() && CheckWindow<3>() && CheckWindow<8>() && CheckWindow<9>() &&
+                 CheckWindow<50>() && CheckWindow<255>();
+  Expect(windows, "average and median of windows 1 to 255 over 20000 samples");
+
+  {
+    // the alpha changes mid-stream, as with "setFilter ema <alpha>" during a run
+    ExponentialFilter ema(0.04f);
+    std::vector<uint16_t> seen;
+    std::vector<float> alphas;
+    bool same = true;
+    for (int i = 0; i < 20000 && same; i++) {
+      if (i == 5000) ema.SetAlpha(0.5f);
+      if (i == 10000) ema.SetAlpha(0); // ignored, as is anything above 1
+      if (i == 12000) ema.SetAlpha(1);
+      if (i == 15000) {
+        ema.Reset();
+        seen.clear();
+        alphas.clear();
+      }
+      seen.push_back(Sample(i));
+      alphas.push_back(ema.Alpha());
+      same = ema.Add(seen.back()) == Ema(seen, alphas);
+    }
+    Expect(same && ema.Alpha() == 1, "EMA through alpha changes and a reset");
+  }
+
+  {
+    // the firmware's stage, switched between the modes mid-stream
+    SampleFilter<50, 9> filter(FILTER_AVERAGE, 0.04f);
+    const FilterMode modes[] = {FILTER_MEDIAN, FILTER_EMA, FILTER_AVERAGE, FILTER_EMA, FILTER_MEDIAN, FILTER_MEDIAN};
+    std::vector<uint16_t> seen;
+    std::vector<float> alphas;
+    bool same = true;
+    size_t next = 0;
+    for (int i = 0; i < 30000 && same; i++) {
+      if (i && i % 4321 == 0 && next < sizeof(modes) / sizeof(modes[0])) {
+        // the same mode again keeps its history
+        if (modes[next] != filter.Mode()) {
+          seen.clear();
+          alphas.clear();
+        }
+        filter.SetMode(modes[next++]);
+      }
+      seen.push_back(Sample(i));
+      alphas.push_back(filter.Alpha());
+      float got = filter.Add(seen.back());
+      float expected = filter.Mode() == FILTER_EMA ? Ema(seen, alphas)
+                       : filter.Mode() == FILTER_MEDIAN ? Median(seen, 9)
+                                                        : Average(seen, 50);
+      if (got != expected) {
+        printf("  sample %d in %s: got %.3f expected %.3f\n", i, filter.ModeName(filter.Mode()), got, expected);
+        same = false;
+      }
+    }
+    Expect(same, "SampleFilter restarts on a mode change, not on the same mode");
+  }
+
+  FilterMode mode;
+  Expect(SampleFilter<50, 9>::ParseMode("median", mode) && mode == FILTER_MEDIAN &&
+         !SampleFilter<50, 9>::ParseMode("mean", mode), "modes by name");
+
+  const int adds = 10000000;
+  MedianFilter<9> median;
+  MovingAverage<50> average;
+  float sum = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < adds; i++) sum += median.Add((uint16_t)(i * 2654435761u >> 20));
+  auto middle = std::chrono::steady_clock::now();
+  for (int i = 0; i < adds; i++) sum += average.Add((uint16_t)(i * 2654435761u >> 20));
+  auto end = std::chrono::steady_clock::now();
+  printf("  one Add(): median of 9 %.1f ns, average of 50 %.1f ns (checksum %.0f)\n",
+         std::chrono::duration<double, std::nano>(middle - begin).count() / adds,
+         std::chrono::duration<double, std::nano>(end - middle).count() / adds, sum);
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
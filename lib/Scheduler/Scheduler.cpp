@@ -0,0 +1,141 @@
+#include "Scheduler.h"
+
+#include <string.h>
+
+// ---------------- JitterHistogram ----------------
+// bins 0..3 hold 0..3 us exactly, above that every power of two is split into
+// four equal bins: [4,5) [5,6) [6,7) [7,8), [8,10) [10,12) ... up to 2^26 us
+uint8_t JitterHistogram::Bin(uint32_t us) {
+  if (us < 4) return us;
+  uint8_t exponent = 31 - __builtin_clz(us);
+  uint8_t bin = 4 * (exponent - 1) + ((us >> (exponent - 2)) & 3);
+  return bin < BINS ? bin : BINS - 1;
+}
+
+uint32_t JitterHistogram::BinLimit(uint8_t bin) {
+  if (bin < 4) return bin;
+  uint8_t exponent = bin / 4 + 1;
+  uint32_t base = 1UL << exponent;
+  return base + ((bin & 3) + 1) * (base / 4) - 1;
+}
+
+void JitterHistogram::Reset() {
+  memset(bins, 0, sizeof(bins));
+  count = 0;
+  min = UINT32_MAX;
+  max = 0;
+}
+
+void JitterHistogram::Add(uint32_t us) {
+  bins[Bin(us)]++;
+  count++;
+  if (us < min) min = us;
+  if (us > max) max = us;
+}
+
+uint32_t JitterHistogram::Percentile(float p) const {
+  if (!count) return 0;
+  uint32_t rank = (uint32_t)(count * p / 100.0f);
+  if (rank >= count) rank = count - 1;
+
+  uint32_t seen = 0;
+  for (uint8_t bin = 0; bin < BINS; bin++) {
+    seen += bins[bin];
+    if (seen > rank) {
+      uint32_t limit = bin == BINS - 1 ? max : BinLimit(bin); // the last bin is open ended
+      return limit < max ? limit : max;
+    }
+  }
+  return max;
+}
+
+// ---------------- Scheduler ----------------
+int Scheduler::Add(const char *name, ScheduledFunction function, uint32_t periodUs,
+                   OverrunPolicy policy, uint32_t deadlineUs) {
+  if (count == SCHEDULER_MAX_TASKS || periodUs == 0) return -1;
+
+  ScheduledTask &task = tasks[count];
+  task.name = name;
+  task.function = function;
+  task.period = periodUs;
+  task.deadline = deadlineUs ? deadlineUs : periodUs;
+  task.policy = policy;
+  task.enabled = true;
+  task.due = clock() + periodUs;
+  task.runs = task.skipped = task.deadlineMisses = task.maxRuntime = 0;
+  task.lateness.Reset();
+
+  return count++;
+}
+
+void Scheduler::Restart(int task) {
+  if (task >= 0 && task < count) tasks[task].due = clock();
+}
+
+void Scheduler::SetEnabled(int task, bool enabled) {
+  if (task < 0 || task >= count) return;
+  if (enabled && !tasks[task].enabled) tasks[task].due = clock() + tasks[task].period;
+  tasks[task].enabled = enabled;
+}
+
+void Scheduler::SetPeriod(int task, uint32_t periodUs) {
+  if (task < 0 || task >= count || periodUs == 0) return;
+  ScheduledTask &t = tasks[task];
+  if (t.deadline == t.period) t.deadline = periodUs;
+  t.period = periodUs;
+  t.due = clock() + periodUs;
+}
+
+void Scheduler::Run() {
+  for (uint8_t i = 0; i < count; i++) {
+    ScheduledTask &task = tasks[i];
+    if (!task.enabled) continue;
+
+    uint32_t start = clock();
+    int32_t late = (int32_t)(start - task.due);
+    if (late < -(int32_t)tolerance) continue;
+    if (late < 0) late = 0;
+
+    uint32_t release = task.due;
+    if (task.policy == OVERRUN_SKIP && (uint32_t)late >= task.period) {
+      // jump to the latest release on the grid, the lateness still counts from the first one
+      uint32_t missed = (uint32_t)late / task.period;
+      task.skipped += missed;
+      task.due += missed * task.period;
+    }
+
+    task.lateness.Add((uint32_t)late);
+    task.function();
+    task.due += task.period;
+    task.runs++;
+
+    uint32_t end = clock();
+    uint32_t runtime = end - start;
+    if (runtime > task.maxRuntime) task.maxRuntime = runtime;
+    if ((int32_t)(end - (release + task.deadline)) > 0) task.deadlineMisses++;
+  }
+}
+
+TaskReport Scheduler::Report(int task) const {
+  const ScheduledTask &t = tasks[task];
+  TaskReport report;
+  report.name = t.name;
+  report.period = t.period;
+  report.runs = t.runs;
+  report.skipped = t.skipped;
+  report.deadlineMisses = t.deadlineMisses;
+  report.maxRuntime = t.maxRuntime;
+  report.lateMin = t.lateness.Min();
+  report.lateP50 = t.lateness.Percentile(50);
+  report.lateP99 = t.lateness.Percentile(99);
+  report.lateMax = t.lateness.Max();
+  return report;
+}
+
+void Scheduler::ResetStats() {
+  for (uint8_t i = 0; i < count; i++) {
+    ScheduledTask &task = tasks[i];
+    task.runs = task.skipped = task.deadlineMisses = task.maxRuntime = 0;
+    task.lateness.Reset();
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <stdint.h>
+
+// Cooperative fixed-rate scheduler.
+// Tasks are released on a fixed grid (start + n * period), never relative to
+// when they last ran, so a late run does not push every later run back. Run()
+// is called from a loop or a periodic task and starts every task that is due.
+// All times are microseconds from the clock passed to the constructor, and
+// wrap-around safe.
+
+#define SCHEDULER_MAX_TASKS 8
+
+typedef void (*ScheduledFunction)();
+typedef uint32_t (*SchedulerClock)();
+
+// what happens when a task is more than a whole period late
+enum OverrunPolicy {
+  OVERRUN_CATCH_UP, // every missed release still runs, one per Run() call
+  OVERRUN_SKIP      // the missed releases are dropped, the grid is kept
+};
+
+// Lateness histogram with 4 bins per power of two (about 19% resolution), so
+// percentiles of anything from 1 us to minutes fit in a fixed 100 bins.
+class JitterHistogram
+{
+  public:
+    static const uint8_t BINS = 100;
+
+    JitterHistogram() { Reset(); }
+
+    void Reset();
+    void Add(uint32_t us);
+
+    uint32_t Count() const { return count; }
+    uint32_t Min() const { return count ? min : 0; }
+    uint32_t Max() const { return max; }
+    // upper bound of the bin holding the p-th percentile (0 < p <= 100)
+    uint32_t Percentile(float p) const;
+
+  private:
+    static uint8_t Bin(uint32_t us);
+    static uint32_t BinLimit(uint8_t bin);
+
+    uint32_t bins[BINS];
+    uint32_t count, min, max;
+};
+
+struct ScheduledTask {
+  const char *name;
+  ScheduledFunction function;
+  uint32_t period;          // us
+  uint32_t deadline;        // us after the release the run must have finished
+  OverrunPolicy policy;
+  bool enabled;
+  uint32_t due;             // next release
+
+  uint32_t runs;
+  uint32_t skipped;         // releases dropped by OVERRUN_SKIP
+  uint32_t deadlineMisses;  // runs that finished after release + deadline
+  uint32_t maxRuntime;      // us
+  JitterHistogram lateness; // release to start of the run
+};
+
+// The statistics of a task without the histogram, its percentiles taken, small
+// enough to copy to another task that prints them.
+struct TaskReport {
+  const char *name;
+  uint32_t period, runs, skipped, deadlineMisses, maxRuntime; // as in ScheduledTask
+  uint32_t lateMin, lateP50, lateP99, lateMax;                // us
+};
+
+class Scheduler
+{
+  public:
+    explicit Scheduler(SchedulerClock clock) : clock(clock), tolerance(0), count(0) {}
+
+    // When Run() itself is called on a fixed period, a release a few us after
+    // one call would otherwise wait a whole period for the next. Releases up to
+    // this much in the future are taken early (and counted as 0 us late).
+    void SetTolerance(uint32_t us) { tolerance = us; }
+
+    // returns the task id, or -1 if the table is full. A deadline of 0 means
+    // one period. The first release is one period after Add().
+    int Add(const char *name, ScheduledFunction function, uint32_t periodUs,
+            OverrunPolicy policy = OVERRUN_SKIP, uint32_t deadlineUs = 0);
+
+    // moves the grid so the task is released right now, e.g. at the start of a run
+    void Restart(int task);
+    void SetEnabled(int task, bool enabled);
+    // changes the period, the next release is one new period from now; a
+    // deadline that was one period stays one period
+    void SetPeriod(int task, uint32_t periodUs);
+
+    // starts every enabled task that is due, in the order they were added
+    void Run();
+
+    void ResetStats();
+    uint8_t Count() const { return count; }
+    const ScheduledTask &Task(int task) const { return tasks[task]; }
+    TaskReport Report(int task) const;
+
+  private:
+    SchedulerClock clock;
+    uint32_t tolerance;
+    ScheduledTask tasks[SCHEDULER_MAX_TASKS];
+    uint8_t count;
+};
+
+#endif
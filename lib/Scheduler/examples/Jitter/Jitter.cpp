@@ -0,0 +1,74 @@
+// Host check for Scheduler on a virtual clock: no drift through stalls, exact lateness percentiles.
+//   g++ -O2 -std=gnu++17 -I lib/Scheduler lib/Scheduler/Scheduler.cpp lib/Scheduler/examples/Jitter/Jitter.cpp -o scheduler_jitter && ./scheduler_jitter
+
+#include <Scheduler.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static uint32_t now = 4000000000u; // starts close to the wrap-around on purpose
+static uint32_t Clock() { return now; }
+
+static Scheduler scheduler(Clock);
+static std::vector<uint32_t> fastLateness;
+static uint32_t fastDue;
+
+static void Fast() {
+  fastLateness.push_back(now - fastDue);
+  fastDue += 10000;
+  now += 300; // takes 0.3 ms
+}
+
+static void Slow() { now += 2000; }
+
+static bool Check(const char *what, bool ok) {
+  printf("%-44s %s\n", what, ok ? "OK" : "FAIL");
+  return ok;
+}
+
+int main() {
+  int fast = scheduler.Add("fast", Fast, 10000, OVERRUN_CATCH_UP);
+  int slow = scheduler.Add("slow", Slow, 25000, OVERRUN_SKIP, 5000);
+  fastDue = now + 10000;
+
+  const uint32_t begin = now;
+  const uint32_t duration = 60000000; // one minute
+  srand(1);
+  while (now - begin < duration) {
+    scheduler.Run();
+    // mostly 1 ms passes, one in 50 an 8..80 ms stall
+    now += rand() % 50 ? 1000 : 8000 + rand() % 72000;
+  }
+
+  // run the backlog the catch-up task still has
+  while ((int32_t)(now - scheduler.Task(fast).due) >= 0) scheduler.Run();
+
+  const ScheduledTask &f = scheduler.Task(fast);
+  const ScheduledTask &s = scheduler.Task(slow);
+  uint32_t elapsed = now - begin;
+
+  std::vector<uint32_t> sorted(fastLateness);
+  std::sort(sorted.begin(), sorted.end());
+  uint32_t exactP50 = sorted[sorted.size() / 2], exactP99 = sorted[sorted.size() * 99 / 100];
+
+  printf("fast: %u runs, lateness min %u p50 %u p99 %u max %u us (exact p50 %u p99 %u)\n",
+         f.runs, f.lateness.Min(), f.lateness.Percentile(50), f.lateness.Percentile(99), f.lateness.Max(), exactP50, exactP99);
+  printf("slow: %u runs, %u skipped, %u deadline misses, lateness p99 %u max %u us\n",
+         s.runs, s.skipped, s.deadlineMisses, s.lateness.Percentile(99), s.lateness.Max());
+
+  bool ok = true;
+  ok &= Check("catch-up task ran once per period", f.runs == elapsed / 10000);
+  ok &= Check("skip task stayed on its grid", (s.due - begin) % 25000 == 0);
+  ok &= Check("skip task accounted once per period", s.runs + s.skipped == (s.due - begin) / 25000 - 1);
+  ok &= Check("skip task skipped during stalls", s.skipped > 0);
+  ok &= Check("deadline misses counted", s.deadlineMisses > 0 && s.deadlineMisses <= s.runs);
+  ok &= Check("histogram max is exact", f.lateness.Max() == sorted.back());
+  ok &= Check("p50 within one bin of exact", f.lateness.Percentile(50) >= exactP50 && f.lateness.Percentile(50) <= exactP50 * 1.25 + 3);
+  ok &= Check("p99 within one bin of exact", f.lateness.Percentile(99) >= exactP99 && f.lateness.Percentile(99) <= exactP99 * 1.25 + 3);
+  TaskReport report = scheduler.Report(slow);
+  ok &= Check("report copies the statistics", report.runs == s.runs && report.skipped == s.skipped &&
+                                              report.lateP99 == s.lateness.Percentile(99) && report.lateMax == s.lateness.Max());
+  return ok ? 0 : 1;
+}
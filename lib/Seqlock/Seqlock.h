@@ -0,0 +1,78 @@
+#ifndef Seqlock_h
+#define Seqlock_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Single-writer snapshot of a small struct, readable from any task or thread.
+//
+// This is a "latched" seqlock: the value is kept twice and the sequence number
+// tells readers which copy is stable. Publishing first rewrites copy 0 while
+// readers are sent to copy 1, then rewrites copy 1 while readers use copy 0.
+// So the writer never waits for anybody, and a reader always has a stable copy
+// available. It is never stuck behind a writer that was preempted mid-update,
+// which a plain seqlock cannot promise. A reader only copies again when a
+// publish happened while it was copying.
+//
+// The payload is moved as relaxed atomic words, so concurrent access is not a
+// data race even though copies may be torn; the sequence check throws those away.
+template <typename T>
+class Seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+    static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  public:
+    Seqlock() { Write(T()); }
+
+    // writer side, only one task may call this
+    void Write(const T &value) {
+      uint32_t seq = sequence.load(std::memory_order_relaxed);
+      sequence.store(seq + 1, std::memory_order_relaxed); // odd: readers use copy 1
+      std::atomic_thread_fence(std::memory_order_release);
+      Store(0, value);
+      sequence.store(seq + 2, std::memory_order_release); // even: readers use copy 0
+      std::atomic_thread_fence(std::memory_order_release);
+      Store(1, value);
+    }
+
+    // reader side, any number of readers, returns the version that was read
+    uint32_t Read(T &value) const {
+      for (;;) {
+        uint32_t seq = sequence.load(std::memory_order_acquire);
+        Load(seq & 1, value);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == seq) return seq / 2;
+      }
+    }
+
+    T Read() const {
+      T value;
+      Read(value);
+      return value;
+    }
+
+    // number of completed Write() calls
+    uint32_t Version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+  private:
+    void Store(int copy, const T &value) {
+      uint32_t words[WORDS] = {};
+      memcpy(words, &value, sizeof(T));
+      for (size_t i = 0; i < WORDS; i++) slots[copy][i].store(words[i], std::memory_order_relaxed);
+    }
+
+    void Load(int copy, T &value) const {
+      uint32_t words[WORDS];
+      for (size_t i = 0; i < WORDS; i++) words[i] = slots[copy][i].load(std::memory_order_relaxed);
+      memcpy(&value, words, sizeof(T));
+    }
+
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> slots[2][WORDS];
+};
+
+#endif
@@ -0,0 +1,94 @@
+// Host torture test for Seqlock: readers racing a writer never see a torn or stale snapshot.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/Seqlock lib/Seqlock/examples/Torture/Torture.cpp -o seqlock_torture && ./seqlock_torture [writes] [readers]
+
+#include <Seqlock.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// about the size of the reflow state, with fields of mixed width
+struct Snapshot {
+  uint32_t counter;
+  double asDouble;
+  float asFloat;
+  uint8_t low;
+  bool odd;
+  uint64_t squared;
+  uint32_t pad[16];
+  uint32_t check; // ~counter, written last
+};
+
+static Snapshot Make(uint32_t n) {
+  Snapshot s;
+  s.counter = n;
+  s.asDouble = n * 0.5;
+  s.asFloat = (float)(n & 0xffff);
+  s.low = (uint8_t)n;
+  s.odd = n & 1;
+  s.squared = (uint64_t)n * n;
+  for (uint32_t i = 0; i < 16; i++) s.pad[i] = n ^ i;
+  s.check = ~n;
+  return s;
+}
+
+static bool Consistent(const Snapshot &s) {
+  uint32_t n = s.counter;
+  if (s.asDouble != n * 0.5 || s.asFloat != (float)(n & 0xffff) || s.low != (uint8_t)n) return false;
+  if (s.odd != (bool)(n & 1) || s.squared != (uint64_t)n * n || s.check != ~n) return false;
+  for (uint32_t i = 0; i < 16; i++) {
+    if (s.pad[i] != (n ^ i)) return false;
+  }
+  return true;
+}
+
+static Seqlock<Snapshot> state;
+
+int main(int argc, char **argv) {
+  const uint32_t writes = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 2000000;
+  const int readers = argc > 2 ? atoi(argv[2]) : 3;
+
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> reads{0}, errors{0};
+
+  state.Write(Make(0));
+  auto begin = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&]() {
+      uint32_t lastVersion = 0, lastCounter = 0;
+      uint64_t count = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        Snapshot s;
+        uint32_t version = state.Read(s);
+        count++;
+        // the constructor publishes version 1 and Make(0) version 2, so Make(n) is n + 2
+        bool ok = Consistent(s) && s.counter + 2 == version && version >= lastVersion && s.counter >= lastCounter;
+        if (!ok && errors.fetch_add(1) < 10) {
+          printf("torn or stale read: version %u counter %u check %08x\n", version, s.counter, s.check);
+        }
+        lastVersion = version;
+        lastCounter = s.counter;
+      }
+      reads += count;
+    });
+  }
+
+  for (uint32_t n = 1; n <= writes; n++) {
+    state.Write(Make(n));
+    if ((n & 1023) == 0) std::this_thread::yield(); // give readers a chance on small hosts
+  }
+  done = true;
+  for (std::thread &t : threads) t.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  uint64_t errorCount = errors.load();
+  printf("%u writes and %llu reads by %d readers in %.3f s, final version %u\n",
+         writes, (unsigned long long)reads.load(), readers, seconds, state.Version());
+  printf("%s: %llu errors\n", errorCount ? "FAIL" : "OK", (unsigned long long)errorCount);
+  return errorCount ? 1 : 0;
+}
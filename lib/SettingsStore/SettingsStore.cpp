@@ -0,0 +1,99 @@
+#include "SettingsStore.h"
+
+#define SETTINGS_KEY "settings"
+
+SettingsStore::SettingsStore(const char *space, uint16_t version, void *data, size_t size)
+    : space(space), data((uint8_t *)data), size(size > SETTINGS_MAX_SIZE ? 0 : size), valid(false), dirty(false),
+      firstChange(0), lastChange(0), writes(0), skipped(0), lastMicros(0), maxMicros(0) {
+  header.version = version;
+  header.size = this->size;
+  header.sequence = 0;
+}
+
+uint32_t SettingsStore::Crc32(const void *data, size_t length) {
+  // bitwise, the settings are read once at boot and written rarely
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+bool SettingsStore::Read(uint16_t version, uint8_t *into, size_t length, uint32_t &sequence) {
+  uint8_t blob[sizeof(SettingsHeader) + SETTINGS_MAX_SIZE + sizeof(uint32_t)];
+  size_t total = sizeof(SettingsHeader) + length + sizeof(uint32_t);
+  if (length > SETTINGS_MAX_SIZE) return false;
+  if (prefs.getBytesLength(SETTINGS_KEY) != total || prefs.getBytes(SETTINGS_KEY, blob, total) != total) return false;
+
+  SettingsHeader found;
+  uint32_t crc;
+  memcpy(&found, blob, sizeof(found));
+  memcpy(&crc, blob + total - sizeof(crc), sizeof(crc));
+  if (found.version != version || found.size != length || crc != Crc32(blob, total - sizeof(crc))) return false;
+
+  sequence = found.sequence;
+  memcpy(into, blob + sizeof(SettingsHeader), length);
+  return true;
+}
+
+bool SettingsStore::Begin() {
+  if (!size || !prefs.begin(space)) return false;
+  if (!Read(header.version, stored, size, header.sequence)) return false;
+  memcpy(data, stored, size);
+  valid = true;
+  return true;
+}
+
+bool SettingsStore::ReadVersion(uint16_t version, void *older, size_t olderSize) {
+  if (!size || version == header.version) return false;
+  return Read(version, (uint8_t *)older, olderSize, header.sequence);
+}
+
+void SettingsStore::Changed(uint32_t now) {
+  if (!dirty) firstChange = now;
+  lastChange = now;
+  dirty = true;
+}
+
+bool SettingsStore::Poll(uint32_t now) {
+  if (!dirty) return false;
+  if (now - lastChange < SETTINGS_COMMIT_DELAY_MS && now - firstChange < SETTINGS_COMMIT_MAX_DELAY_MS) return false;
+  uint32_t before = writes;
+  if (!Commit()) firstChange = lastChange = now; // try again after the delay
+  return writes != before;
+}
+
+bool SettingsStore::Commit() {
+  dirty = false;
+  if (!size) return false;
+  if (valid && memcmp(stored, data, size) == 0) {
+    skipped++;
+    return true;
+  }
+
+  uint8_t blob[sizeof(SettingsHeader) + SETTINGS_MAX_SIZE + sizeof(uint32_t)];
+  size_t length = sizeof(SettingsHeader) + size + sizeof(uint32_t);
+  SettingsHeader next = header;
+  next.sequence++;
+  memcpy(blob, &next, sizeof(next));
+  memcpy(blob + sizeof(next), data, size);
+  uint32_t crc = Crc32(blob, length - sizeof(crc));
+  memcpy(blob + length - sizeof(crc), &crc, sizeof(crc));
+
+  uint32_t start = micros();
+  bool ok = prefs.putBytes(SETTINGS_KEY, blob, length) == length;
+  lastMicros = micros() - start;
+  if (lastMicros > maxMicros) maxMicros = lastMicros;
+  if (!ok) {
+    dirty = true;
+    return false;
+  }
+
+  header = next;
+  memcpy(stored, data, size);
+  valid = true;
+  writes++;
+  return true;
+}
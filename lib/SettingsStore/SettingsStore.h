@@ -0,0 +1,82 @@
+#ifndef SettingsStore_h
+#define SettingsStore_h
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// The firmware settings as one versioned blob in NVS instead of values at
+// fixed EEPROM addresses. The blob is
+//
+//   SettingsHeader   version and size of the settings struct, write counter
+//   settings         the struct itself, as it is in RAM
+//   CRC-32           of everything before it
+//
+// so a struct of another version or size, or a damaged blob, is never read
+// into the settings. NVS spreads its writes over the whole partition and
+// writes a new entry before it drops the old one, a write cut short by a
+// power loss leaves the previous settings.
+//
+// Changed() only marks the settings dirty, Poll() writes them once they have
+// been left alone for SETTINGS_COMMIT_DELAY_MS (at most SETTINGS_COMMIT_MAX_DELAY_MS
+// after the first change), so a burst of changes costs one write. A commit of
+// settings that equal the stored ones is skipped.
+
+#define SETTINGS_MAX_SIZE 512
+#define SETTINGS_COMMIT_DELAY_MS 2000
+#define SETTINGS_COMMIT_MAX_DELAY_MS 10000
+
+struct SettingsHeader {
+  uint16_t version;
+  uint16_t size;
+  uint32_t sequence; // writes of this blob since it was created
+};
+
+class SettingsStore
+{
+  public:
+    // data is the settings struct, at most SETTINGS_MAX_SIZE bytes
+    SettingsStore(const char *space, uint16_t version, void *data, size_t size);
+
+    // Reads the stored settings into data. false, with data untouched, when
+    // there are none or they are of another version or size or damaged.
+    bool Begin();
+    // After a false Begin(): reads settings stored by an older version of the
+    // firmware into older, a struct of that version's size, to convert them.
+    // The next Commit() then replaces them and carries on their write counter.
+    bool ReadVersion(uint16_t version, void *older, size_t olderSize);
+
+    // data was changed, it is written by a later Poll()
+    void Changed(uint32_t now);
+    // call periodically, writes the settings when they are due; true if it did
+    bool Poll(uint32_t now);
+    // writes the settings now unless they equal the stored ones
+    bool Commit();
+    bool Dirty() const { return dirty; }
+
+    uint32_t Writes() const { return writes; }
+    uint32_t Skipped() const { return skipped; }
+    uint32_t Sequence() const { return header.sequence; }
+    // duration of the last and of the longest NVS write in microseconds
+    uint32_t LastMicros() const { return lastMicros; }
+    uint32_t MaxMicros() const { return maxMicros; }
+
+    static uint32_t Crc32(const void *data, size_t length);
+
+  private:
+    bool Read(uint16_t version, uint8_t *into, size_t length, uint32_t &sequence);
+
+    Preferences prefs;
+    const char *space;
+    uint8_t *data;
+    size_t size;
+
+    // the blob as it is stored, compared against on every commit
+    SettingsHeader header;
+    uint8_t stored[SETTINGS_MAX_SIZE];
+    bool valid, dirty;
+
+    uint32_t firstChange, lastChange;
+    uint32_t writes, skipped, lastMicros, maxMicros;
+};
+
+#endif
@@ -0,0 +1,109 @@
+// Host check for SettingsStore on the HostSim Preferences: coalesced writes, restarts and versions.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/HostSim -I lib/SettingsStore lib/HostSim/*.cpp lib/SettingsStore/SettingsStore.cpp lib/SettingsStore/examples/Coalesce/Coalesce.cpp -o settings_store && ./settings_store
+
+#include <SettingsStore.h>
+
+#include <chrono>
+#include <stdio.h>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+struct Settings {
+  double reflowTemp;
+  uint32_t reflowTime;
+  double kp, ki, kd;
+  char profileName[48];
+};
+
+// field by field, a copy of the struct need not copy its padding
+static bool Same(const Settings &a, const Settings &b) {
+  return a.reflowTemp == b.reflowTemp && a.reflowTime == b.reflowTime && a.kp == b.kp && a.ki == b.ki &&
+         a.kd == b.kd && strcmp(a.profileName, b.profileName) == 0;
+}
+
+static const Settings defaults = {230, 120000, 0.05, 0, 0.005, "Custom Profile"};
+
+static const int commits = 10000;
+
+int main() {
+  Settings settings = defaults;
+  {
+    SettingsStore store("check", 1, &settings, sizeof(settings));
+    Expect(!store.Begin() && settings.kp == 0.05, "nothing stored yet, the defaults stay");
+
+    // a slider dragged for a second, one change every 50 ms
+    uint32_t now = 1000;
+    int early = 0;
+    for (int i = 0; i < 20; i++, now += 50) {
+      settings.reflowTemp = 230 + i;
+      store.Changed(now);
+      early += store.Poll(now);
+    }
+    for (; now < 1000 + 1000 + SETTINGS_COMMIT_DELAY_MS - 50; now += 10) early += store.Poll(now);
+    Expect(early == 0 && store.Dirty(), "no write while changes keep coming");
+    now += 100;
+    Expect(store.Poll(now) && store.Writes() == 1 && !store.Dirty(), "one write once they settle");
+
+    // a change every second that never settles
+    uint32_t from = now;
+    for (; now - from < 3 * SETTINGS_COMMIT_MAX_DELAY_MS; now += 10) {
+      if ((now - from) % 1000 == 0) {
+        settings.reflowTime++;
+        store.Changed(now);
+      }
+      store.Poll(now);
+    }
+    // written 10 s after the first change, then 10 s after the first one after that
+    Expect(store.Writes() == 1 + 2 && store.Dirty(), "endless changes are written every max delay");
+    store.Commit();
+
+    store.Changed(now);
+    Expect(!store.Poll(now + SETTINGS_COMMIT_DELAY_MS) && store.Skipped() == 1, "unchanged settings are not written");
+
+    settings.kp = 0.07;
+    snprintf(settings.profileName, sizeof(settings.profileName), "leaded.json");
+    unsigned long before = Preferences::Writes();
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < commits; i++) {
+      settings.reflowTime = i;
+      store.Commit();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / commits;
+    printf("  one Commit(): %.2f us on the host\n", us);
+    Expect(Preferences::Writes() - before == commits, "Commit() writes right away");
+  }
+
+  Settings restored = defaults;
+  SettingsStore store("check", 1, &restored, sizeof(restored));
+  Expect(store.Begin() && Same(restored, settings) && store.Sequence() == 4 + commits,
+         "read back after a restart");
+
+  Settings other = defaults;
+  SettingsStore newer("check", 2, &other, sizeof(other));
+  Expect(!newer.Begin() && Same(other, defaults), "another version leaves the defaults");
+  Settings older = defaults;
+  Expect(newer.ReadVersion(1, &older, sizeof(older)) && Same(older, settings),
+         "the newer version reads the older settings");
+  other.kp = older.kp;
+  Expect(newer.Commit() && newer.Sequence() == 4 + commits + 1 && !newer.ReadVersion(1, &older, sizeof(older)),
+         "and replaces them, keeping the write counter");
+
+  // one flipped byte, as no NVS write would leave it
+  Preferences prefs;
+  prefs.begin("check");
+  uint8_t blob[512];
+  size_t length = prefs.getBytes("settings", blob, sizeof(blob));
+  blob[sizeof(SettingsHeader) + 3] ^= 0x5A;
+  prefs.putBytes("settings", blob, length);
+  Settings damaged = defaults;
+  SettingsStore broken("check", 2, &damaged, sizeof(damaged));
+  Expect(!broken.Begin() && Same(damaged, defaults), "a damaged blob leaves the defaults");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
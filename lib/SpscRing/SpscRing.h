@@ -0,0 +1,45 @@
+#ifndef SpscRing_h
+#define SpscRing_h
+
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// One side may only call Push() and the other only Pop(); then neither side
+// ever blocks or disables interrupts. The indices run freely and are masked on
+// access, so all N slots are usable. N must be a power of two.
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+  public:
+    // producer side, returns false (and stores nothing) when the ring is full
+    bool Push(const T &item) {
+      uint32_t h = head.load(std::memory_order_relaxed);
+      if (h - tail.load(std::memory_order_acquire) == N) return false;
+      buffer[h & (N - 1)] = item;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    // consumer side, returns false when the ring is empty
+    bool Pop(T &item) {
+      uint32_t t = tail.load(std::memory_order_relaxed);
+      if (head.load(std::memory_order_acquire) == t) return false;
+      item = buffer[t & (N - 1)];
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    // a snapshot only, the other side may change it right after
+    uint32_t Size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    static constexpr uint32_t Capacity() { return N; }
+
+  private:
+    T buffer[N];
+    std::atomic<uint32_t> head{0}; // next slot to write, owned by the producer
+    std::atomic<uint32_t> tail{0}; // next slot to read, owned by the consumer
+};
+
+#endif
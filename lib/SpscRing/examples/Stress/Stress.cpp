@@ -0,0 +1,62 @@
+// Host stress test for SpscRing: nothing lost, duplicated or torn between two threads.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/SpscRing lib/SpscRing/examples/Stress/Stress.cpp -o spsc_stress && ./spsc_stress [items]
+
+#include <SpscRing.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+struct Item {
+  uint32_t sequence;
+  uint32_t check; // ~sequence, detects torn reads
+  uint16_t payload[4];
+};
+
+static SpscRing<Item, 128> ring;
+
+int main(int argc, char **argv) {
+  const uint32_t items = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1000000;
+  uint64_t fullSpins = 0;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  std::thread producer([&]() {
+    for (uint32_t i = 0; i < items; i++) {
+      Item item = {i, ~i, {(uint16_t)i, (uint16_t)(i >> 16), 0, 0}};
+      while (!ring.Push(item)) {
+        fullSpins++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0, errors = 0, batches = 0, maxBatch = 0;
+  while (expected < items) {
+    uint32_t batch = 0;
+    Item item;
+    while (ring.Pop(item)) {
+      if (item.sequence != expected || item.check != ~expected || item.payload[0] != (uint16_t)expected) {
+        if (errors++ < 10) printf("mismatch: got %u expected %u\n", item.sequence, expected);
+        expected = item.sequence;
+      }
+      expected++;
+      batch++;
+    }
+    if (!batch) {
+      std::this_thread::yield(); // let the producer run, on a single core it could not otherwise
+      continue;
+    }
+    batches++;
+    if (batch > maxBatch) maxBatch = batch;
+  }
+
+  producer.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  printf("%u items in %.3f s (%.1f M items/s), %u batches, largest batch %u, producer waited %llu times\n",
+         items, seconds, items / seconds / 1e6, batches, maxBatch, (unsigned long long)fullSpins);
+  printf("%s: %u errors\n", errors ? "FAIL" : "OK", errors);
+  return errors ? 1 : 0;
+}
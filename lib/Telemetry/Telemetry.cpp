@@ -0,0 +1,107 @@
+#include "Telemetry.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// FNV-1a, only compared against the previous frame so collisions merely skip one update
+static uint32_t Hash(const char *text) {
+  uint32_t hash = 2166136261u;
+  while (*text) hash = (hash ^ (uint8_t)*text++) * 16777619u;
+  return hash;
+}
+
+size_t JsonEscape(char *out, size_t size, const char *text) {
+  if (!size) return 0;
+  size_t n = 0;
+  // stops while an escaped character still fits whole
+  for (const char *c = text; *c && n + 2 < size; c++) {
+    if ((uint8_t)*c < 0x20) continue;
+    if (*c == '"' || *c == '\\') out[n++] = '\\';
+    out[n++] = *c;
+  }
+  out[n] = 0;
+  return n;
+}
+
+// fields leave room for the closing "}\n\n"
+static const size_t CLOSING = 3;
+
+void TelemetryEncoder::Invalidate() {
+  memset(hashes, 0, sizeof(hashes));
+  full = true;
+}
+
+void TelemetryEncoder::Begin(bool full) {
+  this->full = full || this->full;
+  length = 0;
+  field = written = 0;
+  buffer[0] = 0;
+  Append("data: {", CLOSING);
+}
+
+void TelemetryEncoder::Append(const char *text, size_t reserve) {
+  size_t n = strlen(text);
+  if (length + n + reserve + 1 > sizeof(buffer)) {
+    overflow = true;
+    return;
+  }
+  memcpy(buffer + length, text, n + 1);
+  length += n;
+}
+
+void TelemetryEncoder::Field(const char *name, const char *text, bool quoted) {
+  uint8_t index = field++;
+  if (index >= TELEMETRY_MAX_FIELDS) return;
+
+  uint32_t hash = Hash(text);
+  if (!full && hash == hashes[index]) return;
+
+  size_t before = length;
+  overflow = false;
+  if (written) Append(",", CLOSING);
+  Append("\"", CLOSING);
+  Append(name, CLOSING);
+  Append(quoted ? "\":\"" : "\":", CLOSING);
+  Append(text, CLOSING);
+  if (quoted) Append("\"", CLOSING);
+
+  if (overflow) {
+    // the field did not fit: leave it for the next frame
+    length = before;
+    buffer[length] = 0;
+    return;
+  }
+  hashes[index] = hash;
+  written++;
+}
+
+void TelemetryEncoder::Add(const char *name, float value, uint8_t decimals) {
+  char text[24];
+  if (isfinite(value)) snprintf(text, sizeof(text), "%.*f", decimals, value);
+  else strcpy(text, "null"); // JSON has no NaN
+  Field(name, text, false);
+}
+
+void TelemetryEncoder::Add(const char *name, long value) {
+  char text[16];
+  snprintf(text, sizeof(text), "%ld", value);
+  Field(name, text, false);
+}
+
+void TelemetryEncoder::Add(const char *name, bool value) {
+  Field(name, value ? "true" : "false", false);
+}
+
+void TelemetryEncoder::Add(const char *name, const char *value) {
+  char text[64];
+  JsonEscape(text, sizeof(text), value);
+  Field(name, text, true);
+}
+
+size_t TelemetryEncoder::End() {
+  full = false;
+  if (!written) return 0;
+  Append("}\n\n", 0);
+  return length;
+}
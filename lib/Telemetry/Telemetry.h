@@ -0,0 +1,134 @@
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Server-sent events telemetry.
+//
+// TelemetryEncoder writes one event ("data: {...}\n\n") into a fixed buffer.
+// Every field is formatted to text first and only written when that text
+// differs from what the previous frame carried, so a value that did not change
+// at the precision it is shown with costs nothing on the wire. A full frame
+// carries every field, for clients that just subscribed. Fields are identified
+// by the order they are added in, so every frame must add the same fields in
+// the same order.
+//
+// EventStream keeps the subscribed clients and writes an encoded event to all
+// of them, so an event is encoded once per tick however many browsers listen.
+
+#define TELEMETRY_MAX_FIELDS 32
+#define TELEMETRY_BUFFER_SIZE 1024
+
+// copies text into out as the inside of a JSON string: quotes and backslashes
+// are escaped, control characters dropped, and the result is cut to fit size
+// (including the terminating 0). Returns the length written.
+size_t JsonEscape(char *out, size_t size, const char *text);
+
+class TelemetryEncoder
+{
+  public:
+    TelemetryEncoder() { Invalidate(); }
+
+    // starts a frame, a full frame writes every field
+    void Begin(bool full);
+
+    void Add(const char *name, float value, uint8_t decimals);
+    void Add(const char *name, long value);
+    void Add(const char *name, bool value);
+    void Add(const char *name, const char *value);
+
+    // finishes the frame, returns its length or 0 when no field changed
+    size_t End();
+    const char *Data() const { return buffer; }
+
+    // the next frame writes every field, e.g. after nobody listened for a while
+    void Invalidate();
+
+  private:
+    void Field(const char *name, const char *text, bool quoted);
+    void Append(const char *text, size_t reserve);
+
+    char buffer[TELEMETRY_BUFFER_SIZE];
+    size_t length;
+    uint8_t field, written;
+    bool full, overflow;
+    uint32_t hashes[TELEMETRY_MAX_FIELDS]; // of the text each field was last sent with
+};
+
+// Client is the server's connection type (HttpStream in the firmware): it must
+// be copyable, and have connected(), write(const uint8_t *, size_t) and stop().
+template <typename Client, int MaxClients>
+class EventStream
+{
+  public:
+    EventStream() : count(0), dropped(0) {}
+
+    // takes over the connection of a request for the stream and answers it,
+    // returns false when every slot is taken
+    bool Subscribe(Client client) {
+      Prune();
+      if (count == MaxClients) return false;
+
+      static const char header[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "retry: 2000\n\n"; // browsers reconnect after 2 s when the stream drops
+      if (client.write((const uint8_t *)header, sizeof(header) - 1) != sizeof(header) - 1) {
+        client.stop();
+        return false;
+      }
+      clients[count] = client;
+      fresh[count] = true;
+      count++;
+      return true;
+    }
+
+    // writes the event to the clients that already had a full frame, or when
+    // full to the ones that did not (which then become established)
+    void Send(const char *data, size_t length, bool full) {
+      for (int i = 0; i < count; i++) {
+        if (fresh[i] != full) continue;
+        if (clients[i].write((const uint8_t *)data, length) != length) {
+          clients[i].stop(); // a client that cannot keep up is dropped, it reconnects
+        }
+        fresh[i] = false;
+      }
+      Prune();
+    }
+
+    // a comment line, keeps proxies from closing the stream and finds dead clients
+    void Heartbeat() { Send(": \n\n", 4, false); }
+
+    // drops clients that disconnected
+    void Prune() {
+      for (int i = 0; i < count;) {
+        if (clients[i].connected()) {
+          i++;
+          continue;
+        }
+        clients[i].stop();
+        count--;
+        clients[i] = clients[count];
+        fresh[i] = fresh[count];
+        clients[count] = Client();
+        dropped++;
+      }
+    }
+
+    int Count() const { return count; }
+    bool HasFresh() const { for (int i = 0; i < count; i++) if (fresh[i]) return true; return false; }
+    bool HasEstablished() const { for (int i = 0; i < count; i++) if (!fresh[i]) return true; return false; }
+    uint32_t Dropped() const { return dropped; }
+
+  private:
+    Client clients[MaxClients];
+    bool fresh[MaxClients]; // subscribed, no full frame sent yet
+    int count;
+    uint32_t dropped;
+};
+
+#endif
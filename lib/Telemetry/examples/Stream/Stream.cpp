@@ -0,0 +1,110 @@
+// Host check for TelemetryEncoder and EventStream: delta and full frames, fanned out to clients.
+//   g++ -O2 -std=gnu++17 -I lib/Telemetry lib/Telemetry/Telemetry.cpp lib/Telemetry/examples/Stream/Stream.cpp -o telemetry_stream && ./telemetry_stream
+
+#include <Telemetry.h>
+
+#include <memory>
+#include <stdio.h>
+#include <string>
+
+// a connection as the server sees it, copies share it like WiFiClient
+struct FakeClient {
+  struct State {
+    bool open = true;
+    size_t capacity = 1 << 20; // bytes it takes before it stalls
+    std::string received;
+  };
+  std::shared_ptr<State> state;
+
+  static FakeClient Open() { FakeClient client; client.state = std::make_shared<State>(); return client; }
+  bool connected() const { return state && state->open; }
+  size_t write(const uint8_t *data, size_t length) {
+    if (!connected()) return 0;
+    size_t n = length < state->capacity ? length : state->capacity;
+    state->received.append((const char *)data, n);
+    state->capacity -= n;
+    return n;
+  }
+  void stop() { if (state) state->open = false; }
+};
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+struct State {
+  float temperature;
+  bool running;
+  long elapsed;
+  const char *profile;
+};
+
+static TelemetryEncoder encoder;
+
+static std::string Encode(const State &state, bool full) {
+  encoder.Begin(full);
+  encoder.Add("temperature", state.temperature, 1);
+  encoder.Add("running", state.running);
+  encoder.Add("elapsed", state.elapsed);
+  encoder.Add("profile", state.profile);
+  size_t length = encoder.End();
+  return std::string(encoder.Data(), length);
+}
+
+static int Count(const std::string &text, const char *what) {
+  int n = 0;
+  for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) n++;
+  return n;
+}
+
+int main() {
+  State state = {25.0f, false, 0, "default \"lead free\""};
+
+  std::string first = Encode(state, false);
+  Expect(first == "data: {\"temperature\":25.0,\"running\":false,\"elapsed\":0,\"profile\":\"default \\\"lead free\\\"\"}\n\n",
+         "first frame carries every field, strings escaped");
+  Expect(Encode(state, false).empty(), "unchanged state encodes nothing");
+
+  state.temperature = 25.04f; // the same at one decimal
+  state.elapsed = 1;
+  Expect(Encode(state, false) == "data: {\"elapsed\":1}\n\n", "delta carries only the changed text");
+  Expect(Count(Encode(state, true), "\":") == 4, "full frame carries every field");
+
+  encoder.Invalidate();
+  Expect(Count(Encode(state, false), "\":") == 4, "invalidated encoder sends every field");
+
+  // fan-out
+  EventStream<FakeClient, 2> stream;
+  FakeClient a = FakeClient::Open(), b = FakeClient::Open(), c = FakeClient::Open();
+  Expect(stream.Subscribe(a) && stream.Subscribe(b), "two subscribers fit");
+  Expect(!stream.Subscribe(c), "a third is refused");
+  Expect(a.state->received.find("text/event-stream") != std::string::npos, "subscriber got the stream header");
+
+  std::string full = Encode(state, true);
+  Expect(stream.HasFresh() && !stream.HasEstablished(), "new subscribers wait for a full frame");
+  stream.Send(full.data(), full.size(), true);
+  Expect(!stream.HasFresh() && stream.HasEstablished(), "after the full frame they are established");
+
+  state.running = true;
+  std::string delta = Encode(state, false);
+  stream.Send(delta.data(), delta.size(), false);
+  Expect(Count(a.state->received, "data: ") == 2 && Count(b.state->received, "data: ") == 2, "both got the full frame and the delta");
+
+  b.state->open = false; // the browser went away
+  stream.Heartbeat();
+  Expect(stream.Count() == 1 && stream.Dropped() == 1, "a closed client is dropped");
+
+  FakeClient slow = FakeClient::Open();
+  Expect(stream.Subscribe(slow), "a freed slot takes a new subscriber");
+  full = Encode(state, true);
+  slow.state->capacity = full.size() / 2; // takes half an event
+  stream.Send(full.data(), full.size(), true);
+  Expect(stream.Count() == 1 && !slow.connected(), "a client that stalls mid-event is dropped");
+  Expect(Count(a.state->received, "data: ") == 2, "an established client does not get full frames");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+#include "ThermalFit.h"
+
+#include <math.h>
+
+#include <cmath>
+
+#define FIT_MIN_SAMPLES 10
+#define FOPDT_MAX_DEAD_TIME 120.0f // s
+#define TWO_NODE_MAX_STEP 0.05f    // s, Euler like SimOven, within half the fastest time constant
+
+void ThermalLog::Add(float t, float temperature, float duty) {
+  time.push_back(t);
+  this->temperature.push_back(temperature);
+  this->duty.push_back(duty);
+}
+
+// solves a x = b in place for a few unknowns, false when singular
+static bool Solve(std::vector<double> &a, std::vector<double> &b, size_t n) {
+  for (size_t column = 0; column < n; column++) {
+    size_t pivot = column;
+    for (size_t row = column + 1; row < n; row++) {
+      if (fabs(a[row * n + column]) > fabs(a[pivot * n + column])) pivot = row;
+    }
+    if (fabs(a[pivot * n + column]) < 1e-300) return false;
+    for (size_t k = 0; k < n; k++) std::swap(a[column * n + k], a[pivot * n + k]);
+    std::swap(b[column], b[pivot]);
+    for (size_t row = column + 1; row < n; row++) {
+      double factor = a[row * n + column] / a[column * n + column];
+      for (size_t k = column; k < n; k++) a[row * n + k] -= factor * a[column * n + k];
+      b[row] -= factor * b[column];
+    }
+  }
+  for (size_t row = n; row-- > 0;) {
+    for (size_t k = row + 1; k < n; k++) b[row] -= a[row * n + k] * b[k];
+    b[row] /= a[row * n + row];
+  }
+  return true;
+}
+
+static double SquaredSum(const std::vector<double> &r) {
+  double sum = 0;
+  for (double value : r) sum += value * value;
+  return sum;
+}
+
+// Minimizes the sum of the squared residuals(p, r) over p, returns it.
+// The Jacobian is taken by forward differences, p are logarithms so the step
+// is relative.
+template <typename Residuals>
+static double LevenbergMarquardt(std::vector<double> &p, Residuals residuals) {
+  const size_t n = p.size();
+  std::vector<double> r, trial, next(n);
+  residuals(p, r);
+  double cost = SquaredSum(r), lambda = 1e-3;
+  std::vector<double> jacobian, a(n * n), g(n);
+
+  for (int iteration = 0; iteration < 100 && lambda < 1e10; iteration++) {
+    const size_t m = r.size();
+    jacobian.assign(m * n, 0);
+    for (size_t i = 0; i < n; i++) {
+      std::vector<double> shifted = p;
+      shifted[i] += 1e-4;
+      residuals(shifted, trial);
+      for (size_t k = 0; k < m; k++) jacobian[k * n + i] = (trial[k] - r[k]) / 1e-4;
+    }
+    for (size_t i = 0; i < n; i++) {
+      g[i] = 0;
+      for (size_t k = 0; k < m; k++) g[i] -= jacobian[k * n + i] * r[k];
+      for (size_t j = 0; j < n; j++) {
+        double sum = 0;
+        for (size_t k = 0; k < m; k++) sum += jacobian[k * n + i] * jacobian[k * n + j];
+        a[i * n + j] = sum;
+      }
+    }
+
+    // raise the damping until a step lowers the cost
+    for (; lambda < 1e10; lambda *= 10) {
+      std::vector<double> damped = a, step = g;
+      for (size_t i = 0; i < n; i++) damped[i * n + i] *= 1 + lambda;
+      if (!Solve(damped, step, n)) continue;
+      for (size_t i = 0; i < n; i++) next[i] = p[i] + step[i];
+      residuals(next, trial);
+      double nextCost = SquaredSum(trial);
+      if (nextCost < cost) {
+        bool converged = cost - nextCost < 1e-9 * cost;
+        p = next;
+        r.swap(trial);
+        cost = nextCost;
+        lambda = fmax(lambda * 0.3, 1e-9);
+        if (converged) return cost;
+        break;
+      }
+    }
+  }
+  return cost;
+}
+
+void SimulateFopdt(const ThermalLog &log, const FopdtModel &model, std::vector<float> &temperature) {
+  const size_t n = log.Size();
+  temperature.resize(n);
+  if (!n) return;
+  float rise = log.temperature[0] - model.ambient;
+  size_t delayed = 0; // last sample at or before t - deadTime
+  for (size_t k = 0; k < n; k++) {
+    temperature[k] = model.ambient + rise;
+    if (k + 1 == n) break;
+    float t = log.time[k] - model.deadTime;
+    while (delayed + 1 < n && log.time[delayed + 1] <= t) delayed++;
+    float duty = t >= log.time[0] ? log.duty[delayed] : 0; // the heater was off before the log
+    float decay = expf(-(log.time[k + 1] - log.time[k]) / model.tau);
+    rise = rise * decay + model.gain * duty * (1 - decay);
+  }
+}
+
+void SimulateTwoNode(const ThermalLog &log, const TwoNodeModel &model, std::vector<float> &temperature) {
+  const size_t n = log.Size();
+  temperature.resize(n);
+  if (!n) return;
+  // SimOven::Step(), the oven starts even at the first temperature
+  float element = log.temperature[0], chamber = element, sensor = element;
+  float fastest = fminf(fminf(model.elementCapacity / model.elementToChamber,
+                              model.chamberCapacity / (model.elementToChamber + model.chamberLoss)), model.sensorTau);
+  float maxStep = fminf(TWO_NODE_MAX_STEP, fastest / 2);
+  for (size_t k = 0; k < n; k++) {
+    temperature[k] = sensor;
+    if (k + 1 == n) break;
+    float power = log.duty[k] * model.heaterPower, left = log.time[k + 1] - log.time[k];
+    int steps = (int)ceilf(left / maxStep);
+    float dt = left / steps;
+    for (int i = 0; i < steps; i++) {
+      float toChamber = model.elementToChamber * (element - chamber);
+      float toRoom = model.chamberLoss * (chamber - model.ambient);
+      element += dt * (power - toChamber) / model.elementCapacity;
+      chamber += dt * (toChamber - toRoom) / model.chamberCapacity;
+      sensor += dt * (chamber - sensor) / model.sensorTau;
+    }
+  }
+}
+
+static float Rms(const ThermalLog &log, const std::vector<float> &temperature) {
+  double sum = 0;
+  for (size_t k = 0; k < log.Size(); k++) sum += (temperature[k] - log.temperature[k]) * (temperature[k] - log.temperature[k]);
+  return sqrtf(sum / log.Size());
+}
+
+// Every dead time on the grid of the mean sample period gets the linear fit
+//   rise[k + 1] = a rise[k] + b duty[k - d]
+// (a = exp(-period / tau), b = gain (1 - a)) and is scored by its free run on
+// the same grid. The best one and its neighbours are refined on the actual
+// times, the dead time does not change the residuals smoothly.
+float FitFopdt(const ThermalLog &log, float ambient, FopdtModel &model) {
+  const size_t n = log.Size();
+  if (n < FIT_MIN_SAMPLES) return NAN;
+  const float period = (log.time[n - 1] - log.time[0]) / (n - 1);
+  size_t maxDelay = (size_t)(FOPDT_MAX_DEAD_TIME / period);
+  if (maxDelay > n / 4) maxDelay = n / 4;
+
+  size_t bestDelay = 0;
+  double bestError = INFINITY;
+  FopdtModel best = {ambient, 1, 1, 0};
+  for (size_t d = 0; d <= maxDelay; d++) {
+    double xx = 0, xu = 0, uu = 0, xy = 0, uy = 0;
+    for (size_t k = d; k + 1 < n; k++) {
+      double x = log.temperature[k] - ambient, u = log.duty[k - d], y = log.temperature[k + 1] - ambient;
+      xx += x * x;
+      xu += x * u;
+      uu += u * u;
+      xy += x * y;
+      uy += u * y;
+    }
+    double det = xx * uu - xu * xu;
+    if (fabs(det) < 1e-12) continue;
+    double a = (xy * uu - uy * xu) / det, b = (uy * xx - xy * xu) / det;
+    if (!(a > 0 && a < 1 && b > 0)) continue;
+
+    double rise = log.temperature[0] - ambient, error = 0;
+    for (size_t k = 0; k < n; k++) {
+      double e = ambient + rise - log.temperature[k];
+      error += e * e;
+      rise = a * rise + b * (k >= d ? log.duty[k - d] : 0);
+    }
+    if (error < bestError) {
+      bestError = error;
+      bestDelay = d;
+      best = {ambient, (float)(b / (1 - a)), (float)(-period / std::log(a)), d * period};
+    }
+  }
+  if (bestError == INFINITY) return NAN;
+
+  std::vector<float> simulated;
+  float bestRms = INFINITY;
+  for (size_t d = bestDelay ? bestDelay - 1 : 0; d <= bestDelay + 1; d++) {
+    FopdtModel trial = best;
+    trial.deadTime = d * period;
+    std::vector<double> p = {std::log(best.gain), std::log(best.tau)};
+    LevenbergMarquardt(p, [&](const std::vector<double> &q, std::vector<double> &r) {
+      trial.gain = exp(q[0]);
+      trial.tau = exp(q[1]);
+      SimulateFopdt(log, trial, simulated);
+      r.resize(n);
+      for (size_t k = 0; k < n; k++) r[k] = simulated[k] - log.temperature[k];
+    });
+    trial.gain = exp(p[0]);
+    trial.tau = exp(p[1]);
+    SimulateFopdt(log, trial, simulated);
+    float rms = Rms(log, simulated);
+    if (rms < bestRms) {
+      bestRms = rms;
+      model = trial;
+    }
+  }
+  return bestRms;
+}
+
+float FitTwoNode(const ThermalLog &log, TwoNodeModel &model) {
+  const size_t n = log.Size();
+  if (n < FIT_MIN_SAMPLES) return NAN;
+  TwoNodeModel trial = model;
+  auto apply = [&](const std::vector<double> &q) {
+    trial.chamberCapacity = exp(q[0]);
+    trial.elementToChamber = exp(q[1]);
+    trial.chamberLoss = exp(q[2]);
+    trial.sensorTau = exp(q[3]);
+  };
+  std::vector<float> simulated;
+  std::vector<double> p = {std::log(model.chamberCapacity), std::log(model.elementToChamber), std::log(model.chamberLoss),
+                           std::log(model.sensorTau)};
+  LevenbergMarquardt(p, [&](const std::vector<double> &q, std::vector<double> &r) {
+    apply(q);
+    SimulateTwoNode(log, trial, simulated);
+    r.resize(n);
+    for (size_t k = 0; k < n; k++) r[k] = simulated[k] - log.temperature[k];
+  });
+  apply(p);
+  model = trial;
+  SimulateTwoNode(log, model, simulated);
+  return Rms(log, simulated);
+}
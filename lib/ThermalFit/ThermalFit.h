@@ -0,0 +1,68 @@
+#ifndef ThermalFit_h
+#define ThermalFit_h
+
+#include <stddef.h>
+
+#include <vector>
+
+// Thermal model identification from a recorded run, for host tools.
+//
+// The log is the temperature the controller saw and the heater duty it
+// applied, sampled every PID computation. Two models are fitted to it by
+// least squares on the free-run response, the model driven by the recorded
+// duty alone from the first temperature on:
+//
+//   FOPDT     tau dT/dt = ambient + gain u(t - deadTime) - T, the usual
+//             tuning model. Every dead time on the sample grid is tried with
+//             a linear fit of the sampled equation, the best few are refined.
+//   two-node  the plant of SimOven (lib/HostSim): heating elements driven by
+//             heaterPower heat the chamber, which loses heat to the room, and
+//             a sensor lag. Temperatures alone only give the rates, not the
+//             heat capacities, so heaterPower and elementCapacity stay as
+//             given and the chamber capacity, both conductances and the
+//             sensor lag are fitted, starting from the model given. An
+//             element and a sensor lag of a similar size act in series and
+//             are told apart less well than their sum.
+//
+// Both fits are Levenberg-Marquardt on the logarithms of the parameters, so
+// they stay positive. A 7 minute log at 250 ms fits in a few milliseconds.
+
+struct ThermalLog
+{
+  std::vector<float> time;        // s since the start, increasing
+  std::vector<float> temperature; // C
+  std::vector<float> duty;        // 0..1, heater duty from this sample to the next
+
+  size_t Size() const { return time.size(); }
+  void Add(float t, float temperature, float duty);
+};
+
+struct FopdtModel
+{
+  float ambient;   // C
+  float gain;      // C above ambient at full duty
+  float tau;       // s
+  float deadTime;  // s
+};
+
+// the fields of OvenModel in SimOven.h
+struct TwoNodeModel
+{
+  float ambient = 25;
+  float heaterPower = 1200;
+  float elementCapacity = 150;
+  float chamberCapacity = 700;
+  float elementToChamber = 20;
+  float chamberLoss = 4;
+  float sensorTau = 3;
+};
+
+// both return the RMS error of the free-run response in C
+float FitFopdt(const ThermalLog &log, float ambient, FopdtModel &model);
+float FitTwoNode(const ThermalLog &log, TwoNodeModel &model);
+
+// free-run responses at the times of the log
+void SimulateFopdt(const ThermalLog &log, const FopdtModel &model, std::vector<float> &temperature);
+void SimulateTwoNode(const ThermalLog &log, const TwoNodeModel &model, std::vector<float> &temperature);
+
+#endif
@@ -0,0 +1,92 @@
+// Host check for ThermalFit: finds a simulated oven's parameters again from a recorded run.
+//   g++ -O2 -std=gnu++17 -pthread -I lib/HostSim -I lib/ThermalFit lib/HostSim/Arduino.cpp lib/HostSim/WString.cpp lib/HostSim/SimOven.cpp lib/ThermalFit/ThermalFit.cpp lib/ThermalFit/examples/Fit/Fit.cpp -o thermal_fit && ./thermal_fit
+
+#include <ThermalFit.h>
+#include <SimOven.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+static bool Near(float value, float expected, float tolerance) {
+  return fabsf(value - expected) <= tolerance * fabsf(expected);
+}
+
+int main() {
+  OvenModel truth;
+  truth.chamberCapacity = 900;
+  truth.elementToChamber = 25;
+  truth.chamberLoss = 5;
+  truth.sensorTau = 5;
+
+  // the default profile: 100, 150, 230 and 25 C for 120, 60, 120 and 120 s
+  const float targets[4] = {100, 150, 230, 25};
+  const unsigned long ends[4] = {120000, 180000, 300000, 420000};
+  SimClock::Reset();
+  SimOven oven(truth);
+  ThermalLog log;
+  int dutySteps = 0;
+  for (unsigned long ms = 0, phase = 0; ms < ends[3]; ms += 50) {
+    SimClock::Advance((ms - millis()) * 1000ULL);
+    while (ms >= ends[phase]) phase++;
+    if (ms % 500 == 0) {
+      float output = fminf(fmaxf(0.1f * (targets[phase] - oven.SensorTemp()), 0), 1);
+      dutySteps = (int)(output * 10);
+    }
+    oven.SetHeater((ms % 500) / 50 < (unsigned long)dutySteps);
+    if (ms % 250 == 0) log.Add(ms / 1000.0f, roundf(oven.SensorTemp() * 10) / 10, dutySteps / 10.0f);
+  }
+
+  TwoNodeModel model; // starts from the default oven
+  model.ambient = truth.ambient;
+  auto begin = std::chrono::steady_clock::now();
+  float twoNodeRms = FitTwoNode(log, model);
+  double twoNodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  printf("  two-node: chamber %.0f J/K, conductances %.2f and %.2f W/K, sensor %.2f s, RMS %.3f C in %.1f ms\n",
+         model.chamberCapacity, model.elementToChamber, model.chamberLoss, model.sensorTau, twoNodeRms, twoNodeMs);
+  // the element and sensor lags are of a size and act in series, the log pins down their sum much better than each
+  float lags = model.elementCapacity / model.elementToChamber + model.sensorTau;
+  Expect(Near(model.chamberCapacity, truth.chamberCapacity, 0.05f) && Near(model.chamberLoss, truth.chamberLoss, 0.05f) &&
+         Near(lags, truth.elementCapacity / truth.elementToChamber + truth.sensorTau, 0.05f),
+         "two-node fit finds the chamber and the fast lags within 5%");
+  Expect(Near(model.elementToChamber, truth.elementToChamber, 0.15f) && Near(model.sensorTau, truth.sensorTau, 0.15f),
+         "and the element and sensor lag each within 15%");
+  Expect(twoNodeRms < 0.1f, "two-node fit follows the log within the rounding");
+
+  FopdtModel fopdt;
+  begin = std::chrono::steady_clock::now();
+  float fopdtRms = FitFopdt(log, truth.ambient, fopdt);
+  double fopdtMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  float ceiling = truth.heaterPower / truth.chamberLoss; // steady state rise at full power
+  printf("  FOPDT: gain %.0f C (ceiling %.0f C), tau %.0f s, dead time %.1f s, RMS %.2f C in %.1f ms\n", fopdt.gain,
+         ceiling, fopdt.tau, fopdt.deadTime, fopdtRms, fopdtMs);
+  Expect(Near(fopdt.gain, ceiling, 0.2f) && fopdt.deadTime > 0 && fopdtRms < 5, "FOPDT fit is a first order approximation");
+  Expect(twoNodeMs < 100 && fopdtMs < 100, "a 7 minute log fits in milliseconds");
+
+  // an exact first order plant with 10 s dead time at 250 ms steps
+  FopdtModel plant = {25, 300, 200, 10};
+  ThermalLog first;
+  for (int k = 0; k < 1680; k++) first.Add(k * 0.25f, 25, (k / 240) % 2 ? 0.3f : 0.8f);
+  std::vector<float> response;
+  SimulateFopdt(first, plant, response);
+  first.temperature = response;
+  float exactRms = FitFopdt(first, 25, fopdt);
+  printf("  exact plant: gain %.1f C, tau %.1f s, dead time %.2f s, RMS %.4f C\n", fopdt.gain, fopdt.tau,
+         fopdt.deadTime, exactRms);
+  Expect(Near(fopdt.gain, plant.gain, 0.01f) && Near(fopdt.tau, plant.tau, 0.01f) && fabsf(fopdt.deadTime - plant.deadTime) < 0.3f,
+         "a first order plant with dead time is fitted exactly");
+
+  ThermalLog few;
+  few.Add(0, 25, 1);
+  Expect(isnan(FitFopdt(few, 25, fopdt)) && isnan(FitTwoNode(few, model)), "too short a log is not fitted");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#include "ThermistorTable.h"
+
+#include <math.h>
+
+// Converts the divider reading to the thermistor resistance, with the same
+// clamping the firmware always used to keep the ends of the range finite.
+float ThermistorTable::Resistance(const ThermistorParams &params, float adc) {
+  float _res = adc;
+  if (_res <= 0) _res = 1; // prevent division by zero
+  _res = params.adcMax / _res - 1;
+  if (_res <= 0) _res = 0.0001; // prevent division by zero
+  return params.seriesResistor / _res;
+}
+
+float ThermistorTable::Analytic(const ThermistorParams &params, float adc) {
+  double lnR = log(Resistance(params, adc));
+  double invT;
+
+  if (params.equation == THERMISTOR_STEINHART_HART) {
+    invT = params.a + params.b * lnR + params.c * lnR * lnR * lnR;
+  } else {
+    invT = (lnR - log(params.nominal)) / params.beta + 1.0 / (params.nominalTemp + 273.15);
+  }
+
+  return (float)(1.0 / invT - 273.15);
+}
+
+void ThermistorTable::Build(const ThermistorParams &params) {
+  adcMax = params.adcMax > MAX_ADC ? MAX_ADC : params.adcMax;
+  for (uint16_t i = 0; i < SIZE; i++) {
+    float adc = (float)i * STEP;
+    if (adc > adcMax) adc = adcMax;
+    table[i] = Analytic(params, adc);
+  }
+}
+
+float ThermistorTable::Lookup(float adc) const {
+  if (adc < 0) adc = 0;
+  if (adc > adcMax) adc = adcMax;
+
+  float position = adc / STEP;
+  uint16_t index = (uint16_t)position;
+  if (index >= SIZE - 1) return table[SIZE - 1];
+
+  float fraction = position - index;
+  return table[index] + (table[index + 1] - table[index]) * fraction;
+}
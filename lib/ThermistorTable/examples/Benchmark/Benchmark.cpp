@@ -0,0 +1,73 @@
+// Host benchmark and accuracy check for ThermistorTable against the Beta and Steinhart-Hart formulas.
+//   g++ -O2 -std=gnu++17 -I lib/ThermistorTable lib/ThermistorTable/ThermistorTable.cpp lib/ThermistorTable/examples/Benchmark/Benchmark.cpp -o thermistor_bench && ./thermistor_bench
+
+#include <ThermistorTable.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+static ThermistorTable table;
+
+// worst interpolation error between minTemp and maxTemp, scanned in 1/16 LSB steps
+static bool CheckAccuracy(const char *name, const ThermistorParams &params, float minTemp, float maxTemp, float tolerance) {
+  table.Build(params);
+
+  float worst = 0, worstAdc = 0;
+  for (float adc = 0; adc <= params.adcMax; adc += 1.0f / 16) {
+    float exact = ThermistorTable::Analytic(params, adc);
+    if (exact < minTemp || exact > maxTemp) continue;
+    float error = fabsf(table.Lookup(adc) - exact);
+    if (error > worst) {
+      worst = error;
+      worstAdc = adc;
+    }
+  }
+
+  bool ok = worst <= tolerance;
+  printf("%-16s max error %.4f C at ADC %.2f (%.1f C) %s\n", name, worst, worstAdc,
+         ThermistorTable::Analytic(params, worstAdc), ok ? "OK" : "FAIL");
+  return ok;
+}
+
+template <typename F>
+static double NanosPerCall(F convert) {
+  const int calls = 4000000;
+  volatile float sink = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    sink = sink + convert(77.0f + (i % 38000) * 0.1f); // 20..300 C
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - begin).count() / calls;
+}
+
+int main() {
+  ThermistorParams beta; // defaults match Board.h
+
+  // Steinhart-Hart coefficients equivalent to the Beta model above
+  ThermistorParams steinhart = beta;
+  steinhart.equation = THERMISTOR_STEINHART_HART;
+  steinhart.b = 1.0 / beta.beta;
+  steinhart.a = 1.0 / (beta.nominalTemp + 273.15) - log(beta.nominal) * steinhart.b;
+  steinhart.c = 0;
+
+  // a real three-coefficient fit (generic 100k NTC) to exercise the C term
+  ThermistorParams fitted = steinhart;
+  fitted.a = 0.8269925494e-3;
+  fitted.b = 2.088185118e-4;
+  fitted.c = 0.8059992866e-7;
+
+  bool ok = true;
+  ok &= CheckAccuracy("beta", beta, 20, 300, 0.15f);
+  ok &= CheckAccuracy("steinhart-hart", steinhart, 20, 300, 0.15f);
+  ok &= CheckAccuracy("sh fitted", fitted, 20, 300, 0.25f);
+
+  table.Build(beta);
+  double analytic = NanosPerCall([&](float adc) { return ThermistorTable::Analytic(beta, adc); });
+  double lookup = NanosPerCall([&](float adc) { return table.Lookup(adc); });
+  printf("analytic %.1f ns/sample, table %.1f ns/sample (%.1fx), table size %u bytes\n",
+         analytic, lookup, analytic / lookup, (unsigned)sizeof(table));
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include "WorkPool.h"
+
+#include <thread>
+#include <vector>
+
+WorkPool::WorkPool(unsigned threads) : threads(threads), steals(0) {
+  if (this->threads == 0) this->threads = std::thread::hardware_concurrency();
+  if (this->threads == 0) this->threads = 1;
+  ranges.reset(new Range[this->threads]);
+}
+
+void WorkPool::Run(size_t count, const std::function<void(size_t, unsigned)> &work) {
+  steals = 0;
+  for (unsigned i = 0; i < threads; i++) {
+    ranges[i].next = count * i / threads;
+    ranges[i].end = count * (i + 1) / threads;
+  }
+
+  std::vector<std::thread> helpers;
+  for (unsigned i = 1; i < threads; i++) helpers.emplace_back(&WorkPool::Work, this, i, std::cref(work));
+  Work(0, work);
+  for (std::thread &helper : helpers) helper.join();
+}
+
+void WorkPool::Work(unsigned worker, const std::function<void(size_t, unsigned)> &work) {
+  size_t index;
+  while (Take(worker, index) || Steal(worker, index)) work(index, worker);
+}
+
+bool WorkPool::Take(unsigned worker, size_t &index) {
+  Range &own = ranges[worker];
+  std::lock_guard<std::mutex> guard(own.lock);
+  if (own.next == own.end) return false;
+  index = own.next++;
+  return true;
+}
+
+// Takes the back half of the largest range, the front of it stays with its
+// owner, which is working there. False once every range is empty: what a thief
+// holds between its steal and its own range it does itself.
+bool WorkPool::Steal(unsigned worker, size_t &index) {
+  for (;;) {
+    unsigned victim = worker;
+    size_t largest = 0;
+    for (unsigned i = 0; i < threads; i++) {
+      if (i == worker) continue;
+      std::lock_guard<std::mutex> guard(ranges[i].lock);
+      size_t left = ranges[i].end - ranges[i].next;
+      if (left > largest) {
+        largest = left;
+        victim = i;
+      }
+    }
+    if (victim == worker) return false;
+
+    size_t first, end;
+    {
+      std::lock_guard<std::mutex> guard(ranges[victim].lock);
+      size_t left = ranges[victim].end - ranges[victim].next;
+      if (left == 0) continue; // its owner or another thief was faster
+      end = ranges[victim].end;
+      first = end - (left + 1) / 2;
+      ranges[victim].end = first;
+    }
+    steals++;
+
+    std::lock_guard<std::mutex> guard(ranges[worker].lock);
+    ranges[worker].next = first + 1;
+    ranges[worker].end = end;
+    index = first;
+    return true;
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef WorkPool_h
+#define WorkPool_h
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Work-stealing parallel loop for host tools (not used on the ESP32).
+//
+// Run() calls work(index, worker) once for every index in [0, count) on
+// Threads() threads, the calling one included. Each thread starts with an
+// equal contiguous range and takes indices from its front; a thread whose
+// range is empty steals the back half of the largest range left, so a few
+// slow items do not leave the other threads idle. Ranges are guarded by one
+// mutex each and no thread ever holds two, taking an index costs an
+// uncontended lock: items should take microseconds or more.
+
+class WorkPool
+{
+  public:
+    // threads 0: one per hardware thread
+    explicit WorkPool(unsigned threads = 0);
+
+    void Run(size_t count, const std::function<void(size_t index, unsigned worker)> &work);
+
+    unsigned Threads() const { return threads; }
+    // ranges stolen by the last Run()
+    unsigned long Steals() const { return steals; }
+
+  private:
+    struct alignas(64) Range {
+      std::mutex lock;
+      size_t next = 0, end = 0;
+    };
+
+    void Work(unsigned worker, const std::function<void(size_t, unsigned)> &work);
+    bool Take(unsigned worker, size_t &index);
+    bool Steal(unsigned worker, size_t &index);
+
+    unsigned threads;
+    std::unique_ptr<Range[]> ranges;
+    std::atomic<unsigned long> steals;
+};
+
+#endif
@@ -0,0 +1,55 @@
+// Host check for WorkPool: every index exactly once, and stealing from a slow range.
+//   g++ -O2 -std=gnu++17 -I lib/WorkPool lib/WorkPool/WorkPool.cpp lib/WorkPool/examples/Steal/Steal.cpp -pthread -o work_pool && ./work_pool
+
+#include <WorkPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void Expect(bool ok, const char *what) {
+  printf("%-60s %s\n", what, ok ? "OK" : "FAIL");
+  if (!ok) failures++;
+}
+
+// every index once, and each on a thread that exists
+static bool Once(WorkPool &pool, size_t count) {
+  std::vector<std::atomic<int>> visits(count);
+  for (std::atomic<int> &visit : visits) visit = 0;
+  std::atomic<bool> worker(true);
+  pool.Run(count, [&](size_t index, unsigned thread) {
+    visits[index]++;
+    if (thread >= pool.Threads()) worker = false;
+  });
+  for (std::atomic<int> &visit : visits) {
+    if (visit != 1) return false;
+  }
+  return worker;
+}
+
+int main() {
+  WorkPool single(1), four(4);
+  Expect(WorkPool().Threads() >= 1, "one thread per hardware thread by default");
+  Expect(Once(single, 1000) && single.Steals() == 0, "one thread visits every index once, nothing to steal");
+  Expect(Once(four, 100000), "four threads visit every index once");
+  Expect(Once(four, 3) && Once(four, 0), "fewer indices than threads, and none");
+
+  // 32 items of 10 ms, all in the first of four ranges
+  const size_t count = 128, slow = 32;
+  const auto pause = std::chrono::milliseconds(10);
+  auto begin = std::chrono::steady_clock::now();
+  four.Run(count, [&](size_t index, unsigned) {
+    if (index < slow) std::this_thread::sleep_for(pause);
+  });
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  double dealt = slow * 0.010; // the first thread alone
+  printf("  %zu slow items: %.3f s with %lu steals, %.3f s as dealt out\n", slow, seconds, four.Steals(), dealt);
+  Expect(four.Steals() > 0 && seconds < 0.5 * dealt, "idle threads steal the slow items");
+
+  printf(failures ? "%d checks failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
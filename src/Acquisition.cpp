@@ -0,0 +1,65 @@
+#include <Arduino.h>
+#include <SpscRing.h>
+
+#include "Acquisition.h"
+
+static SpscRing<AdcSample, ACQUISITION_BUFFER> adcRing;
+static std::atomic<uint32_t> droppedSamples{0};
+
+bool AcquisitionRead(AdcSample &sample) {
+  return adcRing.Pop(sample);
+}
+
+void AcquisitionPush(const AdcSample &sample) {
+  if (!adcRing.Push(sample)) droppedSamples.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t AcquisitionDropped() {
+  return droppedSamples.load(std::memory_order_relaxed);
+}
+
+uint32_t AcquisitionPending() {
+  return adcRing.Size();
+}
+
+#ifndef NATIVE_SIM
+// analogRead() takes a lock inside the ADC driver and cannot run in an ISR, so
+// the timer ISR only wakes a high priority sampler task. The timestamps are
+// derived from the tick count, so they are exact even if the task runs late.
+
+static hw_timer_t *sampleTimer = nullptr;
+static TaskHandle_t samplerTask = nullptr;
+static uint8_t samplePin;
+static uint32_t samplePeriod, firstTick;
+
+static void IRAM_ATTR OnSampleTimer() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(samplerTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+static void SamplerTask(void *) {
+  uint32_t tick = 0;
+  for (;;) {
+    // take one notification per timer tick, so a late wake-up catches up
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    AdcSample sample;
+    sample.time = firstTick + ++tick * samplePeriod;
+    sample.value = analogRead(samplePin);
+    AcquisitionPush(sample);
+  }
+}
+
+void AcquisitionBegin(uint8_t pin, uint32_t periodUs) {
+  samplePin = pin;
+  samplePeriod = periodUs;
+
+  xTaskCreatePinnedToCore(SamplerTask, "adc", 2048, nullptr, configMAX_PRIORITIES - 1, &samplerTask, 1);
+
+  sampleTimer = timerBegin(0, 80, true); // 80 MHz APB / 80 = 1 us per count
+  timerAttachInterrupt(sampleTimer, &OnSampleTimer, true);
+  timerAlarmWrite(sampleTimer, periodUs, true);
+  firstTick = micros();
+  timerAlarmEnable(sampleTimer);
+}
+#endif
@@ -0,0 +1,36 @@
+#ifndef NATIVE_SIM
+#include <Arduino.h>
+
+#include "Tasks.h"
+
+// the ADC sampler task (Acquisition.cpp) shares core 1 with a higher priority
+#define CONTROL_CORE 1
+#define CONTROL_PRIORITY (configMAX_PRIORITIES - 2)
+#define UI_CORE 0
+#define UI_PRIORITY 1
+
+static void ControlTask(void *) {
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    ControlTick();
+    // fixed rate: the period is measured from the last wake-up, not from now
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CONTROL_PERIOD_MS));
+  }
+}
+
+static void UiTask(void *) {
+  for (;;) {
+    UiTick();
+    vTaskDelay(1); // let the idle task run, it feeds the task watchdog on core 0
+  }
+}
+
+void StartTasks() {
+  xTaskCreatePinnedToCore(ControlTask, "control", 4096, nullptr, CONTROL_PRIORITY, nullptr, CONTROL_CORE);
+  xTaskCreatePinnedToCore(UiTask, "ui", 8192, nullptr, UI_PRIORITY, nullptr, UI_CORE);
+
+  // setup() runs in the Arduino loop task, which has nothing left to do
+  vTaskDelete(NULL);
+}
+
+#endif
@@ -0,0 +1,311 @@
+// ===================================================================
+// |              Thermal model identification                       |
+// ===================================================================
+// Fits the oven models of lib/ThermalFit to a recorded run and writes a model
+// file the simulation (--model) and the sweep (--model) run instead of the
+// default oven.
+//
+//   .pio/build/identify/program <log> [--out oven.json] [--ambient 25] [--period 250]
+//                               [--power 1200] [--element-capacity 150] [--model oven.json] [--heater burst]
+//                               [--profile data/profiles/default.json | --segments '[...]']
+//
+// The log is one of
+//   - the serial output of a run: the temp,setpoint,output lines HandlePID
+//     prints every --period ms (output in %), other lines are skipped
+//   - the CSV export of a run log (GET /runs/<id>.csv): time,temperature,
+//     setpoint,output with the profile in its comment lines
+//   - a run log itself, runs/<id>.bin from a copy of the filesystem
+// The output is the duty the heater applied; with --heater pwm, for runs of
+// the slow PWM, it is truncated to whole steps of PWM_STEPS. The run starts from a cold oven, its first temperature is the
+// ambient unless --ambient says otherwise.
+//
+// The two-node fit keeps the heater power and element capacity of the
+// default oven, of --model, or --power and --element-capacity, and starts
+// from its other values. The fit error is reported per phase of the profile,
+// replayed on the recorded temperatures: the log's own for run logs,
+// --profile or --segments for serial output, else the default profile.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <HeaterModulator.h>
+#include <OvenModelFile.h>
+#include <ProfileEngine.h>
+#include <RunLog.h>
+#include <ThermalFit.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+
+#include "../sweep/ProfileFile.h"
+
+#define PWM_STEPS 10 // of the slow PWM, as in main.cpp
+
+struct IdentifyOptions {
+  String log;
+  String out = "oven.json";
+  float ambient = NAN;       // the first temperature of the log
+  float periodMs = 250;      // timeTempCheck, between the lines of serial output
+  OvenModel oven;            // heater power and element capacity, the start of the fit
+  ProfileFile profile;
+  bool profileGiven = false;
+  HeaterMode heater = HEATER_BURST; // how the relay was switched, like setHeater
+};
+
+static bool ParseArgs(int argc, char **argv, IdentifyOptions &opt) {
+  bool powerGiven = false, capacityGiven = false;
+  float power = 0, capacity = 0;
+  for (int i = 1; i < argc; i++) {
+    String arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    String error;
+    if (arg == "--out" && hasValue) opt.out = argv[++i];
+    else if (arg == "--ambient" && hasValue) opt.ambient = atof(argv[++i]);
+    else if (arg == "--period" && hasValue) opt.periodMs = atof(argv[++i]);
+    else if (arg == "--power" && hasValue) powerGiven = (power = atof(argv[++i])) > 0;
+    else if (arg == "--element-capacity" && hasValue) capacityGiven = (capacity = atof(argv[++i])) > 0;
+    else if (arg == "--model" && hasValue) error = ReadOvenModel(argv[++i], opt.oven);
+    else if (arg == "--heater" && hasValue) {
+      if (!HeaterModulator::ParseMode(argv[++i], opt.heater)) error = "--heater is burst or pwm";
+    } else if (arg == "--profile" && hasValue) {
+      error = ReadProfile(argv[++i], opt.profile);
+      opt.profileGiven = true;
+    } else if (arg == "--segments" && hasValue) {
+      error = ParseSegments(argv[++i], opt.profile);
+      opt.profile.name = "--segments";
+      opt.profileGiven = true;
+    } else if (!arg.startsWith("--") && opt.log.length() == 0) opt.log = arg;
+    else {
+      fprintf(stderr, "Unknown or incomplete option: %s\n", arg.c_str());
+      return false;
+    }
+    if (error.length()) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return false;
+    }
+  }
+  if (powerGiven) opt.oven.heaterPower = power;
+  if (capacityGiven) opt.oven.elementCapacity = capacity;
+  if (opt.log.length() == 0 || !(opt.periodMs > 0)) {
+    fprintf(stderr, "usage: identify <log> [options], see the top of IdentifyMain.cpp\n");
+    return false;
+  }
+  return true;
+}
+
+// the CSV export of a run log from its binary file, runs/<id>.bin in a copy of the filesystem
+static String ReadRunLog(const String &path, std::string &text) {
+  std::filesystem::path file(path.c_str());
+  std::string directory = file.parent_path().filename().string();
+  uint32_t id = strtoul(file.stem().string().c_str(), nullptr, 10);
+  if ("/" + directory != RUNLOG_DIR || !id) return path + " is not a run log, runs/<id>.bin";
+
+  std::filesystem::path root = file.parent_path().parent_path();
+  LittleFS.SetRoot(root.empty() ? "." : root.string());
+  RunLogReader reader;
+  if (!reader.Open(LittleFS, id)) return "cannot read the run log " + path;
+  char buffer[512];
+  size_t length;
+  while ((length = reader.ReadCsv(buffer, sizeof(buffer))) > 0) text.append(buffer, length);
+  reader.Close();
+  return "";
+}
+
+// the comma separated numbers of a line, false when it is anything else
+static bool Numbers(const std::string &line, double *values, int &count) {
+  count = 0;
+  const char *c = line.c_str();
+  while (count < 4) {
+    char *end;
+    values[count++] = strtod(c, &end);
+    if (end == c) return false;
+    c = end;
+    if (*c != ',') break;
+    c++;
+  }
+  while (*c == '\r' || *c == ' ') c++;
+  return *c == 0;
+}
+
+// Fills the log from either text format, appends the segments in the comment
+// lines of a run log export to profile; what is wrong or ""
+static String ParseLog(const std::string &text, const IdentifyOptions &opt, ThermalLog &log, ProfileFile &profile,
+                       bool &profileRead) {
+  std::istringstream lines(text);
+  std::string line;
+  int columns = 0; // of the first data line, 3 serial output, 4 run log
+  profileRead = false;
+  while (std::getline(lines, line)) {
+    unsigned long run;
+    char name[32];
+    if (sscanf(line.c_str(), "# run %lu, profile %31[^,]", &run, name) == 2) {
+      profile.name = name;
+      continue;
+    }
+    unsigned number;
+    char type[16], phase[16];
+    float target, rate;
+    unsigned long seconds;
+    if (sscanf(line.c_str(), "# segment %u, %15[^,], %15[^,], %f C, %f C/s, %lus", &number, type, phase, &target, &rate,
+               &seconds) == 6 && profile.count < PROFILE_MAX_SEGMENTS) {
+      ProfileSegment &segment = profile.segments[profile.count];
+      memset(&segment, 0, sizeof(segment));
+      ProfileEngine::ParseType(type, segment.type);
+      ProfileEngine::ParsePhase(phase, segment.phase);
+      segment.target = target;
+      segment.rate = rate;
+      segment.time = seconds * 1000;
+      profile.count++;
+      profileRead = true;
+      continue;
+    }
+
+    double values[4];
+    int count;
+    if (!Numbers(line, values, count) || count < 3) continue; // the rest of the serial output
+    if (!columns) columns = count;
+    if (count != columns) continue;
+    bool steps = opt.heater == HEATER_SLOW_PWM;
+    if (columns == 3) {
+      // temp,setpoint,(int)(Output * 100)
+      log.Add(log.Size() * opt.periodMs / 1000, values[0],
+              steps ? (int)values[2] / (100 / PWM_STEPS) / (float)PWM_STEPS : values[2] / 100);
+    } else {
+      // time,temperature,setpoint,output
+      if (log.Size() && values[0] <= log.time.back()) continue;
+      log.Add(values[0], values[1], steps ? floorf(values[3] * PWM_STEPS + 1e-3f) / PWM_STEPS : values[3]);
+    }
+  }
+  if (log.Size() == 0) return opt.log + " has no temp,setpoint,output or run log lines";
+  return "";
+}
+
+// what kind of segment each sample was in, replaying the profile on the recorded temperatures
+static void Phases(const ThermalLog &log, const ProfileFile &profile, std::vector<uint8_t> &phases) {
+  ProfileEngine engine;
+  phases.assign(log.Size(), PHASE_IDLE);
+  if (!engine.Load(profile.segments, profile.count)) return;
+  engine.Start(log.temperature[0]);
+  for (size_t k = 0; k < log.Size(); k++) {
+    EngineState state = engine.Update((uint32_t)lroundf((log.time[k] - log.time[0]) * 1000), log.temperature[k]);
+    if (state == ENGINE_DONE || state == ENGINE_TIMEOUT) break;
+    phases[k] = engine.Phase();
+  }
+}
+
+static void WriteJsonString(FILE *file, const char *text) {
+  fputc('"', file);
+  for (const char *c = text; *c; c++) {
+    if (*c == '"' || *c == '\\') fputc('\\', file);
+    if ((unsigned char)*c >= 0x20) fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+static bool WriteModel(const IdentifyOptions &opt, size_t samples, const TwoNodeModel &oven, float ovenRms,
+                       const FopdtModel &fopdt, float fopdtRms) {
+  FILE *file = fopen(opt.out.c_str(), "w");
+  if (!file) return false;
+  fprintf(file, "{\n  \"source\": ");
+  WriteJsonString(file, opt.log.c_str());
+  fprintf(file, ",\n  \"samples\": %zu,\n", samples);
+  fprintf(file, "  \"oven\": {\"ambient\": %.2f, \"heaterPower\": %.1f, \"elementCapacity\": %.2f, \"chamberCapacity\": %.2f,\n"
+                "           \"elementToChamber\": %.4f, \"chamberLoss\": %.4f, \"sensorTau\": %.3f},\n",
+          oven.ambient, oven.heaterPower, oven.elementCapacity, oven.chamberCapacity, oven.elementToChamber,
+          oven.chamberLoss, oven.sensorTau);
+  fprintf(file, "  \"fopdt\": {\"ambient\": %.2f, \"gain\": %.2f, \"tau\": %.2f, \"deadTime\": %.2f},\n", fopdt.ambient,
+          fopdt.gain, fopdt.tau, fopdt.deadTime);
+  fprintf(file, "  \"rms\": {\"twoNode\": %.4f, \"fopdt\": %.4f}\n}\n", ovenRms, fopdtRms);
+  return fclose(file) == 0;
+}
+
+int main(int argc, char **argv) {
+  IdentifyOptions opt;
+  if (!ParseArgs(argc, argv, opt)) return 2;
+
+  std::string text;
+  String error;
+  if (opt.log.endsWith(".bin")) {
+    error = ReadRunLog(opt.log, text);
+  } else {
+    std::ifstream file(opt.log.c_str());
+    std::stringstream read;
+    read << file.rdbuf();
+    text = read.str();
+    if (!file) error = "cannot open " + opt.log;
+  }
+  ThermalLog log;
+  ProfileFile fromLog;
+  fromLog.count = 0;
+  bool profileRead;
+  if (!error.length()) error = ParseLog(text, opt, log, fromLog, profileRead);
+  if (error.length()) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  ProfileFile profile;
+  if (profileRead) profile = fromLog;
+  else if (opt.profileGiven) profile = opt.profile;
+  else DefaultProfile(profile);
+
+  float ambient = isnan(opt.ambient) ? log.temperature[0] : opt.ambient;
+  TwoNodeModel oven;
+  oven.ambient = ambient;
+  oven.heaterPower = opt.oven.heaterPower;
+  oven.elementCapacity = opt.oven.elementCapacity;
+  oven.chamberCapacity = opt.oven.chamberCapacity;
+  oven.elementToChamber = opt.oven.elementToChamber;
+  oven.chamberLoss = opt.oven.chamberLoss;
+  oven.sensorTau = opt.oven.sensorTau;
+  FopdtModel fopdt;
+
+  auto begin = std::chrono::steady_clock::now();
+  float fopdtRms = FitFopdt(log, ambient, fopdt);
+  float ovenRms = FitTwoNode(log, oven);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  if (isnan(fopdtRms) || isnan(ovenRms)) {
+    fprintf(stderr, "%s: %zu samples are too few to fit\n", opt.log.c_str(), log.Size());
+    return 1;
+  }
+
+  printf("%s: %zu samples over %.1f s, ambient %.1f C, fitted in %.1f ms\n", opt.log.c_str(), log.Size(),
+         log.time.back() - log.time[0], ambient, ms);
+  printf("FOPDT     gain %.1f C at full duty, tau %.1f s, dead time %.2f s\n", fopdt.gain, fopdt.tau, fopdt.deadTime);
+  printf("two-node  heater %.0f W, element %.0f J/K (both given), chamber %.0f J/K, element to chamber %.2f W/K,\n"
+         "          chamber loss %.3f W/K, sensor lag %.2f s\n",
+         oven.heaterPower, oven.elementCapacity, oven.chamberCapacity, oven.elementToChamber, oven.chamberLoss,
+         oven.sensorTau);
+
+  std::vector<float> fopdtResponse, ovenResponse;
+  SimulateFopdt(log, fopdt, fopdtResponse);
+  SimulateTwoNode(log, oven, ovenResponse);
+  std::vector<uint8_t> phases;
+  Phases(log, profile, phases);
+  double fopdtSum[PHASE_COUNT] = {}, ovenSum[PHASE_COUNT] = {};
+  size_t samples[PHASE_COUNT] = {};
+  for (size_t k = 0; k < log.Size(); k++) {
+    double a = fopdtResponse[k] - log.temperature[k], b = ovenResponse[k] - log.temperature[k];
+    fopdtSum[phases[k]] += a * a;
+    ovenSum[phases[k]] += b * b;
+    samples[phases[k]]++;
+  }
+  printf("RMS error by phase of %s:\n  phase     samples   FOPDT  two-node\n", profile.name.c_str());
+  for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+    if (!samples[phase]) continue;
+    printf("  %-9s %7zu %6.2f C %7.2f C\n", phase == PHASE_IDLE ? "other" : ProfileEngine::PhaseName(phase),
+           samples[phase], sqrt(fopdtSum[phase] / samples[phase]), sqrt(ovenSum[phase] / samples[phase]));
+  }
+  printf("  %-9s %7zu %6.2f C %7.2f C\n", "all", log.Size(), fopdtRms, ovenRms);
+
+  if (!WriteModel(opt, log.Size(), oven, ovenRms, fopdt, fopdtRms)) {
+    fprintf(stderr, "cannot write %s\n", opt.out.c_str());
+    return 1;
+  }
+  printf("model written to %s\n", opt.out.c_str());
+  return 0;
+}
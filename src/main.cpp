@@ -1,27 +1,83 @@
 #include <Arduino.h>
 #include <Esp.h>
 #include <WiFi.h>
-#include <WebServer.h>
+#include <HttpServer.h>
 #include <PID_v1.h>
 #include <EEPROM.h>
 #include "LittleFS.h"
 #include <ArduinoJson.h>
 #include <ESPmDNS.h>
-#include <EEPROM.h>
 #include <Wire.h> 
 #include <SSD1306Wire.h>
-
-// ---------------- Stored Profiles and Settings EEPROM adresses ----------------
-
-const int MaxProfiles = 20; // maximum number of profiles
-int ProfileCount = 0; // current number of profiles
-String ProfileFolderPrefix = "/profiles"; // folder prefix for profiles
-String ProfileNames[MaxProfiles]; // array to store profile names
+#include <SampleFilter.h>
+#include <ThermistorTable.h>
+#include <SpscRing.h>
+#include <Seqlock.h>
+#include <Scheduler.h>
+#include <Profiler.h>
+#include <ProfileEngine.h>
+#include <RelayAutotune.h>
+#include <HeaterModulator.h>
+#include <Telemetry.h>
+#include <History.h>
+#include <RunLog.h>
+#include <ProfileCatalog.h>
+#include <ProfileStore.h>
+#include <SettingsStore.h>
+#include <atomic>
+
+#include "Board.h"
+#include "Acquisition.h"
+#include "ReflowState.h"
+#include "Tasks.h"
+
+// ---------------- Stored Profiles and Settings ----------------
+
+String ProfileFolderPrefix = "/profiles"; // folder of the JSON profiles of older firmware, migrated at boot
+#define PROFILE_STORE_PATH "/profiles.bin"
+ProfileStore profileStore(LittleFS, PROFILE_STORE_PATH); // every profile as a fixed-size record (lib/ProfileStore)
+ProfileCatalog profiles; // names and summaries of the stored profiles, read at boot (lib/ProfileCatalog)
 String CurrentProfileName = "Custom Profile"; // currently loaded profile name
 
-// eeprom addresses for storing last used profile settings and PID tuning values
+// the last used profile settings, PID tuning values, thermistor filter and profile name, kept in
+// NVS by the settings store (lib/SettingsStore). Change SETTINGS_VERSION with the struct, stored
+// settings of another version are not loaded, LoadSettings() converts those of versions 1 and 2.
+#define SETTINGS_VERSION 3
+#define SETTINGS_POLL_MS 500 // how often the settings store checks for settled changes
+
+struct StoredSettings {
+  double kp, ki, kd;
+  char profileName[PROFILE_NAME_SIZE];
+  uint8_t segmentCount;
+  uint8_t filterMode; // FilterMode
+  uint8_t reserved[2];
+  float filterAlpha;
+  ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+};
+
+// the settings of firmware that kept the filter only until a reboot
+struct StoredSettingsV2 {
+  double kp, ki, kd;
+  char profileName[PROFILE_NAME_SIZE];
+  uint8_t segmentCount;
+  uint8_t reserved[7];
+  ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+};
+
+// the settings of firmware with the four fixed phases
+struct StoredSettingsV1 {
+  double preheatTemp, soakTemp, reflowTemp, cooldownTemp; // C
+  uint32_t preheatTime, soakTime, reflowTime, cooldownTime; // ms
+  double kp, ki, kd;
+  double rampRate, coolRate; // C/s
+  char profileName[PROFILE_NAME_SIZE];
+};
+
+StoredSettings storedSettings;
+SettingsStore settingsStore("tosti", SETTINGS_VERSION, &storedSettings, sizeof(storedSettings));
+
+// eeprom addresses of the settings of older firmware, only read once to migrate them
 // all used datatypes are 8 bytes long
-
 const int EEPROM_PREHEAT_TEMP_ADDR = 0; // address to store preheat temperature
 const int EEPROM_PREHEAT_TIME_ADDR = 8; // address to store preheat time
 const int EEPROM_SOAK_TEMP_ADDR = 16; // address to store soak temperature
@@ -30,17 +86,12 @@ const int EEPROM_REFLOW_TEMP_ADDR = 32; // address to store reflow temperature
 const int EEPROM_REFLOW_TIME_ADDR = 40; // address to store reflow time
 const int EEPROM_COOLDOWN_TEMP_ADDR = 48; // address to store cooldown temperature
 const int EEPROM_COOLDOWN_TIME_ADDR = 56; // address to store cooldown time
-
-// eeprom addresses for storing PID tuning values
 const int EEPROM_KP_ADDR = 64; // address to store Kp value
 const int EEPROM_KI_ADDR = 72; // address to store Ki value
 const int EEPROM_KD_ADDR = 80; // address to store Kd value
-
-const int EEPROM_FIRST_RUN = 88; // flag to indicate if this is the first run
-
-// Given that strings are of unknown length, we store the last used profile name in EEPROM
-// after everything else, so it does not interfere with the other settings.
-const int EEPROM_LASTPROFILE_NAME_ADDR = 89; // address to store the last used profile name
+const int EEPROM_LASTPROFILE_NAME_ADDR = 89; // length byte and characters of the last used profile name
+const int EEPROM_RAMP_RATE_ADDR = 352; // address to store the heating ramp rate
+const int EEPROM_COOL_RATE_ADDR = 360; // address to store the cooling ramp rate
 
 
 // ---------------- WiFi and Access Point Settings and Values ----------------
@@ -48,120 +99,373 @@ const int EEPROM_LASTPROFILE_NAME_ADDR = 89; // address to store the last used p
 const char* ssid = "TostiReflow";
 const char* password = "LPLTosti";
 // Create a server that listens on port 80
-WebServer server(80); 
-// stores the header for the HTTP response
-String header;
+HttpServer server(80); // non-blocking, see lib/HttpServer
+
+// ---------------- Static assets ----------------
+// tools/compress_assets.py stores the web page gzipped with content-hash ETags
+// and lists it in /static/assets.txt. Pinned assets (referenced with ?v=<hash>)
+// are cached by the browser for a year, the page itself is revalidated and
+// answered with 304 when its ETag still matches. A filesystem uploaded from
+// data/ as is has no list and is streamed uncached, like before.
+#define MAX_ASSETS 16
+struct Asset {
+  String path;  // as requested, e.g. /static/main.js
+  String etag;  // quoted
+  bool gzip;    // stored as path + ".gz"
+  bool immutable;
+};
+Asset assets[MAX_ASSETS];
+int assetCount = 0;
+
+// ---------------- Telemetry ----------------
+// Browsers subscribe to /events (server-sent events) instead of polling
+// /status. Every telemetry period one event with the fields that changed is
+// encoded and written to all subscribers; new subscribers get every field once.
+#define TELEMETRY_PERIOD_MS 250 // default, serial "setTelemetry <ms>"
+#define TELEMETRY_MAX_CLIENTS 4
+#define TELEMETRY_HEARTBEAT_MS 15000 // a comment when nothing changed for this long
+unsigned long telemetryPeriod = TELEMETRY_PERIOD_MS;
+unsigned long lastTelemetryEvent = 0;
+TelemetryEncoder telemetryEncoder;
+EventStream<HttpStream, TELEMETRY_MAX_CLIENTS> telemetryClients;
+int telemetryTask = -1;
+
+// ---------------- History ----------------
+// The control task records temperature, setpoint and output of every PID
+// computation of a run in a fixed ring (lib/History), kept until the next
+// START. GET /history?from=<s>&points=<n> returns the samples from that many
+// seconds into the run, downsampled to at most n points for the chart.
+#define HISTORY_POINTS 300      // default for points
+#define HISTORY_MAX_POINTS 1000
+History history;
+
+// ---------------- Status cache ----------------
+// GET /status is answered from one preallocated buffer that holds the whole
+// response body. It has a config section (profile summary, gains) that
+// is only formatted again when statusConfigVersion changes, and a telemetry
+// section that is only formatted again when the control task published a new
+// state. However many clients ask, the response is built at most once per
+// control tick and never touches the heap.
+#define STATUS_SECTION_SIZE 512
+#define STATUS_RESPONSE_SIZE 1280
+char statusConfig[STATUS_SECTION_SIZE], statusHot[STATUS_SECTION_SIZE];
+char statusResponse[STATUS_RESPONSE_SIZE];
+size_t statusConfigLength = 0, statusResponseLength = 0;
+uint32_t statusConfigVersion = 1; // bumped whenever a config field changes
+uint32_t statusBuiltConfig = 0, statusBuiltState = 0; // versions the cached response was built from
 
 // ---------------- Thermistor Settings and Values ----------------
-// which analog pin to connect
-// WARNING: Use ADC1 (GPIO 32 to 39) on ESP32, as ADC2 is used by WiFi and Bluetooth.
-#define THERMISTORPIN 32      
-// resistance at 25 degrees C
-#define THERMISTORNOMINAL 100000      
-// temp. for nominal resistance (almost always 25 C)
-#define TEMPERATURENOMINAL 25   
+// pin and divider values live in Board.h
 // how many samples to take and average, more takes longer
 // but is more 'smooth'
 #define NUMSAMPLES 50
-// The beta coefficient of the thermistor (usually 3000-4000)
-#define BCOEFFICIENT 4267
-// the value of the 'other' resistor
-#define SERIESRESISTOR 5450    
-// for ESP32, the ADC max value is 4095 (12-bit resolution)
-#define ADC_MAX_VALUE 4095 
-
-// milliseconds between samples
+// window of the median filter, odd so the median is an actual sample
+#define MEDIANSAMPLES 9
+// filter used until one is stored with the settings: FILTER_AVERAGE, FILTER_EMA or FILTER_MEDIAN
+// (set with the serial command "setFilter" or POST /config)
+#ifndef THERMISTOR_FILTER
+#define THERMISTOR_FILTER FILTER_AVERAGE
+#endif
+// smoothing factor of the EMA filter, 2 / (NUMSAMPLES + 1) matches the average
+#define EMA_ALPHA 0.04
+
+// milliseconds between samples, paced by a hardware timer (see Acquisition.h)
 int timeBetweenSamples = 10; 
-// stores the samples
-int samples[NUMSAMPLES], average = 0;
-// current zero index in the samples array
-uint8_t sampleIndex = 0;
-// last time we sampled the thermistor
+// filters the raw samples
+SampleFilter<NUMSAMPLES, MEDIANSAMPLES> thermistorFilter(THERMISTOR_FILTER, EMA_ALPHA);
+FilterMode filterMode = THERMISTOR_FILTER; // UI task, posted with CMD_SET_FILTER
+float filterAlpha = EMA_ALPHA;             // as filterMode
+// filtered ADC value, keeps the fractional part of the average
+float average = 0;
+// timestamp of the newest sample in microseconds
 ulong lastSampleTime = 0;
 // last temperature in Celsius
 float lastTemperature = 0;
-// last calculated resistance in Ohms
-float resistance = 0;
+// thermistor curve, precomputed at boot so no log() is needed per sample
+ThermistorParams thermistorParams;
+ThermistorTable thermistorTable;
 
 // ---------------- PID Settings and Values----------------
-#define RELAYPIN 23 // pin to control the relay
-#define STOPBTN 34
-#define STARTBTN 35
-
 unsigned long timeSinceReflowStarted, reflowStarted;
 
-unsigned long timeTempCheck = 250; 
-unsigned long lastTimeTempCheck = 0;
-
-double 
-  preheatTemp = 100, 
-  soakTemp = 150, 
-  reflowTemp = 230, 
-  cooldownTemp = 25;
-
-unsigned long 
-  preheatTime = 120000, 
-  soakTime = 60000, 
-  reflowTime = 120000, 
-  cooldownTime = 120000, 
-  totalTime = preheatTime + soakTime + reflowTime + cooldownTime;
-
-bool 
-  preheating = false, 
-  soaking = false, 
-  reflowing = false, 
-  coolingDown = false, 
-  newState = false,
-  start = false;
+unsigned long timeTempCheck = 250; // PID period in milliseconds
+// the last computation, published with the state so the UI task prints it as temp,setpoint,output
+uint32_t pidComputations = 0; // since boot
+float pidTemperature = 0;
+double pidSetpoint = 0, pidOutput = 0;
+
+// The profile as a table of segments (lib/ProfileEngine), by default the four
+// phases of a leaded profile: each holds its temperature for its time, the move
+// to it at its rate in C/s (0 steps) is part of that time.
+ProfileSegment profileSegments[PROFILE_MAX_SEGMENTS] = {
+  {SEGMENT_HOLD, PHASE_PREHEAT, 0, 100, 0, 120000},
+  {SEGMENT_HOLD, PHASE_SOAK, 0, 150, 0, 60000},
+  {SEGMENT_HOLD, PHASE_REFLOW, 0, 230, 0, 120000},
+  {SEGMENT_HOLD, PHASE_COOLDOWN, 0, 25, 0, 120000},
+};
+uint8_t profileSegmentCount = 4;
+
+// a run starts from the oven temperature, the planned length shown before one assumes this
+#define PLAN_START_TEMP 25
+
+unsigned long totalTime = 420000; // ms, planned length of the profile, see PlannedTime()
+
+// set by the control task only, read everywhere
+std::atomic<bool> start(false);
 
 double Input, Output, Setpoint; // PID variables
 
 // tune following this guide: https://tlk-energy.de/blog-en/practical-pid-tuning-guide
 double Kp=0.05, Ki=0, Kd=0.005, bias = 0;
 
+// computes in float on the FPU, the variables stay double (PID_NUMERIC in PID_v1.h)
 PID myPID(&Input, &Output, &Setpoint, Kp, Ki, Kd, DIRECT);
 
-// Slow PWM Settings and Values
-#define PWM_PERIOD 500 // frequency of the PWM signal
+// ---------------- Heater ----------------
+// HandleHeater() turns Output into the relay state once per half cycle of the
+// mains (lib/HeaterModulator). Bursts of whole half cycles deliver any Output
+// on average, the energy the last ones gave too much or too little is carried
+// over; the minimum on and off times keep the relay from switching faster.
+// "setHeater pwm" goes back to the slow PWM of earlier firmware: Output
+// truncated to PWM_STEPS levels over PWM_PERIOD.
+#define HEATER_SLOT_US (1000000UL / (2 * MAINS_HZ)) // a half cycle
+#define HEATER_MIN_ON_MS 250
+#define HEATER_MIN_OFF_MS 250
+#define PWM_PERIOD 500 // ms, of the slow PWM
 #define PWM_STEPS 10
 
-unsigned long lastPeriod = 0; // last time the PWM signal was updated
-unsigned long dutyCycleStep = PWM_PERIOD / PWM_STEPS; // how much to increase the duty cycle each step
-unsigned long dutyCycle = 0; // current duty cycle in milliseconds
+HeaterModulator heater; // control task only
+HeaterMode heaterMode = HEATER_BURST; // UI task, posted with CMD_SET_HEATER
+uint32_t heaterMinOn = HEATER_MIN_ON_MS, heaterMinOff = HEATER_MIN_OFF_MS; // ms, as heaterMode
+
+// milliseconds as half cycles of the mains, at least one
+uint16_t HeaterSlots(uint32_t ms) {
+  uint64_t slots = ((uint64_t)ms * 1000 + HEATER_SLOT_US / 2) / HEATER_SLOT_US;
+  return slots ? (uint16_t)(slots < UINT16_MAX ? slots : UINT16_MAX) : 1;
+}
+
+// ---------------- Autotune ----------------
+// The serial command "autotune [setpoint] [rule]" and POST /autotune run a relay
+// feedback test (lib/RelayAutotune) instead of a profile: the heater is fully
+// on below the setpoint and off above it through HandleHeater(), and the
+// period and amplitude of the oscillation that follows give the PID gains.
+// The UI task takes them over like "setPID" once the test is done. The
+// Ziegler-Nichols rule is the default: the PID resets its integral beyond
+// 10 C of error, the softer rules give too little Kp to get that close at
+// reflow temperatures.
+#define AUTOTUNE_SETPOINT 150 // C, default
+#define AUTOTUNE_MIN_SETPOINT 50
+#define AUTOTUNE_MAX_SETPOINT 250
+#define AUTOTUNE_HYSTERESIS 1 // C, several times the noise of the filtered temperature
+float autotuneSetpoint = AUTOTUNE_SETPOINT; // UI task, posted with CMD_AUTOTUNE
+TuneRule autotuneRule = TUNE_CLASSIC;
+uint32_t autotunesApplied = 0; // results the UI task has taken over
+
+// ---------------- Control Task ----------------
+// Everything that drives the relay runs in ControlTick() on its own core (see
+// Tasks.h). The web server, buttons, display and serial console run in UiTick()
+// and never change the run directly, they post commands through a lock-free
+// ring that the control task drains at the start of every tick.
+#define MAX_SAFE_TEMP 300 // a run is aborted above this temperature
+#define THERMISTOR_OPEN_MARGIN 20 // ADC counts below full scale that count as an open thermistor
+
+enum ControlCommandType { CMD_START, CMD_AUTOTUNE, CMD_STOP, CMD_SET_TUNINGS, CMD_SET_FILTER, CMD_SET_HEATER, CMD_REPORT_SCHEDULE, CMD_RESET_SCHEDULE };
+
+// profile and PID gains a run uses, copied when it starts so edits made
+// from the UI side can never reach a running oven halfway through
+struct RunSettings {
+  ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+  uint8_t segmentCount;
+  uint32_t plannedTime; // ms, PlannedTime() of the segments
+  double kp, ki, kd;
+};
+
+struct ControlCommand {
+  ControlCommandType type;
+  RunSettings settings; // CMD_START, CMD_SET_TUNINGS
+  FilterMode filter;    // CMD_SET_FILTER
+  float alpha;          // CMD_SET_FILTER
+  float tuneSetpoint;   // CMD_AUTOTUNE
+  TuneRule tuneRule;    // CMD_AUTOTUNE
+  HeaterMode heaterMode; // CMD_SET_HEATER
+  uint16_t minOnSlots, minOffSlots; // CMD_SET_HEATER, half cycles
+};
+
+SpscRing<ControlCommand, 8> controlCommands; // UI task -> control task
+RunSettings run; // settings of the active run, owned by the control task
+ProfileEngine engine; // setpoint and segment of the active run, loaded from run when it starts
+RelayAutotune autotune; // drives the relay instead of the PID while tuning
+bool tuning = false; // the active run is an autotune
+uint32_t autotunes = 0; // completed since boot, tuneResult holds the last one
+TuneResult tuneResult;
+const char *safetyFault = ""; // why the last run was aborted, empty if it was not
+uint32_t aborts = 0; // runs aborted since boot
+bool abortedTune = false; // the last aborted run was an autotune
+
+Seqlock<ReflowState> reflowState; // published by the control task once per tick
+
+// The control task never prints: the serial port blocks once its buffer is
+// full. What it has to say goes into the state snapshot (PID computations,
+// aborts) or, for "schedule", into a snapshot of its scheduler statistics,
+// and HandleControlLog() prints it from the UI task.
+#define CONTROLLOG_POLL_MS 50 // more often than the PID computes
+uint32_t pidLogged = 0, abortsLogged = 0, scheduleLogged = 0; // printed so far, UI task
+bool startPressed = false, stopPressed = false; // the buttons at the last UI pass, a press acts once
+
+// ---------------- Run log ----------------
+// Every run is also kept on LittleFS (lib/RunLog). The UI task copies the new
+// History samples into the log once a second, so the control task never waits
+// for the flash. GET /runs lists the stored runs, GET /runs/<id>.csv exports
+// one, generated while it is sent.
+#define RUNLOG_PERIOD_MS 1000
+#define RUNLOG_MAX_EXPORTS 2 // CSV downloads at the same time
+size_t RunLogFreeSpace() { return LittleFS.totalBytes() - LittleFS.usedBytes(); }
+RunLogWriter runLog(LittleFS, RunLogFreeSpace);
+uint32_t loggedRun = 0, loggedSamples = 0; // History run and samples already in the log
+bool loggedRunSeen = false; // the logged run was seen running, so its end can close the log
+RunSettings startSettings; // what the last START was posted with, for the log header
+String startProfileName;
+
+// a CSV export in progress, the server releases it when the download ends
+class RunExport : public HttpContent
+{
+  public:
+    RunExport() : busy(false) {}
+    size_t Read(char *buffer, size_t size) override { return reader.ReadCsv(buffer, size); }
+    void Release() override {
+      reader.Close();
+      busy = false;
+    }
+
+    RunLogReader reader;
+    bool busy;
+};
+RunExport runExports[RUNLOG_MAX_EXPORTS];
 
 // ---------------------- Display Settings----------------------------
 SSD1306Wire display(0x3c, 16, 17); // I2C address, SDA, SCL pins
-unsigned long lastRefresh, refreshTime = 100;
+unsigned long refreshTime = 100;
+
+// ---------------- Schedules ----------------
+// Periodic work runs from a Scheduler on a fixed grid instead of comparing
+// millis() against a timestamp, so periods do not stretch by the loop latency.
+// Each task keeps lateness and deadline-miss statistics (serial "schedule").
+uint32_t SchedulerMicros() { return micros(); }
+
+Scheduler controlScheduler(SchedulerMicros); // run by ControlTick()
+Scheduler uiScheduler(SchedulerMicros);      // run by UiTick()
+int pidTask = -1, heaterTask = -1;
+
+// the statistics of a scheduler, ready to print
+struct ScheduleReport {
+  uint8_t count;
+  TaskReport tasks[SCHEDULER_MAX_TASKS];
+};
+Seqlock<ScheduleReport> controlSchedule; // written by the control task on CMD_REPORT_SCHEDULE
+
+// ---------------- Profiling ----------------
+// Built with -D PROFILER every probe counts calls and total/max CPU cycles of
+// its handler, served at /metrics (Prometheus text format) and by the serial
+// command "stats". Without the flag the probes compile to nothing.
+PROFILE_PROBE(probeControlTick, "control_tick");
+PROFILE_PROBE(probeThermistor, "thermistor");
+PROFILE_PROBE(probeProfile, "profile");
+PROFILE_PROBE(probePID, "pid");
+PROFILE_PROBE(probeHeater, "heater");
+PROFILE_PROBE(probeUiLoop, "ui_loop");
+PROFILE_PROBE(probeHttp, "handle_client");
+PROFILE_PROBE(probeButtons, "buttons");
+PROFILE_PROBE(probeDisplay, "display");
+PROFILE_PROBE(probeSerial, "serial");
+PROFILE_PROBE(probeJson, "json");
+PROFILE_PROBE(probeTelemetry, "telemetry");
+PROFILE_PROBE(probeStatus, "status");
+PROFILE_PROBE(probeHistory, "history");
+PROFILE_PROBE(probeRunLog, "run_log");
+
+unsigned long metricsSince = 0; // millis() of the last "stats reset", loop frequencies count from here
 
 
 // ---------------- Function prototypes ----------------
 void SaveSettings();
 void LoadSettings();
-void PutString(int adr, String str);
-String GetString(int adr);
+bool LoadLegacySettings();
+void ConvertSettings(const StoredSettingsV1 &settings);
+void ConvertSettings(const StoredSettingsV2 &settings);
+uint32_t PlannedTime(const ProfileSegment *segments, uint8_t count);
+void PackSettings(StoredSettings &settings);
+void UnpackSettings(const StoredSettings &settings);
+void HandleSettings();
 
 void SetupFS();
 void SetupAP();
 void SetupPID();
+void SetupThermistor();
 void SetupDisplay();
+void SetupSchedule();
+
+bool PostCommand(ControlCommandType type);
+String CheckProfile();
+void HandleCommands();
+void BeginRun();
+void StopReflow();
+void PublishState();
 
 void HandleButtons();
 void HandleDisplay();
+void HandleTelemetry();
+void EncodeTelemetry(bool full);
+void HandleRunLog();
+void OpenRunLog();
 void HandlePID();
-void HandleSlowPWM();
+void HandleControlLog();
+void AbortRun(const char *fault);
+void HandleProfile();
+void HandleSafety();
+void HandleHeater();
 void HandleThermistor();
 void CalculateTemperature();
-void UpdateProfileList();
+String StartAutotune(float setpoint, const char *rule);
+void HandleAutotune();
+void TuneGains(const TuneResult &result, double &kp, double &ki, double &kd);
+void ScanProfiles();
+void MigrateProfiles();
+bool ProfileFromJson(JsonDocument &doc, const String &name, ProfileRecord &record);
+String SegmentsFromJson(JsonVariant array, ProfileSegment *segments, uint8_t &count);
+void SegmentsToJson(const ProfileSegment *segments, uint8_t count, JsonArray array);
+void ProfileToJson(const ProfileRecord &record, JsonDocument &doc);
+ProfileSummary SummaryOf(const ProfileRecord &record, int32_t slot);
+int StoreProfile(ProfileRecord &record, bool replace);
 void HandleSerialCommands();
+ScheduleReport ReportSchedule(const Scheduler &scheduler);
+void PrintSchedule(const char *side, const ScheduleReport &report);
+void PrintStats();
 
 void OnConnect();
+void LoadAssets();
+bool ServeAsset(const String &path);
 void SetProfileValues();
 void SetPIDValues();
+void GetConfig();
+void SetConfig();
+String ApplyConfig(JsonDocument &doc, StoredSettings &next, bool &setFilter);
+void SendConfig();
 void GetProfiles();
 void SaveProfile();
 void DeleteProfile();
 void LoadProfile();
+void ImportProfile();
+void ExportProfile();
+void GetAutotune();
+void PostAutotune();
+void SendAutotune(bool posted = false);
 void GetStatus();
+void BuildStatus();
+void GetMetrics();
+void SubscribeEvents();
+void GetHistory();
+void GetRuns();
+bool ExportRun(const String &path);
 void NotFound();
 
 
@@ -169,22 +473,41 @@ void NotFound();
 void setup() {
   Serial.begin(115200);
 
-  Serial.println("First Run Flag: " + String(EEPROM.read(EEPROM_FIRST_RUN)));
-
   LoadSettings();
+  SetupThermistor();
   SetupFS();
   SetupAP();
   SetupPID();
   SetupDisplay();
+  SetupSchedule();
+  PublishState(); // readers get a valid snapshot before the first control tick
+  StartTasks(); // does not return on the ESP32, loop() is replaced by the two tasks
 }
 
 void loop() {
-  server.handleClient(); // handle incoming client requests
-  HandleButtons();
-  HandleDisplay();
-  HandlePID();
-  HandleSlowPWM();
+  UiTick();
+}
+
+// Control task body, runs every CONTROL_PERIOD_MS
+void ControlTick() {
+  PROFILE_SCOPE(probeControlTick);
+  HandleCommands();
   HandleThermistor();
+  HandleSafety();
+  HandleProfile();
+  controlScheduler.Run(); // PID and heater
+  PublishState();
+}
+
+// UI task body, runs whenever the control task is idle
+void UiTick() {
+  PROFILE_SCOPE(probeUiLoop);
+  {
+    PROFILE_SCOPE(probeHttp);
+    server.handleClient(); // handle incoming client requests
+  }
+  HandleButtons();
+  uiScheduler.Run(); // display
   HandleSerialCommands();
 }
 
@@ -192,76 +515,148 @@ void loop() {
 // |                     Function Definitions                        |
 // ===================================================================
 
-// Save the current settings to EEPROM
+// Stage the current settings, HandleSettings() writes them once they stop changing
 void SaveSettings() {
-  Serial.println("Saving settings to EEPROM...");
-  EEPROM.begin(512); // initialize EEPROM with size 512 bytes
-
-  EEPROM.put(EEPROM_PREHEAT_TEMP_ADDR, preheatTemp);
-  EEPROM.put(EEPROM_PREHEAT_TIME_ADDR, preheatTime);
-  EEPROM.put(EEPROM_SOAK_TEMP_ADDR, soakTemp);
-  EEPROM.put(EEPROM_SOAK_TIME_ADDR, soakTime);
-  EEPROM.put(EEPROM_REFLOW_TEMP_ADDR, reflowTemp);
-  EEPROM.put(EEPROM_REFLOW_TIME_ADDR, reflowTime);
-  EEPROM.put(EEPROM_COOLDOWN_TEMP_ADDR, cooldownTemp);
-  EEPROM.put(EEPROM_COOLDOWN_TIME_ADDR, cooldownTime);
+  totalTime = PlannedTime(profileSegments, profileSegmentCount);
+  statusConfigVersion++; // everything that changes the config is saved through here
 
-  totalTime = preheatTime + soakTime + reflowTime + cooldownTime; // update total time
-
-  EEPROM.put(EEPROM_KP_ADDR, Kp);
-  EEPROM.put(EEPROM_KI_ADDR, Ki);
-  EEPROM.put(EEPROM_KD_ADDR, Kd);
-
-  PutString(EEPROM_LASTPROFILE_NAME_ADDR, CurrentProfileName);
-  EEPROM.commit(); // save changes to EEPROM
-  Serial.println("Settings saved successfully");
+  PackSettings(storedSettings);
+  settingsStore.Changed(millis());
 }
 
-// Load the settings from EEPROM
+// Load the settings from the settings store, on the first boot with it from the
+// EEPROM of older firmware, and keep the defaults when there are none
 void LoadSettings() {
-  Serial.println("Loading settings from EEPROM...");
-  EEPROM.begin(512); // initialize EEPROM with size 64 bytes
-
-  EEPROM.get(EEPROM_PREHEAT_TEMP_ADDR, preheatTemp);
-  EEPROM.get(EEPROM_PREHEAT_TIME_ADDR, preheatTime);
-  EEPROM.get(EEPROM_SOAK_TEMP_ADDR, soakTemp);
-  EEPROM.get(EEPROM_SOAK_TIME_ADDR, soakTime);
-  EEPROM.get(EEPROM_REFLOW_TEMP_ADDR, reflowTemp);
-  EEPROM.get(EEPROM_REFLOW_TIME_ADDR, reflowTime);
-  EEPROM.get(EEPROM_COOLDOWN_TEMP_ADDR, cooldownTemp);
-  EEPROM.get(EEPROM_COOLDOWN_TIME_ADDR, cooldownTime);
-
-  totalTime = preheatTime + soakTime + reflowTime + cooldownTime; // update total time
-
-  EEPROM.get(EEPROM_KP_ADDR, Kp);
-  EEPROM.get(EEPROM_KI_ADDR, Ki);
-  EEPROM.get(EEPROM_KD_ADDR, Kd);
+  if (settingsStore.Begin()) {
+    storedSettings.profileName[PROFILE_NAME_SIZE - 1] = 0;
+    UnpackSettings(storedSettings);
+    Serial.println("Settings loaded, written " + String(settingsStore.Sequence()) + " times");
+  } else {
+    StoredSettingsV2 previous;
+    StoredSettingsV1 older;
+    if (settingsStore.ReadVersion(2, &previous, sizeof(previous))) {
+      previous.profileName[PROFILE_NAME_SIZE - 1] = 0;
+      ConvertSettings(previous);
+      Serial.println("Settings converted, the filter is stored with them now");
+    }
+    else if (settingsStore.ReadVersion(1, &older, sizeof(older))) {
+      older.profileName[PROFILE_NAME_SIZE - 1] = 0;
+      ConvertSettings(older);
+      Serial.println("Settings converted to profile segments");
+    }
+    else if (LoadLegacySettings()) Serial.println("Settings migrated from EEPROM");
+    else Serial.println("No stored settings, using the defaults");
+    PackSettings(storedSettings);
+    settingsStore.Commit(); // the next boot finds them
+  }
 
+  totalTime = PlannedTime(profileSegments, profileSegmentCount);
   myPID.SetTunings(Kp, Ki, Kd);
+  thermistorFilter.SetMode(filterMode); // the control task does not run yet
+  thermistorFilter.SetAlpha(filterAlpha);
+}
+
+// planned length of a profile, shown before a run and in the profile list
+uint32_t PlannedTime(const ProfileSegment *segments, uint8_t count) {
+  return ProfileEngine::PlannedDuration(segments, count, PLAN_START_TEMP);
+}
 
-  CurrentProfileName = GetString(EEPROM_LASTPROFILE_NAME_ADDR);
+// Takes over the settings of firmware with the four fixed phases
+void ConvertSettings(const StoredSettingsV1 &settings) {
+  const float temps[4] = {(float)settings.preheatTemp, (float)settings.soakTemp,
+                          (float)settings.reflowTemp, (float)settings.cooldownTemp};
+  const uint32_t times[4] = {settings.preheatTime, settings.soakTime, settings.reflowTime, settings.cooldownTime};
+  profileSegmentCount = ProfileEngine::FromPhases(temps, times, settings.rampRate, settings.coolRate, profileSegments);
+  Kp = settings.kp;
+  Ki = settings.ki;
+  Kd = settings.kd;
+  CurrentProfileName = settings.profileName;
+}
 
-  Serial.println("Settings loaded successfully");
+// Takes over the settings of firmware that did not store the filter, which keeps its default
+void ConvertSettings(const StoredSettingsV2 &settings) {
+  Kp = settings.kp;
+  Ki = settings.ki;
+  Kd = settings.kd;
+  CurrentProfileName = settings.profileName;
+  profileSegmentCount = settings.segmentCount <= PROFILE_MAX_SEGMENTS ? settings.segmentCount : PROFILE_MAX_SEGMENTS;
+  memcpy(profileSegments, settings.segments, profileSegmentCount * sizeof(ProfileSegment));
 }
 
-void PutString(int adr, String str){
-  uint8_t len = str.length();
-  EEPROM.write(adr, len);
-  for (int i = 0; i < len; i++){
-    EEPROM.write(adr+1+i, str[i]);
+// Reads the settings of older firmware, false when the EEPROM does not hold any
+bool LoadLegacySettings() {
+  EEPROM.begin(512);
+
+  // EEPROM.get() overwrites all of them, zeroed so no path can read garbage
+  double temps[4] = {0, 0, 0, 0}, rates[2] = {0, 0}, tunings[3] = {0, 0, 0};
+  unsigned long times[4] = {0, 0, 0, 0};
+  EEPROM.get(EEPROM_PREHEAT_TEMP_ADDR, temps[0]);
+  EEPROM.get(EEPROM_SOAK_TEMP_ADDR, temps[1]);
+  EEPROM.get(EEPROM_REFLOW_TEMP_ADDR, temps[2]);
+  EEPROM.get(EEPROM_COOLDOWN_TEMP_ADDR, temps[3]);
+  EEPROM.get(EEPROM_PREHEAT_TIME_ADDR, times[0]);
+  EEPROM.get(EEPROM_SOAK_TIME_ADDR, times[1]);
+  EEPROM.get(EEPROM_REFLOW_TIME_ADDR, times[2]);
+  EEPROM.get(EEPROM_COOLDOWN_TIME_ADDR, times[3]);
+  EEPROM.get(EEPROM_KP_ADDR, tunings[0]);
+  EEPROM.get(EEPROM_KI_ADDR, tunings[1]);
+  EEPROM.get(EEPROM_KD_ADDR, tunings[2]);
+  EEPROM.get(EEPROM_RAMP_RATE_ADDR, rates[0]);
+  EEPROM.get(EEPROM_COOL_RATE_ADDR, rates[1]);
+
+  // a fresh EEPROM reads as zeros (or 0xFF), neither is a profile
+  for (int i = 0; i < 4; i++) {
+    if (!(temps[i] > 0 && temps[i] < 500)) return false;
   }
+  if (times[0] == 0 || times[2] == 0 || !(tunings[0] > 0 && tunings[0] < 1e6)) return false;
+
+  const float phaseTemps[4] = {(float)temps[0], (float)temps[1], (float)temps[2], (float)temps[3]};
+  const uint32_t phaseTimes[4] = {(uint32_t)times[0], (uint32_t)times[1], (uint32_t)times[2], (uint32_t)times[3]};
+  // written by firmware without ramps these read as NaN, those profiles step
+  profileSegmentCount = ProfileEngine::FromPhases(phaseTemps, phaseTimes, rates[0] >= 0 ? rates[0] : 0,
+                                                  rates[1] >= 0 ? rates[1] : 0, profileSegments);
+  Kp = tunings[0], Ki = tunings[1], Kd = tunings[2];
+
+  int length = EEPROM.read(EEPROM_LASTPROFILE_NAME_ADDR);
+  char name[PROFILE_NAME_SIZE];
+  if (length >= PROFILE_NAME_SIZE) length = PROFILE_NAME_SIZE - 1;
+  for (int i = 0; i < length; i++) name[i] = (char)EEPROM.read(EEPROM_LASTPROFILE_NAME_ADDR + 1 + i);
+  name[length] = 0;
+  if (length) CurrentProfileName = name;
+  return true;
 }
 
-String GetString(int adr){
-  int len = EEPROM.read(adr);
-  char data[len+1];
+// Copies the settings into and out of the struct the settings store keeps, /config stages into one too
+void PackSettings(StoredSettings &settings) {
+  settings.kp = Kp;
+  settings.ki = Ki;
+  settings.kd = Kd;
+  // pads with zeros, a shorter name or profile leaves nothing behind that would differ
+  strncpy(settings.profileName, CurrentProfileName.c_str(), PROFILE_NAME_SIZE - 1);
+  settings.segmentCount = profileSegmentCount;
+  settings.filterMode = filterMode;
+  memset(settings.reserved, 0, sizeof(settings.reserved));
+  settings.filterAlpha = filterAlpha;
+  memset(settings.segments, 0, sizeof(settings.segments));
+  memcpy(settings.segments, profileSegments, profileSegmentCount * sizeof(ProfileSegment));
+}
 
-  for (int i=0; i < len; i++){
-    data[i] = (char)EEPROM.read(adr+1+i);
-  }
-  data[len] = '\0';
+void UnpackSettings(const StoredSettings &settings) {
+  Kp = settings.kp;
+  Ki = settings.ki;
+  Kd = settings.kd;
+  CurrentProfileName = settings.profileName;
+  profileSegmentCount = settings.segmentCount <= PROFILE_MAX_SEGMENTS ? settings.segmentCount : PROFILE_MAX_SEGMENTS;
+  memcpy(profileSegments, settings.segments, profileSegmentCount * sizeof(ProfileSegment));
+  filterMode = settings.filterMode <= FILTER_MEDIAN ? (FilterMode)settings.filterMode : THERMISTOR_FILTER;
+  filterAlpha = settings.filterAlpha > 0 && settings.filterAlpha <= 1 ? settings.filterAlpha : EMA_ALPHA;
+}
 
-  return String(data);
+// Writes the staged settings once they have settled, a burst of changes is one write
+void HandleSettings() {
+  if (settingsStore.Poll(millis())) {
+    Serial.println("Settings saved in " + String(settingsStore.LastMicros()) + " us");
+  }
 }
 
 // This functions mounts LittleFS
@@ -279,6 +674,39 @@ void SetupFS() {
   Serial.print(LittleFS.totalBytes());
   Serial.print(" (" + String((float)LittleFS.usedBytes() / (float)LittleFS.totalBytes() * 100, 2) + "%)");
   Serial.println(" bytes used");
+
+  LittleFS.mkdir(RUNLOG_DIR);
+  runLog.Begin();
+
+  LoadAssets();
+  ScanProfiles();
+}
+
+// This function reads the asset list written by tools/compress_assets.py
+void LoadAssets() {
+  File file = LittleFS.open("/static/assets.txt", "r");
+  if (!file) {
+    Serial.println("No asset list, serving /static uncompressed and uncached");
+    return;
+  }
+
+  assetCount = 0;
+  while (file.available() && assetCount < MAX_ASSETS) {
+    // <path> "<etag>" <gz|raw> <immutable|revalidate>
+    String line = file.readStringUntil('\n');
+    int space1 = line.indexOf(' ');
+    int space2 = line.indexOf(' ', space1 + 1);
+    int space3 = line.indexOf(' ', space2 + 1);
+    if (space1 < 0 || space2 < 0 || space3 < 0) continue;
+
+    Asset &asset = assets[assetCount++];
+    asset.path = line.substring(0, space1);
+    asset.etag = line.substring(space1 + 1, space2);
+    asset.gzip = line.substring(space2 + 1, space3) == "gz";
+    asset.immutable = line.substring(space3 + 1).startsWith("immutable");
+  }
+  file.close();
+  Serial.println("Loaded " + String(assetCount) + " static assets");
 }
 
 // This function initializes the Access Point and sets up the web server
@@ -290,36 +718,52 @@ void SetupAP() {
   Serial.print("AP IP address: ");
   Serial.println(IP);
 
-  server.serveStatic("/static", LittleFS, "/static");
+  // /static is served by NotFound() through ServeAsset(), which needs these request headers
+  static const char *assetHeaders[] = {"If-None-Match"};
+  server.collectHeaders(assetHeaders, 1);
   server.on("/", HTTP_GET, OnConnect);
   server.on("/setvalues", HTTP_POST, SetProfileValues);
   server.on("/setPIDvalues", HTTP_POST, SetPIDValues);
+  server.on("/config", HTTP_GET, GetConfig);
+  server.on("/config", HTTP_POST, SetConfig);
   server.on("/profiles", HTTP_GET, GetProfiles);
   server.on("/saveprofile", HTTP_POST, SaveProfile);
   server.on("/deleteprofile", HTTP_POST, DeleteProfile);
   server.on("/loadprofile", HTTP_POST, LoadProfile);
+  server.on("/importprofile", HTTP_POST, ImportProfile);
+  server.on("/exportprofile", HTTP_GET, ExportProfile);
   server.on("/status", HTTP_GET, GetStatus);
+  server.on("/metrics", HTTP_GET, GetMetrics);
+  server.on("/events", HTTP_GET, SubscribeEvents);
+  server.on("/history", HTTP_GET, GetHistory);
+  server.on("/runs", HTTP_GET, GetRuns);
+  server.on("/autotune", HTTP_GET, GetAutotune);
+  server.on("/autotune", HTTP_POST, PostAutotune);
 
   server.on("/start", HTTP_GET, []() {
-    start = true;
-    reflowStarted = millis();
+    // checked here too, the control task would only refuse it after this answer
+    String problem = CheckProfile();
+    if (problem.length()) {
+      server.send(400, "text/plain", problem);
+      return;
+    }
+    if (!PostCommand(CMD_START)) {
+      server.send(503, "text/plain", "Controller busy, try again");
+      return;
+    }
     server.send(200, "text/plain", "Reflow process started");
   });
 
   server.on("/stop", HTTP_GET, []() {
-    start = false;
-    reflowing = false;
-    coolingDown = false;
-    soaking = false;
-    preheating = false;
-    Output = 0; // stop the PID output
+    if (!PostCommand(CMD_STOP)) {
+      server.send(503, "text/plain", "Controller busy, try again");
+      return;
+    }
     server.send(200, "text/plain", "Reflow process stopped");
   });
 
   server.onNotFound(NotFound);
 
-  UpdateProfileList();
-
   server.begin();
 
   if (!MDNS.begin("tostireflow")) {
@@ -331,7 +775,7 @@ void SetupAP() {
 
 // This function sets up the PID controller
 void SetupPID(){
-  Setpoint = cooldownTemp;
+  Setpoint = PLAN_START_TEMP;
   // tell the PID to range between 0 and the full window size
   myPID.SetOutputLimits(0, 1);
 
@@ -341,6 +785,9 @@ void SetupPID(){
   myPID.SetMode(AUTOMATIC);
   myPID.SetIntegralBounds(-10, 10); // set integral bounds to prevent windup
 
+  heater.SetBurst(HeaterSlots(heaterMinOn), HeaterSlots(heaterMinOff));
+  heater.SetPwm(HeaterSlots(PWM_PERIOD), PWM_STEPS);
+
   pinMode(RELAYPIN, OUTPUT);
   pinMode(STOPBTN, INPUT_PULLUP);
   pinMode(STARTBTN, INPUT_PULLUP);
@@ -348,6 +795,41 @@ void SetupPID(){
   Output = 0; // initialize Output to 0
 }
 
+// This function builds the ADC to temperature lookup table from the values in Board.h
+void SetupThermistor(){
+#ifdef THERMISTOR_SH_A
+  thermistorParams.equation = THERMISTOR_STEINHART_HART;
+  thermistorParams.a = THERMISTOR_SH_A;
+  thermistorParams.b = THERMISTOR_SH_B;
+  thermistorParams.c = THERMISTOR_SH_C;
+#else
+  thermistorParams.equation = THERMISTOR_BETA;
+  thermistorParams.nominal = THERMISTORNOMINAL;
+  thermistorParams.nominalTemp = TEMPERATURENOMINAL;
+  thermistorParams.beta = BCOEFFICIENT;
+#endif
+  thermistorParams.seriesResistor = SERIESRESISTOR;
+  thermistorParams.adcMax = ADC_MAX_VALUE;
+
+  thermistorTable.Build(thermistorParams);
+
+  AcquisitionBegin(THERMISTORPIN, timeBetweenSamples * 1000UL);
+}
+
+// This function registers the periodic tasks of both sides
+// The PID skips computations it missed, the heater catches up so no half cycle is lost.
+void SetupSchedule() {
+  controlScheduler.SetTolerance(CONTROL_PERIOD_MS * 1000 / 2); // Run() is called every control tick
+  pidTask = controlScheduler.Add("pid", HandlePID, timeTempCheck * 1000, OVERRUN_SKIP);
+  heaterTask = controlScheduler.Add("heater", HandleHeater, HEATER_SLOT_US, OVERRUN_CATCH_UP);
+  uiScheduler.Add("display", HandleDisplay, refreshTime * 1000, OVERRUN_SKIP);
+  telemetryTask = uiScheduler.Add("telemetry", HandleTelemetry, telemetryPeriod * 1000, OVERRUN_SKIP);
+  uiScheduler.Add("runlog", HandleRunLog, RUNLOG_PERIOD_MS * 1000, OVERRUN_SKIP);
+  uiScheduler.Add("settings", HandleSettings, SETTINGS_POLL_MS * 1000, OVERRUN_SKIP);
+  uiScheduler.Add("autotune", HandleAutotune, SETTINGS_POLL_MS * 1000, OVERRUN_SKIP);
+  uiScheduler.Add("controllog", HandleControlLog, CONTROLLOG_POLL_MS * 1000, OVERRUN_SKIP);
+}
+
 void SetupDisplay() {
   if (!display.init()){
     Serial.println("SSD1306 display initialization failed!");
@@ -361,226 +843,558 @@ void SetupDisplay() {
   display.display();
 }
 
+// This function queues a command for the control task, with a snapshot of the current settings
+// Returns false when the queue is full and the command was dropped.
+bool PostCommand(ControlCommandType type) {
+  ControlCommand command;
+  command.type = type;
+  memcpy(command.settings.segments, profileSegments, sizeof(profileSegments));
+  command.settings.segmentCount = profileSegmentCount;
+  command.settings.plannedTime = PlannedTime(profileSegments, profileSegmentCount);
+  command.settings.kp = Kp;
+  command.settings.ki = Ki;
+  command.settings.kd = Kd;
+  command.filter = filterMode;
+  command.alpha = filterAlpha;
+  command.tuneSetpoint = autotuneSetpoint;
+  command.tuneRule = autotuneRule;
+  command.heaterMode = heaterMode;
+  command.minOnSlots = HeaterSlots(heaterMinOn);
+  command.minOffSlots = HeaterSlots(heaterMinOff);
+  if (!controlCommands.Push(command)) {
+    Serial.println("Control command queue full, command dropped");
+    return false;
+  }
+
+  // the control task only starts the run later, the UI task logs it with these
+  if (type == CMD_START) {
+    startSettings = command.settings;
+    startProfileName = CurrentProfileName;
+  } else if (type == CMD_AUTOTUNE) {
+    // logged like a run, with the gains it started from and no segments
+    startSettings = command.settings;
+    startSettings.segmentCount = 0;
+    startProfileName = "Autotune " + String(autotuneSetpoint, 0) + " C " + RelayAutotune::RuleName(autotuneRule);
+  }
+  return true;
+}
+
+// This function checks the current profile the way the control task loads it, returns what is wrong or ""
+String CheckProfile() {
+  if (profileSegmentCount == 0 || profileSegmentCount > PROFILE_MAX_SEGMENTS) {
+    return "The profile must have 1 to " + String(PROFILE_MAX_SEGMENTS) + " segments";
+  }
+  for (uint8_t i = 0; i < profileSegmentCount; i++) {
+    const ProfileSegment &segment = profileSegments[i];
+    if (ProfileEngine::Valid(segment)) continue;
+    String which = "Segment " + String(i + 1) + " of the profile";
+    return which + (segment.type == SEGMENT_RAMP && segment.rate == 0 ? " is a ramp without a rate" : " is invalid");
+  }
+  return "";
+}
+
+// This function runs the commands posted by the UI task, in the control task
+// A start is ignored while a run is active, so a held button cannot restart it.
+void HandleCommands() {
+  ControlCommand command;
+
+  while (controlCommands.Pop(command)) {
+    switch (command.type) {
+      case CMD_START:
+        if (start) break;
+        run = command.settings;
+        if (!engine.Load(run.segments, run.segmentCount)) {
+          safetyFault = "Invalid profile";
+          break;
+        }
+        engine.Start(lastTemperature); // the first segment moves from where the oven is
+        myPID.SetTunings(run.kp, run.ki, run.kd);
+        BeginRun();
+        break;
+      case CMD_AUTOTUNE:
+        if (start) break;
+        run = command.settings;
+        autotune.Begin(command.tuneSetpoint, AUTOTUNE_HYSTERESIS, 0, 1, command.tuneRule);
+        tuning = true;
+        BeginRun();
+        break;
+      case CMD_STOP:
+        StopReflow();
+        break;
+      case CMD_SET_TUNINGS:
+        run.kp = command.settings.kp;
+        run.ki = command.settings.ki;
+        run.kd = command.settings.kd;
+        myPID.SetTunings(run.kp, run.ki, run.kd);
+        break;
+      case CMD_SET_FILTER:
+        thermistorFilter.SetMode(command.filter);
+        thermistorFilter.SetAlpha(command.alpha);
+        break;
+      case CMD_SET_HEATER:
+        // a new mode starts from nothing owed, in a run too
+        if (command.heaterMode != heater.Mode()) heater.SetMode(command.heaterMode);
+        heater.SetBurst(command.minOnSlots, command.minOffSlots);
+        break;
+      case CMD_REPORT_SCHEDULE:
+        controlSchedule.Write(ReportSchedule(controlScheduler)); // printed by the UI task
+        break;
+      case CMD_RESET_SCHEDULE:
+        controlScheduler.ResetStats();
+        break;
+    }
+  }
+}
+
+// This function starts the history and the schedule of a run or an autotune, control task only
+void BeginRun() {
+  safetyFault = "";
+  reflowStarted = millis();
+  history.Clear();
+  start = true;
+  // first PID computation and heater slot begin with the run, not wherever the grid was,
+  // with nothing owed from the last run
+  controlScheduler.Restart(pidTask);
+  controlScheduler.Restart(heaterTask);
+  heater.Reset();
+}
+
+// This function ends the run with a fault, control task only
+// The UI task prints the reason once it sees the abort in the state.
+void AbortRun(const char *fault) {
+  safetyFault = fault;
+  abortedTune = tuning;
+  aborts++;
+  StopReflow();
+}
+
+// This function ends the run and turns the heater off, control task only
+void StopReflow() {
+  start = false;
+  engine.Stop();
+  autotune.Stop();
+  tuning = false;
+  Output = 0; // stop the PID output
+  digitalWrite(RELAYPIN, LOW);
+}
+
+// This function publishes the control state for the UI task, once per control tick
+// The control task never waits here, readers copy whichever buffer is stable.
+// Only what the control task owns goes in, the profile of the last run rather
+// than the one the UI is editing.
+void PublishState() {
+  ReflowState state;
+  state.time = millis();
+  state.running = start;
+  bool profile = start && !tuning;
+  state.phase = profile ? engine.Phase() : PHASE_IDLE;
+  state.waiting = profile && engine.State() == ENGINE_WAITING;
+  state.segment = profile ? engine.Index() : 0;
+  state.segments = profile ? engine.Count() : run.segmentCount;
+  state.target = profile ? engine.Segment(engine.Index()).target : tuning ? autotune.Setpoint() : 0;
+  state.tuning = start && tuning;
+  state.tuneCycles = state.tuning ? autotune.Cycles() : 0;
+  state.autotunes = autotunes;
+  state.tune = tuneResult;
+  state.filter = thermistorFilter.Mode();
+  state.filterAlpha = thermistorFilter.Alpha();
+  state.temperature = lastTemperature;
+  state.adcAverage = average;
+  state.setpoint = Setpoint;
+  state.output = Output;
+  state.elapsed = start ? timeSinceReflowStarted : 0;
+  // an autotune takes as long as the oven needs to settle into its cycle
+  state.totalTime = profile ? engine.Duration(timeSinceReflowStarted) : start ? timeSinceReflowStarted : run.plannedTime;
+  state.droppedSamples = AcquisitionDropped();
+  state.pidComputations = pidComputations;
+  state.pidTemperature = pidTemperature;
+  state.pidSetpoint = pidSetpoint;
+  state.pidOutput = pidOutput;
+  state.fault = safetyFault;
+  state.aborts = aborts;
+  state.abortedTune = abortedTune;
+
+  reflowState.Write(state);
+}
+
+ReflowState GetReflowState(uint32_t *version) {
+  ReflowState state;
+  uint32_t v = reflowState.Read(state);
+  if (version) *version = v;
+  return state;
+}
+
 // This function handles the button presses for starting and stopping the reflow process
-// No debouncing is required as the boolean flags only allow one press to be registered at a time.
+// A press acts once, when the button goes down, and a start is checked like
+// /start. No debouncing is required as the control task ignores repeated
+// starts and stops.
 void HandleButtons() {
-  if (digitalRead(STOPBTN) == LOW) {
-    if (start) {
-      Serial.println("Stopping reflow process.");
-      reflowing = false;
-      coolingDown = false;
-      soaking = false;
-      preheating = false;
-      start = false;
-      
-      Output = 0; // stop the PID output
-    }
+  PROFILE_SCOPE(probeButtons);
+  bool stopDown = digitalRead(STOPBTN) == LOW;
+  bool startDown = digitalRead(STARTBTN) == LOW;
+  bool stopPress = stopDown && !stopPressed, startPress = startDown && !startPressed;
+  stopPressed = stopDown;
+  startPressed = startDown;
+  if (!stopPress && !startPress) return;
+
+  bool running = GetReflowState().running;
+  if (stopPress && running) {
+    Serial.println("Stopping reflow process.");
+    PostCommand(CMD_STOP);
   }
 
-  if (digitalRead(STARTBTN) == LOW) {
-    if (!start) {
+  if (startPress && !running) {
+    String problem = CheckProfile();
+    if (problem.length()) {
+      Serial.println("Reflow not started: " + problem);
+    } else if (PostCommand(CMD_START)) {
       Serial.println("Starting reflow process.");
-      start = true;
-      reflowStarted = millis();
     }
   }
 }
 
-void HandleDisplay(){
-  if (millis() - lastRefresh < refreshTime){
-    return;
+// This function pushes the status to the /events subscribers, one encoding for all of them
+void HandleTelemetry(){
+  if (!telemetryClients.Count()) return;
+
+  PROFILE_SCOPE(probeTelemetry);
+
+  // established subscribers only get what changed since the last event
+  if (telemetryClients.HasEstablished()) {
+    EncodeTelemetry(false);
+    size_t length = telemetryEncoder.End();
+    if (length) {
+      telemetryClients.Send(telemetryEncoder.Data(), length, false);
+      lastTelemetryEvent = millis();
+    } else if (millis() - lastTelemetryEvent >= TELEMETRY_HEARTBEAT_MS) {
+      telemetryClients.Heartbeat();
+      lastTelemetryEvent = millis();
+    }
   }
+  // new ones get everything once, after the delta so both see the same values
+  if (telemetryClients.HasFresh()) {
+    EncodeTelemetry(true);
+    size_t length = telemetryEncoder.End();
+    telemetryClients.Send(telemetryEncoder.Data(), length, true);
+    lastTelemetryEvent = millis();
+  }
+}
 
-  lastRefresh = millis();
+// This function copies the samples the control task added to the History into the run log
+// A START clears the History, which opens the log of the new run; the log is
+// closed when that run is over. Samples the ring overwrote before they were
+// copied are counted as dropped, which takes a UI stall of over 15 minutes.
+void HandleRunLog() {
+  PROFILE_SCOPE(probeRunLog);
+  // before the samples, so all of a run that has ended are there
+  bool running = GetReflowState().running;
+  uint32_t runId = history.Run();
+
+  if (runId != loggedRun) {
+    runLog.Close();
+    loggedRun = runId;
+    loggedSamples = 0;
+    loggedRunSeen = false;
+    if (runId) OpenRunLog();
+  }
+  if (!runLog.IsOpen()) return;
+  loggedRunSeen |= running;
+
+  uint32_t end = history.Written();
+  uint32_t first = history.First(end);
+  if (loggedSamples < first) {
+    runLog.Lost(first - loggedSamples);
+    loggedSamples = first;
+  }
 
-  if (!start) {
+  // copied in batches and checked like any History reader, a new run is logged on the next call
+  HistorySample batch[32];
+  while (loggedSamples < end) {
+    uint32_t count = end - loggedSamples < 32 ? end - loggedSamples : 32;
+    for (uint32_t i = 0; i < count; i++) batch[i] = history.At(loggedSamples + i);
+    if (!history.Valid(runId, loggedSamples)) return;
+    for (uint32_t i = 0; i < count; i++) runLog.Append(batch[i]);
+    loggedSamples += count;
+  }
+
+  if (loggedRunSeen && !running) runLog.Close();
+}
+
+// This function starts the log of a new run with the profile and gains it was started with
+void OpenRunLog() {
+  const RunSettings &settings = startSettings;
+  RunLogHeader header;
+  memset(&header, 0, sizeof(header));
+  snprintf(header.profile, sizeof(header.profile), "%s", startProfileName.c_str());
+  header.samplePeriod = timeTempCheck;
+  header.segmentCount = settings.segmentCount;
+  memcpy(header.segments, settings.segments, settings.segmentCount * sizeof(ProfileSegment));
+  header.kp = settings.kp;
+  header.ki = settings.ki;
+  header.kd = settings.kd;
+
+  if (!runLog.Open(header)) Serial.println("Could not create the run log");
+}
+
+// The same fields as /status, see GetStatus()
+void EncodeTelemetry(bool full){
+  ReflowState state = GetReflowState();
+
+  char time[32];
+  if (state.running) snprintf(time, sizeof(time), "%lu/%lu seconds", (unsigned long)state.elapsed / 1000, (unsigned long)state.totalTime / 1000);
+  else snprintf(time, sizeof(time), "Idle");
+
+  TelemetryEncoder &e = telemetryEncoder;
+  e.Begin(full);
+  e.Add("phase", ProfileEngine::PhaseName(state.phase));
+  e.Add("segment", (long)state.segment);
+  e.Add("waiting", state.waiting);
+  e.Add("tuning", state.tuning);
+  e.Add("start", state.running);
+  e.Add("fault", state.fault);
+  e.Add("lastTemperature", state.temperature, 2);
+  e.Add("resistance", (float)ThermistorTable::Resistance(thermistorParams, state.adcAverage), 0);
+  e.Add("filter", thermistorFilter.ModeName(state.filter));
+  e.Add("droppedSamples", (long)state.droppedSamples);
+  e.Add("segments", (long)profileSegmentCount);
+  e.Add("totalTime", (long)(totalTime / 1000));
+  e.Add("config", (long)statusConfigVersion);
+  e.Add("kp", (float)Kp, 4);
+  e.Add("ki", (float)Ki, 4);
+  e.Add("kd", (float)Kd, 4);
+  e.Add("currentProfile", CurrentProfileName.c_str());
+  e.Add("time", time);
+  e.Add("setpoint", (float)state.setpoint, 1);
+  e.Add("pidOutput", (float)state.output, 3);
+}
+
+void HandleDisplay(){
+  PROFILE_SCOPE(probeDisplay);
+  ReflowState state = GetReflowState();
+
+  if (!state.running) {
     display.clear();
     display.drawString(0, 0, "Reflow Oven");
     display.drawString(0, 10, "Current Profile:");\
     display.drawString(0, 20, "\"" + CurrentProfileName + "\"");
-    display.drawString(0, 30, "Current Temperature: " + String(lastTemperature) + " C");
-    display.drawString(0, 40, "Press START to begin");
+    display.drawString(0, 30, "Current Temperature: " + String(state.temperature) + " C");
+    display.drawString(0, 40, state.fault[0] ? "Aborted: " + String(state.fault) : String("Press START to begin"));
     display.display();
     return;
   }
 
   display.clear();
+
+  if (state.tuning) {
+    display.drawString(0, 0, "Autotuning...");
+    display.drawString(0, 10, "Temp: " + String(state.temperature) + " C");
+    display.drawString(0, 20, "Setpoint: " + String(state.setpoint) + " C");
+    display.drawString(0, 30, "Time Elapsed: " + String(state.elapsed / 1000) + " s");
+    display.drawString(0, 40, "Cycles: " + String(state.tuneCycles) + ", heater " + (state.output > 0 ? "on" : "off"));
+    display.display();
+    return;
+  }
   
-  if (preheating) {
-    display.drawString(0, 0, "Preheating...");
-  } else if (soaking) {
-    display.drawString(0, 0, "Soaking...");
-  } else if (reflowing) {
-    display.drawString(0, 0, "Reflowing...");
-  } else if (coolingDown) {
-    display.drawString(0, 0, "Cooling Down...");
-  }
-
-  display.drawString(0, 10, "Temp: " + String(lastTemperature) + " C");
-  display.drawString(0, 20, "Setpoint: " + String(Setpoint) + " C");
-  display.drawString(0, 30, "Time Elapsed: " + String(timeSinceReflowStarted / 1000) + " s");
+  static const char *const titles[PHASE_COUNT] = {"Running...", "Preheating...", "Soaking...", "Reflowing...", "Cooling Down..."};
+  display.drawString(0, 0, titles[state.phase < PHASE_COUNT ? state.phase : PHASE_IDLE]);
+
+  display.drawString(0, 10, "Temp: " + String(state.temperature) + " C");
+  display.drawString(0, 20, "Setpoint: " + String(state.setpoint) + " C");
+  display.drawString(0, 30, "Time Elapsed: " + String(state.elapsed / 1000) + " s");
+  display.drawString(0, 40, "Segment " + String(state.segment + 1) + "/" + String(state.segments) +
+                            (state.waiting ? ", waiting for " + String(state.target, 0) + " C" : String("")));
   
   display.display();
 }
 
 // This function handles the PID control logic
-// It uses the last temperature reading from the thermistor on a set interval
-// and adjusts the relay output based on the PID calculations.
+// It runs every timeTempCheck ms from the control schedule, uses the last
+// temperature reading from the thermistor and updates the relay output.
 void HandlePID(){
+  PROFILE_SCOPE(probePID);
 
   if (!start) return; // do nothing if not started
 
-  timeSinceReflowStarted = millis() - reflowStarted;
+  Input = lastTemperature - bias; // read the temperature from the thermistor
+  if (!tuning) myPID.Compute(); // compute the PID output, the relay test sets it itself
+  history.Add(timeSinceReflowStarted, lastTemperature, Setpoint, Output);
 
-  if (timeSinceReflowStarted - lastTimeTempCheck > timeTempCheck){
-    lastTimeTempCheck = timeSinceReflowStarted;
+  // printed by HandleControlLog(), the serial port may block and this is the control task
+  pidTemperature = lastTemperature;
+  pidSetpoint = Setpoint;
+  pidOutput = Output;
+  pidComputations++;
+}
 
-    Input = lastTemperature - bias; // read the temperature from the thermistor
-    myPID.Compute(); // compute the PID output
+// This function prints what the control task published since the last call
+// Every PID computation as temp,setpoint,output: polled more often than the
+// PID computes, a line is only lost when the UI task is held up for a whole
+// PID period; the tools that read the log count lines as periods, so a gap is
+// reported. Then the reason of an abort and the control side of "schedule".
+void HandleControlLog() {
+  ReflowState state = GetReflowState();
+  if (state.pidComputations != pidLogged) {
+    uint32_t missed = state.pidComputations - pidLogged - 1;
+    pidLogged = state.pidComputations;
+    if (missed) Serial.println("# " + String(missed) + " PID lines missed");
+    Serial.println(String(state.pidTemperature) + "," + String(state.pidSetpoint) + "," + String((int)(state.pidOutput * 100)));
+  }
 
-    //Serial.println("PIDOutput:" + String(Output) + ",Setpoint:" + String(Setpoint) +",Input: " + String(Input));
-    Serial.println(String(lastTemperature) + "," + String(Setpoint) + "," + String((int)(Output * 100)));
+  if (state.aborts != abortsLogged) {
+    abortsLogged = state.aborts;
+    Serial.println(String(state.abortedTune ? "Autotune" : "Reflow") + " aborted: " + state.fault);
   }
 
-  if (timeSinceReflowStarted > totalTime){
-    start = false, preheating = false, soaking = false, reflowing = false, coolingDown = false;
-    Output = 0;
+  if (controlSchedule.Version() != scheduleLogged) {
+    ScheduleReport report;
+    scheduleLogged = controlSchedule.Read(report);
+    PrintSchedule("control", report);
   }
-  else if(timeSinceReflowStarted > (preheatTime + soakTime + reflowTime)){ // preheat and soak and reflow are complete. Start cooldown
-    if(!coolingDown){
-      preheating = false, soaking = false, reflowing = false, coolingDown = true;
+}
+
+// This function advances the profile engine to now and takes the setpoint from it
+// The run ends after the last segment, or with a fault when the oven does not
+// reach the target of a segment that waits for it in time. During an autotune
+// the relay test sets the output instead, until it has a result or gives up.
+void HandleProfile(){
+  PROFILE_SCOPE(probeProfile);
+
+  if (!start) return; // do nothing if not started
+
+  timeSinceReflowStarted = millis() - reflowStarted;
+
+  if (tuning) {
+    // the relay decides on every new temperature, HandleHeater() switches at the next slot
+    Output = autotune.Update(timeSinceReflowStarted, lastTemperature);
+    Setpoint = autotune.Setpoint();
+    TuneState tune = autotune.State();
+    if (tune == TUNE_DONE) {
+      tuneResult = autotune.Result();
+      autotunes++; // the UI task applies and stores the gains
+      StopReflow();
+    } else if (tune == TUNE_FAILED) {
+      AbortRun(autotune.Failure());
     }
-    Setpoint = cooldownTemp;
+    return;
   }
-  else if(timeSinceReflowStarted > (preheatTime + soakTime)){ // preheat and soak are complete. Start reflow
-    if(!reflowing){
-      preheating = false, soaking = false, reflowing = true, coolingDown = false;
-    }
-    Setpoint = reflowTemp;
+
+  EngineState state = engine.Update(timeSinceReflowStarted, lastTemperature);
+  if (state == ENGINE_TIMEOUT) {
+    AbortRun("Temperature not reached");
+    return;
   }
-  else if(timeSinceReflowStarted > preheatTime){ // preheat is complete. Start soak
-    if(!soaking){
-      preheating = false, soaking = true, reflowing = false, coolingDown = false;
-    }
-    Setpoint = soakTemp;
+  if (state == ENGINE_DONE) {
+    StopReflow();
+    return;
   }
-  else{ // cycle is starting. Start preheat
-    if(!preheating){
-      preheating = true, soaking = false, reflowing = false, coolingDown = false;
-    }
-    Setpoint = preheatTemp;
+
+  Setpoint = engine.Setpoint();
+}
+
+// This function aborts the run when the temperature cannot be trusted or is too high
+// It runs in the control task right after the new samples are converted, so a
+// fault turns the relay off within one control period regardless of the UI.
+void HandleSafety(){
+  if (!start) return;
+
+  if (average > ADC_MAX_VALUE - THERMISTOR_OPEN_MARGIN) {
+    AbortRun("Thermistor open");
+  } else if (lastTemperature > MAX_SAFE_TEMP) {
+    AbortRun("Over temperature");
   }
 }
 
-void HandleSlowPWM() {
+// This function switches the relay for the next half cycle of the mains
+// It runs once per slot from the control schedule, see Heater above. A stop or
+// a fault turns the relay off at once, whatever the minimum on time.
+void HandleHeater() {
+  PROFILE_SCOPE(probeHeater);
   if (!start) {
     digitalWrite(RELAYPIN, LOW); // ensure relay is off when not started
     return; // do nothing if not started
   }
 
-  // This function is used to control the relay with a slow PWM signal
-  if (millis() - lastPeriod > PWM_PERIOD){
-    lastPeriod = millis();
-
-    if (Output > 0){
-      digitalWrite(RELAYPIN, HIGH); // turn on the relay
-
-      // calculate the duty cycle based on the Output value
-      int steps = (int)(Output *  PWM_STEPS); // convert Output to steps 
-      dutyCycle = steps * dutyCycleStep; // calculate the duty cycle in milliseconds
-    }
-    else{
-      digitalWrite(RELAYPIN, LOW);
-    }
-  }
-
-  if (millis() - lastPeriod > dutyCycle) {
-    digitalWrite(RELAYPIN, LOW); // turn off the relay
-  }
+  digitalWrite(RELAYPIN, heater.Update(Output) ? HIGH : LOW);
 }
 
 // This function handles the thermistor readings and calculates the temperature
+// The samples are taken by the acquisition timer, here we only drain everything
+// that arrived since the last call and convert the filtered value once.
 void HandleThermistor(){
-  if (millis() - lastSampleTime >= timeBetweenSamples) {
-    lastSampleTime = millis();
-    
-    // take a reading
-    int reading = analogRead(THERMISTORPIN);
-    
-    // add to the array of samples
-    samples[sampleIndex++ % NUMSAMPLES] = reading;
-    
-    int _avg = 0;
-    for (int i = 0; i < NUMSAMPLES; i++)
-      _avg += samples[i];
-    
-    average = _avg / NUMSAMPLES;
-    
-    CalculateTemperature();
+  PROFILE_SCOPE(probeThermistor);
+  AdcSample sample;
+  bool newSamples = false;
+
+  while (AcquisitionRead(sample)) {
+    average = thermistorFilter.Add(sample.value);
+    lastSampleTime = sample.time;
+    newSamples = true;
   }
+
+  if (newSamples) CalculateTemperature();
 }
 
 // This function calculates the temperature based on the average ADC value
-// It converts the ADC value to resistance and then calculates the temperature
-// using the Steinhart-Hart equation.
+// It interpolates in the table built by SetupThermistor(), which holds the
+// Beta/Steinhart-Hart curve every few ADC counts.
 void CalculateTemperature(){
-  float _res = (float)average;
-  if (_res <= 0) _res = 1; // prevent division by zero
-  // convert the value to resistance
-  _res = ADC_MAX_VALUE / _res - 1;
-  if (_res <= 0) _res = 0.0001; // prevent division by zero
-  _res = SERIESRESISTOR / _res;
-  resistance = _res; // store the resistance value
-  
-  float steinhart;
-  steinhart = resistance / THERMISTORNOMINAL;       // (R/Ro)
-  steinhart = log(steinhart);                       // ln(R/Ro)
-  steinhart /= BCOEFFICIENT;                        // 1/B * ln(R/Ro)
-  steinhart += 1.0 / (TEMPERATURENOMINAL + 273.15); // + (1/To)
-  steinhart = 1.0 / steinhart;                      // Invert
-  steinhart -= 273.15;                              // convert absolute temp to C
+  float temperature = thermistorTable.Lookup(average);
 
-  if (steinhart < 20.0) steinhart = 20.0;
+  if (temperature < 20.0) temperature = 20.0;
 
-  lastTemperature = steinhart;
+  lastTemperature = temperature;
 }
 
-// This function updates the list of profiles from the filesystem
-void UpdateProfileList(){
-  File dir = LittleFS.open(ProfileFolderPrefix, "r");
-  if (!dir) {
-    Serial.println("Failed to open profile directory");
-    return;
-  }
 
-  if (!dir.isDirectory()){
-    Serial.println("Not a directory");
-    server.send(500, "text/plain", "FS failure");
+// This function posts an autotune from the UI task, returns what is wrong or ""
+// The rule is one of RelayAutotune::RuleName(), empty keeps the last one used.
+String StartAutotune(float setpoint, const char *rule) {
+  if (start) return "Cannot autotune while reflow is in progress";
+  if (!(setpoint >= AUTOTUNE_MIN_SETPOINT && setpoint <= AUTOTUNE_MAX_SETPOINT)) {
+    return "Autotune setpoint must be " + String(AUTOTUNE_MIN_SETPOINT) + " to " + String(AUTOTUNE_MAX_SETPOINT) + " C";
   }
+  uint8_t parsed = autotuneRule;
+  if (rule[0] && !RelayAutotune::ParseRule(rule, parsed)) return "Unknown autotune rule: " + String(rule);
+
+  autotuneSetpoint = setpoint;
+  autotuneRule = (TuneRule)parsed;
+  if (!PostCommand(CMD_AUTOTUNE)) return "Controller busy, try again";
+  Serial.println("Autotune started at " + String(setpoint, 1) + " C, rule " + RelayAutotune::RuleName(autotuneRule));
+  return "";
+}
 
-  // read all files in the profile directory and store their names
-  int index = 0;
-  File file = dir.openNextFile();
-  while (file && index < MaxProfiles) {
-    ProfileNames[index++] = String(file.name()); // store the file name without extension
-    
-    file = dir.openNextFile();
-  }
+// This function takes over the gains of a finished autotune, like "setPID" does
+void HandleAutotune() {
+  ReflowState state = GetReflowState();
+  if (state.autotunes == autotunesApplied) return;
+  autotunesApplied = state.autotunes;
 
-  ProfileCount = index; // update the profile count
+  TuneGains(state.tune, Kp, Ki, Kd);
+  PostCommand(CMD_SET_TUNINGS);
+  SaveSettings();
+  Serial.println("Autotune done after " + String(state.tune.cycles) + " cycles: Ku=" + String(state.tune.ku, 4) +
+                 ", Tu=" + String(state.tune.tu, 1) + " s, amplitude " + String(state.tune.amplitude, 2) + " C");
+  Serial.println("PID values updated: Kp=" + String(Kp, 4) + ", Ki=" + String(Ki, 4) + ", Kd=" + String(Kd, 4));
+}
 
-  // fill remaining slots with empty strings
-  for (index; index < MaxProfiles; index++) {
-    ProfileNames[index] = ""; 
-  }
-  
-  dir.close();
+// This function converts the gains of an autotune (per second) to those of myPID
+// The PID scales Ki and Kd by its sample time, timeBetweenSamples, but computes
+// once every timeTempCheck, so its integral and derivative act that many times
+// slower and faster than the sample time says.
+void TuneGains(const TuneResult &result, double &kp, double &ki, double &kd) {
+  double computations = (double)timeTempCheck / timeBetweenSamples;
+  kp = result.kp;
+  ki = result.ki * computations;
+  kd = result.kd / computations;
 }
 
+
 void HandleSerialCommands(){
 
   if (!Serial.available()) return; // no data available
 
+  PROFILE_SCOPE(probeSerial);
+
   String command = Serial.readStringUntil('\n'); // read the command from serial
   command.trim(); // remove any leading/trailing whitespace
 
@@ -598,32 +1412,240 @@ void HandleSerialCommands(){
     Ki = command.substring(spaceIndex1 + 1, spaceIndex2).toFloat();
     Kd = command.substring(spaceIndex2 + 1, command.length()).toFloat();
 
-    myPID.SetTunings(Kp, Ki, Kd); // update PID tunings
-    SaveSettings(); // save to EEPROM
+    PostCommand(CMD_SET_TUNINGS); // the control task applies them, also during a run
+    SaveSettings(); // stored once they stop changing
     Serial.println("PID values updated: Kp=" + String(Kp, 4) + ", Ki=" + String(Ki, 4) + ", Kd=" + String(Kd, 4));
   }
+  else if (command.startsWith("setFilter ")) {
+    // select the thermistor filter: setFilter <average|ema|median> [alpha]
+    int spaceIndex = command.indexOf(' ', 10);
+    String name = spaceIndex == -1 ? command.substring(10) : command.substring(10, spaceIndex);
+
+    FilterMode mode;
+    if (!thermistorFilter.ParseMode(name.c_str(), mode)) {
+      Serial.println("Invalid command format. Use: setFilter <average|ema|median> [alpha]");
+      return;
+    }
+
+    float alpha = spaceIndex == -1 ? 0 : command.substring(spaceIndex + 1).toFloat();
+    filterMode = mode;
+    if (alpha > 0 && alpha <= 1) filterAlpha = alpha; // anything else keeps the current alpha
+    PostCommand(CMD_SET_FILTER); // the filter belongs to the control task
+    SaveSettings(); // stored once they stop changing
+    Serial.println("Filter set to " + String(thermistorFilter.ModeName(mode)) + (alpha > 0 ? " (alpha=" + String(filterAlpha, 3) + ")" : ""));
+  }
+  else if (command.startsWith("setHeater ")) {
+    // how the relay is switched: setHeater <burst|pwm> [minOnMs] [minOffMs]
+    int spaceIndex1 = command.indexOf(' ', 10);
+    int spaceIndex2 = spaceIndex1 == -1 ? -1 : command.indexOf(' ', spaceIndex1 + 1);
+    String name = spaceIndex1 == -1 ? command.substring(10) : command.substring(10, spaceIndex1);
+
+    HeaterMode mode;
+    long minOn = spaceIndex1 == -1 ? heaterMinOn : command.substring(spaceIndex1 + 1, spaceIndex2 == -1 ? command.length() : spaceIndex2).toInt();
+    long minOff = spaceIndex2 == -1 ? minOn : command.substring(spaceIndex2 + 1).toInt();
+    if (!HeaterModulator::ParseMode(name.c_str(), mode) || minOn < 0 || minOff < 0) {
+      Serial.println("Invalid command format. Use: setHeater <burst|pwm> [minOnMs] [minOffMs]");
+      return;
+    }
+
+    heaterMode = mode;
+    heaterMinOn = minOn;
+    heaterMinOff = minOff;
+    PostCommand(CMD_SET_HEATER); // the heater belongs to the control task
+    uint32_t slotUs = HEATER_SLOT_US;
+    Serial.println("Heater set to " + String(HeaterModulator::ModeName(mode)) + (mode == HEATER_BURST ?
+                   ", at least " + String(HeaterSlots(minOn) * slotUs / 1000.0f, 1) + " ms on, " +
+                   String(HeaterSlots(minOff) * slotUs / 1000.0f, 1) + " ms off" : String("")));
+  }
+  else if (command.startsWith("setRamp ")) {
+    // rate of the hold and until segments that heat and optionally of those that
+    // cool in C/s, 0 steps: setRamp <rate> [coolRate]. Ramps keep their own rate.
+    int spaceIndex = command.indexOf(' ', 8);
+    double rate = (spaceIndex == -1 ? command.substring(8) : command.substring(8, spaceIndex)).toFloat();
+    double cool = spaceIndex == -1 ? -1 : command.substring(spaceIndex + 1).toFloat();
+
+    if (rate < 0 || (spaceIndex != -1 && cool < 0)) {
+      Serial.println("Invalid command format. Use: setRamp <rate> [coolRate]");
+      return;
+    }
+
+    float last = profileSegmentCount ? profileSegments[0].target : 0; // the first segment heats
+    for (uint8_t i = 0; i < profileSegmentCount; i++) {
+      ProfileSegment &segment = profileSegments[i];
+      bool heats = segment.target >= last;
+      last = segment.target;
+      if (segment.type == SEGMENT_RAMP) continue;
+      if (heats) segment.rate = rate;
+      else if (cool >= 0) segment.rate = cool;
+    }
+    SaveSettings(); // used from the next run on
+    Serial.println("Ramp rates set: heating " + String(rate, 2) + " C/s, cooling " +
+                   (cool >= 0 ? String(cool, 2) + " C/s" : String("unchanged")));
+  }
+  else if (command.startsWith("setTelemetry ")) {
+    // period of the /events stream in milliseconds: setTelemetry <ms>
+    long period = command.substring(13).toInt();
+    if (period < CONTROL_PERIOD_MS) {
+      Serial.println("Invalid command format. Use: setTelemetry <ms>, at least " + String(CONTROL_PERIOD_MS) + " ms");
+      return;
+    }
+    telemetryPeriod = period;
+    uiScheduler.SetPeriod(telemetryTask, telemetryPeriod * 1000);
+    Serial.println("Telemetry period set to " + String(telemetryPeriod) + " ms, " + String(telemetryClients.Count()) + " subscribers");
+  }
+  else if (command == "autotune" || command.startsWith("autotune ")) {
+    // relay feedback test that sets the PID gains: autotune [setpoint] [classic|some-overshoot|no-overshoot]
+    int spaceIndex = command.indexOf(' ', 9);
+    String setpoint = command.length() > 9 ? (spaceIndex == -1 ? command.substring(9) : command.substring(9, spaceIndex)) : String("");
+    String rule = spaceIndex == -1 ? String("") : command.substring(spaceIndex + 1);
+
+    String problem = StartAutotune(setpoint.length() ? setpoint.toFloat() : AUTOTUNE_SETPOINT, rule.c_str());
+    if (problem.length()) Serial.println(problem + ". Use: autotune [setpoint] [classic|some-overshoot|no-overshoot]");
+  }
+  else if (command == "schedule") {
+    // lateness of every periodic task, the control side follows once its task has copied its statistics
+    PrintSchedule("ui", ReportSchedule(uiScheduler));
+    PostCommand(CMD_REPORT_SCHEDULE);
+  }
+  else if (command == "schedule reset") {
+    uiScheduler.ResetStats();
+    PostCommand(CMD_RESET_SCHEDULE);
+    Serial.println("Schedule statistics reset");
+  }
+  else if (command == "stats") {
+    PrintStats();
+  }
+  else if (command == "stats reset") {
+#ifdef PROFILER
+    ProfileProbe::ResetAll();
+#endif
+    metricsSince = millis();
+    Serial.println("Handler statistics reset");
+  }
   
 }
 
+// This function prints the heap usage and, when profiling is compiled in, the
+// calls and mean/max time of every probed handler in microseconds
+void PrintStats(){
+  Serial.println("heap: size " + String(ESP.getHeapSize()) +
+                 ", free " + String(ESP.getFreeHeap()) +
+                 ", min free " + String(ESP.getMinFreeHeap()) +
+                 ", max alloc " + String(ESP.getMaxAllocHeap()));
+#ifdef PROFILER
+  float seconds = (millis() - metricsSince) / 1000.0f;
+  float usPerTick = 1e6f / ProfilerTicksPerSecond();
+  Serial.println("loop: control " + String(seconds > 0 ? probeControlTick.Stats().calls / seconds : 0, 1) +
+                 " Hz, ui " + String(seconds > 0 ? probeUiLoop.Stats().calls / seconds : 0, 1) + " Hz");
+  for (ProfileProbe *probe = ProfileProbe::First(); probe; probe = probe->Next()) {
+    ProbeStats stats = probe->Stats();
+    Serial.println(String(probe->Name()) +
+                   ": calls " + String(stats.calls) +
+                   ", mean " + String(stats.calls ? stats.totalTicks * usPerTick / stats.calls : 0, 1) +
+                   " us, max " + String(stats.maxTicks * usPerTick, 1) +
+                   " us, total " + String(stats.totalTicks * usPerTick / 1000, 1) + " ms");
+  }
+#else
+  Serial.println("Handler profiling is not compiled in, build with -D PROFILER");
+#endif
+}
+
+// This function copies the statistics of every task of a scheduler, on the task that runs it
+ScheduleReport ReportSchedule(const Scheduler &scheduler){
+  ScheduleReport report = {};
+  report.count = scheduler.Count();
+  for (uint8_t i = 0; i < report.count; i++) report.tasks[i] = scheduler.Report(i);
+  return report;
+}
+
+// This function prints the statistics of every task of a scheduler, times in microseconds
+void PrintSchedule(const char *side, const ScheduleReport &report){
+  for (uint8_t i = 0; i < report.count; i++) {
+    const TaskReport &task = report.tasks[i];
+    Serial.println(String(side) + "/" + task.name +
+                   ": period " + String(task.period) +
+                   ", runs " + String(task.runs) +
+                   ", late min " + String(task.lateMin) +
+                   " p50 " + String(task.lateP50) +
+                   " p99 " + String(task.lateP99) +
+                   " max " + String(task.lateMax) +
+                   ", skipped " + String(task.skipped) +
+                   ", deadline misses " + String(task.deadlineMisses) +
+                   ", max runtime " + String(task.maxRuntime));
+  }
+}
+
 //                 ==================================================================
 //                 |                     Web Server Handlers                        |
 //                 ==================================================================
 
+// JSON parsing and serialisation of the web handlers, timed together by the "json" probe
+template <typename TInput>
+DeserializationError ParseJson(JsonDocument &doc, TInput &input) {
+  PROFILE_SCOPE(probeJson);
+  return deserializeJson(doc, input);
+}
+
+void WriteJson(const JsonDocument &doc, String &output) {
+  PROFILE_SCOPE(probeJson);
+  serializeJson(doc, output);
+}
+
 // ------------- This function serves the main HTML page when the root URL is accessed -------------
 void OnConnect(){
-  File file = LittleFS.open("/static/index.html", "r");
-  if (!file) {
+  if (!ServeAsset("/static/index.html")) {
     Serial.println("Failed to open file for reading");
     server.send(404, "text/plain", "File not found");
-    return;
   }
-  server.streamFile(file, "text/html");
-  file.close();
+}
+// -------------------------------------------------------------------------------------------------
+
+// ---------------- This function sends a static asset, or 304 when the browser has it -------------
+bool ServeAsset(const String &path){
+  const char *type = "text/plain";
+  if (path.endsWith(".html")) type = "text/html";
+  else if (path.endsWith(".js")) type = "application/javascript";
+  else if (path.endsWith(".css")) type = "text/css";
+  else if (path.endsWith(".png")) type = "image/png";
+  else if (path.endsWith(".ico")) type = "image/x-icon";
+  else if (path.endsWith(".json")) type = "application/json";
+
+  const Asset *asset = nullptr;
+  for (int i = 0; i < assetCount; i++) {
+    if (assets[i].path == path) asset = &assets[i];
+  }
+
+  if (!asset) {
+    // not in the list: an image uploaded straight from data/
+    if (assetCount || !LittleFS.exists(path)) return false;
+    File file = LittleFS.open(path, "r");
+    if (!file || file.isDirectory()) return false;
+    server.streamFile(file, type); // the server closes it once sent
+    return true;
+  }
+
+  const char *cacheControl = asset->immutable ? "public, max-age=31536000, immutable" : "no-cache";
+  if (server.header("If-None-Match") == asset->etag) {
+    server.sendHeader("ETag", asset->etag);
+    server.sendHeader("Cache-Control", cacheControl);
+    server.send(304);
+    return true;
+  }
+
+  File file = LittleFS.open(asset->gzip ? path + ".gz" : path, "r");
+  if (!file) return false;
+  server.sendHeader("ETag", asset->etag);
+  server.sendHeader("Cache-Control", cacheControl);
+  server.streamFile(file, type); // adds Content-Encoding: gzip for .gz files, closes it once sent
+  return true;
 }
 // -------------------------------------------------------------------------------------------------
 
 // ---------------------- This function handles the request to set a profile -----------------------
 void NotFound(){
+  if (server.method() == HTTP_GET && server.uri().startsWith("/static/") && ServeAsset(server.uri())) return;
+  if (server.method() == HTTP_GET && server.uri().startsWith(RUNLOG_DIR "/") && ExportRun(server.uri())) return;
+
   Serial.println("Not Found: " + server.uri());
   server.send(404, "text/plain", "Not Found");
 }
@@ -641,10 +1663,8 @@ void SetProfileValues(){
     return;
   }
 
-  String jsonData = server.arg("plain");
-  Serial.println("Received JSON data: " + jsonData);
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, jsonData);
+  DeserializationError error = ParseJson(doc, server.body());
   if (error) {
     Serial.println("Failed to parse JSON: " + String(error.c_str()));
     server.send(400, "text/plain", "Invalid JSON data");
@@ -664,34 +1684,28 @@ void SetProfileValues(){
     return;
   }
 
-  // Set the values from the JSON document
-  preheatTemp = doc["preheatTemp"].as<float>();
-  preheatTime = doc["preheatTime"].as<unsigned long>() * 1000;
-  soakTemp = doc["soakTemp"].as<float>();
-  soakTime = doc["soakTime"].as<unsigned long>() * 1000;
-  reflowTemp = doc["reflowTemp"].as<float>();
-  reflowTime = doc["reflowTime"].as<unsigned long>() * 1000;
-  cooldownTemp = doc["cooldownTemp"].as<float>();
-  cooldownTime = doc["cooldownTime"].as<unsigned long>() * 1000;
-  totalTime = preheatTime + soakTime + reflowTime + cooldownTime;
+  // the four phases of the JSON document as hold segments, times in seconds
+  const float temps[4] = {doc["preheatTemp"].as<float>(), doc["soakTemp"].as<float>(),
+                          doc["reflowTemp"].as<float>(), doc["cooldownTemp"].as<float>()};
+  const uint32_t times[4] = {doc["preheatTime"].as<uint32_t>() * 1000, doc["soakTime"].as<uint32_t>() * 1000,
+                             doc["reflowTime"].as<uint32_t>() * 1000, doc["cooldownTime"].as<uint32_t>() * 1000};
+  // optional, older clients do not send the ramp rates and step
+  profileSegmentCount = ProfileEngine::FromPhases(temps, times, doc["rampRate"] | 0.0f, doc["coolRate"] | 0.0f,
+                                                  profileSegments);
 
   CurrentProfileName = "Custom Profile"; // set a default name for the profile
   
-  // Save the settings to EEPROM
+  // Save the settings, written once they stop changing
   SaveSettings();
   Serial.println("Profile values set successfully");
 
   // Send a success response
   server.send(200, "text/plain", "Profile values set successfully");
   Serial.println("Profile values set: " +
-                 String(preheatTemp) + ", " +
-                 String(preheatTime) + ", " +
-                 String(soakTemp) + ", " +
-                 String(soakTime) + ", " +
-                 String(reflowTemp) + ", " +
-                 String(reflowTime) + ", " +
-                 String(cooldownTemp) + ", " +
-                 String(cooldownTime));
+                 String(temps[0]) + ", " + String(times[0]) + ", " +
+                 String(temps[1]) + ", " + String(times[1]) + ", " +
+                 String(temps[2]) + ", " + String(times[2]) + ", " +
+                 String(temps[3]) + ", " + String(times[3]));
 }
 // -------------------------------------------------------------------------------------------------
 
@@ -707,10 +1721,8 @@ void SetPIDValues(){
     return;
   }
 
-  String jsonData = server.arg("plain");
-  Serial.println("Received JSON data: " + jsonData);
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, jsonData);
+  DeserializationError error = ParseJson(doc, server.body());
   if (error) {
     Serial.println("Failed to parse JSON: " + String(error.c_str()));
     server.send(400, "text/plain", "Invalid JSON data");
@@ -721,7 +1733,7 @@ void SetPIDValues(){
   Ki = doc["ki"].as<float>();
   Kd = doc["kd"].as<float>();
 
-  myPID.SetTunings(Kp, Ki, Kd);
+  // applied by the control task when the next run starts
   SaveSettings();
   Serial.println("New PID Settings: Kp= " + String(Kp, 4) + " Ki= " + String(Ki, 4) + " Kd= " + String(Kd, 4));
   server.send(200, "text/plain", "PID values set successfully");
@@ -729,38 +1741,391 @@ void SetPIDValues(){
 
 // -------------------------------------------------------------------------------------------------
 
-// ------------------ This function returns the list of profiles as a JSON array -------------------
-void GetProfiles() {
-  UpdateProfileList(); // ensure the profile list is up to date
+// ---------------- These functions start an autotune and report on it ----------------
+// POST /autotune {"setpoint": 150, "rule": "classic|some-overshoot|no-overshoot"},
+// both optional, starts one; /stop and the STOP button end it like a run. Both
+// methods return
+//   {"running": true, "setpoint": 150, "rule": "classic", "cycles": 2, "fault": "",
+//    "result": {"ku": .., "tu": .., "amplitude": .., "cycles": .., "kp": .., "ki": .., "kd": ..}}
+// where result is the last autotune since boot, with the gains as /setPIDvalues
+// takes them, or null when there was none.
+void GetAutotune() {
+  SendAutotune();
+}
+
+void PostAutotune() {
+  JsonDocument doc;
+  if (server.hasArg("plain")) { // the body is optional
+    DeserializationError error = ParseJson(doc, server.body());
+    if (error || !doc.is<JsonObject>()) {
+      server.send(400, "text/plain", "Invalid JSON data");
+      return;
+    }
+  }
+
+  String rule = doc["rule"] | "";
+  String problem = StartAutotune(doc["setpoint"] | (float)AUTOTUNE_SETPOINT, rule.c_str());
+  if (problem.length()) {
+    server.send(start ? 409 : 400, "text/plain", problem);
+    return;
+  }
+  SendAutotune(true);
+}
+
+// posted: an autotune was just posted, running before the control task picked it up
+void SendAutotune(bool posted) {
+  ReflowState state = GetReflowState();
+  JsonDocument doc;
+  doc["running"] = posted || state.tuning;
+  doc["setpoint"] = autotuneSetpoint;
+  doc["rule"] = RelayAutotune::RuleName(autotuneRule);
+  doc["cycles"] = state.tuneCycles;
+  doc["fault"] = state.fault;
+  if (state.autotunes) {
+    double kp, ki, kd;
+    TuneGains(state.tune, kp, ki, kd);
+    JsonObject result = doc["result"].to<JsonObject>();
+    result["ku"] = state.tune.ku;
+    result["tu"] = state.tune.tu;
+    result["amplitude"] = state.tune.amplitude;
+    result["cycles"] = state.tune.cycles;
+    result["kp"] = kp;
+    result["ki"] = ki;
+    result["kd"] = kd;
+  } else {
+    doc["result"] = nullptr;
+  }
+
+  String response;
+  WriteJson(doc, response);
+  server.send(200, "application/json", response);
+}
+// -------------------------------------------------------------------------------------------------
+
+// ---------------- These functions read and set the whole configuration at once ----------------
+// POST /config takes any combination of
+//   {"profile": "<stored profile>",
+//    "segments": [<segments as in /exportprofile, times in ms>],
+//    "pid": {"kp": 0.05, "ki": 0, "kd": 0.005},
+//    "filter": {"mode": "average|ema|median", "alpha": 0.1}}
+// applied in this order, so segments replace the profile that was selected.
+// Everything is checked before anything changes, an invalid part rejects the
+// whole request. The settings are written to flash once, before the response.
+// Both methods return the config in effect, in the same format.
+#define CONFIG_MAX_SEGMENT_MS 3600000UL // longest segment time a profile may have
+
+void GetConfig() {
+  SendConfig();
+}
+
+void SetConfig() {
+  if (start) {
+    server.send(409, "text/plain", "Cannot change the config while reflow is in progress");
+    return;
+  }
+
+  JsonDocument doc;
+  DeserializationError error = ParseJson(doc, server.body());
+  if (error || !doc.is<JsonObject>()) {
+    server.send(400, "text/plain", "Invalid JSON data");
+    return;
+  }
+
+  // staged on a copy, the globals only change once all of it is valid
+  StoredSettings next;
+  memset(&next, 0, sizeof(next));
+  PackSettings(next);
+  bool setFilter = false;
+
+  String problem = ApplyConfig(doc, next, setFilter);
+  if (problem.length()) {
+    server.send(400, "text/plain", problem);
+    return;
+  }
 
-  String profilesList = "[";
-  for (int i = 0; i < MaxProfiles; i++) {
-    if (ProfileNames[i].length() > 0) {
-      if (i > 0) profilesList += ",";
-      profilesList += "\"" + ProfileNames[i] + "\"";
+  // the UI task is the only writer of the settings and posts every start, so
+  // a run always starts with all of this or none of it
+  UnpackSettings(next);
+  SaveSettings();
+  settingsStore.Commit(); // one write for the whole config, the filter included
+  if (setFilter) PostCommand(CMD_SET_FILTER);
+  Serial.println("Config applied, profile " + CurrentProfileName);
+
+  SendConfig();
+}
+
+// checks every part of a /config request and applies it to next, returns what is wrong or ""
+String ApplyConfig(JsonDocument &doc, StoredSettings &next, bool &setFilter) {
+  for (JsonPair part : doc.as<JsonObject>()) {
+    const char *key = part.key().c_str();
+    if (strcmp(key, "profile") && strcmp(key, "segments") && strcmp(key, "pid") && strcmp(key, "filter")) {
+      return "Unknown config part: " + String(key);
     }
-    else {
-      break; // stop if we hit an empty slot
+  }
+
+  JsonVariant profile = doc["profile"];
+  if (!profile.isNull()) {
+    const ProfileSummary *summary = profile.is<const char *>() ? profiles.Find(profile.as<String>()) : nullptr;
+    ProfileRecord record;
+    if (!summary) return "Profile does not exist";
+    if (!profileStore.Read(summary->slot, record)) return "Failed to read profile";
+    next.segmentCount = record.segmentCount;
+    memset(next.segments, 0, sizeof(next.segments));
+    memcpy(next.segments, record.segments, record.segmentCount * sizeof(ProfileSegment));
+    memset(next.profileName, 0, sizeof(next.profileName));
+    snprintf(next.profileName, sizeof(next.profileName), "%s", record.name);
+  }
+
+  JsonVariant segments = doc["segments"];
+  if (!segments.isNull()) {
+    ProfileSegment table[PROFILE_MAX_SEGMENTS];
+    uint8_t count;
+    String problem = SegmentsFromJson(segments, table, count);
+    if (problem.length()) return problem;
+    next.segmentCount = count;
+    memset(next.segments, 0, sizeof(next.segments));
+    memcpy(next.segments, table, count * sizeof(ProfileSegment));
+    memset(next.profileName, 0, sizeof(next.profileName));
+    snprintf(next.profileName, sizeof(next.profileName), "%s", "Custom Profile");
+  }
+
+  JsonVariant pid = doc["pid"];
+  if (!pid.isNull()) {
+    if (!pid.is<JsonObject>() || pid.size() == 0) return "pid must be an object with kp, ki and kd";
+    const struct { const char *key; double *value; } gains[] = {{"kp", &next.kp}, {"ki", &next.ki}, {"kd", &next.kd}};
+    size_t known = 0;
+    for (const auto &gain : gains) {
+      JsonVariant value = pid[gain.key];
+      if (value.isNull()) continue;
+      double v = value.as<double>();
+      if (!value.is<double>() || !(v >= 0 && v < 1e6)) return String(gain.key) + " must be a number from 0";
+      *gain.value = v;
+      known++;
     }
+    if (known != pid.size()) return "pid has an unknown field";
   }
-  profilesList += "]";
 
-  Serial.println("Profiles List: " + profilesList);
+  JsonVariant filterPart = doc["filter"];
+  if (!filterPart.isNull()) {
+    if (!filterPart.is<JsonObject>()) return "filter must be an object with mode and alpha";
+    JsonVariant mode = filterPart["mode"];
+    FilterMode filter;
+    if (!mode.isNull()) {
+      if (!mode.is<const char *>() || !thermistorFilter.ParseMode(mode.as<const char *>(), filter)) {
+        return "filter mode must be average, ema or median";
+      }
+      next.filterMode = filter;
+    }
+    JsonVariant value = filterPart["alpha"];
+    if (!value.isNull()) {
+      double v = value.as<double>();
+      if (!value.is<double>() || !(v > 0 && v <= 1)) return "filter alpha must be above 0 and at most 1";
+      next.filterAlpha = v;
+    }
+    if (mode.isNull() && value.isNull()) return "filter must be an object with mode and alpha";
+    setFilter = true;
+  }
+  return "";
+}
+
+void SendConfig() {
+  JsonDocument doc;
+  doc["profile"] = CurrentProfileName;
+  SegmentsToJson(profileSegments, profileSegmentCount, doc["segments"].to<JsonArray>());
+  doc["totalTime"] = totalTime;
+  doc["pid"]["kp"] = Kp;
+  doc["pid"]["ki"] = Ki;
+  doc["pid"]["kd"] = Kd;
+  doc["filter"]["mode"] = thermistorFilter.ModeName(filterMode);
+  doc["filter"]["alpha"] = filterAlpha;
 
-  server.send(200, "application/json", profilesList);
+  String response;
+  WriteJson(doc, response);
+  server.send(200, "application/json", response);
 }
 // -------------------------------------------------------------------------------------------------
 
-// --------------- This function creates a new profile based on the current settings ---------------
-void SaveProfile() {
-  if (ProfileCount >= MaxProfiles) {
-    server.send(400, "text/plain", "Maximum number of profiles reached");
+// This function opens the profile store and reads every profile into the catalogue, once at boot
+// The store first takes over the JSON profiles of older firmware (and of the
+// filesystem image), those that could not be migrated are tried again on every
+// boot. Saving and deleting a profile update the catalogue themselves.
+void ScanProfiles(){
+  profiles.Clear();
+  if (!profileStore.Begin()) {
+    Serial.println("Failed to open the profile store");
     return;
   }
-  String rawJson = server.arg("plain");
-  Serial.println("Save profile data: " + rawJson);
+  MigrateProfiles();
+
+  ProfileRecord record;
+  for (uint32_t slot = 0; slot < profileStore.Slots(); slot++) {
+    if (profileStore.Read(slot, record)) profiles.Put(SummaryOf(record, slot));
+  }
+  Serial.println("Loaded " + String((int)profiles.Count()) + " profiles");
+}
+
+// This function moves the JSON files in the profile directory into the store
+// The directory is removed once it is empty, a file that fails stays for the next boot.
+void MigrateProfiles(){
+  File dir = LittleFS.open(ProfileFolderPrefix, "r");
+  if (!dir || !dir.isDirectory()) return;
+
+  // the names first: removing files while the directory is being read can skip entries
+  std::vector<String> names;
+  for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    if (!file.isDirectory()) names.push_back(file.name());
+  }
+  dir.close();
+
+  size_t migrated = 0;
+  for (const String &name : names) {
+    String path = ProfileFolderPrefix + "/" + name;
+    File file = LittleFS.open(path, "r");
+    JsonDocument doc;
+    DeserializationError error = ParseJson(doc, file);
+    file.close();
+
+    ProfileRecord record;
+    if (error || !ProfileFromJson(doc, name, record) || profileStore.Write(record) < 0) {
+      Serial.println("Could not migrate profile " + name);
+      continue;
+    }
+    LittleFS.remove(path);
+    migrated++;
+  }
+  if (migrated == names.size()) LittleFS.rmdir(ProfileFolderPrefix);
+  Serial.println("Migrated " + String((int)migrated) + " profiles into " PROFILE_STORE_PATH +
+                 (migrated < names.size() ? ", " + String((int)(names.size() - migrated)) + " left in " + ProfileFolderPrefix : String("")));
+}
+
+// a profile value, also when it is stored as a string like in the old default.json
+double ProfileValue(JsonVariant value, double fallback) {
+  if (value.is<const char *>()) return atof(value.as<const char *>());
+  return value | fallback;
+}
+
+// This function checks a JSON array of segments and fills the table, returns what is wrong or ""
+//   [{"type": "ramp|hold|until", "phase": "none|preheat|soak|reflow|cooldown",
+//     "target": 150, "rate": 1.5, "time": 60000}, ...]
+// rate (C/s, 0 steps), time (ms) and phase are optional, see lib/ProfileEngine.
+String SegmentsFromJson(JsonVariant array, ProfileSegment *segments, uint8_t &count) {
+  if (!array.is<JsonArray>() || array.size() == 0 || array.size() > PROFILE_MAX_SEGMENTS) {
+    return "segments must be an array of 1 to " + String(PROFILE_MAX_SEGMENTS) + " segments";
+  }
+  count = 0;
+  for (JsonVariant item : array.as<JsonArray>()) {
+    String which = "segment " + String(count + 1);
+    if (!item.is<JsonObject>()) return which + " must be an object";
+    ProfileSegment &segment = segments[count];
+    memset(&segment, 0, sizeof(segment));
+
+    JsonVariant type = item["type"], phase = item["phase"], target = item["target"], rate = item["rate"], time = item["time"];
+    if (!type.is<const char *>() || !ProfileEngine::ParseType(type.as<const char *>(), segment.type)) {
+      return which + ": type must be ramp, hold or until";
+    }
+    if (!phase.isNull() && (!phase.is<const char *>() || !ProfileEngine::ParsePhase(phase.as<const char *>(), segment.phase))) {
+      return which + ": phase must be none, preheat, soak, reflow or cooldown";
+    }
+    double v = target.as<double>();
+    if (!target.is<double>() || !(v >= 1 && v <= MAX_SAFE_TEMP)) {
+      return which + ": target must be a number from 1 to " + String(MAX_SAFE_TEMP);
+    }
+    segment.target = v;
+    v = rate | 0.0;
+    if ((!rate.isNull() && !rate.is<double>()) || !(v >= 0 && v <= 100)) return which + ": rate must be from 0 to 100";
+    segment.rate = v;
+    v = time | 0.0;
+    if ((!time.isNull() && !time.is<double>()) || !(v >= 0 && v <= CONFIG_MAX_SEGMENT_MS)) {
+      return which + ": time must be from 0 to " + String(CONFIG_MAX_SEGMENT_MS) + " ms";
+    }
+    segment.time = (uint32_t)v;
+    size_t known = 2 + !phase.isNull() + !rate.isNull() + !time.isNull();
+    if (item.size() != known) return which + " has an unknown field";
+    if (!ProfileEngine::Valid(segment)) return which + ": a ramp needs a rate";
+    count++;
+  }
+  return "";
+}
+
+void SegmentsToJson(const ProfileSegment *segments, uint8_t count, JsonArray array) {
+  for (uint8_t i = 0; i < count; i++) {
+    JsonObject item = array.add<JsonObject>();
+    item["type"] = ProfileEngine::TypeName(segments[i].type);
+    item["phase"] = ProfileEngine::PhaseName(segments[i].phase);
+    item["target"] = segments[i].target;
+    item["rate"] = segments[i].rate;
+    item["time"] = segments[i].time;
+  }
+}
+
+// This function fills a record from a profile in JSON, {"segments": [...]}, or
+// the four phases of older profiles where missing values get the defaults
+bool ProfileFromJson(JsonDocument &doc, const String &name, ProfileRecord &record){
+  if (name.length() == 0 || name.length() >= PROFILE_NAME_SIZE) return false;
+  memset(&record, 0, sizeof(record));
+  snprintf(record.name, sizeof(record.name), "%s", name.c_str());
+  if (!doc["segments"].isNull()) return SegmentsFromJson(doc["segments"], record.segments, record.segmentCount).length() == 0;
+
+  const float temps[4] = {(float)ProfileValue(doc["preheatTemp"], 100.0), (float)ProfileValue(doc["soakTemp"], 150.0),
+                          (float)ProfileValue(doc["reflowTemp"], 230.0), (float)ProfileValue(doc["cooldownTemp"], 25.0)};
+  // default 2, 1, 2 and 2 minutes
+  const uint32_t times[4] = {(uint32_t)ProfileValue(doc["preheatTime"], 120000), (uint32_t)ProfileValue(doc["soakTime"], 60000),
+                             (uint32_t)ProfileValue(doc["reflowTime"], 120000), (uint32_t)ProfileValue(doc["cooldownTime"], 120000)};
+  // profiles from before the ramps step, as they always did
+  record.segmentCount = ProfileEngine::FromPhases(temps, times, ProfileValue(doc["rampRate"], 0.0),
+                                                  ProfileValue(doc["coolRate"], 0.0), record.segments);
+  return true;
+}
+
+// This function writes a record in the JSON format of the profile files
+void ProfileToJson(const ProfileRecord &record, JsonDocument &doc){
+  doc["name"] = record.name;
+  SegmentsToJson(record.segments, record.segmentCount, doc["segments"].to<JsonArray>());
+}
+
+ProfileSummary SummaryOf(const ProfileRecord &record, int32_t slot){
+  ProfileSummary summary;
+  summary.name = record.name;
+  summary.slot = slot;
+  summary.segments = record.segmentCount;
+  summary.peakTemp = 0;
+  for (uint8_t i = 0; i < record.segmentCount; i++) {
+    if (record.segments[i].target > summary.peakTemp) summary.peakTemp = record.segments[i].target;
+  }
+  summary.totalTime = PlannedTime(record.segments, record.segmentCount);
+  return summary;
+}
+
+// This function stores a record under its name, replacing a profile of the same name when replace is set
+// Returns the HTTP status for the handlers.
+int StoreProfile(ProfileRecord &record, bool replace){
+  const ProfileSummary *existing = profiles.Find(record.name);
+  if (existing && !replace) return 409;
+  int32_t slot = profileStore.Write(record, existing ? existing->slot : -1);
+  if (slot < 0) return 500;
+  profiles.Put(SummaryOf(record, slot));
+  return 200;
+}
+
+// ------------ This function returns the profiles and their summaries as a JSON array -------------
+// Served from the catalogue, serialised again only after a profile was saved or deleted.
+void GetProfiles() {
+  const String &etag = profiles.ETag();
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == etag) {
+    server.send(304);
+    return;
+  }
+  const String &json = profiles.Json();
+  server.send(200, "application/json", json.c_str(), json.length());
+}
+// -------------------------------------------------------------------------------------------------
+
+// --------------- This function creates a new profile based on the current settings ---------------
+void SaveProfile() {
   JsonDocument incoming;
-  DeserializationError error = deserializeJson(incoming, rawJson);
+  DeserializationError error = ParseJson(incoming, server.body());
 
   if (error){
     Serial.println("Failed to parse JSON: " + String(error.c_str()));
@@ -778,64 +2143,81 @@ void SaveProfile() {
     server.send(400, "text/plain", "Profile name cannot be empty");
     return;
   }
+  if (profileName.length() >= PROFILE_NAME_SIZE) {
+    server.send(400, "text/plain", "Profile name too long");
+    return;
+  }
 
-  // Check if the profile already exists
-  if (LittleFS.exists(ProfileFolderPrefix + "/" + profileName)) {
+  ProfileRecord record;
+  memset(&record, 0, sizeof(record));
+  snprintf(record.name, sizeof(record.name), "%s", profileName.c_str());
+  record.segmentCount = profileSegmentCount;
+  memcpy(record.segments, profileSegments, profileSegmentCount * sizeof(ProfileSegment));
+
+  int status = StoreProfile(record, false);
+  if (status == 409) {
     server.send(400, "text/plain", "Profile already exists");
     return;
   }
-
-  // Create a new file for the profile
-  File file = LittleFS.open(ProfileFolderPrefix + "/" + profileName, "w", true);
-  if (!file) {
-    server.send(500, "text/plain", "Failed to create profile");
+  if (status != 200) {
+    server.send(500, "text/plain", "Failed to write profile data");
     return;
   }
+  Serial.println("Profile created: " + profileName);
 
-  // Create a JSON document to store the profile data
-  JsonDocument doc;
-  doc["preheatTemp"] = preheatTemp;
-  doc["preheatTime"] = preheatTime;
-  doc["soakTemp"] = soakTemp;
-  doc["soakTime"] = soakTime;
-  doc["reflowTemp"] = reflowTemp;
-  doc["reflowTime"] = reflowTime;
-  doc["cooldownTemp"] = cooldownTemp;
-  doc["cooldownTime"] = cooldownTime;
-
-  // Serialize the JSON document to the file
-  String jsonString;
-  serializeJson(doc, jsonString);
-
-  if (file.print(jsonString)) {
-    file.close();
-    Serial.println("Profile created: " + profileName);
-    
-    // Update the profile list after creation
-    UpdateProfileList();
+  // the saved profile is the current one now
+  CurrentProfileName = profileName;
+  SaveSettings();
 
-    // Save the current profile name to EEPROM
-    CurrentProfileName = profileName;
-    PutString(EEPROM_LASTPROFILE_NAME_ADDR, CurrentProfileName);
-    EEPROM.commit(); // save changes to EEPROM
-    
-    server.send(200, "text/plain", "Profile created successfully");
-  } else {
-    file.close();
-    LittleFS.remove(ProfileFolderPrefix + "\\" + profileName); // clean up if write failed
+  server.send(200, "text/plain", "Profile created successfully");
+}
+// -------------------------------------------------------------------------------------------------
+
+// ------------ This function stores a profile sent as JSON, replacing one of the same name ------------
+void ImportProfile() {
+  JsonDocument incoming;
+  DeserializationError error = ParseJson(incoming, server.body());
+  if (error) {
+    server.send(400, "text/plain", "Invalid JSON data");
+    return;
+  }
+
+  ProfileRecord record;
+  if (!ProfileFromJson(incoming, incoming["name"] | "", record)) {
+    server.send(400, "text/plain", "Profile name missing or too long, or an invalid segment");
+    return;
+  }
+  if (StoreProfile(record, true) != 200) {
     server.send(500, "text/plain", "Failed to write profile data");
+    return;
+  }
+  Serial.println("Profile imported: " + String(record.name));
+  server.send(200, "text/plain", "Profile imported successfully");
+}
+// -------------------------------------------------------------------------------------------------
+
+// ------------------ This function returns a stored profile as JSON, ?name=<profile> ------------------
+void ExportProfile() {
+  const ProfileSummary *summary = profiles.Find(server.arg("name"));
+  ProfileRecord record;
+  if (!summary || !profileStore.Read(summary->slot, record)) {
+    server.send(404, "text/plain", "Profile not found");
+    return;
   }
 
+  JsonDocument doc;
+  ProfileToJson(record, doc);
+  String response;
+  WriteJson(doc, response);
+  server.send(200, "application/json", response);
 }
 // -------------------------------------------------------------------------------------------------
 
 // ------------------ This function deletes a profile based on the provided name -------------------
 void DeleteProfile() {
 
-  String rawJson = server.arg("plain");
-  Serial.println("Save profile data: " + rawJson);
   JsonDocument incoming;
-  DeserializationError error = deserializeJson(incoming, rawJson);
+  DeserializationError error = ParseJson(incoming, server.body());
 
   if (error){
     Serial.println("Failed to parse JSON: " + String(error.c_str()));
@@ -855,33 +2237,32 @@ void DeleteProfile() {
   }
 
   // Check if the profile already exists
-  if (!LittleFS.exists(ProfileFolderPrefix + "/" + profileName)) {
+  const ProfileSummary *summary = profiles.Find(profileName);
+  if (!summary) {
     server.send(400, "text/plain", "Profile does not exists");
     return;
   }
 
-  if (LittleFS.remove(ProfileFolderPrefix + "/" + profileName)) {
-    // Update the profile list after deletion
-    UpdateProfileList();
+  if (profileStore.Erase(summary->slot)) {
+    profiles.Remove(profileName);
     Serial.println("Profile deleted: " + profileName);
     server.send(200, "text/plain", "Profile deleted successfully");
   } else {
-    server.send(404, "text/plain", "Profile not found");
+    server.send(500, "text/plain", "Failed to delete profile");
   }
 }
 // -------------------------------------------------------------------------------------------------
 
 // --------------- This function sets the current profile based on the provided name ---------------
+// One record read from the store, found through the catalogue.
 void LoadProfile(){
   if (start) {
     server.send(400, "text/plain", "Cannot load profile while reflow is in progress");
     return;
   }
 
-  String rawJson = server.arg("plain");
-  Serial.println("Save profile data: " + rawJson);
   JsonDocument incoming;
-  DeserializationError error = deserializeJson(incoming, rawJson);
+  DeserializationError error = ParseJson(incoming, server.body());
 
   if (error){
     Serial.println("Failed to parse JSON: " + String(error.c_str()));
@@ -901,38 +2282,23 @@ void LoadProfile(){
   }
 
   // Check if the profile exists
-  if (!LittleFS.exists(ProfileFolderPrefix + "/" + profileName)) {
+  const ProfileSummary *summary = profiles.Find(profileName);
+  if (!summary) {
     server.send(400, "text/plain", "Profile does not exist");
     return;
   }
 
-  File file = LittleFS.open(ProfileFolderPrefix + "/" + profileName, "r");
-
-  JsonDocument doc;
-  error = deserializeJson(doc, file);
-
-  if (error) {
-    Serial.println("Failed to parse profile: " + String(error.c_str()));
-    server.send(500, "text/plain", "Failed to parse profile");
-    file.close();
+  ProfileRecord record;
+  if (!profileStore.Read(summary->slot, record)) {
+    server.send(500, "text/plain", "Failed to read profile");
     return;
   }
 
-  preheatTemp = doc["preheatTemp"] | 100.0;
-  preheatTime = doc["preheatTime"] | 120000; // default 2 minutes
-  soakTemp = doc["soakTemp"] | 150.0;
-  soakTime = doc["soakTime"] | 60000; // default 1 minute
-  reflowTemp = doc["reflowTemp"] | 230.0;
-  reflowTime = doc["reflowTime"] | 120000; // default 2 minutes
-  cooldownTemp = doc["cooldownTemp"] | 25.0;
-  cooldownTime = doc["cooldownTime"] | 120000; // default 2 minutes
+  profileSegmentCount = record.segmentCount;
+  memcpy(profileSegments, record.segments, record.segmentCount * sizeof(ProfileSegment));
   CurrentProfileName = profileName; // set the current profile name
 
-  totalTime = preheatTime + soakTime + reflowTime + cooldownTime;
-  
-  file.close();
-
-  // Save the loaded settings to EEPROM
+  // Save the loaded settings, written once they stop changing
   SaveSettings();
   Serial.println("Profile loaded: " + profileName);
   
@@ -942,45 +2308,202 @@ void LoadProfile(){
 
 // ---------------- This function returns the current status of the reflow process -----------------
 void GetStatus() {
+  PROFILE_SCOPE(probeStatus);
+  BuildStatus();
+  // copied into the connection's send buffer, no String in between
+  server.send(200, "application/json", statusResponse, statusResponseLength);
+}
+
+// This function brings the cached /status response up to date, see "Status cache"
+void BuildStatus() {
+  uint32_t stateVersion;
+  ReflowState state = GetReflowState(&stateVersion);
+  if (statusResponseLength && stateVersion == statusBuiltState && statusConfigVersion == statusBuiltConfig) return;
+
+  char name[96], filter[16];
+
+  if (statusConfigVersion != statusBuiltConfig) {
+    JsonEscape(name, sizeof(name), CurrentProfileName.c_str());
+    // the segments themselves are in GET /config, fetched again when "config" changes
+    int length = snprintf(statusConfig, sizeof(statusConfig),
+      "\"segments\":%u,\"totalTime\":%lu,\"config\":%lu,"
+      "\"kp\":%.4f,\"ki\":%.4f,\"kd\":%.4f,\"currentProfile\":\"%s\"",
+      (unsigned)profileSegmentCount, totalTime / 1000, (unsigned long)statusConfigVersion, Kp, Ki, Kd, name);
+    statusConfigLength = length < (int)sizeof(statusConfig) ? length : sizeof(statusConfig) - 1;
+    statusBuiltConfig = statusConfigVersion;
+  }
+
+  char time[32];
+  if (state.running) snprintf(time, sizeof(time), "%lu/%lu seconds", (unsigned long)state.elapsed / 1000, (unsigned long)state.totalTime / 1000);
+  else snprintf(time, sizeof(time), "Idle");
+  JsonEscape(name, sizeof(name), state.fault);
+  JsonEscape(filter, sizeof(filter), thermistorFilter.ModeName(state.filter));
+
+  int hotLength = snprintf(statusHot, sizeof(statusHot),
+    "\"phase\":\"%s\",\"segment\":%u,\"waiting\":%s,\"tuning\":%s,\"start\":%s,"
+    "\"fault\":\"%s\",\"lastTemperature\":%.2f,\"resistance\":%.0f,\"filter\":\"%s\","
+    "\"droppedSamples\":%lu,\"time\":\"%s\",\"setpoint\":%.2f,\"pidOutput\":%.4f",
+    ProfileEngine::PhaseName(state.phase), (unsigned)state.segment, state.waiting ? "true" : "false",
+    state.tuning ? "true" : "false", state.running ? "true" : "false", name, state.temperature,
+    ThermistorTable::Resistance(thermistorParams, state.adcAverage), filter,
+    (unsigned long)state.droppedSamples, time, state.setpoint, state.output);
+  if (hotLength >= (int)sizeof(statusHot)) hotLength = sizeof(statusHot) - 1;
+
+  // {hot,config}
+  char *body = statusResponse;
+  *body++ = '{';
+  memcpy(body, statusHot, hotLength);
+  body += hotLength;
+  *body++ = ',';
+  memcpy(body, statusConfig, statusConfigLength);
+  body += statusConfigLength;
+  *body++ = '}';
+  statusResponseLength = body - statusResponse;
+  statusBuiltState = stateVersion;
+}
+// -------------------------------------------------------------------------------------------------
+
+// ------------- This function returns the recorded run, downsampled for the chart ---------------
+void GetHistory() {
+  PROFILE_SCOPE(probeHistory);
+  float from = server.hasArg("from") ? server.arg("from").toFloat() : 0;
+  long points = server.hasArg("points") ? server.arg("points").toInt() : HISTORY_POINTS;
+  if (points < 2) points = 2;
+  if (points > HISTORY_MAX_POINTS) points = HISTORY_MAX_POINTS;
+
+  // the control task keeps adding samples meanwhile, see lib/History
+  String response;
+  for (int attempt = 0; attempt < 3; attempt++) {
+    uint32_t run = history.Run(), end = history.Written();
+    uint32_t first = history.Find(history.First(end), end, from);
+    uint32_t count = end - first;
+
+    char line[64];
+    response = "";
+    response.reserve(64 + (count < (uint32_t)points ? count : points) * 32);
+    snprintf(line, sizeof(line), "{\"run\":%lu,\"samples\":%lu,\"points\":[", (unsigned long)run, (unsigned long)count);
+    response += line;
+    bool comma = false;
+    history.Downsample(first, end, points, [&](uint32_t index) {
+      HistorySample sample = history.At(index);
+      snprintf(line, sizeof(line), "%s[%.1f,%.1f,%.1f,%.3f]", comma ? "," : "",
+               sample.Seconds(), sample.Temperature(), sample.Setpoint(), sample.Output());
+      response += line;
+      comma = true;
+    });
+    response += "]}";
+
+    if (history.Valid(run, first)) {
+      server.send(200, "application/json", response);
+      return;
+    }
+  }
+  server.send(503, "text/plain", "History changed while reading, try again");
+}
+// -------------------------------------------------------------------------------------------------
 
-  int elapsedTimeInSeconds = (int)((millis() - reflowStarted) / 1000); // elapsed time in seconds
-  int totalTimeInSeconds = (int)(totalTime / 1000); // total time in seconds
+// ------------------------ This function lists the runs stored on LittleFS -------------------------
+void GetRuns() {
+  PROFILE_SCOPE(probeRunLog);
+  uint32_t ids[RUNLOG_MAX_RUNS];
+  int count = RunLogList(LittleFS, ids, RUNLOG_MAX_RUNS);
 
   JsonDocument doc;
-  
-  doc["preheating"] = preheating;
-  doc["soaking"] = soaking;
-  doc["reflowing"] = reflowing;
-  doc["coolingDown"] = coolingDown;
-  doc["start"] = start;
-  doc["lastTemperature"] = lastTemperature;
-  doc["resistance"] = resistance;
-  doc["preheatTemp"] = preheatTemp;
-  doc["preheatTime"] = preheatTime / 1000; // convert to seconds
-  doc["soakTemp"] = soakTemp;
-  doc["soakTime"] = soakTime / 1000; // convert to seconds
-  doc["reflowTemp"] = reflowTemp;
-  doc["reflowTime"] = reflowTime / 1000; // convert to seconds
-  doc["cooldownTemp"] = cooldownTemp;
-  doc["cooldownTime"] = cooldownTime / 1000; // convert to seconds
-  doc["totalTime"] = totalTime / 1000; // convert to seconds
-  doc["kp"] = Kp;
-  doc["ki"] = Ki;
-  doc["kd"] = Kd;
-  doc["currentProfile"] = CurrentProfileName;
-
-  if (start){
-    doc["time"] = String(elapsedTimeInSeconds) + "/" + String(totalTimeInSeconds) + " seconds";
-  }
-  else {
-    doc["time"] = "Idle";
-  }
-  doc["setpoint"] = Setpoint;
-  doc["pidOutput"] = Output;
+  JsonArray runs = doc["runs"].to<JsonArray>();
+  for (int i = count - 1; i >= 0; i--) { // newest first
+    RunLogReader reader;
+    if (!reader.Open(LittleFS, ids[i])) continue;
+    JsonObject entry = runs.add<JsonObject>();
+    entry["id"] = ids[i];
+    entry["profile"] = reader.Header().profile;
+    entry["seconds"] = reader.Samples() * reader.Header().samplePeriod / 1000;
+    entry["samples"] = reader.Samples();
+    entry["csv"] = String(RUNLOG_DIR "/") + String((unsigned long)ids[i]) + ".csv";
+  }
+  doc["recording"] = runLog.IsOpen();
+  doc["droppedSamples"] = runLog.Dropped();
+  doc["freeBytes"] = RunLogFreeSpace();
 
   String response;
-  serializeJson(doc, response);
-  
+  WriteJson(doc, response);
   server.send(200, "application/json", response);
 }
-// -------------------------------------------------------------------------------------------------
\ No newline at end of file
+// -------------------------------------------------------------------------------------------------
+
+// --------------- This function sends /runs/<id>.csv, converted while it is sent ---------------
+bool ExportRun(const String &path) {
+  if (!path.endsWith(".csv")) return false;
+  uint32_t id = strtoul(path.c_str() + strlen(RUNLOG_DIR "/"), nullptr, 10);
+
+  for (RunExport &runExport : runExports) {
+    if (runExport.busy) continue;
+    if (!id || !runExport.reader.Open(LittleFS, id)) return false;
+    runExport.busy = true;
+    server.sendHeader("Content-Disposition", "attachment; filename=\"run-" + String((unsigned long)id) + ".csv\"");
+    server.send(200, "text/csv", &runExport); // released by the server once sent
+    return true;
+  }
+  server.send(503, "text/plain", "Too many exports at once, try again");
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+
+// ---------------- This function subscribes the client to the telemetry event stream ----------------
+void SubscribeEvents() {
+  // the connection outlives the request, HandleTelemetry() writes the events to it
+  if (!telemetryClients.Subscribe(server.stream())) {
+    server.send(503, "text/plain", "Too many event stream subscribers");
+  }
+}
+// -------------------------------------------------------------------------------------------------
+
+// ------------ This function returns the handler profile and heap usage for Prometheus ------------
+void GetMetrics() {
+  String response;
+  response.reserve(2048);
+
+  auto metric = [&response](const char *name, const char *type, const char *help) {
+    response += String("# HELP ") + name + " " + help + "\n";
+    response += String("# TYPE ") + name + " " + type + "\n";
+  };
+
+  metric("tosti_uptime_seconds", "gauge", "Time since boot.");
+  response += "tosti_uptime_seconds " + String(millis() / 1000.0, 3) + "\n";
+  metric("tosti_heap_size_bytes", "gauge", "Total heap size.");
+  response += "tosti_heap_size_bytes " + String(ESP.getHeapSize()) + "\n";
+  metric("tosti_heap_free_bytes", "gauge", "Free heap right now.");
+  response += "tosti_heap_free_bytes " + String(ESP.getFreeHeap()) + "\n";
+  metric("tosti_heap_min_free_bytes", "gauge", "Lowest free heap since boot, the heap high-water mark.");
+  response += "tosti_heap_min_free_bytes " + String(ESP.getMinFreeHeap()) + "\n";
+  metric("tosti_settings_writes_total", "counter", "Settings written to flash since boot.");
+  response += "tosti_settings_writes_total " + String(settingsStore.Writes()) + "\n";
+  metric("tosti_settings_skipped_total", "counter", "Settings commits skipped because nothing changed.");
+  response += "tosti_settings_skipped_total " + String(settingsStore.Skipped()) + "\n";
+  metric("tosti_settings_write_max_seconds", "gauge", "Longest settings write since boot.");
+  response += "tosti_settings_write_max_seconds " + String(settingsStore.MaxMicros() / 1e6, 6) + "\n";
+
+#ifdef PROFILER
+  float seconds = (millis() - metricsSince) / 1000.0f;
+  metric("tosti_loop_frequency_hertz", "gauge", "Mean iterations per second of each task loop since the last stats reset.");
+  response += "tosti_loop_frequency_hertz{task=\"control\"} " + String(seconds > 0 ? probeControlTick.Stats().calls / seconds : 0, 1) + "\n";
+  response += "tosti_loop_frequency_hertz{task=\"ui\"} " + String(seconds > 0 ? probeUiLoop.Stats().calls / seconds : 0, 1) + "\n";
+  metric("tosti_profiler_ticks_per_second", "gauge", "Profiler ticks per second, CPU cycles on the ESP32.");
+  response += "tosti_profiler_ticks_per_second " + String(ProfilerTicksPerSecond()) + "\n";
+
+  metric("tosti_handler_calls_total", "counter", "Calls of each profiled handler.");
+  for (ProfileProbe *probe = ProfileProbe::First(); probe; probe = probe->Next()) {
+    response += String("tosti_handler_calls_total{handler=\"") + probe->Name() + "\"} " + String(probe->Stats().calls) + "\n";
+  }
+  metric("tosti_handler_cycles_total", "counter", "Profiler ticks spent in each handler.");
+  for (ProfileProbe *probe = ProfileProbe::First(); probe; probe = probe->Next()) {
+    response += String("tosti_handler_cycles_total{handler=\"") + probe->Name() + "\"} " + String((unsigned long long)probe->Stats().totalTicks) + "\n";
+  }
+  metric("tosti_handler_cycles_max", "gauge", "Longest single call of each handler in profiler ticks.");
+  for (ProfileProbe *probe = ProfileProbe::First(); probe; probe = probe->Next()) {
+    response += String("tosti_handler_cycles_max{handler=\"") + probe->Name() + "\"} " + String(probe->Stats().maxTicks) + "\n";
+  }
+#endif
+
+  server.send(200, "text/plain; version=0.0.4", response);
+}
+// -------------------------------------------------------------------------------------------------
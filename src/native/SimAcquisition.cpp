@@ -0,0 +1,61 @@
+// Host producer for the continuous ADC acquisition (see Acquisition.h).
+// By default the sampler is a SimClock timer, the host equivalent of the timer
+// ISR: it fires at the exact virtual tick time, so runs stay deterministic.
+// With SimAcquisitionUseThread(true) the samples come from a separate producer
+// thread instead, which exercises the lock-free ring across real threads. The
+// realtime modes always use the thread, SimClock timers do not fire there.
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "Acquisition.h"
+
+static bool useThread = false;
+static std::thread producer;
+static std::atomic<bool> running{false};
+static std::atomic<uint64_t> producedUntil{0}; // virtual time of the next tick to produce
+
+void SimAcquisitionUseThread(bool enabled) { useThread = enabled; }
+
+// Blocks the simulation driver until the producer thread has published every
+// tick up to the current virtual time, so threaded runs give the same result.
+void SimAcquisitionSync() {
+  if (!running) return;
+  while (producedUntil.load(std::memory_order_acquire) <= SimClock::Micros()) std::this_thread::yield();
+}
+
+void SimAcquisitionStop() {
+  running = false;
+  if (producer.joinable()) producer.join();
+}
+
+void AcquisitionBegin(uint8_t pin, uint32_t periodUs) {
+  if (!useThread) {
+    SimClock::Every(periodUs, [pin](uint64_t tick) {
+      AcquisitionPush({(uint32_t)tick, analogRead(pin)});
+    });
+    return;
+  }
+
+  uint64_t first = SimClock::Micros() + periodUs;
+  producedUntil = first;
+  running = true;
+  producer = std::thread([pin, periodUs, first]() {
+    uint64_t tick = first;
+    while (running) {
+      uint64_t now = SimClock::Micros();
+      if (now < tick) {
+        // on the realtime clock, sleep instead of spinning away a core
+        if (SimClock::Realtime()) std::this_thread::sleep_for(std::chrono::microseconds(tick - now));
+        else std::this_thread::yield();
+        continue;
+      }
+      AcquisitionPush({(uint32_t)tick, analogRead(pin)});
+      tick += periodUs;
+      producedUntil.store(tick, std::memory_order_release);
+    }
+  });
+}
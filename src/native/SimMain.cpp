@@ -0,0 +1,576 @@
+// ===================================================================
+// |                 Native simulation entry point                   |
+// ===================================================================
+// Runs the unmodified firmware (setup()/loop() from main.cpp) against the
+// HostSim virtual clock and a simulated oven, as fast as the host allows.
+//
+//   .pio/build/native/program [--profile default.json] [--segments '[...]'] [--data data]
+//                             [--kp 0.05 --ki 0 --kd 0.005] [--autotune 150] [--step 1]
+//                             [--model oven.json] [--seed 1] [--max 3600] [--quiet]
+//                             [--serial "setFilter ema"]... [--adc-thread]
+//                             [--realtime | --threads]
+//                             [--http-load 4] [--http-delay 20] [--sse 3]
+//                             [--bench-status 100000] [--page-load]
+//                             [--history 300] [--runs]
+//
+// --segments replaces the segments of the profile with a JSON array in the
+// format of POST /config, e.g. to try ramps and segments that wait for the oven.
+// --model replaces the default oven with one fitted to a recorded run by the
+// identification tool (src/identify).
+// --autotune runs POST /autotune at that setpoint before the profile and
+// reports what it found; the profile then runs with the gains it stored, once
+// the oven has cooled down to where it started.
+// --realtime runs on the wall clock with the control tick polled from the UI
+// loop (the firmware before the task split), --threads runs it on its own
+// thread like the ESP32 build. --http-load starts that many browser threads
+// that keep requesting /status and the logo over localhost TCP; --http-delay
+// makes them slow: each request goes out in two halves and each response is
+// read 4 kB at a time, pausing that many milliseconds in between, and one more
+// client sends a request a byte a second, which the server must close once the
+// request has taken longer than it may and report its slot free. Realtime
+// runs report the control tick jitter; use --max to bound them. --sse
+// subscribes that many browsers to /events and reports what the stream sent
+// them next to what polling /status would have.
+// --bench-status times that many GET /status requests in the middle of the run,
+// back to back and with a new control tick before each one, and reports the
+// heap allocations and the time of the server per request. --page-load
+// loads the web page like a browser, then reloads it with the browser cache,
+// and reports the bytes and the time it takes over a slow soft-AP link.
+// --history fetches the recorded run from /history after the run, downsampled
+// to that many points, and reports its size and the peak it still shows.
+// --runs lets the run log catch up after the run, then lists /runs and
+// downloads the CSV export of the newest run.
+//
+// The firmware writes to its filesystem (run logs, the profile store, which
+// replaces the JSON profiles on first boot), so it runs on a scratch copy of
+// the data directory, like a board on the image uploaded from it.
+//
+// The firmware's serial output (including the temp,setpoint,output CSV) goes to
+// stdout, the run summary goes to stderr.
+
+#include <Arduino.h>
+#include <Esp.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <SimOven.h>
+#include <OvenModelFile.h>
+#include <SimHttpClient.h>
+#include <Scheduler.h>
+#include <Profiler.h>
+#include <RunLog.h>
+#include <ArduinoJson.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Board.h"
+#include "Acquisition.h"
+#include "ReflowState.h"
+#include "SimTasks.h"
+
+void setup();
+void loop();
+
+// SimAcquisition.cpp
+void SimAcquisitionUseThread(bool enabled);
+void SimAcquisitionSync();
+void SimAcquisitionStop();
+
+// firmware state observed by the simulation driver
+extern HttpServer server;
+extern std::atomic<bool> start;
+extern Scheduler controlScheduler, uiScheduler;
+
+struct SimOptions {
+  String profile = "default.json";
+  String segments;                    // JSON array, replaces the profile's segments
+  String dataDir = "data";
+  double kp = 0.05, ki = 0, kd = 0.005;
+  double autotune = 0;                // setpoint of an autotune before the run, 0 none
+  OvenModel oven;                     // the simulated oven, --model
+  uint32_t stepUs = 1000;
+  uint32_t seed = 1;
+  double maxSeconds = 3600;
+  bool quiet = false;
+  bool adcThread = false;             // sample from a producer thread instead of a timer callback
+  SimTasksMode tasks = SIM_TASKS_VIRTUAL;
+  int httpClients = 0;                // browser threads requesting /status and the logo
+  uint32_t httpDelayUs = 0;           // pause of those browsers between request halves and reads
+  int sseClients = 0;                 // browsers subscribed to /events
+  unsigned long benchStatus = 0;      // GET /status requests to benchmark
+  bool pageLoad = false;              // report what loading the web page costs
+  int historyPoints = 0;              // fetch /history with this many points after the run
+  bool runs = false;                  // fetch /runs and the newest CSV after the run
+  std::vector<String> serialCommands; // console lines typed before START
+};
+
+struct SimStats {
+  double peakTemp = 0;
+  double maxOvershoot = 0; // largest sensor reading above the active heating setpoint
+  double absErrorSum = 0;
+  unsigned long samples = 0;
+};
+
+static bool ParseArgs(int argc, char **argv, SimOptions &opt) {
+  for (int i = 1; i < argc; i++) {
+    String arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--quiet") opt.quiet = true;
+    else if (arg == "--profile" && hasValue) opt.profile = argv[++i];
+    else if (arg == "--segments" && hasValue) opt.segments = argv[++i];
+    else if (arg == "--data" && hasValue) opt.dataDir = argv[++i];
+    else if (arg == "--kp" && hasValue) opt.kp = atof(argv[++i]);
+    else if (arg == "--ki" && hasValue) opt.ki = atof(argv[++i]);
+    else if (arg == "--kd" && hasValue) opt.kd = atof(argv[++i]);
+    else if (arg == "--autotune" && hasValue) opt.autotune = atof(argv[++i]);
+    else if (arg == "--step" && hasValue) opt.stepUs = (uint32_t)(atof(argv[++i]) * 1000);
+    else if (arg == "--seed" && hasValue) opt.seed = (uint32_t)atol(argv[++i]);
+    else if (arg == "--model" && hasValue) {
+      String error = ReadOvenModel(argv[++i], opt.oven);
+      if (error.length()) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+      }
+    }
+    else if (arg == "--max" && hasValue) opt.maxSeconds = atof(argv[++i]);
+    else if (arg == "--adc-thread") opt.adcThread = true;
+    else if (arg == "--realtime") opt.tasks = SIM_TASKS_POLLED;
+    else if (arg == "--threads") opt.tasks = SIM_TASKS_THREADS;
+    else if (arg == "--http-load" && hasValue) opt.httpClients = atoi(argv[++i]);
+    else if (arg == "--http-delay" && hasValue) opt.httpDelayUs = (uint32_t)(atof(argv[++i]) * 1000);
+    else if (arg == "--bench-status" && hasValue) opt.benchStatus = strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--page-load") opt.pageLoad = true;
+    else if (arg == "--history" && hasValue) opt.historyPoints = atoi(argv[++i]);
+    else if (arg == "--runs") opt.runs = true;
+    else if (arg == "--sse" && hasValue) opt.sseClients = atoi(argv[++i]);
+    else if (arg == "--serial" && hasValue) opt.serialCommands.push_back(argv[++i]);
+    else {
+      fprintf(stderr, "Unknown or incomplete option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (opt.stepUs == 0) opt.stepUs = 1000;
+  if (opt.tasks != SIM_TASKS_VIRTUAL) opt.adcThread = true; // timers do not fire on the realtime clock
+  return true;
+}
+
+// a copy of the data directory for one run, removed afterwards
+struct ScratchFlash {
+  std::string path;
+
+  explicit ScratchFlash(const std::string &source) {
+    char directory[] = "/tmp/tostireflow-flash-XXXXXX";
+    if (!mkdtemp(directory)) return;
+    path = directory;
+    std::error_code ec;
+    std::filesystem::copy(source, path, std::filesystem::copy_options::recursive, ec);
+  }
+  ~ScratchFlash() {
+    std::error_code ec;
+    if (!path.empty()) std::filesystem::remove_all(path, ec);
+  }
+};
+
+// a request the way the web UI makes it, the firmware's server answers it on this thread
+static SimHttpResponse Request(HTTPMethod method, const String &uri, const String &body = String(""),
+                               const SimHttpHeaders &headers = {}) {
+  return SimHttpRequest(server.Port(), method, uri, body, headers, []() { server.handleClient(); });
+}
+
+// GET /status n times, stepping the firmware before each request when fresh
+template <typename Step>
+static void BenchStatus(unsigned long n, bool fresh, Step step) {
+  unsigned long allocations = 0, bytes = 0;
+  double micros = 0;
+  // only the server's passes count, not the client around them
+  auto pump = [&]() {
+    unsigned long allocationsBefore = SimHeapAllocations();
+    auto start = std::chrono::steady_clock::now();
+    server.handleClient();
+    micros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    allocations += SimHeapAllocations() - allocationsBefore;
+  };
+  for (unsigned long i = 0; i < n; i++) {
+    if (fresh) step();
+    bytes += SimHttpRequest(server.Port(), HTTP_GET, "/status", String(""), {}, pump).body.length();
+  }
+  fprintf(stderr, "status %-9s %lu requests, %.2f allocations, %.0f bytes and %.2f us of server time each\n",
+          fresh ? "(fresh)" : "(cached)", n, (double)allocations / n, (double)bytes / n, micros / n);
+}
+
+// every file under dir as the browser asks for it, .gz stored files by their plain name
+static void ListAssets(const char *dir, std::vector<String> &paths) {
+  File directory = LittleFS.open(dir, "r");
+  for (File file = directory.openNextFile(); file; file = directory.openNextFile()) {
+    String path = file.path();
+    if (file.isDirectory()) ListAssets(path.c_str(), paths);
+    else if (!path.endsWith("/assets.txt")) paths.push_back(path.endsWith(".gz") ? path.substring(0, path.length() - 3) : path);
+  }
+}
+
+// the page and everything under /static, then the same again with the browser cache
+static void PageLoad() {
+  const double LINK_KBPS = 1000; // what a phone at the edge of the soft-AP gets
+  const double REQUEST_MS = 20;  // connection setup and round trip per request
+
+  std::vector<String> paths = {"/", "/profiles"}; // the page fetches the profile list on load
+  ListAssets("/static", paths);
+
+  std::vector<SimHttpResponse> first;
+  for (int load = 0; load < 2; load++) {
+    unsigned long bytes = 0, requests = 0, notModified = 0, cached = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+      SimHttpHeaders headers = {{"Accept-Encoding", "gzip, deflate"}};
+      if (load == 1) {
+        // a pinned asset is not even asked for, the rest is revalidated
+        if (first[i].Header("Cache-Control").indexOf("immutable") >= 0) {
+          cached++;
+          continue;
+        }
+        String etag = first[i].Header("ETag");
+        if (etag.length()) headers.push_back({"If-None-Match", etag});
+      }
+      SimHttpResponse reply = Request(HTTP_GET, paths[i], String(""), headers);
+      requests++;
+      bytes += reply.bytes;
+      if (reply.code == 304) notModified++;
+      if (load == 0) first.push_back(reply);
+    }
+    fprintf(stderr, "page %-11s %lu requests (%lu not modified, %lu from cache), %lu bytes, %.2f s at %.0f kbit/s\n",
+            load ? "reload" : "first load", requests, notModified, cached, bytes,
+            bytes * 8 / (LINK_KBPS * 1000) + requests * REQUEST_MS / 1000, LINK_KBPS);
+  }
+}
+
+// a client that keeps a request trickling in, a byte a second, until the server hangs up
+struct SlowSender {
+  size_t sent = 0;
+  double closedAfter = -1; // s, -1 while connected
+
+  void Run(uint16_t port, const std::atomic<bool> &running) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+      close(fd);
+      return;
+    }
+    const char request[] = "GET /status HTTP/1.1\r\nHost: 192.168.4.1\r\nUser-Agent: a phone at the edge of the soft-AP\r\n\r\n";
+    auto begin = std::chrono::steady_clock::now();
+    while (running && sent < sizeof(request) - 1) {
+      char scratch[64];
+      int n = recv(fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) ||
+          send(fd, request + sent, 1, MSG_NOSIGNAL) != 1) {
+        closedAfter = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        break;
+      }
+      sent++;
+      for (int i = 0; i < 100 && running; i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    close(fd);
+  }
+};
+
+static bool PostJson(const char *uri, const String &body) {
+  SimHttpResponse reply = Request(HTTP_POST, uri, body);
+  if (reply.code != 200) {
+    fprintf(stderr, "%s failed (%d): %s\n", uri, reply.code, reply.body.c_str());
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  SimOptions opt;
+  if (!ParseArgs(argc, argv, opt)) return 2;
+
+  ScratchFlash flash(opt.dataDir.str());
+  if (flash.path.empty()) {
+    fprintf(stderr, "Cannot create a copy of %s\n", opt.dataDir.c_str());
+    return 1;
+  }
+  LittleFS.SetRoot(flash.path);
+  Serial.SetEcho(!opt.quiet);
+
+  ThermistorModel thermistor;
+  thermistor.nominal = THERMISTORNOMINAL;
+  thermistor.nominalTemp = TEMPERATURENOMINAL;
+  thermistor.beta = BCOEFFICIENT;
+  thermistor.series = SERIESRESISTOR;
+  thermistor.adcMax = ADC_MAX_VALUE;
+
+  SimOven oven(opt.oven, thermistor, opt.seed);
+  SimBoard::AttachAnalog(THERMISTORPIN, [&oven]() { return oven.ReadAdc(); });
+  SimBoard::AttachOutput(RELAYPIN, [&oven](int level) { oven.SetHeater(level == HIGH); });
+
+  SimAcquisitionUseThread(opt.adcThread);
+  SimTasksSetMode(opt.tasks);
+  server.SetPort(0); // any free port, several runs may share the host
+
+  bool realtime = opt.tasks != SIM_TASKS_VIRTUAL;
+  SimClock::SetRealtime(realtime);
+
+  // one pass of the firmware: UI loop plus whatever the control side needs
+  auto step = [&]() {
+    if (!realtime) {
+      SimClock::Advance(opt.stepUs);
+      SimAcquisitionSync();
+      loop();
+    } else if (opt.tasks == SIM_TASKS_POLLED) {
+      loop();
+      SimTasksPoll();
+      std::this_thread::yield();
+    } else {
+      loop();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1)); // the UI task's vTaskDelay(1)
+    }
+  };
+
+  auto wallStart = std::chrono::steady_clock::now();
+
+  setup();
+
+  if (opt.pageLoad) PageLoad();
+
+  // configure the controller in one request, profile and gains together
+  String segments = opt.segments.length() ? ",\"segments\":" + opt.segments : String("");
+  if (!PostJson("/config", "{\"profile\":\"" + opt.profile + "\"" + segments + ",\"pid\":{\"kp\":" + String(opt.kp, 6) +
+                ",\"ki\":" + String(opt.ki, 6) + ",\"kd\":" + String(opt.kd, 6) + "}}")) return 1;
+
+  std::vector<std::unique_ptr<SimHttpConnection>> subscribers;
+  for (int i = 0; i < opt.sseClients; i++) {
+    subscribers.emplace_back(new SimHttpConnection());
+    SimHttpConnection &subscriber = *subscribers.back();
+    subscriber.Open(server.Port(), HTTP_GET, "/events");
+    subscriber.WaitHeader([]() { server.handleClient(); });
+    const SimHttpResponse &reply = subscriber.Response();
+    if (reply.code != 200 || reply.contentType != "text/event-stream") {
+      fprintf(stderr, "/events failed (%d): %s\n", reply.code, reply.body.c_str());
+      return 1;
+    }
+  }
+  unsigned long sseEvents = 0;
+  // what the browsers received, counted as it arrives so nothing piles up
+  auto readEvents = [&]() {
+    for (std::unique_ptr<SimHttpConnection> &subscriber : subscribers) {
+      subscriber->Poll([]() {}); // only what already arrived
+      String data = subscriber->Take();
+      for (int at = data.indexOf("data: "); at >= 0; at = data.indexOf("data: ", at + 1)) sseEvents++;
+    }
+  };
+
+  for (const String &command : opt.serialCommands) {
+    Serial.Inject(command);
+    step();
+  }
+
+  // let the thermistor filter fill before START, the first ramp starts at the measured temperature
+  uint64_t powerOn = SimClock::Micros();
+  while (SimClock::Micros() - powerOn < 1000000) step();
+
+  if (opt.autotune > 0) {
+    if (!PostJson("/autotune", "{\"setpoint\":" + String(opt.autotune, 1) + "}")) return 1;
+    uint64_t tuneStart = SimClock::Micros();
+    while (!start && SimClock::Micros() - tuneStart < 1000000) step();
+    while (start && SimClock::Micros() - tuneStart < (uint64_t)(opt.maxSeconds * 1e6)) step();
+    double tuneSeconds = (SimClock::Micros() - tuneStart) * 1e-6;
+    // the UI task takes the gains over within a settings poll
+    uint64_t ended = SimClock::Micros();
+    while (SimClock::Micros() - ended < 1000000) step();
+
+    JsonDocument tune;
+    deserializeJson(tune, Request(HTTP_GET, "/autotune").body.c_str());
+    JsonVariant result = tune["result"];
+    if (start || result.isNull()) {
+      fprintf(stderr, "autotune         failed after %.1f s: %s\n", tuneSeconds,
+              start ? "timed out" : tune["fault"].as<String>().c_str());
+      return 1;
+    }
+    fprintf(stderr, "autotune         %.0f C %s, %lu cycles in %.1f s: Ku %.4f, Tu %.1f s, amplitude %.2f C\n",
+            opt.autotune, tune["rule"].as<String>().c_str(), result["cycles"].as<unsigned long>(), tuneSeconds,
+            result["ku"].as<float>(), result["tu"].as<float>(), result["amplitude"].as<float>());
+    fprintf(stderr, "tuned gains      Kp %.4f, Ki %.4f, Kd %.5f\n", result["kp"].as<float>(), result["ki"].as<float>(),
+            result["kd"].as<float>());
+
+    // the profile starts from a cold oven again, like the run without the autotune
+    while (oven.SensorTemp() > opt.oven.ambient + 1) step();
+  }
+
+  // press START for one loop pass, the control task picks it up on its next tick
+  SimBoard::SetInput(STARTBTN, LOW);
+  step();
+  SimBoard::SetInput(STARTBTN, HIGH);
+  uint64_t pressed = SimClock::Micros();
+  while (!start && SimClock::Micros() - pressed < 1000000) step();
+
+  // browsers on their own threads, the firmware keeps running on this one
+  std::atomic<bool> clientsRunning{true};
+  std::atomic<int> clientsActive{opt.httpClients};
+  std::atomic<unsigned long> clientResponses{0}, clientFailures{0};
+  std::vector<std::thread> clients;
+  uint16_t port = server.Port();
+  for (int i = 0; i < opt.httpClients; i++) {
+    clients.emplace_back([&, i]() {
+      const char *uri = i % 2 ? "/static/images/TostiReflowLogo.png" : "/status";
+      while (clientsRunning) {
+        SimHttpConnection connection;
+        if (!connection.Open(port, HTTP_GET, uri, String(""), {}, opt.httpDelayUs)) {
+          clientFailures++;
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+          continue;
+        }
+        if (opt.httpDelayUs) connection.SetReceiveBuffer(4096);
+        while (clientsRunning && connection.Poll(nullptr, 4096)) {
+          if (opt.httpDelayUs) std::this_thread::sleep_for(std::chrono::microseconds(opt.httpDelayUs));
+        }
+        if (connection.Response().code == 200) clientResponses++;
+        else if (clientsRunning) clientFailures++;
+      }
+      clientsActive--;
+    });
+  }
+
+  SlowSender slowSender;
+  std::thread slowThread;
+  if (opt.httpDelayUs) slowThread = std::thread([&]() { slowSender.Run(port, clientsRunning); });
+
+  uint64_t runStart = SimClock::Micros();
+  unsigned long switchesBefore = oven.RelaySwitches(); // an autotune heated before the run
+  double energyBefore = oven.EnergyJoules();
+  uint64_t maxUs = (uint64_t)(opt.maxSeconds * 1e6);
+  SimStats stats;
+  double highestSetpoint = 0;
+  unsigned long handledBefore = server.Requests();
+
+  bool benchmarked = opt.benchStatus == 0;
+  while (start && SimClock::Micros() - runStart < maxUs) {
+    step();
+    readEvents();
+
+    if (!benchmarked && SimClock::Micros() - runStart >= 60000000) {
+      BenchStatus(opt.benchStatus, false, step);
+      BenchStatus(opt.benchStatus, true, [&]() { for (int i = 0; i < 5; i++) step(); }); // one control tick
+      benchmarked = true;
+    }
+
+    double setpoint = GetReflowState().setpoint;
+    stats.peakTemp = std::max(stats.peakTemp, (double)oven.SensorTemp());
+    // overshoot only counts while heating, not while the oven lags a cooldown setpoint
+    highestSetpoint = std::max(highestSetpoint, setpoint);
+    if (setpoint >= highestSetpoint) stats.maxOvershoot = std::max(stats.maxOvershoot, oven.SensorTemp() - setpoint);
+    stats.absErrorSum += fabs(oven.SensorTemp() - setpoint);
+    stats.samples++;
+  }
+  uint64_t runEnd = SimClock::Micros();
+  // the UI task prints what the control task published last (an abort, the last PID line) on its next poll
+  while (SimClock::Micros() - runEnd < 100000) step();
+
+  clientsRunning = false;
+  while (clientsActive > 0) loop(); // a browser may wait in recv() for the server
+  for (std::thread &client : clients) client.join();
+  if (slowThread.joinable()) slowThread.join();
+  SimTasksStop();
+  SimAcquisitionStop();
+
+  double simSeconds = (runEnd - runStart) * 1e-6;
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  fprintf(stderr, "---- simulation summary ----\n");
+  fprintf(stderr, "profile          %s\n", opt.profile.c_str());
+  fprintf(stderr, "simulated time   %.1f s%s\n", simSeconds, start ? " (timed out)" : "");
+  fprintf(stderr, "wall time        %.3f s (%.0fx real time)\n", wallSeconds, simSeconds / wallSeconds);
+  fprintf(stderr, "peak temperature %.1f C\n", stats.peakTemp);
+  fprintf(stderr, "max overshoot    %.1f C\n", stats.maxOvershoot);
+  fprintf(stderr, "mean |error|     %.2f C\n", stats.samples ? stats.absErrorSum / stats.samples : 0.0);
+  fprintf(stderr, "relay switches   %lu\n", oven.RelaySwitches() - switchesBefore);
+  fprintf(stderr, "heater energy    %.1f kJ\n", (oven.EnergyJoules() - energyBefore) / 1000);
+  fprintf(stderr, "dropped samples  %u\n", AcquisitionDropped());
+  fprintf(stderr, "settings writes  %lu\n", Preferences::Writes());
+  const char *fault = GetReflowState().fault;
+  if (fault[0]) fprintf(stderr, "aborted          %s\n", fault);
+  if (!subscribers.empty()) {
+    readEvents();
+    unsigned long bytes = 0;
+    for (const std::unique_ptr<SimHttpConnection> &subscriber : subscribers) bytes += subscriber->Received();
+    // the web UI polled /status every 500 ms before the stream
+    size_t statusBytes = Request(HTTP_GET, "/status").bytes;
+    fprintf(stderr, "sse subscribers  %zu, %lu events, %lu bytes (polling: %.0f requests, %.0f bytes)\n",
+            subscribers.size(), sseEvents, bytes, subscribers.size() * simSeconds * 2,
+            subscribers.size() * simSeconds * 2 * statusBytes);
+  }
+  if (opt.historyPoints) {
+    SimHttpResponse reply = Request(HTTP_GET, "/history?points=" + String(opt.historyPoints));
+    JsonDocument doc;
+    deserializeJson(doc, reply.body.c_str());
+    float peak = 0;
+    for (JsonVariant point : doc["points"].as<JsonArray>()) peak = std::max(peak, point[1].as<float>());
+    fprintf(stderr, "history          %lu samples as %u points, %u bytes, peak %.1f C\n",
+            doc["samples"].as<unsigned long>(), (unsigned)doc["points"].size(), (unsigned)reply.body.length(), peak);
+  }
+  if (opt.runs) {
+    // the UI task copies the samples to flash once a second
+    uint64_t ended = SimClock::Micros();
+    while (SimClock::Micros() - ended < 2000000) step();
+    SimHttpResponse list = Request(HTTP_GET, "/runs");
+    JsonDocument doc;
+    deserializeJson(doc, list.body.c_str());
+    JsonArray runs = doc["runs"].as<JsonArray>();
+    if (runs.size() == 0) {
+      fprintf(stderr, "runs             none stored: %s\n", list.body.c_str());
+    } else {
+      String csv = runs[0]["csv"].as<String>();
+      size_t binaryBytes = LittleFS.open(RunLogPath(runs[0]["id"].as<unsigned long>())).size();
+      SimHttpResponse reply = Request(HTTP_GET, csv);
+      int lines = 0;
+      for (size_t i = 0; i < reply.body.length(); i++) lines += reply.body[i] == '\n';
+      fprintf(stderr, "runs             %u stored, newest %lu samples in %zu bytes, GET %s %d, %d lines, %u bytes\n",
+              (unsigned)runs.size(), runs[0]["samples"].as<unsigned long>(), binaryBytes, csv.c_str(),
+              reply.code, lines, (unsigned)reply.body.length());
+    }
+  }
+  if (realtime) {
+    SimTasksJitter jitter = SimTasksGetJitter();
+    fprintf(stderr, "control tasks    %s\n", opt.tasks == SIM_TASKS_THREADS ? "threaded" : "polled from the UI loop");
+    fprintf(stderr, "http requests    %lu, %lu complete responses, %lu failed\n", server.Requests() - handledBefore,
+            clientResponses.load(), clientFailures.load());
+    if (opt.httpDelayUs) {
+      if (slowSender.closedAfter < 0) fprintf(stderr, "slow sender      %zu bytes, still connected\n", slowSender.sent);
+      else fprintf(stderr, "slow sender      %zu bytes, closed by the server after %.1f s\n", slowSender.sent, slowSender.closedAfter);
+    }
+    fprintf(stderr, "control ticks    %lu\n", jitter.ticks);
+    fprintf(stderr, "tick lateness    p50 %u us, p99 %u us, max %u us\n", jitter.p50, jitter.p99, jitter.max);
+    for (const Scheduler *scheduler : {&controlScheduler, &uiScheduler}) {
+      for (int i = 0; i < scheduler->Count(); i++) {
+        const ScheduledTask &task = scheduler->Task(i);
+        fprintf(stderr, "%-7s lateness  p50 %u us, p99 %u us, max %u us, %u runs, %u skipped, %u deadline misses\n",
+                task.name, task.lateness.Percentile(50), task.lateness.Percentile(99), task.lateness.Max(),
+                task.runs, task.skipped, task.deadlineMisses);
+      }
+    }
+  }
+#ifdef PROFILER
+  // host wall-clock time spent in every probed handler, the same numbers /metrics serves
+  for (ProfileProbe *probe = ProfileProbe::First(); probe; probe = probe->Next()) {
+    ProbeStats stats = probe->Stats();
+    fprintf(stderr, "%-13s %9u calls, mean %8.2f us, max %8.1f us\n", probe->Name(), stats.calls,
+            stats.calls ? stats.totalTicks / 1e3 / stats.calls : 0.0, stats.maxTicks / 1e3);
+  }
+#endif
+
+  // a realtime run is normally bounded by --max, that is not a failure
+  return start && !realtime ? 1 : 0;
+}
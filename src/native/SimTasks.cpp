@@ -0,0 +1,86 @@
+// Host version of the task split (see Tasks.h).
+//   SIM_TASKS_VIRTUAL  the control tick is a SimClock timer, deterministic and
+//                      as fast as the host allows (the default)
+//   SIM_TASKS_POLLED   realtime, one thread: the driver calls SimTasksPoll()
+//                      between UI passes, like the firmware before the split
+//   SIM_TASKS_THREADS  realtime, the control tick runs on its own thread
+// In the realtime modes every tick records how late it started, so the effect
+// of UI load on the control loop can be measured.
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Tasks.h"
+#include "SimTasks.h"
+
+static SimTasksMode mode = SIM_TASKS_VIRTUAL;
+static std::thread controlThread;
+static std::atomic<bool> running{false};
+static uint64_t nextTick = 0;
+static std::vector<uint32_t> lateness; // per tick, in microseconds
+
+static const uint64_t CONTROL_PERIOD_US = CONTROL_PERIOD_MS * 1000ULL;
+
+void SimAcquisitionSync(); // SimAcquisition.cpp
+
+void SimTasksSetMode(SimTasksMode newMode) { mode = newMode; }
+
+static void RecordAndTick(uint64_t now) {
+  lateness.push_back((uint32_t)std::min<uint64_t>(now - nextTick, UINT32_MAX));
+  ControlTick();
+  nextTick += CONTROL_PERIOD_US;
+  // after a stall of more than a period, restart the schedule instead of running
+  // the missed ticks back to back (each would count the same stall again)
+  if (nextTick + CONTROL_PERIOD_US < now) nextTick = now;
+}
+
+void StartTasks() {
+  nextTick = SimClock::Micros() + CONTROL_PERIOD_US;
+  lateness.clear();
+  lateness.reserve(1 << 20);
+
+  if (mode == SIM_TASKS_VIRTUAL) {
+    SimClock::Every(CONTROL_PERIOD_US, [](uint64_t) {
+      SimAcquisitionSync(); // see every sample up to this tick, also with --adc-thread
+      ControlTick();
+    });
+  } else if (mode == SIM_TASKS_THREADS) {
+    running = true;
+    controlThread = std::thread([]() {
+      auto epoch = std::chrono::steady_clock::now() - std::chrono::microseconds(SimClock::Micros());
+      while (running) {
+        std::this_thread::sleep_until(epoch + std::chrono::microseconds(nextTick));
+        RecordAndTick(SimClock::Micros());
+      }
+    });
+  }
+}
+
+void SimTasksPoll() {
+  if (mode != SIM_TASKS_POLLED) return;
+  uint64_t now = SimClock::Micros();
+  if (now >= nextTick) RecordAndTick(now);
+}
+
+void SimTasksStop() {
+  running = false;
+  if (controlThread.joinable()) controlThread.join();
+}
+
+SimTasksJitter SimTasksGetJitter() {
+  SimTasksJitter jitter;
+  if (lateness.empty()) return jitter;
+
+  std::vector<uint32_t> sorted(lateness);
+  std::sort(sorted.begin(), sorted.end());
+  jitter.ticks = sorted.size();
+  jitter.p50 = sorted[sorted.size() / 2];
+  jitter.p99 = sorted[sorted.size() * 99 / 100];
+  jitter.max = sorted.back();
+  return jitter;
+}
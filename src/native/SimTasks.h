@@ -0,0 +1,19 @@
+#ifndef SimTasks_h
+#define SimTasks_h
+
+#include <stdint.h>
+
+enum SimTasksMode { SIM_TASKS_VIRTUAL, SIM_TASKS_POLLED, SIM_TASKS_THREADS };
+
+// how late the control ticks started, in microseconds
+struct SimTasksJitter {
+  unsigned long ticks = 0;
+  uint32_t p50 = 0, p99 = 0, max = 0;
+};
+
+void SimTasksSetMode(SimTasksMode mode); // before setup()
+void SimTasksPoll();                     // SIM_TASKS_POLLED only, runs the control tick when due
+void SimTasksStop();
+SimTasksJitter SimTasksGetJitter();
+
+#endif
@@ -0,0 +1,80 @@
+#include "ProfileFile.h"
+
+#include <ArduinoJson.h>
+
+#include <fstream>
+#include <sstream>
+
+#define CONFIG_MAX_SEGMENT_MS 86400000UL // as main.cpp
+#define MAX_SAFE_TEMP 300
+
+// the segments format of POST /config, what is wrong or ""
+static String SegmentsFromJson(JsonVariant array, ProfileFile &profile) {
+  if (!array.is<JsonArray>() || array.size() == 0 || array.size() > PROFILE_MAX_SEGMENTS) {
+    return "segments must be an array of 1 to " + String(PROFILE_MAX_SEGMENTS) + " segments";
+  }
+  profile.count = 0;
+  for (JsonVariant item : array.as<JsonArray>()) {
+    ProfileSegment &segment = profile.segments[profile.count];
+    memset(&segment, 0, sizeof(segment));
+    String which = "segment " + String(profile.count + 1);
+    String type = item["type"] | "", phase = item["phase"] | "none";
+    if (!ProfileEngine::ParseType(type.c_str(), segment.type)) return which + ": type must be ramp, hold or until";
+    if (!ProfileEngine::ParsePhase(phase.c_str(), segment.phase)) return which + ": unknown phase";
+    segment.target = item["target"] | 0.0;
+    segment.rate = item["rate"] | 0.0;
+    double time = item["time"] | 0.0;
+    if (!(segment.target >= 1 && segment.target <= MAX_SAFE_TEMP) || !(segment.rate >= 0) || !(time >= 0 && time <= CONFIG_MAX_SEGMENT_MS)) {
+      return which + ": target, rate or time out of range";
+    }
+    segment.time = (uint32_t)time;
+    if (!ProfileEngine::Valid(segment)) return which + ": a ramp needs a rate";
+    profile.count++;
+  }
+  return "";
+}
+
+// a profile value, also when it is stored as a string like in the old default.json
+static double ProfileValue(JsonVariant value, double fallback) {
+  if (value.is<const char *>()) return atof(value.as<const char *>());
+  return value | fallback;
+}
+
+// a profile file like ProfileFromJson() in main.cpp reads it, what is wrong or ""
+String ReadProfile(const String &path, ProfileFile &profile) {
+  std::ifstream file(path.c_str());
+  if (!file) return "cannot open " + path;
+  std::stringstream text;
+  text << file.rdbuf();
+  JsonDocument doc;
+  if (deserializeJson(doc, text.str().c_str())) return path + " is not JSON";
+
+  profile.name = path;
+  if (!doc["segments"].isNull()) return SegmentsFromJson(doc["segments"], profile);
+  const float temps[4] = {(float)ProfileValue(doc["preheatTemp"], 100.0), (float)ProfileValue(doc["soakTemp"], 150.0),
+                          (float)ProfileValue(doc["reflowTemp"], 230.0), (float)ProfileValue(doc["cooldownTemp"], 25.0)};
+  const uint32_t times[4] = {(uint32_t)ProfileValue(doc["preheatTime"], 120000), (uint32_t)ProfileValue(doc["soakTime"], 60000),
+                             (uint32_t)ProfileValue(doc["reflowTime"], 120000), (uint32_t)ProfileValue(doc["cooldownTime"], 120000)};
+  profile.count = ProfileEngine::FromPhases(temps, times, ProfileValue(doc["rampRate"], 0.0),
+                                            ProfileValue(doc["coolRate"], 0.0), profile.segments);
+  return "";
+}
+
+String ParseSegments(const char *json, ProfileFile &profile) {
+  JsonDocument doc;
+  String text = "{\"segments\":" + String(json) + "}";
+  if (deserializeJson(doc, text.c_str())) return "segments are not JSON";
+  return SegmentsFromJson(doc["segments"], profile);
+}
+
+void DefaultProfile(ProfileFile &profile) {
+  static const ProfileSegment segments[4] = {
+    {SEGMENT_HOLD, PHASE_PREHEAT, 0, 100, 0, 120000},
+    {SEGMENT_HOLD, PHASE_SOAK, 0, 150, 0, 60000},
+    {SEGMENT_HOLD, PHASE_REFLOW, 0, 230, 0, 120000},
+    {SEGMENT_HOLD, PHASE_COOLDOWN, 0, 25, 0, 120000},
+  };
+  profile.name = "default";
+  memcpy(profile.segments, segments, sizeof(segments));
+  profile.count = 4;
+}
@@ -0,0 +1,24 @@
+#ifndef ProfileFile_h
+#define ProfileFile_h
+
+#include <Arduino.h>
+#include <ProfileEngine.h>
+
+// Profiles for the host tools (the sweep and the model identification), read
+// from the JSON files of data/profiles or a --segments argument the way the
+// firmware reads them, see ProfileFromJson() and SegmentsFromJson() in main.cpp.
+
+struct ProfileFile {
+  String name;
+  ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+  uint8_t count;
+};
+
+// {"segments": [...]} or the four phases of older profiles, what is wrong or ""
+String ReadProfile(const String &path, ProfileFile &profile);
+// a JSON array of segments in the format of POST /config, what is wrong or ""
+String ParseSegments(const char *json, ProfileFile &profile);
+// profileSegments in main.cpp
+void DefaultProfile(ProfileFile &profile);
+
+#endif
@@ -0,0 +1,333 @@
+// ===================================================================
+// |                Offline PID and profile sweep                    |
+// ===================================================================
+// Runs the firmware's control path (see SweepRun.h) against the simulated
+// oven for every combination of the values given, on every core, and ranks
+// the combinations by how they reflowed the profiles.
+//
+//   .pio/build/sweep/program [--profile data/profiles/default.json]... [--segments '[...]']
+//                            [--kp 0.02:0.2:10] [--ki 0,0.001] [--kd 0:0.02:5]
+//                            [--bound 10] [--heater burst] [--min-on 100,250] [--pwm 500]
+//                            [--tolerance 5]
+//                            [--weights 1,1,1,1] [--model oven.json] [--seed 1] [--max 3600]
+//                            [--threads 0] [--top 10] [--out ranked.csv] [--pareto front.csv]
+//
+// Each of --kp, --ki, --kd (in the firmware's units, like setPID), --bound
+// (C, the integral bounds +-), --min-on (ms, the minimum on and off time of
+// the bursts) and --pwm (ms, the slow PWM period) takes one value, a comma
+// separated list or first:last:count for count values evenly spaced. --heater
+// switches the relay like setHeater, burst or pwm; only the axis of its mode
+// may have more than one value. Every combination runs every profile: JSON files in the format of
+// data/profiles (segments or the four phases of older profiles) and
+// --segments arrays in the format of POST /config; the default profile of the
+// firmware when none is given.
+//
+// A run is scored on its overshoot, the share of the heating time within
+// --tolerance of the setpoint, its cycle time and its relay switches; with
+// several profiles the worst overshoot, the mean share and the sums count.
+// The ranking weighs them by --weights: at 1,1,1,1 one C of overshoot counts
+// as much as 10 % of the time out of tolerance, a minute of cycle time or 100
+// relay switches. Runs that did not finish (over temperature, an until
+// segment that timed out, longer than --max s) rank last. The Pareto front
+// is every finished combination no other one beats on all four at once.
+//
+// --model runs an oven fitted to a recorded run by src/identify instead of
+// the default one. --threads 0 runs one thread per core. The table goes to stdout, --out and
+// --pareto write all ranked combinations and the front as CSV.
+
+#include <Arduino.h>
+#include <OvenModelFile.h>
+#include <WorkPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <vector>
+
+#include "Board.h"
+#include "ProfileFile.h"
+#include "SweepRun.h"
+
+struct SweepOptions {
+  std::vector<double> kp = {0.05}, ki = {0}, kd = {0.005}, bound = {10}, minOn = {250}, pwm = {500};
+  HeaterMode heater = HEATER_BURST;
+  std::vector<ProfileFile> profiles;
+  double weights[4] = {1, 1, 1, 1}; // overshoot, tolerance, cycle time, switches
+  float tolerance = 5;
+  OvenModel oven;
+  double maxSeconds = 3600;
+  uint32_t seed = 1;
+  unsigned threads = 0;
+  size_t top = 10;
+  String out, pareto;
+};
+
+struct SweepResult {
+  SweepParams params;
+  SweepScore score; // over all profiles
+  double rank;      // weighted score, lower is better, INFINITY when a run failed
+  bool front;       // on the Pareto front
+};
+
+// one value, a list "a,b,c" or a range "first:last:count"
+static bool ParseValues(const char *text, std::vector<double> &values) {
+  values.clear();
+  double first, last;
+  int count, used = 0;
+  if (sscanf(text, "%lf:%lf:%d%n", &first, &last, &count, &used) == 3 && text[used] == 0) {
+    if (count < 1) return false;
+    for (int i = 0; i < count; i++) values.push_back(count == 1 ? first : first + (last - first) * i / (count - 1));
+    return true;
+  }
+  std::stringstream list(text);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    char *end;
+    double value = strtod(item.c_str(), &end);
+    if (end == item.c_str() || *end) return false;
+    values.push_back(value);
+  }
+  return !values.empty();
+}
+
+static bool ParseArgs(int argc, char **argv, SweepOptions &opt) {
+  for (int i = 1; i < argc; i++) {
+    String arg = argv[i];
+    bool hasValue = i + 1 < argc, ok = hasValue;
+    if (arg == "--kp" && hasValue) ok = ParseValues(argv[++i], opt.kp);
+    else if (arg == "--ki" && hasValue) ok = ParseValues(argv[++i], opt.ki);
+    else if (arg == "--kd" && hasValue) ok = ParseValues(argv[++i], opt.kd);
+    else if (arg == "--bound" && hasValue) ok = ParseValues(argv[++i], opt.bound);
+    else if (arg == "--min-on" && hasValue) ok = ParseValues(argv[++i], opt.minOn);
+    else if (arg == "--pwm" && hasValue) ok = ParseValues(argv[++i], opt.pwm);
+    else if (arg == "--heater" && hasValue) ok = HeaterModulator::ParseMode(argv[++i], opt.heater);
+    else if (arg == "--tolerance" && hasValue) opt.tolerance = atof(argv[++i]);
+    else if (arg == "--seed" && hasValue) opt.seed = (uint32_t)atol(argv[++i]);
+    else if (arg == "--max" && hasValue) opt.maxSeconds = atof(argv[++i]);
+    else if (arg == "--threads" && hasValue) opt.threads = (unsigned)atoi(argv[++i]);
+    else if (arg == "--top" && hasValue) opt.top = strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--out" && hasValue) opt.out = argv[++i];
+    else if (arg == "--pareto" && hasValue) opt.pareto = argv[++i];
+    else if (arg == "--model" && hasValue) {
+      String error = ReadOvenModel(argv[++i], opt.oven);
+      if (error.length()) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+      }
+    } else if (arg == "--weights" && hasValue) {
+      ok = sscanf(argv[++i], "%lf,%lf,%lf,%lf", &opt.weights[0], &opt.weights[1], &opt.weights[2], &opt.weights[3]) == 4;
+    } else if ((arg == "--profile" || arg == "--segments") && hasValue) {
+      ProfileFile profile;
+      String error;
+      if (arg == "--profile") {
+        error = ReadProfile(argv[++i], profile);
+      } else {
+        profile.name = "--segments " + String((int)opt.profiles.size() + 1);
+        error = ParseSegments(argv[++i], profile);
+      }
+      if (error.length()) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+      }
+      opt.profiles.push_back(profile);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "Unknown, incomplete or invalid option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+
+  for (const std::vector<double> *times : {&opt.minOn, &opt.pwm}) {
+    for (double ms : *times) {
+      if (!(ms > 0)) {
+        fprintf(stderr, "--min-on and --pwm must be positive\n");
+        return false;
+      }
+    }
+  }
+  // the axis of the other mode would only repeat the same runs
+  if (opt.heater == HEATER_BURST && opt.pwm.size() > 1) {
+    fprintf(stderr, "--pwm lists need --heater pwm\n");
+    return false;
+  }
+  if (opt.heater == HEATER_SLOW_PWM && opt.minOn.size() > 1) {
+    fprintf(stderr, "--min-on lists need --heater burst\n");
+    return false;
+  }
+
+  if (opt.profiles.empty()) {
+    ProfileFile profile;
+    DefaultProfile(profile);
+    opt.profiles.push_back(profile);
+  }
+  return true;
+}
+
+// a beats b on every objective, or ties: lower overshoot, higher share in tolerance, shorter cycle, fewer switches
+static bool Dominates(const SweepScore &a, const SweepScore &b) {
+  return a.overshoot <= b.overshoot && a.inTolerance >= b.inTolerance && a.cycleTime <= b.cycleTime &&
+         a.switches <= b.switches;
+}
+
+// Marks the front. In the order by overshoot, then the other objectives, a
+// combination can only be beaten by one before it, and whatever beats it is
+// itself beaten by, or is, one on the front so far.
+static void MarkFront(std::vector<SweepResult> &results) {
+  std::vector<SweepResult *> order;
+  for (SweepResult &result : results) {
+    if (!result.score.failure[0]) order.push_back(&result);
+  }
+  std::sort(order.begin(), order.end(), [](const SweepResult *a, const SweepResult *b) {
+    const SweepScore &x = a->score, &y = b->score;
+    if (x.overshoot != y.overshoot) return x.overshoot < y.overshoot;
+    if (x.inTolerance != y.inTolerance) return x.inTolerance > y.inTolerance;
+    if (x.cycleTime != y.cycleTime) return x.cycleTime < y.cycleTime;
+    return x.switches < y.switches;
+  });
+  std::vector<SweepResult *> front;
+  for (SweepResult *candidate : order) {
+    bool beaten = false;
+    for (SweepResult *member : front) {
+      if (Dominates(member->score, candidate->score)) {
+        beaten = true;
+        break;
+      }
+    }
+    if (!beaten) {
+      candidate->front = true;
+      front.push_back(candidate);
+    }
+  }
+}
+
+static const char *CSV_HEADER = "rank,kp,ki,kd,bound,min_on,pwm,overshoot,in_tolerance,cycle_s,switches,energy_kj,score,pareto,failure\n";
+
+static void PrintResult(FILE *out, size_t rank, const SweepResult &result, bool csv) {
+  const SweepParams &p = result.params;
+  const SweepScore &s = result.score;
+  const char *format = csv ? "%zu,%g,%g,%g,%g,%lu,%lu,%.2f,%.3f,%.1f,%lu,%.1f,%.3f,%d,%s\n"
+                           : "%5zu %9.4g %9.4g %9.4g %6g %6lu %5lu %9.2f %8.1f%% %8.1f %8lu %8.1f %8.3f %s%s\n";
+  if (csv) {
+    fprintf(out, format, rank, p.kp, p.ki, p.kd, p.integralBound, (unsigned long)p.minOn, (unsigned long)p.pwmPeriod,
+            s.overshoot, s.inTolerance, s.cycleTime, s.switches, s.energy, result.rank, result.front ? 1 : 0, s.failure);
+  } else {
+    fprintf(out, format, rank, p.kp, p.ki, p.kd, p.integralBound, (unsigned long)p.minOn, (unsigned long)p.pwmPeriod,
+            s.overshoot,
+            s.inTolerance * 100, s.cycleTime, s.switches, s.energy, result.rank, result.front ? "pareto " : "",
+            s.failure);
+  }
+}
+
+static void PrintTableHeader() {
+  printf(" rank        kp        ki        kd  bound min on   pwm overshoot in toler.  cycle s switches   energy    score\n");
+}
+
+static bool WriteCsv(const String &path, const std::vector<SweepResult> &ranked, bool frontOnly) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file) return false;
+  fputs(CSV_HEADER, file);
+  for (size_t i = 0; i < ranked.size(); i++) {
+    if (!frontOnly || ranked[i].front) PrintResult(file, i + 1, ranked[i], true);
+  }
+  return fclose(file) == 0;
+}
+
+int main(int argc, char **argv) {
+  SweepOptions opt;
+  if (!ParseArgs(argc, argv, opt)) return 2;
+
+  SweepSetup setup;
+  ThermistorParams thermistor; // SetupThermistor() with Board.h
+  thermistor.nominal = THERMISTORNOMINAL;
+  thermistor.nominalTemp = TEMPERATURENOMINAL;
+  thermistor.beta = BCOEFFICIENT;
+  thermistor.seriesResistor = SERIESRESISTOR;
+  thermistor.adcMax = ADC_MAX_VALUE;
+  setup.table.Build(thermistor);
+  setup.oven = opt.oven;
+  setup.tolerance = opt.tolerance;
+  setup.maxMs = (uint32_t)(opt.maxSeconds * 1000);
+  setup.seed = opt.seed;
+  setup.heater = opt.heater;
+
+  // the combinations in mixed radix, pwm the fastest
+  const std::vector<double> *axes[6] = {&opt.kp, &opt.ki, &opt.kd, &opt.bound, &opt.minOn, &opt.pwm};
+  size_t combinations = 1;
+  for (const std::vector<double> *axis : axes) combinations *= axis->size();
+  std::vector<SweepResult> results(combinations);
+
+  WorkPool pool(opt.threads);
+  size_t runs = combinations * opt.profiles.size();
+  for (const ProfileFile &profile : opt.profiles) {
+    fprintf(stderr, "profile %s: %u segments, %.0f s planned\n", profile.name.c_str(), (unsigned)profile.count,
+            ProfileEngine::PlannedDuration(profile.segments, profile.count, setup.oven.ambient) / 1000.0);
+  }
+  fprintf(stderr, "%zu combinations x %zu profiles on %u threads\n", combinations, opt.profiles.size(), pool.Threads());
+
+  auto wallStart = std::chrono::steady_clock::now();
+  pool.Run(combinations, [&](size_t index, unsigned) {
+    SweepResult &result = results[index];
+    double value[6];
+    for (int axis = 5; axis >= 0; axis--) {
+      value[axis] = (*axes[axis])[index % axes[axis]->size()];
+      index /= axes[axis]->size();
+    }
+    result.params = {value[0], value[1], value[2], (float)value[3], (uint32_t)value[5], (uint32_t)value[4]};
+
+    SweepScore &total = result.score;
+    total = {"", 0, 0, 0, 0, 0};
+    for (const ProfileFile &profile : opt.profiles) {
+      SweepScore score = SimulateRun(result.params, profile, setup);
+      if (!total.failure[0]) total.failure = score.failure;
+      total.overshoot = std::max(total.overshoot, score.overshoot);
+      total.inTolerance += score.inTolerance / opt.profiles.size();
+      total.cycleTime += score.cycleTime;
+      total.switches += score.switches;
+      total.energy += score.energy;
+    }
+    result.rank = total.failure[0] ? INFINITY
+                                   : opt.weights[0] * total.overshoot + opt.weights[1] * (1 - total.inTolerance) * 10 +
+                                       opt.weights[2] * total.cycleTime / 60 + opt.weights[3] * total.switches / 100.0;
+    result.front = false;
+  });
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  MarkFront(results);
+  std::stable_sort(results.begin(), results.end(),
+                   [](const SweepResult &a, const SweepResult &b) { return a.rank < b.rank || (a.rank == b.rank && a.front > b.front); });
+  size_t finished = 0, front = 0;
+  for (const SweepResult &result : results) {
+    finished += !result.score.failure[0];
+    front += result.front;
+  }
+
+  fprintf(stderr, "%zu runs in %.2f s: %.0f runs per minute, %lu ranges stolen\n", runs, wallSeconds,
+          runs / wallSeconds * 60, pool.Steals());
+  printf("%zu of %zu combinations finished every profile, %zu on the Pareto front\n", finished, combinations, front);
+  PrintTableHeader();
+  for (size_t i = 0; i < results.size() && i < opt.top; i++) PrintResult(stdout, i + 1, results[i], false);
+  printf("Pareto front (overshoot, time in tolerance, cycle time, relay switches):\n");
+  PrintTableHeader();
+  size_t shown = 0;
+  for (size_t i = 0; i < results.size() && shown < opt.top; i++) {
+    if (results[i].front) {
+      PrintResult(stdout, i + 1, results[i], false);
+      shown++;
+    }
+  }
+  if (front > shown) printf("  ... %zu more, see --pareto\n", front - shown);
+
+  if (opt.out.length() && !WriteCsv(opt.out, results, false)) {
+    fprintf(stderr, "cannot write %s\n", opt.out.c_str());
+    return 1;
+  }
+  if (opt.pareto.length() && !WriteCsv(opt.pareto, results, true)) {
+    fprintf(stderr, "cannot write %s\n", opt.pareto.c_str());
+    return 1;
+  }
+  return 0;
+}
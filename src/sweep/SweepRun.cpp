@@ -0,0 +1,115 @@
+#include "SweepRun.h"
+
+#include <PidCore.h>
+#include <SampleFilter.h>
+
+#include "Board.h"
+
+// The control path of main.cpp, keep these in step with it
+#define NUMSAMPLES 50
+#define MEDIANSAMPLES 9
+#define EMA_ALPHA 0.04
+#define SAMPLE_MS 10         // timeBetweenSamples
+#define PID_MS 250           // timeTempCheck
+#define MAX_SAFE_TEMP 300
+#define THERMISTOR_OPEN_MARGIN 20
+#define WARMUP_MS 1000       // the filter runs before the run starts, like it does after boot
+#define HEATER_SLOT_US (1000000UL / (2 * MAINS_HZ))
+
+// HeaterSlots() of main.cpp
+static uint16_t HeaterSlots(uint32_t ms) {
+  uint64_t slots = ((uint64_t)ms * 1000 + HEATER_SLOT_US / 2) / HEATER_SLOT_US;
+  return slots ? (uint16_t)(slots < UINT16_MAX ? slots : UINT16_MAX) : 1;
+}
+
+// the PID's clock is the run's, one per thread
+struct SweepClock {
+  static thread_local unsigned long now;
+  static unsigned long Now() { return now; }
+};
+thread_local unsigned long SweepClock::now = 0;
+
+SweepScore SimulateRun(const SweepParams &params, const ProfileFile &profile, const SweepSetup &setup) {
+  SweepScore score = {"", 0, 0, 0, 0, 0};
+  SimOven oven(setup.oven, ThermistorModel(), setup.seed);
+  SampleFilter<NUMSAMPLES, MEDIANSAMPLES> filter(FILTER_AVERAGE, EMA_ALPHA);
+
+  float average = 0, temperature = 0;
+  uint32_t t = 0; // ms since the oven was built, the run starts at WARMUP_MS
+  auto sample = [&]() {
+    average = filter.Add(oven.ReadAdcAt(t * 1000ULL));
+    temperature = setup.table.Lookup(average);
+    if (temperature < 20.0f) temperature = 20.0f;
+  };
+  for (; t < WARMUP_MS; t += SAMPLE_MS) sample();
+
+  ProfileEngine engine;
+  if (!engine.Load(profile.segments, profile.count)) {
+    score.failure = "Invalid profile";
+    return score;
+  }
+  engine.Start(temperature);
+
+  SweepClock::now = 0;
+  PidController<float, SweepClock> pid(params.kp, params.ki, params.kd, P_ON_E, DIRECT);
+  pid.SetOutputLimits(0, 1);
+  pid.SetSampleTime(SAMPLE_MS);
+  pid.SetIntegralBounds(-params.integralBound, params.integralBound);
+  pid.SetMode(AUTOMATIC, temperature);
+
+  HeaterModulator heater;
+  heater.SetMode(setup.heater);
+  heater.SetBurst(HeaterSlots(params.minOn), HeaterSlots(params.minOn));
+  heater.SetPwm(HeaterSlots(params.pwmPeriod), PWM_STEPS);
+  uint64_t nextSlot = 0; // us since the run started
+
+  float output = 0, setpoint = engine.Setpoint(), highestSetpoint = 0;
+  unsigned long heating = 0, inside = 0;
+  const uint32_t end = WARMUP_MS + setup.maxMs;
+
+  for (; t < end; t += CONTROL_PERIOD_MS) {
+    uint32_t elapsed = t - WARMUP_MS;
+    if (t % SAMPLE_MS == 0) sample();
+
+    // HandleSafety()
+    if (average > ADC_MAX_VALUE - THERMISTOR_OPEN_MARGIN) score.failure = "Thermistor open";
+    else if (temperature > MAX_SAFE_TEMP) score.failure = "Over temperature";
+    if (score.failure[0]) break;
+
+    // HandleProfile()
+    EngineState state = engine.Update(elapsed, temperature);
+    if (state == ENGINE_TIMEOUT) score.failure = "Temperature not reached";
+    if (state == ENGINE_DONE || state == ENGINE_TIMEOUT) break;
+    setpoint = engine.Setpoint();
+
+    // HandlePID(), the scores sample the oven as often as the history does
+    if (elapsed % PID_MS == 0) {
+      SweepClock::now = elapsed;
+      pid.Compute(temperature, setpoint);
+      output = pid.Output();
+
+      float sensor = oven.SensorTemp();
+      // like the simulation summary: only while heating, the oven lags a cooldown by design
+      if (setpoint > highestSetpoint) highestSetpoint = setpoint;
+      if (setpoint >= highestSetpoint) {
+        if (sensor - setpoint > score.overshoot) score.overshoot = sensor - setpoint;
+        heating++;
+        if (fabsf(sensor - setpoint) <= setup.tolerance) inside++;
+      }
+    }
+
+    // HandleHeater(), caught up like the schedule does; the oven only hears of changes
+    for (; nextSlot <= elapsed * 1000ULL; nextSlot += HEATER_SLOT_US) {
+      bool on = heater.Update(output);
+      if (on != oven.HeaterOn()) oven.SetHeaterAt(t * 1000ULL, on);
+    }
+  }
+  if (t >= end) score.failure = "Run too long";
+
+  oven.SetHeaterAt(t * 1000ULL, false);
+  score.inTolerance = heating ? (float)inside / heating : 0;
+  score.cycleTime = (t - WARMUP_MS) / 1000.0f;
+  score.switches = oven.RelaySwitches();
+  score.energy = oven.EnergyJoules() / 1000;
+  return score;
+}
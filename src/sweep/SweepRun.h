@@ -0,0 +1,49 @@
+#ifndef SweepRun_h
+#define SweepRun_h
+
+#include <Arduino.h>
+#include <HeaterModulator.h>
+#include <ProfileEngine.h>
+#include <SimOven.h>
+#include <ThermistorTable.h>
+
+#include "ProfileFile.h"
+#include "Tasks.h"
+
+// One simulated reflow run for the parameter sweep: the control path of the
+// firmware (filter, thermistor table, profile engine, PID and heater on the
+// 5 ms control tick) driving its own SimOven on its own clock, so runs can go
+// on every core at once. The run starts from a cold oven and a fresh PID.
+
+#define PWM_STEPS 10 // of the slow PWM, as in main.cpp
+
+// the parameters a sweep varies, Ki and Kd in the firmware's units like setPID
+struct SweepParams {
+  double kp, ki, kd;
+  float integralBound;  // C, the PID resets its integral beyond this error
+  uint32_t pwmPeriod;   // ms, of the slow PWM
+  uint32_t minOn;       // ms, the minimum on and off time of bursts
+};
+
+// what is the same for every run
+struct SweepSetup {
+  OvenModel oven;
+  ThermistorTable table;   // built from Board.h like SetupThermistor()
+  float tolerance = 5;     // C around the setpoint that counts as in tolerance
+  uint32_t maxMs = 3600000;
+  uint32_t seed = 1;       // ADC noise, the same for every run so they compare fairly
+  HeaterMode heater = HEATER_BURST; // like setHeater
+};
+
+struct SweepScore {
+  const char *failure;     // why the run did not finish, "" when it did
+  float overshoot;         // C, largest sensor reading above the setpoint while heating
+  float inTolerance;       // share of the heating samples within the tolerance
+  float cycleTime;         // s until the profile was done
+  unsigned long switches;  // relay switches
+  float energy;            // kJ
+};
+
+SweepScore SimulateRun(const SweepParams &params, const ProfileFile &profile, const SweepSetup &setup);
+
+#endif
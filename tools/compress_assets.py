@@ -0,0 +1,118 @@
+# Builds the LittleFS image directory from data/.
+#
+# Files under static/ are stored gzipped when that makes them at least 10%
+# smaller (the PNG logo does not, it stays as is) and get a content-hash ETag.
+# index.html references the other assets with "?v=<hash>", so those can be
+# cached by the browser for a year; index.html itself is revalidated and
+# answered with 304 Not Modified when unchanged. Everything is listed in
+# static/assets.txt, which the firmware reads at boot:
+#
+#   <path> "<etag>" <gz|raw> <immutable|revalidate>
+#
+# Everything outside static/ (the profiles) is copied unchanged.
+#
+# PlatformIO runs it before every build (extra_scripts in platformio.ini) and
+# points uploadfs at the output, set custom_minify_assets = yes to also strip
+# indentation and blank lines from html/css/js. By hand:
+#
+#   python tools/compress_assets.py [data] [.pio/assets] [--minify]
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+TEXT_TYPES = (".html", ".css", ".js", ".json", ".svg", ".txt")
+MANIFEST = "assets.txt"
+
+
+def minify(data):
+    # only whitespace at the start and end of lines: safe for html, css and js
+    lines = (line.strip() for line in data.decode("utf-8").splitlines())
+    return ("\n".join(line for line in lines if line) + "\n").encode("utf-8")
+
+
+def etag(data):
+    return hashlib.sha1(data).hexdigest()[:16]
+
+
+def build(source, output, minify_text=False):
+    if os.path.isdir(output):
+        shutil.rmtree(output)
+    shutil.copytree(source, output, ignore=shutil.ignore_patterns("static"))
+
+    static_source = os.path.join(source, "static")
+    assets = {}  # fs path -> content
+    for directory, _, files in os.walk(static_source):
+        for name in sorted(files):
+            host_path = os.path.join(directory, name)
+            fs_path = "/static/" + os.path.relpath(host_path, static_source).replace(os.sep, "/")
+            with open(host_path, "rb") as f:
+                data = f.read()
+            if minify_text and name.endswith(TEXT_TYPES):
+                data = minify(data)
+            assets[fs_path] = data
+
+    # the pages pin the version of what they reference, so those never go stale
+    hashes = {path: etag(data) for path, data in assets.items() if not path.endswith(".html")}
+    immutable = set()
+
+    def pin(match):
+        path = "/" + match.group(2).lstrip("/")
+        if path not in hashes:
+            return match.group(0)
+        immutable.add(path)
+        return "%s%s?v=%s%s" % (match.group(1), match.group(2), hashes[path][:8], match.group(3))
+
+    for path, data in assets.items():
+        if path.endswith(".html"):
+            text = data.decode("utf-8")
+            text = re.sub(r'((?:src|href)=")(/?static/[^"?#]+)(")', pin, text)
+            assets[path] = text.encode("utf-8")
+
+    manifest = []
+    raw_bytes = stored_bytes = 0
+    for path, data in sorted(assets.items()):
+        target = os.path.join(output, path.lstrip("/"))
+        os.makedirs(os.path.dirname(target), exist_ok=True)
+
+        packed = gzip.compress(data, compresslevel=9, mtime=0)  # mtime 0: same input, same image
+        use_gzip = len(packed) <= len(data) * 0.9
+        with open(target + (".gz" if use_gzip else ""), "wb") as f:
+            f.write(packed if use_gzip else data)
+
+        manifest.append('%s "%s" %s %s' % (path, etag(data), "gz" if use_gzip else "raw",
+                                            "immutable" if path in immutable else "revalidate"))
+        raw_bytes += len(data)
+        stored_bytes += len(packed) if use_gzip else len(data)
+        print("  %-40s %8d -> %8d bytes%s" % (path, len(data), len(packed) if use_gzip else len(data),
+                                              " (gzip)" if use_gzip else ""))
+
+    with open(os.path.join(output, "static", MANIFEST), "w", newline="\n") as f:
+        f.write("\n".join(manifest) + "\n")
+    print("  static assets %d -> %d bytes" % (raw_bytes, stored_bytes))
+
+
+def main(argv):
+    minify_text = "--minify" in argv
+    paths = [arg for arg in argv if not arg.startswith("--")]
+    source = paths[0] if len(paths) > 0 else "data"
+    output = paths[1] if len(paths) > 1 else os.path.join(".pio", "assets")
+    build(source, output, minify_text)
+
+
+try:
+    Import("env")  # noqa: F821, run by PlatformIO
+except NameError:
+    if __name__ == "__main__":
+        main(sys.argv[1:])
+else:
+    project = env.subst("$PROJECT_DIR")  # noqa: F821
+    source = env.subst("$PROJECT_DATA_DIR")  # noqa: F821
+    output = os.path.join(project, ".pio", "assets")
+    minify_text = env.GetProjectOption("custom_minify_assets", "no") in ("yes", "true", "1")  # noqa: F821
+    print("Building the filesystem image directory %s from %s" % (output, source))
+    build(source, output, minify_text)
+    env.Replace(PROJECT_DATA_DIR=output)  # noqa: F821